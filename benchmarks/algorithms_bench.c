@@ -0,0 +1,147 @@
+// Benchmark for the algorithms package: sorts on a million-element list, and
+// reduction throughput in GB/s against the previous pointer-chasing loop.
+// Build and run with: make bench
+
+#define _GNU_SOURCE
+#include "../include/ast.h"
+#include "../include/simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+ASTNode *tesseract_quick_sort(ASTNode **args, int arg_count);
+ASTNode *tesseract_merge_sort(ASTNode **args, int arg_count);
+ASTNode *tesseract_radix_sort(ASTNode **args, int arg_count);
+ASTNode *tesseract_parallel_sort(ASTNode **args, int arg_count);
+ASTNode *tesseract_find_max(ASTNode **args, int arg_count);
+ASTNode *tesseract_list_sum(ASTNode **args, int arg_count);
+
+#define SORT_COUNT 1000000
+#define REDUCE_COUNT 4000000
+#define REDUCE_REPEATS 10
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Small deterministic generator so runs are comparable
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+static unsigned int next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned int)(rng_state >> 16);
+}
+
+static ASTNode *random_list(int count)
+{
+    ASTNode *list = ast_new_list();
+    list->list.elements = malloc(sizeof(ASTNode *) * count);
+    for (int i = 0; i < count; i++)
+        list->list.elements[i] = ast_new_number((double)next_random() - 2147483648.0);
+    list->list.count = count;
+    return list;
+}
+
+static int is_sorted(ASTNode *list)
+{
+    for (int i = 1; i < list->list.count; i++)
+        if (list->list.elements[i - 1]->number > list->list.elements[i]->number)
+            return 0;
+    return 1;
+}
+
+static void run_sort(const char *name, ASTNode *(*sort)(ASTNode **, int))
+{
+    ASTNode *list = random_list(SORT_COUNT);
+    ASTNode *args[] = {list};
+    double start = now_ms();
+    ast_free(sort(args, 1));
+    double elapsed = now_ms() - start;
+    printf("%-32s %10.1f ms  (%s)\n", name, elapsed, is_sorted(list) ? "sorted" : "NOT SORTED");
+    ast_free(list);
+}
+
+// find_max as it was before the SIMD kernels: one pointer dereference per element
+static ASTNode *legacy_find_max(ASTNode **args, int arg_count)
+{
+    (void)arg_count;
+    ASTNode *list = args[0];
+    double max_val = list->list.elements[0]->number;
+    for (int i = 1; i < list->list.count; i++)
+        if (list->list.elements[i]->type == NODE_NUMBER && list->list.elements[i]->number > max_val)
+            max_val = list->list.elements[i]->number;
+    return ast_new_number(max_val);
+}
+
+static void print_throughput(const char *name, double elapsed_ms, double checksum)
+{
+    double gigabytes = (double)REDUCE_COUNT * sizeof(double) * REDUCE_REPEATS / 1e9;
+    printf("%-32s %10.2f GB/s  (%g)\n", name, gigabytes / (elapsed_ms / 1000.0), checksum);
+}
+
+static void run_list_reduction(const char *name, ASTNode *(*reduce)(ASTNode **, int), ASTNode *list)
+{
+    ASTNode *args[] = {list};
+    double checksum = 0;
+    double start = now_ms();
+    for (int r = 0; r < REDUCE_REPEATS; r++)
+    {
+        ASTNode *result = reduce(args, 1);
+        checksum = result->number;
+        ast_free(result);
+    }
+    print_throughput(name, now_ms() - start, checksum);
+}
+
+static void run_kernel(const char *backend, const double *values)
+{
+    if (!simd_set_backend(backend))
+    {
+        printf("%-32s not supported on this CPU\n", backend);
+        return;
+    }
+    char name[64];
+    double checksum = 0;
+    double start = now_ms();
+    for (int r = 0; r < REDUCE_REPEATS; r++)
+        checksum = simd_sum(values, REDUCE_COUNT);
+    snprintf(name, sizeof(name), "simd_sum packed (%s)", backend);
+    print_throughput(name, now_ms() - start, checksum);
+
+    start = now_ms();
+    for (int r = 0; r < REDUCE_REPEATS; r++)
+        checksum = simd_max(values, REDUCE_COUNT);
+    snprintf(name, sizeof(name), "simd_max packed (%s)", backend);
+    print_throughput(name, now_ms() - start, checksum);
+}
+
+int main(void)
+{
+    printf("Sorting %d random numbers\n", SORT_COUNT);
+    run_sort("quick_sort (introsort)", tesseract_quick_sort);
+    run_sort("merge_sort (stable)", tesseract_merge_sort);
+    run_sort("radix_sort (LSD)", tesseract_radix_sort);
+    run_sort("parallel_sort", tesseract_parallel_sort);
+
+    printf("\nReducing %d numbers %d times (default backend: %s)\n", REDUCE_COUNT, REDUCE_REPEATS,
+           simd_backend());
+    ASTNode *list = random_list(REDUCE_COUNT);
+    run_list_reduction("find_max (previous loop)", legacy_find_max, list);
+    run_list_reduction("find_max", tesseract_find_max, list);
+    run_list_reduction("list_sum", tesseract_list_sum, list);
+
+    double *packed = malloc(sizeof(double) * REDUCE_COUNT);
+    for (int i = 0; i < REDUCE_COUNT; i++)
+        packed[i] = list->list.elements[i]->number;
+    run_kernel("scalar", packed);
+    run_kernel("sse2", packed);
+    run_kernel("avx2", packed);
+    free(packed);
+    ast_free(list);
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Benchmark for the graph_algorithms package on a synthetic million-edge graph.
+// Build and run with: make bench
+
+#define _GNU_SOURCE
+#include "../include/ast.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+ASTNode *tesseract_dijkstra(ASTNode **args, int arg_count);
+ASTNode *tesseract_bfs_distances(ASTNode **args, int arg_count);
+ASTNode *tesseract_topological_sort(ASTNode **args, int arg_count);
+ASTNode *tesseract_connected_components(ASTNode **args, int arg_count);
+ASTNode *tesseract_strongly_connected_components(ASTNode **args, int arg_count);
+ASTNode *tesseract_pagerank(ASTNode **args, int arg_count);
+
+#define VERTEX_COUNT 250000
+#define EDGE_COUNT 1000000
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Small deterministic generator so runs are comparable
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+static unsigned int next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned int)(rng_state >> 16);
+}
+
+static void run(const char *name, ASTNode *(*func)(ASTNode **, int), ASTNode **args, int arg_count)
+{
+    double start = now_ms();
+    ASTNode *result = func(args, arg_count);
+    double elapsed = now_ms() - start;
+    int size = result->type == NODE_DICT ? result->dict.count : result->type == NODE_LIST ? result->list.count : 0;
+    printf("%-32s %10.1f ms  (%d results)\n", name, elapsed, size);
+    ast_free(result);
+}
+
+int main(void)
+{
+    ASTNode *graph = ast_new_graph();
+    // The same edges pointed from the lower vertex to the higher, which has no
+    // cycle for topological_sort to reject
+    ASTNode *dag = ast_new_graph();
+
+    double start = now_ms();
+    for (int v = 0; v < VERTEX_COUNT; v++)
+    {
+        ast_graph_add_vertex(graph, ast_new_number(v));
+        ast_graph_add_vertex(dag, ast_new_number(v));
+    }
+    for (int e = 0; e < EDGE_COUNT; e++)
+    {
+        int from = next_random() % VERTEX_COUNT;
+        int to = next_random() % VERTEX_COUNT;
+        double weight = 1 + next_random() % 100;
+        ast_graph_add_edge(graph, from, to, weight);
+        if (from != to)
+            ast_graph_add_edge(dag, from < to ? from : to, from < to ? to : from, weight);
+    }
+    printf("%-32s %10.1f ms  (%d vertices, %d edges)\n", "build", now_ms() - start,
+           graph->graph.vertex_count, graph->graph.edge_count);
+
+    start = now_ms();
+    ast_graph_freeze(graph);
+    printf("%-32s %10.1f ms\n", "freeze (CSR)", now_ms() - start);
+
+    ASTNode *source = ast_new_number(0);
+    ASTNode *with_source[] = {graph, source};
+    ASTNode *graph_only[] = {graph};
+    ASTNode *dag_only[] = {dag};
+
+    run("dijkstra", tesseract_dijkstra, with_source, 2);
+    run("bfs_distances", tesseract_bfs_distances, with_source, 2);
+    run("topological_sort (acyclic)", tesseract_topological_sort, dag_only, 1);
+    run("connected_components", tesseract_connected_components, graph_only, 1);
+    run("strongly_connected_components", tesseract_strongly_connected_components, graph_only, 1);
+    run("pagerank (100 iterations)", tesseract_pagerank, graph_only, 1);
+
+    ast_free(source);
+    ast_free(graph);
+    ast_free(dag);
+    return 0;
+}
@@ -0,0 +1,155 @@
+// Benchmark for the ndarray_utils package: matrix product against nested lists
+// and a naive triple loop, plus broadcasting and axis reductions.
+// Build and run with: make bench
+
+#define _GNU_SOURCE
+#include "../include/ast.h"
+#include "../include/ndarray.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+ASTNode *tesseract_nd_array(ASTNode **args, int arg_count);
+ASTNode *tesseract_nd_matmul(ASTNode **args, int arg_count);
+ASTNode *tesseract_nd_add(ASTNode **args, int arg_count);
+ASTNode *tesseract_nd_sum(ASTNode **args, int arg_count);
+
+#define MATRIX_SIZE 512
+#define LIST_MATRIX_SIZE 128
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Small deterministic generator so runs are comparable
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+static double next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (double)(rng_state >> 11) / (double)(1ULL << 53);
+}
+
+// n x n matrix as a list of row lists, the way scripts build one today
+static ASTNode *random_list_matrix(int n)
+{
+    ASTNode *matrix = ast_new_list();
+    for (int i = 0; i < n; i++)
+    {
+        ASTNode *row = ast_new_list();
+        for (int j = 0; j < n; j++)
+            ast_list_add_element(row, ast_new_number(next_random()));
+        ast_list_add_element(matrix, row);
+    }
+    return matrix;
+}
+
+static ASTNode *random_array(int rows, int cols)
+{
+    int shape[2] = {rows, cols};
+    ASTNode *array = ndarray_new(2, shape);
+    double *data = ndarray_data(array);
+    for (long i = 0; i < (long)rows * cols; i++)
+        data[i] = next_random();
+    return array;
+}
+
+// Product of two list-of-lists matrices, reading every element through its node
+static double list_matmul(ASTNode *a, ASTNode *b, int n)
+{
+    double checksum = 0;
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+        {
+            double total = 0;
+            for (int p = 0; p < n; p++)
+                total += a->list.elements[i]->list.elements[p]->number *
+                         b->list.elements[p]->list.elements[j]->number;
+            checksum += total;
+        }
+    return checksum;
+}
+
+// Textbook i-j-p loop over packed arrays; B is read down its columns
+static double naive_matmul(const double *a, const double *b, double *c, int n)
+{
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+        {
+            double total = 0;
+            for (int p = 0; p < n; p++)
+                total += a[i * n + p] * b[p * n + j];
+            c[i * n + j] = total;
+        }
+    double checksum = 0;
+    for (long i = 0; i < (long)n * n; i++)
+        checksum += c[i];
+    return checksum;
+}
+
+static void print_gflops(const char *name, int n, double elapsed_ms, double checksum)
+{
+    double flops = 2.0 * n * n * n;
+    printf("%-36s %9.1f ms %8.2f GFLOP/s  (%g)\n", name, elapsed_ms, flops / (elapsed_ms * 1e6), checksum);
+}
+
+int main(void)
+{
+    printf("Matrix product, %dx%d\n", LIST_MATRIX_SIZE, LIST_MATRIX_SIZE);
+    ASTNode *list_a = random_list_matrix(LIST_MATRIX_SIZE);
+    ASTNode *list_b = random_list_matrix(LIST_MATRIX_SIZE);
+    double start = now_ms();
+    double checksum = list_matmul(list_a, list_b, LIST_MATRIX_SIZE);
+    print_gflops("nested lists", LIST_MATRIX_SIZE, now_ms() - start, checksum);
+
+    start = now_ms();
+    ASTNode *list_args[] = {list_a, list_b};
+    ASTNode *product = tesseract_nd_matmul(list_args, 2);
+    checksum = ndarray_reduce_all(product, ND_SUM);
+    print_gflops("nd_matmul on the lists (converts)", LIST_MATRIX_SIZE, now_ms() - start, checksum);
+    ast_free(product);
+    ast_free(list_a);
+    ast_free(list_b);
+
+    printf("\nMatrix product, %dx%d\n", MATRIX_SIZE, MATRIX_SIZE);
+    ASTNode *a = random_array(MATRIX_SIZE, MATRIX_SIZE);
+    ASTNode *b = random_array(MATRIX_SIZE, MATRIX_SIZE);
+    double *c = malloc(sizeof(double) * MATRIX_SIZE * MATRIX_SIZE);
+    start = now_ms();
+    checksum = naive_matmul(ndarray_data(a), ndarray_data(b), c, MATRIX_SIZE);
+    print_gflops("naive triple loop", MATRIX_SIZE, now_ms() - start, checksum);
+    free(c);
+
+    ASTNode *args[] = {a, b};
+    start = now_ms();
+    product = tesseract_nd_matmul(args, 2);
+    checksum = ndarray_reduce_all(product, ND_SUM);
+    print_gflops("nd_matmul (blocked)", MATRIX_SIZE, now_ms() - start, checksum);
+    ast_free(product);
+
+    printf("\nBroadcasting and reductions on %dx%d\n", MATRIX_SIZE, MATRIX_SIZE);
+    ASTNode *row = random_array(1, MATRIX_SIZE);
+    ASTNode *add_args[] = {a, row};
+    start = now_ms();
+    ASTNode *shifted = tesseract_nd_add(add_args, 2);
+    printf("%-36s %9.2f ms\n", "nd_add(matrix, row)", now_ms() - start);
+
+    ASTNode *axis = ast_new_number(0);
+    ASTNode *sum_args[] = {shifted, axis};
+    start = now_ms();
+    ASTNode *column_sums = tesseract_nd_sum(sum_args, 2);
+    printf("%-36s %9.2f ms  (%g)\n", "nd_sum(matrix, 0)", now_ms() - start,
+           ndarray_reduce_all(column_sums, ND_SUM));
+
+    ast_free(column_sums);
+    ast_free(axis);
+    ast_free(shifted);
+    ast_free(row);
+    ast_free(a);
+    ast_free(b);
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Benchmark for compiled regular expressions: testing and scanning a 10MB log for
+// a pattern, and a pattern that makes a backtracking matcher take exponential time
+// on a short text, which the Pike VM runs in time linear in the text.
+// Build and run with: make bench
+
+#define _GNU_SOURCE
+#include "../include/regex_vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LINE_COUNT 200000
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static RegexProgram *compile(const char *pattern)
+{
+    char error[128];
+    RegexProgram *program = regex_compile(pattern, 0, error, sizeof(error));
+    if (!program)
+    {
+        fprintf(stderr, "Bad pattern %s: %s\n", pattern, error);
+        exit(EXIT_FAILURE);
+    }
+    return program;
+}
+
+int main(void)
+{
+    // A log where one line in a thousand is an error
+    size_t capacity = (size_t)LINE_COUNT * 64;
+    char *log = malloc(capacity);
+    size_t length = 0;
+    for (int i = 0; i < LINE_COUNT; i++)
+        length += snprintf(log + length, capacity - length, "2024-05-%02d 12:%02d:%02d %s request %d took %dms\n",
+                           i % 28 + 1, i % 60, (i * 7) % 60, i % 1000 == 999 ? "ERROR" : "INFO", i, i % 250);
+
+    RegexProgram *error_line = compile("ERROR request \\d+ took \\d+ms");
+    double start = now_ms();
+    int found = regex_test(error_line, log, length);
+    printf("%-32s %10.1f ms  (%zu bytes, found %d)\n", "test, first match", now_ms() - start, length, found);
+
+    size_t match[4]; // The match and one group
+    int count = 0;
+    start = now_ms();
+    for (size_t pos = 0; regex_search(error_line, log, length, pos, match); pos = match[1])
+        count++;
+    printf("%-32s %10.1f ms  (%d matches)\n", "find all, sparse", now_ms() - start, count);
+    regex_free(error_line);
+
+    RegexProgram *timing = compile("took (\\d+)ms");
+    count = 0;
+    start = now_ms();
+    for (size_t pos = 0; regex_search(timing, log, length, pos, match); pos = match[1])
+        count++;
+    printf("%-32s %10.1f ms  (%d matches)\n", "find all, every line", now_ms() - start, count);
+    regex_free(timing);
+
+    // (a|aa)*c against a run of a's with no c: about 1.6^n paths for a backtracker
+    RegexProgram *nested = compile("(a|aa)*c");
+    char *run = malloc(100001);
+    memset(run, 'a', 100000);
+    run[100000] = '\0';
+    start = now_ms();
+    found = regex_test(nested, run, 100000);
+    printf("%-32s %10.1f ms  (found %d)\n", "(a|aa)*c on 100k a's", now_ms() - start, found);
+    regex_free(nested);
+
+    free(run);
+    free(log);
+    return 0;
+}
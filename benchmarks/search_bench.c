@@ -0,0 +1,124 @@
+// Benchmark for exact substring search over a 10MB log: one needle with the SIMD
+// byte pair filter against the byte-by-byte loop it replaces, and a list of
+// keywords with one Aho-Corasick pass against a search per keyword.
+// Build and run with: make bench
+
+#define _GNU_SOURCE
+#include "../include/text_search.h"
+#include "../include/simd.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LINE_COUNT 200000
+#define KEYWORD_COUNT 300
+#define RUNS 5 // Each timing is the fastest of this many, as single runs are noisy
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static size_t naive_count(const char *text, size_t length, const char *needle, size_t m)
+{
+    size_t count = 0;
+    for (size_t i = 0; i + m <= length; i++)
+    {
+        size_t j = 0;
+        while (j < m && text[i + j] == needle[j])
+            j++;
+        count += j == m;
+    }
+    return count;
+}
+
+static size_t find_count(const char *text, size_t length, const char *needle)
+{
+    TextNeedle compiled;
+    text_needle_init(&compiled, needle, strlen(needle));
+    size_t count = 0;
+    for (size_t pos = text_find(&compiled, text, length, 0); pos != TEXT_NONE;
+         pos = text_find(&compiled, text, length, pos + 1))
+        count++;
+    return count;
+}
+
+static void count_match(size_t start, int needle, void *ctx)
+{
+    (void)start;
+    (void)needle;
+    (*(size_t *)ctx)++;
+}
+
+int main(void)
+{
+    // A log where one line in a thousand is an error
+    size_t capacity = (size_t)LINE_COUNT * 64;
+    char *log = malloc(capacity);
+    size_t length = 0;
+    for (int i = 0; i < LINE_COUNT; i++)
+        length += snprintf(log + length, capacity - length, "2024-05-%02d 12:%02d:%02d %s request %d took %dms\n",
+                           i % 28 + 1, i % 60, (i * 7) % 60, i % 1000 == 999 ? "ERROR" : "INFO", i, i % 250);
+
+    const char *needle = "ERROR request";
+    size_t expected = 0, found = 0;
+    double best = 1e9;
+    for (int run = 0; run < RUNS; run++)
+    {
+        double start = now_ms();
+        expected = naive_count(log, length, needle, strlen(needle));
+        best = fmin(best, now_ms() - start);
+    }
+    printf("%-32s %10.1f ms  (%zu bytes, %zu matches)\n", "one needle, naive loop", best, length, expected);
+
+    best = 1e9;
+    for (int run = 0; run < RUNS; run++)
+    {
+        double start = now_ms();
+        found = find_count(log, length, needle);
+        best = fmin(best, now_ms() - start);
+    }
+    printf("%-32s %10.1f ms  (%zu matches, %s)\n", "one needle, byte pair filter", best, found, simd_backend());
+
+    // A needle whose end bytes are everywhere, so the filter hands over to Horspool
+    best = 1e9;
+    for (int run = 0; run < RUNS; run++)
+    {
+        double start = now_ms();
+        found = find_count(log, length, "2024-05-28 12:59:59 INFO");
+        best = fmin(best, now_ms() - start);
+    }
+    printf("%-32s %10.1f ms  (%zu matches)\n", "one needle, common pair", best, found);
+
+    // Keywords like "request 12345", only some of which occur
+    char (*keywords)[32] = malloc(sizeof(*keywords) * KEYWORD_COUNT);
+    const char *needles[KEYWORD_COUNT];
+    size_t lengths[KEYWORD_COUNT];
+    for (int i = 0; i < KEYWORD_COUNT; i++)
+    {
+        lengths[i] = snprintf(keywords[i], sizeof(keywords[i]), "request %d took", i * 997);
+        needles[i] = keywords[i];
+    }
+
+    double start = now_ms();
+    size_t separate = 0;
+    for (int i = 0; i < KEYWORD_COUNT; i++)
+        separate += find_count(log, length, needles[i]);
+    printf("%-32s %10.1f ms  (%zu matches)\n", "300 keywords, one by one", now_ms() - start, separate);
+
+    start = now_ms();
+    TextMatcher *matcher = text_matcher_new(needles, lengths, KEYWORD_COUNT);
+    size_t together = 0;
+    text_matcher_scan(matcher, log, length, count_match, &together);
+    printf("%-32s %10.1f ms  (%zu matches, %d states)\n", "300 keywords, Aho-Corasick", now_ms() - start, together,
+           matcher->states);
+    text_matcher_free(matcher);
+
+    free(keywords);
+    free(log);
+    return 0;
+}
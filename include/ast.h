@@ -2,6 +2,9 @@
 #define AST_H
 
 #include "lexer.h"
+#include "temporal_spec.h"
+#include "regex_vm.h"
+#include "text_search.h"
 
 typedef enum
 {
@@ -35,6 +38,7 @@ typedef enum
     NODE_LIST_POP,
     NODE_LIST_INSERT,
     NODE_LIST_REMOVE,
+    NODE_LIST_SLICE, // Zero-copy view of part of a list
     NODE_AND,
     NODE_OR,
     NODE_NOT,
@@ -43,6 +47,7 @@ typedef enum
     NODE_BITWISE_XOR,
     NODE_BITWISE_NOT,
     NODE_PATTERN_MATCH,
+    NODE_PATTERN_MATCH_ANY, // Occurrences of any of a list of needles
     NODE_FORMAT_STRING,
     NODE_NOP,
     NODE_CLASS_DEF,      // Class definition
@@ -75,6 +80,15 @@ typedef enum
     NODE_LINKED_LIST_GET,     // Get element from linked list
     NODE_LINKED_LIST_SIZE,    // Get size of linked list
     NODE_LINKED_LIST_ISEMPTY, // Check if linked list is empty
+    NODE_LINKED_LIST_PUSH_FRONT, // Prepend to linked list
+    NODE_LINKED_LIST_POP_FRONT,  // Remove and return first element
+    NODE_LINKED_LIST_POP_BACK,   // Remove and return last element
+    NODE_LINKED_LIST_CURSOR,     // Move the cursor to an index
+    NODE_LINKED_LIST_NEXT,       // Advance the cursor
+    NODE_LINKED_LIST_CURRENT,    // Element under the cursor
+    NODE_LINKED_LIST_INSERT,     // Insert before the cursor
+    NODE_LINKED_LIST_ERASE,      // Remove the element under the cursor
+    NODE_LINKED_LIST_SPLICE,     // Move all elements of one list onto another
     NODE_FILE_OPEN,
     NODE_FILE_READ,
     NODE_FILE_WRITE,
@@ -89,6 +103,8 @@ typedef enum
     NODE_REGEX_MATCH,    // Regex match operation
     NODE_REGEX_REPLACE,  // Regex replace operation
     NODE_REGEX_FIND_ALL, // Regex find all operation
+    NODE_REGEX_NEXT,     // First regex match from an offset
+    NODE_REGEX_GROUP,    // Number of a named regex group
     NODE_TERNARY,        // Ternary operator (condition ? true_val : false_val)
     NODE_TEMPORAL_VAR,   // Temporal variable access (x@2)
     NODE_TEMPORAL_LOOP,  // Temporal loop (temporal$i in x)
@@ -100,6 +116,15 @@ typedef enum
     NODE_TEMPORAL_QUERY,       // Temporal queries with time windows
     NODE_TEMPORAL_CORRELATE,   // Temporal correlations between variables
     NODE_TEMPORAL_INTERPOLATE, // Temporal interpolation for missing data
+    NODE_TEMPORAL_DOWNSAMPLE,  // Temporal downsampling into time buckets
+    NODE_TEMPORAL_CORRELATE_MATRIX, // Pairwise correlations across temporal variables
+    NODE_TEMPORAL_XCORR,       // Lagged cross-correlation of two temporal variables
+    NODE_TEMPORAL_NEW,         // Temporal variable creation (<temp@N> or <temp@N+M>)
+    NODE_TEMPORAL_PERSIST,     // Persist a temporal variable's history to a log file
+    NODE_TEMPORAL_FILL,        // Temporal history with missing samples filled in
+    NODE_TEMPORAL_RESAMPLE,    // Temporal history reduced onto a fixed time grid
+    NODE_TEMPORAL_TRIGGER,     // Callback run when writes move a temporal variable across a threshold
+    NODE_TEMPORAL_UNTRIGGER,   // Detach a trigger registered with the same condition and callback
     NODE_TRY,                  // Try block
     NODE_CATCH,                // Catch block
     NODE_THROW,                // Throw statement
@@ -129,6 +154,9 @@ typedef enum
     NODE_TREE_INORDER,         // Tree inorder traversal
     NODE_TREE_PREORDER,        // Tree preorder traversal
     NODE_TREE_POSTORDER,       // Tree postorder traversal
+    NODE_TREE_RANGE,           // Tree values within [lo, hi]
+    NODE_TREE_FLOOR,           // Largest tree value <= x
+    NODE_TREE_CEIL,            // Smallest tree value >= x
     NODE_GRAPH,                // Graph data structure
     NODE_GRAPH_ADD_VERTEX,     // Graph add vertex operation
     NODE_GRAPH_ADD_EDGE,       // Graph add edge operation
@@ -149,10 +177,72 @@ typedef enum
     NODE_SET_EMPTY,            // Set empty check operation
     NODE_SET_CLEAR,            // Set clear operation
     NODE_SET_COPY,             // Set copy operation
+    NODE_PVEC,                 // Persistent vector
+    NODE_PMAP,                 // Persistent hash map
+    NODE_PVEC_PUSH,            // Persistent vector append
+    NODE_PVEC_SET,             // Persistent vector replace at index
+    NODE_PVEC_POP,             // Persistent vector without its last element
+    NODE_PVEC_GET,             // Persistent vector element at index
+    NODE_PVEC_SIZE,            // Persistent vector length
+    NODE_PMAP_PUT,             // Persistent map with key set
+    NODE_PMAP_REMOVE,          // Persistent map without key
+    NODE_PMAP_GET,             // Persistent map lookup
+    NODE_PMAP_HAS,             // Persistent map membership
+    NODE_PMAP_SIZE,            // Persistent map entry count
+    NODE_NDARRAY,              // N-dimensional array of numbers (ndarray_utils package)
+    NODE_HEAP,                 // Priority queue
+    NODE_HEAP_PUSH,            // Heap insert, giving a handle
+    NODE_HEAP_POP,             // Heap remove first
+    NODE_HEAP_PEEK,            // Heap first element
+    NODE_HEAP_SIZE,            // Heap element count
+    NODE_HEAP_UPDATE,          // Change the priority behind a handle (decrease-key)
+    NODE_HEAP_KEY,             // Order a heap by a key function
+    NODE_HEAP_COMPARE,         // Order a heap by a comparator function
+    NODE_HEAPIFY,              // Heap built from a list
 } NodeType;
 
 typedef struct ASTNode ASTNode;
 
+#define NDARRAY_MAX_DIMS 8
+
+// AVL node backing <tree>
+typedef struct TreeNode
+{
+    double value;
+    int height;
+    struct TreeNode *left;
+    struct TreeNode *right;
+} TreeNode;
+
+typedef enum
+{
+    TREE_INORDER,
+    TREE_PREORDER,
+    TREE_POSTORDER
+} TreeOrder;
+
+typedef void (*TreeVisitor)(double value, void *ctx);
+
+// Per-vertex edge vector backing <graph>
+typedef struct
+{
+    int *targets;    // Dense vertex IDs
+    double *weights;
+    int count;
+    int capacity;
+    int *slots;      // Hash of target to position once there are many edges, else NULL
+    int slot_count;
+} GraphAdjacency;
+
+// Doubly linked list node. Nodes come from a shared pool, so splicing
+// between lists only relinks pointers.
+typedef struct LinkedNode
+{
+    ASTNode *value;
+    struct LinkedNode *prev;
+    struct LinkedNode *next;
+} LinkedNode;
+
 struct ASTNode
 {
     NodeType type;
@@ -248,6 +338,9 @@ struct ASTNode
         {
             ASTNode **elements;
             int count;
+            int stride; // Distance between elements; 1 except for strided slice views
+            int refs;   // Slice views sharing this list's storage
+            ASTNode *base; // Owning list when this is a slice view, NULL otherwise
         } list;
         struct
         {
@@ -259,11 +352,13 @@ struct ASTNode
             ASTNode *list;
             ASTNode *start;
             ASTNode *end;
+            ASTNode *step;
         } list_slice;
         struct
         {
             ASTNode *pattern;
             ASTNode *noise;
+            TextMatcher *matcher; // Built for the needles of the last call, reused while they stay the same
         } pattern_match;
         struct
         {
@@ -309,9 +404,12 @@ struct ASTNode
         } member_assign;
         struct
         {
-            ASTNode **keys;
+            ASTNode **keys;   // Entries in insertion order
             ASTNode **values;
             int count;
+            int capacity;     // Allocated entry slots
+            int *index;       // Open-addressing slots holding entry positions, -1 = empty
+            int index_size;   // Slot count, always a power of two
         } dict;
         struct
         {
@@ -354,7 +452,9 @@ struct ASTNode
         } queue_op;
         struct
         {
-            ASTNode **elements;
+            LinkedNode *head;
+            LinkedNode *tail;
+            LinkedNode *cursor; // Position for ::lnext / ::linsert / ::lerase, NULL past the end
             int count;
         } linked_list;
         struct
@@ -411,6 +511,7 @@ struct ASTNode
         {
             char pattern[256];
             char flags[16];
+            RegexProgram *program; // Compiled on first use
         } regex;
         struct
         {
@@ -429,6 +530,17 @@ struct ASTNode
             ASTNode *text;
         } regex_find_all;
         struct
+        {
+            ASTNode *regex;
+            ASTNode *text;
+            ASTNode *from;
+        } regex_next;
+        struct
+        {
+            ASTNode *regex;
+            ASTNode *name;
+        } regex_group;
+        struct
         {
             ASTNode *condition;
             ASTNode *true_expr;
@@ -449,18 +561,22 @@ struct ASTNode
         {
             char varname[64];     // Temporal variable name
             char operation[16];   // "sum", "avg", "min", "max"
+            int stat;             // TemporalStat for operation, -1 if it is not one of these
             ASTNode *window_size; // Size of sliding window
         } temporal_aggregate;
         struct
         {
             char varname[64];     // Temporal variable name
             char pattern_type[16]; // "trend", "cycle", "anomaly"
+            int has_spec;         // Whether pattern_type parsed
+            TemporalPatternSpec spec; // pattern_type, parsed when the node is built
             ASTNode *threshold;   // Threshold for pattern detection
         } temporal_pattern;
         struct
         {
             char varname[64];     // Temporal variable name
             char condition[64];   // Condition string (">", "<", "==", "between", etc.)
+            TemporalCondition predicate; // Condition compiled when the node is built
             ASTNode *start_index; // Starting position in history
             ASTNode *window_size; // Number of consecutive values to check
         } temporal_condition;
@@ -469,6 +585,7 @@ struct ASTNode
             char varname[64];     // Temporal variable name
             ASTNode *window_size; // Size of the sliding window
             char stat_type[16];   // "variance", "stddev", "range", "median"
+            int stat;             // TemporalStat for stat_type, -1 if it is not one of these
         } sliding_window_stats;
         struct
         {
@@ -481,6 +598,9 @@ struct ASTNode
             char varname[64];     // Temporal variable name
             char time_window[64]; // Time window specification ("last 5 minutes", "between 10:00 12:00")
             char condition[64];   // Condition to check
+            int has_span;         // Whether time_window parsed
+            TemporalSpan span;    // time_window, parsed when the node is built
+            TemporalCondition predicate; // condition, compiled when the node is built
         } temporal_query;
         struct
         {
@@ -494,6 +614,59 @@ struct ASTNode
             ASTNode *missing_index; // Index where data is missing
         } temporal_interpolate;
         struct
+        {
+            char varname[64];     // Temporal variable name
+            char bucket[32];      // Bucket width ("1m", "500ms")
+            char operation[16];   // Reduction applied to each bucket
+            long long bucket_ns;  // Bucket width, 0 if bucket did not parse
+            int stat;             // TemporalStat for operation, -1 if unknown
+        } temporal_downsample;
+        struct
+        {
+            ASTNode *names;       // List of temporal variable names
+            ASTNode *window_size; // Number of recent values to correlate
+            TemporalCorrelation *cache; // Sums kept from the last evaluation
+        } temporal_correlate_matrix;
+        struct
+        {
+            char var1[64];        // Leading temporal variable
+            char var2[64];        // Following temporal variable
+            ASTNode *window_size; // Number of values to correlate
+            ASTNode *max_lag;     // Largest lag to try
+        } temporal_xcorr;
+        struct
+        {
+            int max_history;      // Samples kept uncompressed
+            long long archived;   // Older samples kept compressed, 0 for none
+        } temporal_new;
+        struct
+        {
+            char varname[64];     // Temporal variable name
+            char path[256];       // Log file
+        } temporal_persist;
+        struct
+        {
+            char varname[64];     // Temporal variable name
+            char method[16];      // Fill method ("previous", "linear", "spline")
+            int fill;             // TemporalFill for method, -1 if unknown
+        } temporal_fill;
+        struct
+        {
+            char varname[64];     // Temporal variable name
+            char bucket[32];      // Grid spacing ("1m", "500ms")
+            char operation[16];   // Reduction applied to each bucket
+            long long bucket_ns;  // Grid spacing, 0 if bucket did not parse
+            int stat;             // TemporalStat for operation, -1 if unknown
+        } temporal_resample;
+        struct
+        {
+            char varname[64];     // Temporal variable name
+            char condition[64];   // "band 10 20", "rate 5/1s", "anomaly 3"
+            char callback[64];    // Function run on each change of state
+            int has_spec;         // Whether condition parsed
+            TemporalTriggerSpec spec; // condition, parsed when the node is built
+        } temporal_trigger;
+        struct
         {
             ASTNode *try_body;
             ASTNode **catch_blocks;
@@ -536,8 +709,12 @@ struct ASTNode
         } destructure;
         struct
         {
-            ASTNode **elements;
-            int count;
+            ASTNode **elements; // Members in insertion order, NULL where one was removed
+            int count;          // Members, not counting the holes
+            int removed;        // Holes in elements; ast_set_compact squeezes them out
+            int capacity;
+            int *index;         // Hash slots into elements, -1 = empty, -2 = removed
+            int index_size;
         } set;
         struct
         {
@@ -601,7 +778,7 @@ struct ASTNode
         } next_stmt;
         struct
         {
-            ASTNode **elements;
+            TreeNode *root;
             int count;
         } tree;
         struct
@@ -625,10 +802,25 @@ struct ASTNode
         } tree_traversal;
         struct
         {
-            ASTNode **vertices;
-            ASTNode **edges;
+            ASTNode *tree;
+            ASTNode *lo;
+            ASTNode *hi;
+        } tree_range;
+        struct
+        {
+            ASTNode **vertices;      // Vertex values by dense ID
+            GraphAdjacency *out;     // Outgoing edges per vertex
+            GraphAdjacency *in;      // Incoming edges per vertex
             int vertex_count;
+            int vertex_capacity;
             int edge_count;
+            int *index;              // Hash slots mapping vertex value to dense ID
+            int index_size;
+            // CSR snapshot of the out edges, rebuilt on demand after changes
+            int *csr_offsets;
+            int *csr_targets;
+            double *csr_weights;
+            int csr_valid;
         } graph;
         struct
         {
@@ -640,6 +832,7 @@ struct ASTNode
             ASTNode *graph;
             ASTNode *from;
             ASTNode *to;
+            ASTNode *weight; // NULL means weight 1
         } graph_edge_op;
         struct
         {
@@ -665,6 +858,52 @@ struct ASTNode
         {
             ASTNode *set;
         } set_op;
+        struct
+        {
+            struct PVecNode *root;
+            int count;
+            int shift; // Bit offset of the root level
+        } pvec;
+        struct
+        {
+            struct PMapNode *root;
+            int count;
+        } pmap;
+        struct
+        {
+            ASTNode *collection;
+            ASTNode *key; // Index for vectors
+            ASTNode *value;
+        } persistent_op;
+        struct
+        {
+            struct NDBuffer *buffer; // Element storage, shared by views
+            int ndim;
+            int shape[NDARRAY_MAX_DIMS];
+            long strides[NDARRAY_MAX_DIMS]; // In elements; 0 along broadcast axes
+            long offset;                    // Index of the first element in buffer
+        } ndarray;
+        struct
+        {
+            struct HeapEntry *entries; // 4-ary heap array, see heap.c
+            int count;
+            int capacity;
+            ASTNode **values;          // Pushed values by handle slot, NULL once popped
+            int *positions;            // Entry index of each slot, -1 once popped
+            unsigned *generations;     // Bumped each time a slot is popped, so old handles fail
+            int *free_slots;           // Popped slots waiting to be reused
+            int free_count;
+            int handle_count;          // Slots issued so far
+            int handle_capacity;
+            char key_fn[64];           // User function giving a value's priority, "" for none
+            char compare_fn[64];       // User function ordering two values, "" for none
+        } heap;
+        struct
+        {
+            ASTNode *heap; // The list for ::heapify
+            ASTNode *value;
+            ASTNode *priority; // Optional for ::hpush
+        } heap_op;
     };
 };
 
@@ -702,6 +941,10 @@ ASTNode *ast_new_list_insert(ASTNode *list, ASTNode *index, ASTNode *value);
 ASTNode *ast_new_list_remove(ASTNode *list, ASTNode *value);
 void ast_list_add_element(ASTNode *list, ASTNode *element);
 ASTNode *ast_new_list_access(ASTNode *list, ASTNode *index);
+ASTNode *ast_new_list_slice(ASTNode *list, ASTNode *start, ASTNode *end, ASTNode *step);
+ASTNode *ast_list_access(ASTNode *list, int index);
+// Slice views share the parent's elements and keep it alive until released with ast_free
+ASTNode *ast_list_slice(ASTNode *list, int start, int end, int step);
 
 void ast_block_add_statement(ASTNode *block, ASTNode *statement);
 void ast_free(ASTNode *node);
@@ -716,6 +959,7 @@ ASTNode *ast_new_bitwise_xor(ASTNode *left, ASTNode *right);
 ASTNode *ast_new_bitwise_not(ASTNode *operand);
 
 ASTNode *ast_new_pattern_match(ASTNode *pattern, ASTNode *noise);
+ASTNode *ast_new_pattern_match_any(ASTNode *patterns, ASTNode *noise);
 
 ASTNode *ast_new_format_string(const char *format, ASTNode **args, int arg_count);
 
@@ -731,6 +975,11 @@ ASTNode *ast_new_dict_set(ASTNode *dict, ASTNode *key, ASTNode *value);
 ASTNode *ast_new_dict_keys(ASTNode *dict);
 ASTNode *ast_new_dict_values(ASTNode *dict);
 void ast_dict_add_pair(ASTNode *dict, ASTNode *key, ASTNode *value);
+int ast_dict_find(ASTNode *dict, ASTNode *key);
+
+// Hashing and equality for number/string value nodes (used by dicts and sets)
+unsigned long ast_value_hash(ASTNode *value);
+int ast_value_equals(ASTNode *a, ASTNode *b);
 
 ASTNode *ast_new_stack();
 ASTNode *ast_new_stack_push(ASTNode *stack, ASTNode *value);
@@ -755,7 +1004,24 @@ ASTNode *ast_new_linked_list_remove(ASTNode *list, ASTNode *value);
 ASTNode *ast_new_linked_list_get(ASTNode *list, ASTNode *index);
 ASTNode *ast_new_linked_list_size(ASTNode *list);
 ASTNode *ast_new_linked_list_isempty(ASTNode *list);
-void ast_linked_list_add_element(ASTNode *list, ASTNode *element);
+ASTNode *ast_new_linked_list_push_front(ASTNode *list, ASTNode *value);
+ASTNode *ast_new_linked_list_pop_front(ASTNode *list);
+ASTNode *ast_new_linked_list_pop_back(ASTNode *list);
+ASTNode *ast_new_linked_list_cursor(ASTNode *list, ASTNode *index);
+ASTNode *ast_new_linked_list_next(ASTNode *list);
+ASTNode *ast_new_linked_list_current(ASTNode *list);
+ASTNode *ast_new_linked_list_insert(ASTNode *list, ASTNode *value);
+ASTNode *ast_new_linked_list_erase(ASTNode *list);
+ASTNode *ast_new_linked_list_splice(ASTNode *list, ASTNode *source);
+// Linked list storage: the list owns its values; pops hand ownership to the caller
+void ast_linked_list_push_front(ASTNode *list, ASTNode *value);
+void ast_linked_list_push_back(ASTNode *list, ASTNode *value);
+ASTNode *ast_linked_list_pop_front(ASTNode *list);
+ASTNode *ast_linked_list_pop_back(ASTNode *list);
+LinkedNode *ast_linked_list_at(ASTNode *list, int index);
+void ast_linked_list_insert_before(ASTNode *list, LinkedNode *position, ASTNode *value);
+LinkedNode *ast_linked_list_erase(ASTNode *list, LinkedNode *node);
+void ast_linked_list_splice(ASTNode *list, ASTNode *source);
 
 ASTNode *ast_new_file_open(ASTNode *filename, ASTNode *mode);
 ASTNode *ast_new_file_read(ASTNode *file_handle);
@@ -776,6 +1042,8 @@ ASTNode *ast_new_regex(const char *pattern, const char *flags);
 ASTNode *ast_new_regex_match(ASTNode *regex, ASTNode *text);
 ASTNode *ast_new_regex_replace(ASTNode *regex, ASTNode *text, ASTNode *replacement);
 ASTNode *ast_new_regex_find_all(ASTNode *regex, ASTNode *text);
+ASTNode *ast_new_regex_next(ASTNode *regex, ASTNode *text, ASTNode *from);
+ASTNode *ast_new_regex_group(ASTNode *regex, ASTNode *name);
 
 // Ternary operator
 ASTNode *ast_new_ternary(ASTNode *condition, ASTNode *true_expr, ASTNode *false_expr);
@@ -791,6 +1059,15 @@ ASTNode *ast_new_sensitivity_threshold(const char *varname, ASTNode *threshold_v
 ASTNode *ast_new_temporal_query(const char *varname, const char *time_window, const char *condition);
 ASTNode *ast_new_temporal_correlate(const char *var1, const char *var2, ASTNode *window_size);
 ASTNode *ast_new_temporal_interpolate(const char *varname, ASTNode *missing_index);
+ASTNode *ast_new_temporal_downsample(const char *varname, const char *bucket, const char *operation);
+ASTNode *ast_new_temporal_correlate_matrix(ASTNode *names, ASTNode *window_size);
+ASTNode *ast_new_temporal_xcorr(const char *var1, const char *var2, ASTNode *window_size, ASTNode *max_lag);
+ASTNode *ast_new_temporal_new(int max_history, long long archived);
+ASTNode *ast_new_temporal_persist(const char *varname, const char *path);
+ASTNode *ast_new_temporal_fill(const char *varname, const char *method);
+ASTNode *ast_new_temporal_resample(const char *varname, const char *bucket, const char *operation);
+ASTNode *ast_new_temporal_trigger(const char *varname, const char *condition, const char *callback);
+ASTNode *ast_new_temporal_untrigger(const char *varname, const char *condition, const char *callback);
 
 // Exception handling functions
 ASTNode *ast_new_try(ASTNode *try_body, ASTNode **catch_blocks, int catch_count, ASTNode *finally_block);
@@ -800,7 +1077,11 @@ ASTNode *ast_new_finally(ASTNode *finally_body);
 ASTNode *ast_new_lambda(char params[][64], int param_count, ASTNode *body);
 ASTNode *ast_new_string_interpolation(const char *template, ASTNode **expressions, int expr_count);
 ASTNode *ast_new_set();
-void ast_set_add_element(ASTNode *set, ASTNode *element);
+int ast_set_add_element(ASTNode *set, ASTNode *element);
+int ast_set_find(ASTNode *set, ASTNode *element);
+int ast_set_remove_element(ASTNode *set, ASTNode *element);
+void ast_set_compact(ASTNode *set);
+void ast_set_clear(ASTNode *set);
 ASTNode *ast_new_set_union(ASTNode *set1, ASTNode *set2);
 ASTNode *ast_new_set_intersection(ASTNode *set1, ASTNode *set2);
 ASTNode *ast_new_set_difference(ASTNode *set1, ASTNode *set2);
@@ -812,6 +1093,26 @@ ASTNode *ast_new_set_size(ASTNode *set);
 ASTNode *ast_new_set_empty(ASTNode *set);
 ASTNode *ast_new_set_clear(ASTNode *set);
 ASTNode *ast_new_set_copy(ASTNode *set);
+
+ASTNode *ast_new_pvec_push(ASTNode *collection, ASTNode *value);
+ASTNode *ast_new_pvec_set(ASTNode *collection, ASTNode *key, ASTNode *value);
+ASTNode *ast_new_pvec_pop(ASTNode *collection);
+ASTNode *ast_new_pvec_get(ASTNode *collection, ASTNode *key);
+ASTNode *ast_new_pvec_size(ASTNode *collection);
+ASTNode *ast_new_pmap_put(ASTNode *collection, ASTNode *key, ASTNode *value);
+ASTNode *ast_new_pmap_remove(ASTNode *collection, ASTNode *key);
+ASTNode *ast_new_pmap_get(ASTNode *collection, ASTNode *key);
+ASTNode *ast_new_pmap_has(ASTNode *collection, ASTNode *key);
+ASTNode *ast_new_pmap_size(ASTNode *collection);
+
+ASTNode *ast_new_heap_push(ASTNode *heap, ASTNode *value, ASTNode *priority);
+ASTNode *ast_new_heap_pop(ASTNode *heap);
+ASTNode *ast_new_heap_peek(ASTNode *heap);
+ASTNode *ast_new_heap_size(ASTNode *heap);
+ASTNode *ast_new_heap_update(ASTNode *heap, ASTNode *handle, ASTNode *priority);
+ASTNode *ast_new_heap_key(ASTNode *heap, ASTNode *function);
+ASTNode *ast_new_heap_compare(ASTNode *heap, ASTNode *function);
+ASTNode *ast_new_heapify(ASTNode *list, ASTNode *key_function);
 ASTNode *ast_new_type(ASTNode *value);
 ASTNode *ast_new_undef();
 
@@ -839,20 +1140,34 @@ ASTNode *ast_new_tree_delete(ASTNode *tree, ASTNode *value);
 ASTNode *ast_new_tree_inorder(ASTNode *tree);
 ASTNode *ast_new_tree_preorder(ASTNode *tree);
 ASTNode *ast_new_tree_postorder(ASTNode *tree);
-void ast_tree_add_element(ASTNode *tree, ASTNode *element);
+ASTNode *ast_new_tree_range(ASTNode *tree, ASTNode *lo, ASTNode *hi);
+ASTNode *ast_new_tree_floor(ASTNode *tree, ASTNode *value);
+ASTNode *ast_new_tree_ceil(ASTNode *tree, ASTNode *value);
+int ast_tree_insert(ASTNode *tree, double value);
+int ast_tree_contains(ASTNode *tree, double value);
+int ast_tree_remove(ASTNode *tree, double value);
+int ast_tree_floor(ASTNode *tree, double value, double *out);
+int ast_tree_ceiling(ASTNode *tree, double value, double *out);
+void ast_tree_walk(ASTNode *tree, TreeOrder order, TreeVisitor visit, void *ctx);
+void ast_tree_range(ASTNode *tree, double lo, double hi, TreeVisitor visit, void *ctx);
 
 // Graph functions
 ASTNode *ast_new_graph();
 ASTNode *ast_new_graph_add_vertex(ASTNode *graph, ASTNode *vertex);
-ASTNode *ast_new_graph_add_edge(ASTNode *graph, ASTNode *from, ASTNode *to);
+ASTNode *ast_new_graph_add_edge(ASTNode *graph, ASTNode *from, ASTNode *to, ASTNode *weight);
 ASTNode *ast_new_graph_remove_vertex(ASTNode *graph, ASTNode *vertex);
 ASTNode *ast_new_graph_remove_edge(ASTNode *graph, ASTNode *from, ASTNode *to);
 ASTNode *ast_new_graph_has_edge(ASTNode *graph, ASTNode *from, ASTNode *to);
 ASTNode *ast_new_graph_neighbors(ASTNode *graph, ASTNode *vertex);
 ASTNode *ast_new_graph_dfs(ASTNode *graph, ASTNode *start);
 ASTNode *ast_new_graph_bfs(ASTNode *graph, ASTNode *start);
-void ast_graph_add_vertex(ASTNode *graph, ASTNode *vertex);
-void ast_graph_add_edge(ASTNode *graph, ASTNode *from, ASTNode *to);
+int ast_graph_find_vertex(ASTNode *graph, ASTNode *vertex);
+int ast_graph_add_vertex(ASTNode *graph, ASTNode *vertex);
+int ast_graph_remove_vertex(ASTNode *graph, int id);
+void ast_graph_add_edge(ASTNode *graph, int from, int to, double weight);
+int ast_graph_has_edge(ASTNode *graph, int from, int to);
+int ast_graph_remove_edge(ASTNode *graph, int from, int to);
+void ast_graph_freeze(ASTNode *graph);
 
 void ast_set_node_location(ASTNode *node, int line, int column);
 
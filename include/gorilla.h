@@ -0,0 +1,53 @@
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Gorilla-style compression for blocks of (time, value) samples, as described for
+// Facebook's Gorilla time series database. Times are stored as the difference
+// between consecutive intervals (delta-of-delta), which is 0 for evenly spaced
+// samples and costs a single bit; values are stored as the XOR with the previous
+// value, which is 0 for repeats and has few meaningful bits for values that change
+// slowly. Samples are appended one at a time and read back in order.
+
+typedef struct
+{
+    uint64_t *words;  // Bit stream, most significant bit first
+    size_t bits;      // Bits written
+    size_t capacity;  // Words allocated
+    int count;        // Samples written
+    // Encoder state
+    int64_t prev_time;
+    int64_t prev_delta;
+    uint64_t prev_value;
+    int prev_leading; // Window of meaningful XOR bits, -1 before the first one
+    int prev_trailing;
+} GorillaBlock;
+
+typedef struct
+{
+    const GorillaBlock *block;
+    size_t bit;
+    int index;
+    int64_t time;
+    int64_t delta;
+    uint64_t value;
+    int leading;
+    int trailing;
+} GorillaReader;
+
+void gorilla_init(GorillaBlock *block);
+void gorilla_free(GorillaBlock *block);
+// Times must not decrease
+void gorilla_append(GorillaBlock *block, int64_t time, double value);
+// Release the unused tail of the bit stream once no more samples will be appended
+void gorilla_seal(GorillaBlock *block);
+// Heap bytes held by the block's bit stream
+size_t gorilla_bytes(const GorillaBlock *block);
+
+void gorilla_reader_init(GorillaReader *reader, const GorillaBlock *block);
+// Next sample in order; returns 0 once every sample has been read
+int gorilla_next(GorillaReader *reader, int64_t *time, double *value);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "ast.h"
+
+// Priority queue backing <heap>. Entries sit in a 4-ary heap whose sibling groups
+// each fill one 64-byte cache line, so a sift-down step touches a single line.
+// Every push returns a handle that stays valid until the value is popped, which
+// is what ::hupdate uses to change a priority in place (decrease-key). Popped
+// slots are reused, so storage follows the live count; a handle carries its
+// slot's generation, which a pop bumps, so a stale handle is still rejected.
+//
+// Lower priorities come out first. A value's priority is the number given to
+// ::hpush, else its key function result, else the value itself; a heap with a
+// comparator function orders values by calling it instead.
+
+typedef struct HeapEntry
+{
+    double priority;
+    int handle; // Slot in values and positions
+} HeapEntry;
+
+// Slot in the low bits, generation above them; exact as a script number
+typedef long long HeapHandle;
+
+ASTNode *heap_new(void);
+// Build a heap from a list in O(n); key_fn may be NULL. Returns NULL if an element
+// has no priority (a string without a key function)
+ASTNode *heap_from_list(ASTNode *list, const char *key_fn);
+
+// Priority of value under the heap's key function; 0 if it has none
+int heap_priority(ASTNode *heap, ASTNode *value, double *priority);
+// Insert value (the heap takes ownership) and return its handle
+HeapHandle heap_push(ASTNode *heap, ASTNode *value, double priority);
+// Remove the first value and hand it to the caller; NULL if the heap is empty
+ASTNode *heap_pop(ASTNode *heap);
+// The first value, still owned by the heap; NULL if the heap is empty
+ASTNode *heap_peek(ASTNode *heap);
+// Give a live handle a new priority, or with a comparator a new value (which the
+// heap takes); returns 0 if the handle was popped or never issued
+int heap_update(ASTNode *heap, HeapHandle handle, double priority);
+int heap_update_value(ASTNode *heap, HeapHandle handle, ASTNode *value);
+// Switch to ordering by a key function or comparator ("" for none) and rebuild in O(n).
+// Returns 0 (leaving the heap unchanged) if a value would have no priority
+int heap_set_order(ASTNode *heap, const char *key_fn, const char *compare_fn);
+
+// Values in the order they would be popped, leaving the heap unchanged
+ASTNode *heap_to_list(ASTNode *heap);
+// Free the heap's storage (called by ast_free)
+void heap_release(ASTNode *heap);
+
+#endif
@@ -57,6 +57,7 @@ typedef enum
     TOK_LIST_POP,
     TOK_LIST_INSERT,
     TOK_LIST_REMOVE,
+    TOK_LIST_SLICE, // ::slice
     TOK_AND,
     TOK_OR,
     TOK_NOT,
@@ -65,6 +66,7 @@ typedef enum
     TOK_BITWISE_XOR,
     TOK_BITWISE_NOT,
     TOK_PATTERN_MATCH,
+    TOK_PATTERN_MATCH_ANY,
     TOK_FORMAT_SPECIFIER,
     TOK_EOF,
     TOK_CLASS,               // class$
@@ -94,6 +96,16 @@ typedef enum
     TOK_LINKED_LIST_GET,     // ::lget
     TOK_LINKED_LIST_SIZE,    // ::lsize
     TOK_LINKED_LIST_ISEMPTY, // ::lisEmpty
+    TOK_LINKED_LIST_PUSH_FRONT, // ::lpush_front
+    TOK_LINKED_LIST_PUSH_BACK,  // ::lpush_back
+    TOK_LINKED_LIST_POP_FRONT,  // ::lpop_front
+    TOK_LINKED_LIST_POP_BACK,   // ::lpop_back
+    TOK_LINKED_LIST_CURSOR,     // ::lcursor
+    TOK_LINKED_LIST_NEXT,       // ::lnext
+    TOK_LINKED_LIST_CURRENT,    // ::lcurrent
+    TOK_LINKED_LIST_INSERT,     // ::linsert
+    TOK_LINKED_LIST_ERASE,      // ::lerase
+    TOK_LINKED_LIST_SPLICE,     // ::lsplice
     TOK_FILE_OPEN,
     TOK_FILE_READ,
     TOK_FILE_WRITE,
@@ -108,6 +120,8 @@ typedef enum
     TOK_REGEX_MATCH,         // ::rmatch
     TOK_REGEX_REPLACE,       // ::rreplace
     TOK_REGEX_FIND_ALL,      // ::rfind_all
+    TOK_REGEX_NEXT,          // ::rnext
+    TOK_REGEX_GROUP,         // ::rgroup
     TOK_QUESTION,            // ?
     TOK_COLON,               // :
     TOK_TRUE,                // true
@@ -124,6 +138,14 @@ typedef enum
     TOK_TEMPORAL_QUERY,      // ::temporal_query
     TOK_TEMPORAL_CORRELATE,  // ::temporal_correlate
     TOK_TEMPORAL_INTERPOLATE, // ::temporal_interpolate
+    TOK_TEMPORAL_DOWNSAMPLE, // ::temporal_downsample
+    TOK_TEMPORAL_CORRELATE_MATRIX, // ::temporal_correlate_matrix
+    TOK_TEMPORAL_XCORR,      // ::temporal_xcorr
+    TOK_TEMPORAL_PERSIST,    // ::temporal_persist
+    TOK_TEMPORAL_FILL,       // ::temporal_fill
+    TOK_TEMPORAL_RESAMPLE,   // ::temporal_resample
+    TOK_TEMPORAL_TRIGGER,    // ::temporal_trigger
+    TOK_TEMPORAL_UNTRIGGER,  // ::temporal_untrigger
     TOK_TRY,                 // try$
     TOK_CATCH,               // catch$
     TOK_THROW,               // throw$
@@ -152,6 +174,9 @@ typedef enum
     TOK_TREE_INORDER,        // ::tinorder
     TOK_TREE_PREORDER,       // ::tpreorder
     TOK_TREE_POSTORDER,      // ::tpostorder
+    TOK_TREE_RANGE,          // ::trange
+    TOK_TREE_FLOOR,          // ::tfloor
+    TOK_TREE_CEIL,           // ::tceil
     TOK_GRAPH_NEW,           // <graph>
     TOK_GRAPH_ADD_VERTEX,    // ::gadd_vertex
     TOK_GRAPH_ADD_EDGE,      // ::gadd_edge
@@ -172,6 +197,27 @@ typedef enum
     TOK_SET_EMPTY,           // ::sempty
     TOK_SET_CLEAR,           // ::sclear
     TOK_SET_COPY,            // ::scopy
+    TOK_PVEC_NEW,            // <pvec>
+    TOK_PMAP_NEW,            // <pmap>
+    TOK_PVEC_PUSH,           // ::pvpush
+    TOK_PVEC_SET,            // ::pvset
+    TOK_PVEC_POP,            // ::pvpop
+    TOK_PVEC_GET,            // ::pvget
+    TOK_PVEC_SIZE,           // ::pvsize
+    TOK_PMAP_PUT,            // ::pmput
+    TOK_PMAP_REMOVE,         // ::pmremove
+    TOK_PMAP_GET,            // ::pmget
+    TOK_PMAP_HAS,            // ::pmhas
+    TOK_PMAP_SIZE,           // ::pmsize
+    TOK_HEAP_NEW,            // <heap>
+    TOK_HEAP_PUSH,           // ::hpush
+    TOK_HEAP_POP,            // ::hpop
+    TOK_HEAP_PEEK,           // ::hpeek
+    TOK_HEAP_SIZE,           // ::hsize
+    TOK_HEAP_UPDATE,         // ::hupdate
+    TOK_HEAP_KEY,            // ::hkey
+    TOK_HEAP_COMPARE,        // ::hcompare
+    TOK_HEAPIFY,             // ::heapify
 } TokenType;
 
 typedef struct
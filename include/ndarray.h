@@ -0,0 +1,73 @@
+#ifndef NDARRAY_H
+#define NDARRAY_H
+
+#include "ast.h"
+
+// Contiguous N-dimensional arrays of doubles. A NODE_NDARRAY is a view (shape,
+// strides and offset) onto a reference-counted buffer, so transposes, row access
+// and copies between variables share storage instead of copying it. Operations
+// never modify their inputs; each returns a new array.
+
+typedef struct NDBuffer
+{
+    int refs;
+    long size;
+    double data[];
+} NDBuffer;
+
+typedef enum
+{
+    ND_ADD,
+    ND_SUB,
+    ND_MUL,
+    ND_DIV,
+    ND_POW
+} NDBinaryOp;
+
+typedef enum
+{
+    ND_SUM,
+    ND_MEAN,
+    ND_MIN,
+    ND_MAX
+} NDReduceOp;
+
+// Zero-filled contiguous array; ndim 0 is a single number
+ASTNode *ndarray_new(int ndim, const int *shape);
+ASTNode *ndarray_scalar(double value);
+// Array from a list of numbers or a rectangular nested list; NULL otherwise
+ASTNode *ndarray_from_list(ASTNode *list);
+// Nested lists matching the array's shape
+ASTNode *ndarray_to_list(ASTNode *array);
+
+long ndarray_size(ASTNode *array);
+int ndarray_is_contiguous(ASTNode *array);
+// Address of the first element; with ndarray_is_contiguous the elements follow in order
+double *ndarray_data(ASTNode *array);
+double ndarray_get(ASTNode *array, const int *index);
+
+// New array sharing the buffer (O(1))
+ASTNode *ndarray_share(ASTNode *array);
+// Contiguous copy with its own buffer
+ASTNode *ndarray_copy(ASTNode *array);
+// Same elements in a new shape; a view when the array is contiguous. NULL if sizes differ
+ASTNode *ndarray_reshape(ASTNode *array, int ndim, const int *shape);
+// View with the axes reversed
+ASTNode *ndarray_transpose(ASTNode *array);
+// View of the sub-array at index along the first axis
+ASTNode *ndarray_index(ASTNode *array, int index);
+
+ASTNode *ndarray_map(ASTNode *array, double (*fn)(double));
+// Elementwise op with broadcasting; NULL if the shapes are incompatible
+ASTNode *ndarray_binary(ASTNode *a, ASTNode *b, NDBinaryOp op);
+double ndarray_reduce_all(ASTNode *array, NDReduceOp op);
+// Reduce along one axis, dropping it from the shape
+ASTNode *ndarray_reduce_axis(ASTNode *array, NDReduceOp op, int axis);
+// Matrix product of 2-D arrays (1-D operands act as a row or column vector);
+// NULL if the inner dimensions differ
+ASTNode *ndarray_matmul(ASTNode *a, ASTNode *b);
+
+// Drop the array's reference to its buffer (called by ast_free)
+void ndarray_release(ASTNode *array);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PERSISTENT_H
+#define PERSISTENT_H
+
+#include "ast.h"
+
+// Persistent (immutable) vector and hash map. Every update returns a new
+// NODE_PVEC / NODE_PMAP in O(log n) and leaves the original untouched; the
+// versions share all unchanged tree nodes through reference counts, so a
+// snapshot is O(1).
+
+// Reference-counted immutable string shared between versions
+typedef struct PString
+{
+    int refs;
+    char text[];
+} PString;
+
+// Element stored in a persistent collection: a string when string is set, else a number
+typedef struct
+{
+    PString *string;
+    double number;
+} PValue;
+
+// Persistent vector: 32-way trie indexed by position
+ASTNode *pvec_new(void);
+ASTNode *pvec_push(ASTNode *vec, ASTNode *value);
+ASTNode *pvec_set(ASTNode *vec, int index, ASTNode *value); // NULL if index is out of range
+ASTNode *pvec_pop(ASTNode *vec);
+ASTNode *pvec_get(ASTNode *vec, int index);                // New value node, NULL if out of range
+ASTNode *pvec_to_list(ASTNode *vec);
+
+// Persistent hash map: hash array mapped trie keyed by number or string
+ASTNode *pmap_new(void);
+ASTNode *pmap_put(ASTNode *map, ASTNode *key, ASTNode *value);
+ASTNode *pmap_remove(ASTNode *map, ASTNode *key);
+ASTNode *pmap_get(ASTNode *map, ASTNode *key); // New value node, NULL if missing
+ASTNode *pmap_to_dict(ASTNode *map);
+
+// O(1) copy of either collection sharing all structure
+ASTNode *persistent_snapshot(ASTNode *collection);
+// Drop the collection's reference to its tree (called by ast_free)
+void persistent_release(ASTNode *collection);
+
+#endif
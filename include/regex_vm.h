@@ -0,0 +1,115 @@
+#ifndef REGEX_VM_H
+#define REGEX_VM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Regular expressions compiled once into a small program and run without
+// backtracking, after Thompson and Pike: the program is an NFA whose threads all
+// advance together over the text, one byte at a time, so a search costs at most
+// the text length times the program length whatever the pattern. Matches are
+// leftmost-first, as in Perl: greedy quantifiers prefer more, lazy ones less.
+// Each thread carries the positions where the match and its groups start and end.
+//
+// Whether a text matches at all is answered by a DFA built lazily from the same
+// program: each set of NFA states reached is turned into one DFA state the first
+// time it is seen, with its transitions filled in as the text asks for them, and
+// kept with the program for every later search. Anchors depend on the bytes
+// around a position rather than the one read, so programs using them leave this
+// to the Pike VM.
+//
+// Syntax: literals, '.', [classes] with ranges and [^negation], the escapes
+// \d \w \s \D \W \S \n \t \r, groups (...), non-capturing (?:...) and named
+// (?<name>...), alternation |, the quantifiers * + ? {n} {n,} {n,m}, each
+// optionally followed by ? to make it lazy, and the anchors ^ $ \b \B. For
+// patterns written as Tesseract strings, a doubled backslash escapes like one.
+
+#define REGEX_CASE_INSENSITIVE 1
+#define REGEX_MULTILINE 2 // ^ and $ also match at line breaks
+#define REGEX_MAX_PROGRAM 20000 // Instructions, after expanding counted repeats
+#define REGEX_MAX_GROUPS 99
+#define REGEX_NONE ((size_t)-1) // Offset of a group that took no part in the match
+
+typedef enum
+{
+    REGEX_CHAR,  // Byte x
+    REGEX_ANY,   // Any byte
+    REGEX_CLASS, // A byte in classes[x]
+    REGEX_SPLIT, // Continue at x, or failing that at y
+    REGEX_JMP,   // Continue at x
+    REGEX_SAVE,  // Record the position in slot x
+    REGEX_ASSERT, // Continue only if assertion x holds at the position
+    REGEX_MATCH
+} RegexOp;
+
+typedef enum
+{
+    REGEX_TEXT_START,
+    REGEX_TEXT_END,
+    REGEX_LINE_START,
+    REGEX_LINE_END,
+    REGEX_WORD_BOUNDARY,
+    REGEX_NOT_WORD_BOUNDARY
+} RegexAssertion;
+
+typedef struct
+{
+    RegexOp op;
+    int x;
+    int y;
+} RegexInst;
+
+typedef struct RegexDfa RegexDfa;
+typedef struct RegexVm RegexVm;
+
+typedef struct RegexProgram
+{
+    RegexInst *code;
+    int length;
+    uint8_t (*classes)[32]; // 256-bit byte sets
+    int class_count;
+    int groups;             // Capturing groups, numbered from 1
+    char **names;           // Name of each group, NULL when it has none; [0] is unused
+    int slots;              // Positions a thread records: start and end of the match, then of each group
+    int assertions;         // Uses anchors, so cannot run on the DFA
+    int anchored;           // Can only match at the start of the text
+    uint8_t first[32];      // Bytes a non-empty match can start with
+    int first_byte;         // The only byte in first, or -1
+    int nullable;           // The empty string matches
+    RegexDfa *dfa;          // Built as searches need it
+    RegexVm *vm;            // Thread lists and scratch space, sized to the program
+} RegexProgram;
+
+// Successive matches of a program over one text, left to right and without
+// overlapping. Matches are found one at a time as they are asked for, and
+// reported as offsets into the text, which is never copied.
+typedef struct
+{
+    RegexProgram *program;
+    const char *text;
+    size_t length;
+    size_t pos;      // Where the next search starts
+    int after_empty; // The last match was empty and ended at pos
+    int done;
+} RegexIterator;
+
+// Returns NULL and describes the problem in error when the pattern is malformed
+RegexProgram *regex_compile(const char *pattern, int flags, char *error, size_t error_size);
+void regex_free(RegexProgram *program);
+// Number of the group with the given name, or -1
+int regex_group_index(const RegexProgram *program, const char *name);
+// Whether any part of text matches
+int regex_test(RegexProgram *program, const char *text, size_t length);
+// Leftmost-first match starting at or after from. Fills spans with program->slots
+// offsets, the start and end of the match and then of each group, REGEX_NONE for
+// groups that took no part, and returns 1; returns 0 when there is no match. The
+// text before from still counts for anchors
+int regex_search(RegexProgram *program, const char *text, size_t length, size_t from, size_t *spans);
+
+void regex_iter_init(RegexIterator *iter, RegexProgram *program, const char *text, size_t length);
+// Next match, filling spans as regex_search does; returns 0 once there are no more.
+// After an empty match the next one may start at the same place only if it is
+// not empty, so the search always advances
+int regex_iter_next(RegexIterator *iter, size_t *spans);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+
+// Vectorized kernels over packed arrays of doubles, and one over bytes for
+// substring search. The backend (AVX2, SSE2 or scalar) is picked at runtime from
+// what the CPU supports.
+
+typedef enum
+{
+    SIMD_LESS,
+    SIMD_LESS_EQUAL,
+    SIMD_GREATER,
+    SIMD_GREATER_EQUAL,
+    SIMD_EQUAL,
+    SIMD_NOT_EQUAL
+} SimdCompare;
+
+double simd_sum(const double *values, size_t count);
+double simd_dot(const double *a, const double *b, size_t count);
+// Sum of (value - mean)^2, the numerator of the variance
+double simd_squared_deviation(const double *values, size_t count, double mean);
+// min, max, argmin and argmax need count > 0; arg* return the first matching index
+double simd_min(const double *values, size_t count);
+double simd_max(const double *values, size_t count);
+size_t simd_argmin(const double *values, size_t count);
+size_t simd_argmax(const double *values, size_t count);
+size_t simd_count_compare(const double *values, size_t count, SimdCompare op, double threshold);
+// Index of the first value equal to target, or count if there is none
+size_t simd_find(const double *values, size_t count, double target);
+// y[i] += alpha * x[i], the inner step of matrix multiplication
+void simd_axpy(double *y, double alpha, const double *x, size_t count);
+// Index of the first i < count where text[i] is first and text[i + gap] is last,
+// or count if there is none; text holds count + gap bytes. Candidates for a
+// substring starting with first and ending gap bytes later with last
+size_t simd_find_byte_pair(const char *text, size_t count, unsigned char first, unsigned char last, size_t gap);
+
+// Name of the active backend: "avx2", "sse2" or "scalar"
+const char *simd_backend(void);
+// Force a backend by name (for benchmarks and tests); returns 0 if the CPU lacks it.
+// Call it before starting threads that use the kernels
+int simd_set_backend(const char *name);
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef TEMPORAL_H
+#define TEMPORAL_H
+
+// History of a temporal variable: a circular buffer of its last max_history
+// samples. Every sample is kept as a double, so writes and numeric reads cost
+// O(1) with no parsing. A sample written as text that is not a plain number
+// also keeps its text in a side channel, allocated on first use, so it reads
+// back unchanged.
+//
+// The buffer grows geometrically until it reaches max_history slots; from then
+// on a write overwrites the oldest sample and allocates nothing.
+//
+// Each sample also records when it was written, in nanoseconds of the monotonic
+// clock. Times never decrease along the history, so a time window maps to a range
+// of samples with two binary searches.
+//
+// Window statistics are kept incrementally. The first query for a window size
+// registers a tracker that every later write updates: a running sum and Welford
+// mean/variance, monotonic deques for min and max, and (once a median has been
+// asked for) two heaps split at the median. Queries then take O(1), or O(log n)
+// amortized for the median, instead of a pass over the window.
+//
+// Pattern detectors work the same way: the first ::temporal_pattern query with a
+// given setup attaches a detector, which replays the history once and from then
+// on is updated by every write in O(1).
+//
+// Triggers are checked by every write too, in O(1) each: a trigger keeps a state
+// (below, inside or above a threshold band, rate of change or EWMA z-score) and is
+// flagged when a write changes it, so its callback runs once per transition and
+// scripts need not poll.
+//
+// A history can also keep an archive of the samples that age out of the buffer,
+// compressed Gorilla-style into blocks of TEMPORAL_ARCHIVE_BLOCK samples (see
+// gorilla.h). Each block keeps a summary (count, sum, mean/variance, min, max),
+// so statistics over whole blocks need no decoding and only the blocks at either
+// end of a range are decompressed. Archived samples keep their value and their
+// time to the microsecond; text samples are archived as their numeric value.
+// Index i of the full history runs over the archive first, then the buffer.
+//
+// A sample can be marked missing, which stores it as NaN. Gap filling replaces
+// missing samples from their neighbours, and resampling leaves them out.
+//
+// A persisted history also appends every write to a memory-mapped log file (see
+// temporal_log.h), from which a later run restores the buffer and the archive.
+
+#define TEMPORAL_MAX_WINDOWS 8
+#define TEMPORAL_MAX_DETECTORS 8
+#define TEMPORAL_MAX_TRIGGERS 8
+#define TEMPORAL_ARCHIVE_BLOCK 1024
+#define TEMPORAL_MAX_GRID 10000000 // Largest resampling grid the interpreter builds
+
+#include "gorilla.h"
+#include "temporal_log.h"
+#include "temporal_spec.h"
+
+typedef enum
+{
+    TEMPORAL_SUM,
+    TEMPORAL_MEAN,
+    TEMPORAL_MIN,
+    TEMPORAL_MAX,
+    TEMPORAL_VARIANCE,
+    TEMPORAL_STDDEV,
+    TEMPORAL_RANGE,
+    TEMPORAL_MEDIAN,
+    TEMPORAL_COUNT,
+    TEMPORAL_FIRST,
+    TEMPORAL_LAST
+} TemporalStat;
+
+typedef enum
+{
+    TEMPORAL_FILL_PREVIOUS, // The last sample before the gap
+    TEMPORAL_FILL_LINEAR,   // A straight line between the samples either side, by time
+    TEMPORAL_FILL_SPLINE    // A natural cubic spline through every sample present, by time
+} TemporalFill;
+
+typedef struct
+{
+    TemporalPatternSpec spec;
+    double threshold; // Trend only, since it decides which changes count
+    int up;           // Trend: adjacent pairs rising (up) or falling (down) beyond threshold
+    int down;
+    int turns;        // Cycle: consecutive triples whose middle is a peak or valley
+    int count;        // Anomaly: running mean and m2 over the history, as in TemporalWindow
+    double sum;
+    double mean;
+    double m2;
+    int since_reseed;
+    double ewma;      // EWMA and CUSUM baseline
+    double ewmv;
+    double z;         // Newest sample against the baseline before it
+    double high;      // CUSUM sums for upward and downward shifts
+    double low;
+    double level;     // Holt
+    double slope;
+    long long seen;   // Samples fed to the detector
+} TemporalDetector;
+
+// State is -1 below the band (or falling, or low), 0 inside it, 1 above it
+typedef struct
+{
+    TemporalTriggerSpec spec;
+    char callback[64];  // Function run on each change of state
+    int state;
+    int fired;          // State changed since the callback last ran
+    double value;       // Sample that changed the state
+    long long seen;     // Samples fed to the trigger; missing ones are skipped
+    double last;        // Rate: previous sample and its time
+    long long last_time;
+    double ewma;        // Anomaly baseline
+    double ewmv;
+} TemporalTrigger;
+
+// A sample inside a window tracker; seq counts every write to the variable
+typedef struct
+{
+    double value;
+    long long seq;
+} WindowSample;
+
+typedef struct
+{
+    WindowSample *items;
+    int head;
+    int count;
+    int capacity;
+} SampleDeque;
+
+typedef struct
+{
+    WindowSample *items;
+    int count;
+    int capacity;
+} SampleHeap;
+
+typedef struct TemporalWindow
+{
+    int size;           // Samples covered once the history is long enough
+    int count;          // Samples covered now, min(size, history count)
+    double sum;
+    double mean;
+    double m2;          // Sum of squared deviations from the mean (Welford)
+    int since_reseed;   // Removals since the running values were recomputed
+    SampleDeque min_deque;
+    SampleDeque max_deque;
+    int has_median;
+    SampleHeap low;     // Max-heap holding the lower half
+    SampleHeap high;    // Min-heap holding the upper half
+    int low_count;      // Live samples in each heap; expired ones are dropped lazily
+    int high_count;
+} TemporalWindow;
+
+// Running statistics over consecutive samples
+typedef struct
+{
+    long long count;
+    double sum;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    double first;
+    double last;
+} TemporalSummary;
+
+typedef struct
+{
+    GorillaBlock data;
+    long long last_time;  // Time of the newest sample, in nanoseconds
+    TemporalSummary summary;
+} TemporalArchiveBlock;
+
+typedef struct
+{
+    TemporalArchiveBlock *blocks; // Ring of blocks, oldest at head; only the newest takes new samples
+    int head;
+    int count;
+    int capacity;
+    long long samples;            // Samples held across the blocks
+    long long limit;              // The oldest block is dropped once the rest hold this many
+} TemporalArchive;
+
+typedef struct TemporalVariable
+{
+    double *values;
+    long long *times; // Write time of each sample (monotonic nanoseconds)
+    char **texts;     // NULL until the first text sample; NULL slots hold numbers
+    int head;         // Slot of the oldest sample
+    int count;
+    int capacity;     // Slots allocated so far
+    int max_history;
+    long long total;  // Samples ever written
+    long long id;     // Unique per history, so caches can tell histories apart
+    TemporalWindow *windows[TEMPORAL_MAX_WINDOWS];
+    int window_count;
+    TemporalDetector *detectors[TEMPORAL_MAX_DETECTORS];
+    int detector_count;
+    TemporalTrigger *triggers[TEMPORAL_MAX_TRIGGERS];
+    int trigger_count;
+    TemporalArchive *archive; // NULL unless enabled
+    TemporalLog *log;         // NULL unless persisted
+    char scratch[32]; // Text of the last numeric sample read with temporal_text
+} TemporalVariable;
+
+TemporalVariable *temporal_new(int max_history);
+void temporal_free(TemporalVariable *history);
+
+void temporal_push(TemporalVariable *history, double value);
+void temporal_push_missing(TemporalVariable *history);
+// Stores plain numbers as numbers and anything else in the text side channel
+void temporal_push_text(TemporalVariable *history, const char *text);
+
+// Sample i counted from the oldest (0) to the newest (count - 1)
+double temporal_value(const TemporalVariable *history, int i);
+// Whether a value marks a missing sample
+int temporal_missing(double value);
+// Text of sample i; numbers are formatted into a buffer reused by the next call
+const char *temporal_text(TemporalVariable *history, int i);
+
+// Write time of sample i, and the current time on the same clock
+long long temporal_time(const TemporalVariable *history, int i);
+long long temporal_now(void);
+
+// Parse "5", "250ms" or "5 minutes" into nanoseconds. Returns 0 if text is not a
+// number; a bare number gives has_unit 0 and the number itself in ns
+int temporal_parse_duration(const char *text, long long *ns, int *has_unit);
+// Parse a time window: "last N", "last <duration>" or "between A B", where A and
+// B are durations ago, "start", "now"/"end" or times of day such as "10:30".
+// Returns 0 if the text is not a window
+int temporal_parse_span(const char *text, TemporalSpan *span);
+// Samples [*start, *end) of the full history inside a window, found by binary
+// search on the times
+void temporal_span_range(const TemporalVariable *history, const TemporalSpan *span, long long *start,
+                         long long *end);
+
+// A TemporalStat by name ("sum", "avg", "median", ...); -1 for an unknown name
+int temporal_stat_by_name(const char *name);
+// Parse "trend", "cycle", "anomaly", "ewma [alpha]", "cusum [k]" or
+// "holt [alpha [beta]]"; returns 0 for anything else or parameters out of range
+int temporal_parse_pattern(const char *text, TemporalPatternSpec *spec);
+// Compile condition text such as "> 100" or "between 10 50"
+void temporal_parse_condition(const char *text, TemporalCondition *condition);
+// Samples in [start, end) satisfying a value condition (>, <, == or between)
+int temporal_count_matches(const TemporalVariable *history, int start, int end, const TemporalCondition *condition);
+
+// Statistic over the samples [start, end), in one pass
+double temporal_range_stat(const TemporalVariable *history, int start, int end, TemporalStat stat);
+// Split [start, end) into buckets of bucket_ns aligned on the clock and reduce each
+// non-empty bucket with stat. Writes at most end - start values and returns how many
+int temporal_downsample(const TemporalVariable *history, int start, int end, long long bucket_ns,
+                        TemporalStat stat, double *out);
+
+// Result of a pattern detector with the given threshold: 1 (rising, detected or
+// high), -1 (falling or low) or 0
+int temporal_pattern(TemporalVariable *history, const TemporalPatternSpec *spec, double threshold);
+
+// Parse a trigger from "band 10 20", "rate 5", "rate 5/1s", "anomaly 3", ...;
+// returns 0 if text is not a trigger
+int temporal_parse_trigger(const char *text, TemporalTriggerSpec *spec);
+// Trigger for a setup and callback, attaching one on first use with its state
+// taken from a replay of the history (which fires nothing); NULL when all are taken
+TemporalTrigger *temporal_add_trigger(TemporalVariable *history, const TemporalTriggerSpec *spec,
+                                      const char *callback);
+// Detach the trigger for a setup and callback; returns 0 if there is none. Safe
+// to call from a callback, including the trigger's own
+int temporal_remove_trigger(TemporalVariable *history, const TemporalTriggerSpec *spec, const char *callback);
+// A trigger whose state changed since its callback last ran, with its flag
+// cleared; NULL when there is none. Writers call this until NULL after each write
+TemporalTrigger *temporal_next_fired(TemporalVariable *history);
+
+// Running sums behind a correlation matrix, kept between calls. When every series
+// has advanced by the same few samples since the last call, only those samples
+// are folded in (O(n^2) per sample) instead of recomputing the window
+struct TemporalCorrelation
+{
+    int series;
+    int window;
+    long long *ids;     // Histories the sums belong to
+    long long *totals;  // Their write counts when the sums were last brought up to date
+    double *shift;      // Per-series offset taken off every value, which keeps the sums precise
+    double *sum;
+    double *sum_sq;
+    double *cross;      // series x series sums of products, upper triangle
+    int since_reseed;   // Samples folded in since the last full computation
+};
+
+TemporalCorrelation *temporal_correlation_new(void);
+void temporal_correlation_free(TemporalCorrelation *cache);
+// Pearson correlations between the newest window samples of every pair of series,
+// aligned at their newest sample, into out (series x series, row-major). window
+// is clamped to the shortest history; pairs with no variance give 0
+void temporal_correlation_matrix(TemporalCorrelation *cache, TemporalVariable **vars, int series, int window,
+                                 double *out);
+// Correlation of a's window ending lag samples back with b's newest window, for
+// lag 0 .. max_lag. Returns how many lags had enough history
+int temporal_cross_correlation(const TemporalVariable *a, const TemporalVariable *b, int window, int max_lag,
+                               double *out);
+
+// Statistic over the newest window_size samples (all of them if window_size is
+// out of range); 0 for an empty history. With an archive, windows longer than the
+// buffer reach into it, and out of range means the full history
+double temporal_window_stat(TemporalVariable *history, int window_size, TemporalStat stat);
+
+// A TemporalFill by name ("previous", "linear", "spline"); -1 for an unknown name
+int temporal_fill_by_name(const char *name);
+// The buffer's samples, oldest first, into out (count values) with missing samples
+// filled in. Gaps at either end take the nearest sample; with no sample present
+// the output stays missing. Returns how many samples were filled
+int temporal_fill(const TemporalVariable *history, TemporalFill method, double *out);
+// Sample i of the buffer, or if it is missing, its linear fill
+double temporal_interpolate(const TemporalVariable *history, int i);
+
+// Buckets of bucket_ns aligned on the clock from the full history's oldest sample
+// to its newest; 0 for an empty history
+long long temporal_grid_size(const TemporalVariable *history, long long bucket_ns);
+// Reduce the samples in each bucket of that grid with stat (anything but the
+// median), in one pass. Buckets without a sample present come out missing
+void temporal_resample(const TemporalVariable *history, long long bucket_ns, TemporalStat stat, double *out);
+
+// Keep samples leaving the buffer in a compressed archive of at least limit samples
+void temporal_enable_archive(TemporalVariable *history, long long limit);
+// Samples in the archive, and the heap bytes it holds
+long long temporal_archived(const TemporalVariable *history);
+size_t temporal_archive_bytes(const TemporalVariable *history);
+
+// Log every write to the file at path. If the file already holds samples, they
+// replace the history (text samples come back as their numeric value) and their
+// count is returned; a new file starts from the samples held now and 0 is
+// returned. Returns -1, with errno set, if the file cannot be used
+long long temporal_persist(TemporalVariable *history, const char *path);
+
+// Queries over [start, end) of the full history, archive included. Without an
+// archive these match the buffer-only functions above
+double temporal_full_stat(const TemporalVariable *history, long long start, long long end, TemporalStat stat);
+long long temporal_full_count_matches(const TemporalVariable *history, long long start, long long end,
+                                      const TemporalCondition *condition);
+long long temporal_full_downsample(const TemporalVariable *history, long long start, long long end,
+                                   long long bucket_ns, TemporalStat stat, double *out);
+
+#endif
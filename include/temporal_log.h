@@ -0,0 +1,53 @@
+#ifndef TEMPORAL_LOG_H
+#define TEMPORAL_LOG_H
+
+#include <stddef.h>
+
+// Append-only file of (time, value) records behind a persisted temporal variable.
+// The file is memory-mapped, so an append is a store into the mapping and a
+// restore reads the records it needs straight out of the page cache, with no
+// parsing. Times are kept on the wall clock, which unlike the monotonic clock
+// means the same thing after a restart.
+//
+// A checkpoint every TEMPORAL_LOG_CHECKPOINT records stores the record count in
+// the header and schedules the dirty pages for writing. Records after the last
+// checkpoint are recovered on open by reading on until the zero-filled space the
+// file was grown by. At a checkpoint, a log holding more than twice the records
+// it has to keep is rewritten with only the newest ones.
+
+#define TEMPORAL_LOG_CHECKPOINT 4096
+
+typedef struct
+{
+    long long time; // Wall-clock nanoseconds
+    double value;
+} TemporalLogRecord;
+
+typedef struct
+{
+    char *path;
+    int fd;
+    char *map;              // The whole file: header, then records
+    size_t mapped;          // File size
+    long long count;        // Records written
+    long long checkpointed; // Records counted by the last checkpoint
+    long long keep;         // Newest records kept when the log is compacted
+    long long clock_offset; // Wall clock minus monotonic clock, in nanoseconds
+} TemporalLog;
+
+// Open or create the log at path. Returns NULL, with errno set, if the file cannot
+// be opened or is not a temporal log
+TemporalLog *temporal_log_open(const char *path, long long keep);
+// Checkpoint, trim the file to its records and unmap it
+void temporal_log_close(TemporalLog *log);
+
+// time is on the monotonic clock, as in TemporalVariable
+void temporal_log_append(TemporalLog *log, long long time, double value);
+void temporal_log_checkpoint(TemporalLog *log);
+
+// Record i, oldest first, and its time back on the monotonic clock (never later
+// than now, in case the wall clock was set back)
+const TemporalLogRecord *temporal_log_record(const TemporalLog *log, long long i);
+long long temporal_log_time(const TemporalLog *log, const TemporalLogRecord *record, long long now);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TEMPORAL_SPEC_H
+#define TEMPORAL_SPEC_H
+
+// Compiled forms of the text arguments to the temporal functions: time windows,
+// pattern setups, trigger conditions and sample conditions. The parser builds them
+// once into the AST (see the temporal_* parsers in temporal.h), so this header is
+// all ast.h needs from the temporal subsystem.
+
+// One end of a time window: an age in nanoseconds, or with clock set a time of
+// day (nanoseconds after local midnight)
+typedef struct
+{
+    int clock;
+    long long ns;
+} TemporalBound;
+
+typedef enum
+{
+    TEMPORAL_SPAN_COUNT, // The newest count samples ("last 5")
+    TEMPORAL_SPAN_TIME   // Samples written between two bounds ("last 5 minutes", "between 10m 5m")
+} TemporalSpanKind;
+
+typedef struct
+{
+    TemporalSpanKind kind;
+    int count;
+    TemporalBound from;
+    TemporalBound to;
+} TemporalSpan;
+
+typedef enum
+{
+    TEMPORAL_TREND,   // Rises vs falls beyond threshold percent, over the whole history
+    TEMPORAL_CYCLE,   // At least two peaks or valleys
+    TEMPORAL_ANOMALY, // Newest sample's z-score against the whole history
+    TEMPORAL_EWMA,    // Newest sample's z-score against an exponentially weighted mean and variance
+    TEMPORAL_CUSUM,   // Two-sided CUSUM of standardized deviations from the EWMA mean
+    TEMPORAL_HOLT     // Slope of Holt's linear trend, in percent of the level per sample
+} TemporalPattern;
+
+// A pattern and its smoothing parameters, parsed from "ewma 0.2", "holt 0.5 0.1", ...
+typedef struct
+{
+    TemporalPattern pattern;
+    double a; // EWMA and Holt alpha, CUSUM slack k
+    double b; // Holt beta
+} TemporalPatternSpec;
+
+typedef enum
+{
+    TEMPORAL_TRIGGER_BAND,   // "band low high": the sample itself
+    TEMPORAL_TRIGGER_RATE,   // "rate limit", "rate limit/1s": change per sample, or per duration
+    TEMPORAL_TRIGGER_ANOMALY // "anomaly z", "anomaly z alpha": z-score against an EWMA baseline
+} TemporalTriggerKind;
+
+typedef struct
+{
+    TemporalTriggerKind kind;
+    double a;         // Band low; rate limit; anomaly z
+    double b;         // Band high; anomaly alpha
+    long long per_ns; // Rate: duration the limit applies to, 0 for per sample
+} TemporalTriggerSpec;
+
+typedef enum
+{
+    TEMPORAL_COND_NONE,       // Text that is not a condition; matches nothing
+    TEMPORAL_COND_GT,         // "> a"
+    TEMPORAL_COND_LT,         // "< a"
+    TEMPORAL_COND_EQ,         // "== a"
+    TEMPORAL_COND_BETWEEN,    // "between a b"
+    TEMPORAL_COND_INCREASING, // "increasing"
+    TEMPORAL_COND_STABLE      // "stable a", variance below a
+} TemporalConditionOp;
+
+// A condition compiled once from its text, so checking a sample does no parsing
+typedef struct
+{
+    TemporalConditionOp op;
+    double a;
+    double b;
+} TemporalCondition;
+
+// Cached sums for ::temporal_correlate_matrix, defined in temporal.h
+typedef struct TemporalCorrelation TemporalCorrelation;
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef TESSERACT_PCH_H
 #define TESSERACT_PCH_H
 
+#define _GNU_SOURCE
+
 // Standard library headers
 #include <stdio.h>
 #include <stdlib.h>
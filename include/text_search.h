@@ -0,0 +1,66 @@
+#ifndef TEXT_SEARCH_H
+#define TEXT_SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Exact substring search, for one needle or many at once.
+//
+// One needle is found by filtering for its first and last bytes the right
+// distance apart, sixteen or thirty-two positions at a time with the SIMD
+// kernels, and comparing the bytes in between only at those candidates. When the
+// pair turns out to be common in the text, so that most candidates fail, the
+// search moves on to Horspool's algorithm, which skips ahead by up to the needle
+// length after each comparison.
+//
+// Many needles are found in one pass with an Aho-Corasick automaton: a trie of
+// the needles whose missing transitions are filled in from the longest suffix
+// that is also in the trie, so each byte of the text costs one table lookup
+// whatever the number of needles. Bytes that occur in no needle share a column
+// of the table, which keeps it small for keyword lists.
+
+#define TEXT_NONE ((size_t)-1)
+
+typedef struct
+{
+    const char *bytes;  // Not copied; must outlive the needle
+    size_t length;
+    size_t shift[256];  // Horspool skip for each byte at the end of the window
+    int horspool;       // The byte pair filter gave up on this text
+    size_t misses;      // Candidates from the filter that did not match
+    size_t covered;     // Bytes the filter has moved past
+} TextNeedle;
+
+typedef struct
+{
+    int count;          // Needles
+    char *bytes;        // Every needle, one after another
+    size_t *offsets;    // Where each needle starts in bytes, then the total length
+    int states;
+    int alphabet;       // Columns of the table: 0 for bytes in no needle, then one per byte used
+    uint8_t classes[256];
+    int32_t *next;      // states * alphabet transitions
+    int *output;        // First needle ending at each state, or -1
+    int *dict;          // Nearest state down the suffix chain that has an output, or -1
+    int *same;          // Next needle equal to this one, or -1
+    uint8_t start[256]; // Bytes some needle starts with
+    int first_byte;     // The only byte needles start with, or -1
+} TextMatcher;
+
+// Called for each occurrence: where it starts and which needle it is
+typedef void (*TextMatchFn)(size_t start, int needle, void *ctx);
+
+void text_needle_init(TextNeedle *needle, const char *bytes, size_t length);
+// First occurrence starting at or after from, or TEXT_NONE; an empty needle is found at from
+size_t text_find(TextNeedle *needle, const char *text, size_t length, size_t from);
+
+// Empty needles are accepted but never reported
+TextMatcher *text_matcher_new(const char *const *needles, const size_t *lengths, int count);
+void text_matcher_free(TextMatcher *matcher);
+// Whether the matcher was built from exactly these needles, in this order
+int text_matcher_same(const TextMatcher *matcher, const char *const *needles, const size_t *lengths, int count);
+// Reports every occurrence of every needle, overlapping ones included, in the
+// order they end in the text; occurrences ending together come longest first
+void text_matcher_scan(const TextMatcher *matcher, const char *text, size_t length, TextMatchFn report, void *ctx);
+
+#endif
@@ -1,20 +1,7 @@
 #ifndef VARIABLES_H
 #define VARIABLES_H
 #include "ast.h"
-
-#define MAX_TEMPORAL_HISTORY 10
-
-typedef struct {
-    char *value;
-    int timestamp;
-} TemporalEntry;
-
-typedef struct {
-    TemporalEntry history[MAX_TEMPORAL_HISTORY];
-    int current_index;
-    int count;
-    int max_history;
-} TemporalVariable;
+#include "temporal.h"
 
 typedef struct {
     char name[64];
@@ -33,6 +20,8 @@ typedef struct {
 } Iterator;
 
 void set_variable(const char *name, const char *value);
+// Stores the number as text, remembering that it was a number
+void set_number_variable(const char *name, double value);
 void set_list_variable(const char *name, ASTNode *list);
 void set_dict_variable(const char *name, ASTNode *dict);
 void set_stack_variable(const char *name, ASTNode *stack);
@@ -42,6 +31,9 @@ void set_regex_variable(const char *name, ASTNode *regex);
 void set_set_variable(const char *name, ASTNode *set);
 void set_tree_variable(const char *name, ASTNode *tree);
 void set_graph_variable(const char *name, ASTNode *graph);
+void set_persistent_variable(const char *name, ASTNode *collection);
+void set_ndarray_variable(const char *name, ASTNode *array);
+void set_heap_variable(const char *name, ASTNode *heap);
 void set_undef_variable(const char *name);
 const char *get_variable(const char *name);
 ASTNode *get_list_variable(const char *name);
@@ -53,13 +45,23 @@ ASTNode *get_regex_variable(const char *name);
 ASTNode *get_set_variable(const char *name);
 ASTNode *get_tree_variable(const char *name);
 ASTNode *get_graph_variable(const char *name);
+ASTNode *get_persistent_variable(const char *name);
+ASTNode *get_ndarray_variable(const char *name);
+ASTNode *get_heap_variable(const char *name);
 int is_undef_variable(const char *name);
+int is_number_variable(const char *name);
+// The exact number behind a variable stored with set_number_variable; 0 for any other
+int get_number_variable(const char *name, double *value);
 
 // Temporal variable functions
 void set_temporal_variable(const char *name, const char *value, int max_history);
+void set_temporal_number(const char *name, double value);
 const char *get_temporal_variable(const char *name, int time_offset);
 int get_temporal_variable_count(const char *name);
 TemporalVariable *get_temporal_var_struct(const char *name);
+// Runs a trigger's callback after the write that fired it; set by the interpreter
+typedef void (*TriggerCallbackRunner)(const char *callback, ASTNode **args, int arg_count);
+void set_trigger_callback_runner(TriggerCallbackRunner runner);
 
 // Generator and iterator functions
 void register_generator(const char *name, char params[][64], int param_count, ASTNode *body);
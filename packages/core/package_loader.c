@@ -9,15 +9,30 @@ typedef struct {
     char *package_name;
 } FunctionPackageMapping;
 
-static PackageFunction package_functions[128];
+#define MAX_PACKAGE_FUNCTIONS 256
+
+static PackageFunction package_functions[MAX_PACKAGE_FUNCTIONS];
 static int function_count = 0;
 static char imported_packages[32][64];
 static int imported_count = 0;
-static FunctionPackageMapping function_mappings[128];
+static FunctionPackageMapping function_mappings[MAX_PACKAGE_FUNCTIONS];
 static int mapping_count = 0;
+static UserFunctionCaller user_function_caller = NULL;
+
+void set_user_function_caller(UserFunctionCaller caller) {
+    user_function_caller = caller;
+}
+
+double call_user_function(const char *func_name, ASTNode **args, int arg_count) {
+    if (!user_function_caller) {
+        printf("Runtime error: Cannot call function '%s' from a package here\n", func_name);
+        exit(1);
+    }
+    return user_function_caller(func_name, args, arg_count);
+}
 
 void register_package_function(const char *name, ASTNode *(*func)(ASTNode **args, int arg_count)) {
-    if (function_count < 128) {
+    if (function_count < MAX_PACKAGE_FUNCTIONS) {
         package_functions[function_count].name = malloc(strlen(name) + 1);
         strcpy(package_functions[function_count].name, name);
         package_functions[function_count].func = func;
@@ -26,7 +41,7 @@ void register_package_function(const char *name, ASTNode *(*func)(ASTNode **args
 }
 
 void register_function_package_mapping(const char *function_name, const char *package_name) {
-    if (mapping_count < 128) {
+    if (mapping_count < MAX_PACKAGE_FUNCTIONS) {
         function_mappings[mapping_count].function_name = malloc(strlen(function_name) + 1);
         strcpy(function_mappings[mapping_count].function_name, function_name);
         function_mappings[mapping_count].package_name = malloc(strlen(package_name) + 1);
@@ -60,7 +75,7 @@ void import_package(const char *package_name) {
     }
 }
 
-ASTNode *call_package_function(const char *func_name, ASTNode **args, int arg_count) {
+static PackageFunction *find_package_function(const char *func_name) {
     const char *required_package = get_function_package(func_name);
     if (required_package && !is_package_imported(required_package)) {
         return NULL;
@@ -68,12 +83,21 @@ ASTNode *call_package_function(const char *func_name, ASTNode **args, int arg_co
     
     for (int i = 0; i < function_count; i++) {
         if (strcmp(package_functions[i].name, func_name) == 0) {
-            return package_functions[i].func(args, arg_count);
+            return &package_functions[i];
         }
     }
     return NULL;
 }
 
+int has_package_function(const char *func_name) {
+    return find_package_function(func_name) != NULL;
+}
+
+ASTNode *call_package_function(const char *func_name, ASTNode **args, int arg_count) {
+    PackageFunction *function = find_package_function(func_name);
+    return function ? function->func(args, arg_count) : NULL;
+}
+
 int load_package(const char *package_name) {
     import_package(package_name);
     printf("Package %s imported\n", package_name);
@@ -16,10 +16,17 @@ typedef struct {
 
 int load_package(const char *package_name);
 ASTNode *call_package_function(const char *func_name, ASTNode **args, int arg_count);
+int has_package_function(const char *func_name);
 void register_package_function(const char *name, ASTNode *(*func)(ASTNode **args, int arg_count));
 void import_package(const char *package_name);
 int is_package_imported(const char *package_name);
 void register_function_package_mapping(const char *function_name, const char *package_name);
 const char* get_function_package(const char *function_name);
 
+// Lets package functions call a user-defined Tesseract function by name (sort_by keys).
+// The interpreter installs the caller; the arguments stay owned by the package.
+typedef double (*UserFunctionCaller)(const char *func_name, ASTNode **args, int arg_count);
+void set_user_function_caller(UserFunctionCaller caller);
+double call_user_function(const char *func_name, ASTNode **args, int arg_count);
+
 #endif
\ No newline at end of file
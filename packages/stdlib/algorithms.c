@@ -1,8 +1,155 @@
+#define _GNU_SOURCE
 #include "../core/package_loader.h"
 #include "../../include/ast.h"
+#include "../../include/simd.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 // Sorting algorithms
+//
+// All sorts order mixed lists as numbers first (by value), then strings (by strcmp),
+// then anything else, and rearrange the element pointers in place.
+
+#define INSERTION_SORT_THRESHOLD 24
+#define PARALLEL_SORT_THRESHOLD 65536
+#define MAX_SORT_THREADS 16
+
+static int value_rank(const ASTNode *value) {
+    if (value->type == NODE_NUMBER) return 0;
+    if (value->type == NODE_STRING) return 1;
+    return 2;
+}
+
+static int compare_values(const ASTNode *a, const ASTNode *b) {
+    int rank_a = value_rank(a), rank_b = value_rank(b);
+    if (rank_a != rank_b) return rank_a - rank_b;
+    if (rank_a == 0) return (a->number > b->number) - (a->number < b->number);
+    if (rank_a == 1) return strcmp(a->string, b->string);
+    return 0;
+}
+
+static void insertion_sort(ASTNode **items, int n) {
+    for (int i = 1; i < n; i++) {
+        ASTNode *item = items[i];
+        int j = i - 1;
+        while (j >= 0 && compare_values(items[j], item) > 0) {
+            items[j + 1] = items[j];
+            j--;
+        }
+        items[j + 1] = item;
+    }
+}
+
+static void swap_items(ASTNode **items, int i, int j) {
+    ASTNode *temp = items[i];
+    items[i] = items[j];
+    items[j] = temp;
+}
+
+static void sift_down(ASTNode **items, int root, int n) {
+    for (;;) {
+        int child = 2 * root + 1;
+        if (child >= n) return;
+        if (child + 1 < n && compare_values(items[child], items[child + 1]) < 0) child++;
+        if (compare_values(items[root], items[child]) >= 0) return;
+        swap_items(items, root, child);
+        root = child;
+    }
+}
+
+static void heap_sort(ASTNode **items, int n) {
+    for (int i = n / 2 - 1; i >= 0; i--) sift_down(items, i, n);
+    for (int end = n - 1; end > 0; end--) {
+        swap_items(items, 0, end);
+        sift_down(items, 0, end);
+    }
+}
+
+// Introsort: median-of-three quicksort that falls back to heapsort when the recursion
+// gets too deep, so adversarial inputs stay O(n log n)
+static void introsort(ASTNode **items, int n, int depth_limit) {
+    while (n > INSERTION_SORT_THRESHOLD) {
+        if (depth_limit-- == 0) {
+            heap_sort(items, n);
+            return;
+        }
+        int mid = n / 2;
+        if (compare_values(items[mid], items[0]) < 0) swap_items(items, mid, 0);
+        if (compare_values(items[n - 1], items[0]) < 0) swap_items(items, n - 1, 0);
+        if (compare_values(items[n - 1], items[mid]) < 0) swap_items(items, n - 1, mid);
+        ASTNode *pivot = items[mid];
+
+        // Hoare partition; runs of equal values split evenly instead of degrading
+        int i = -1, j = n;
+        for (;;) {
+            do i++; while (compare_values(items[i], pivot) < 0);
+            do j--; while (compare_values(items[j], pivot) > 0);
+            if (i >= j) break;
+            swap_items(items, i, j);
+        }
+        // Recurse into the smaller half and loop on the larger one
+        int left = j + 1;
+        if (left < n - left) {
+            introsort(items, left, depth_limit);
+            items += left;
+            n -= left;
+        } else {
+            introsort(items + left, n - left, depth_limit);
+            n = left;
+        }
+    }
+    insertion_sort(items, n);
+}
+
+static int depth_limit_for(int n) {
+    int depth = 0;
+    while (n > 1) {
+        depth++;
+        n >>= 1;
+    }
+    return 2 * depth;
+}
+
+static void merge_runs(ASTNode **src, int left, int mid, int right, ASTNode **dst) {
+    int i = left, j = mid, k = left;
+    while (i < mid && j < right) dst[k++] = compare_values(src[j], src[i]) < 0 ? src[j++] : src[i++];
+    while (i < mid) dst[k++] = src[i++];
+    while (j < right) dst[k++] = src[j++];
+}
+
+// Bottom-up stable merge sort on items[0..n) using buffer (also n long)
+static void merge_sort_range(ASTNode **items, ASTNode **buffer, int n) {
+    for (int start = 0; start < n; start += INSERTION_SORT_THRESHOLD) {
+        int len = n - start < INSERTION_SORT_THRESHOLD ? n - start : INSERTION_SORT_THRESHOLD;
+        insertion_sort(items + start, len);
+    }
+    ASTNode **src = items, **dst = buffer;
+    for (int width = INSERTION_SORT_THRESHOLD; width < n; width *= 2) {
+        for (int left = 0; left < n; left += 2 * width) {
+            int mid = left + width < n ? left + width : n;
+            int right = left + 2 * width < n ? left + 2 * width : n;
+            merge_runs(src, left, mid, right, dst);
+        }
+        ASTNode **temp = src;
+        src = dst;
+        dst = temp;
+    }
+    if (src != items) memcpy(items, src, sizeof(ASTNode *) * n);
+}
+
+static void stable_sort(ASTNode **items, int n) {
+    if (n <= INSERTION_SORT_THRESHOLD) {
+        insertion_sort(items, n);
+        return;
+    }
+    ASTNode **buffer = malloc(sizeof(ASTNode *) * n);
+    merge_sort_range(items, buffer, n);
+    free(buffer);
+}
+
 ASTNode *tesseract_bubble_sort(ASTNode **args, int arg_count) {
     if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
     
@@ -10,16 +157,14 @@ ASTNode *tesseract_bubble_sort(ASTNode **args, int arg_count) {
     int n = list->list.count;
     
     for (int i = 0; i < n - 1; i++) {
+        int swapped = 0;
         for (int j = 0; j < n - i - 1; j++) {
-            if (list->list.elements[j]->type == NODE_NUMBER && 
-                list->list.elements[j + 1]->type == NODE_NUMBER) {
-                if (list->list.elements[j]->number > list->list.elements[j + 1]->number) {
-                    ASTNode *temp = list->list.elements[j];
-                    list->list.elements[j] = list->list.elements[j + 1];
-                    list->list.elements[j + 1] = temp;
-                }
+            if (compare_values(list->list.elements[j], list->list.elements[j + 1]) > 0) {
+                swap_items(list->list.elements, j, j + 1);
+                swapped = 1;
             }
         }
+        if (!swapped) break;
     }
     return ast_new_number(1);
 }
@@ -27,28 +172,335 @@ ASTNode *tesseract_bubble_sort(ASTNode **args, int arg_count) {
 ASTNode *tesseract_quick_sort(ASTNode **args, int arg_count) {
     if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
     
-    // Simple quicksort implementation
+    ASTNode *list = args[0];
+    introsort(list->list.elements, list->list.count, depth_limit_for(list->list.count));
+    return ast_new_number(1);
+}
+
+ASTNode *tesseract_merge_sort(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
+    
+    stable_sort(args[0]->list.elements, args[0]->list.count);
+    return ast_new_number(1);
+}
+
+// Doubles mapped to unsigned keys whose integer order matches numeric order
+static uint64_t radix_key(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x8000000000000000ULL ? ~bits : bits | 0x8000000000000000ULL;
+}
+
+static double radix_value(uint64_t key) {
+    uint64_t bits = key & 0x8000000000000000ULL ? key & ~0x8000000000000000ULL : ~key;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// LSD radix sort for all-number lists: packs the values into 64-bit keys and sorts them
+// a byte at a time, skipping bytes that are the same for every key. Lists holding
+// anything other than numbers fall back to the stable merge sort.
+ASTNode *tesseract_radix_sort(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
+    
     ASTNode *list = args[0];
     int n = list->list.count;
+    for (int i = 0; i < n; i++) {
+        if (list->list.elements[i]->type != NODE_NUMBER) {
+            stable_sort(list->list.elements, n);
+            return ast_new_number(1);
+        }
+    }
+    if (n < 2) return ast_new_number(1);
+
+    uint64_t *keys = malloc(sizeof(uint64_t) * n);
+    uint64_t *scratch = malloc(sizeof(uint64_t) * n);
+    for (int i = 0; i < n; i++) keys[i] = radix_key(list->list.elements[i]->number);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[257] = {0};
+        for (int i = 0; i < n; i++) counts[((keys[i] >> shift) & 0xFF) + 1]++;
+        if (counts[((keys[0] >> shift) & 0xFF) + 1] == (size_t)n) continue;
+        for (int b = 0; b < 256; b++) counts[b + 1] += counts[b];
+        for (int i = 0; i < n; i++) scratch[counts[(keys[i] >> shift) & 0xFF]++] = keys[i];
+        uint64_t *temp = keys;
+        keys = scratch;
+        scratch = temp;
+    }
+
+    // Every element is a number node, so the sorted values can be written back in place
+    for (int i = 0; i < n; i++) list->list.elements[i]->number = radix_value(keys[i]);
+    free(keys);
+    free(scratch);
+    return ast_new_number(1);
+}
+
+typedef struct {
+    ASTNode **items;
+    ASTNode **buffer;
+    int left, mid, right;
+} SortTask;
+
+static void *sort_chunk(void *arg) {
+    SortTask *task = arg;
+    merge_sort_range(task->items + task->left, task->buffer + task->left, task->right - task->left);
+    return NULL;
+}
+
+static void *merge_chunk(void *arg) {
+    SortTask *task = arg;
+    merge_runs(task->items, task->left, task->mid, task->right, task->buffer);
+    return NULL;
+}
+
+static int default_thread_count(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores < 1 ? 1 : cores > MAX_SORT_THREADS ? MAX_SORT_THREADS : (int)cores;
+}
+
+// Stable merge sort that sorts one chunk per thread, then merges neighbouring chunks
+// pairwise, also in parallel, until one run is left. Small lists sort on the calling thread.
+ASTNode *tesseract_parallel_sort(ASTNode **args, int arg_count) {
+    if (arg_count < 1 || arg_count > 2 || args[0]->type != NODE_LIST) return ast_new_number(0);
     
-    if (n <= 1) return ast_new_number(1);
+    ASTNode *list = args[0];
+    int n = list->list.count;
+    int threads = arg_count == 2 && args[1]->type == NODE_NUMBER ? (int)args[1]->number : default_thread_count();
+    if (threads > MAX_SORT_THREADS) threads = MAX_SORT_THREADS;
+    if (n < PARALLEL_SORT_THRESHOLD || threads < 2) {
+        stable_sort(list->list.elements, n);
+        return ast_new_number(1);
+    }
+
+    int chunks = 1;
+    while (chunks * 2 <= threads) chunks *= 2;
+    ASTNode **items = list->list.elements;
+    ASTNode **buffer = malloc(sizeof(ASTNode *) * n);
+    pthread_t workers[MAX_SORT_THREADS];
+    SortTask tasks[MAX_SORT_THREADS];
+
+    for (int c = 0; c < chunks; c++) {
+        tasks[c] = (SortTask){items, buffer, (int)((long)n * c / chunks), 0, (int)((long)n * (c + 1) / chunks)};
+        pthread_create(&workers[c], NULL, sort_chunk, &tasks[c]);
+    }
+    for (int c = 0; c < chunks; c++) pthread_join(workers[c], NULL);
+
+    // Each round halves the number of runs, alternating between the two arrays
+    ASTNode **src = items, **dst = buffer;
+    for (int runs = chunks; runs > 1; runs /= 2) {
+        int pairs = runs / 2;
+        for (int p = 0; p < pairs; p++) {
+            int left = (int)((long)n * (2 * p) / runs);
+            int mid = (int)((long)n * (2 * p + 1) / runs);
+            int right = (int)((long)n * (2 * p + 2) / runs);
+            tasks[p] = (SortTask){src, dst, left, mid, right};
+            pthread_create(&workers[p], NULL, merge_chunk, &tasks[p]);
+        }
+        for (int p = 0; p < pairs; p++) pthread_join(workers[p], NULL);
+        ASTNode **temp = src;
+        src = dst;
+        dst = temp;
+    }
+    if (src != items) memcpy(items, src, sizeof(ASTNode *) * n);
+    free(buffer);
+    return ast_new_number(1);
+}
+
+typedef struct {
+    double key;
+    ASTNode *item;
+} KeyedItem;
+
+static void merge_keyed(KeyedItem *src, int left, int mid, int right, KeyedItem *dst) {
+    int i = left, j = mid, k = left;
+    while (i < mid && j < right) dst[k++] = src[j].key < src[i].key ? src[j++] : src[i++];
+    while (i < mid) dst[k++] = src[i++];
+    while (j < right) dst[k++] = src[j++];
+}
+
+// sort_by(list, "function_name"): stable sort by the number a user-defined function returns
+// for each element. The key function runs once per element, not once per comparison.
+ASTNode *tesseract_sort_by(ASTNode **args, int arg_count) {
+    if (arg_count != 2 || args[0]->type != NODE_LIST || args[1]->type != NODE_STRING) return ast_new_number(0);
     
-    // Use bubble sort for simplicity in this minimal implementation
-    for (int i = 0; i < n - 1; i++) {
-        for (int j = 0; j < n - i - 1; j++) {
-            if (list->list.elements[j]->type == NODE_NUMBER && 
-                list->list.elements[j + 1]->type == NODE_NUMBER) {
-                if (list->list.elements[j]->number > list->list.elements[j + 1]->number) {
-                    ASTNode *temp = list->list.elements[j];
-                    list->list.elements[j] = list->list.elements[j + 1];
-                    list->list.elements[j + 1] = temp;
-                }
-            }
+    ASTNode *list = args[0];
+    int n = list->list.count;
+    KeyedItem *keyed = malloc(sizeof(KeyedItem) * (n > 0 ? n : 1));
+    KeyedItem *buffer = malloc(sizeof(KeyedItem) * (n > 0 ? n : 1));
+    for (int i = 0; i < n; i++) {
+        keyed[i].item = list->list.elements[i];
+        keyed[i].key = call_user_function(args[1]->string, &keyed[i].item, 1);
+    }
+
+    KeyedItem *src = keyed, *dst = buffer;
+    for (int width = 1; width < n; width *= 2) {
+        for (int left = 0; left < n; left += 2 * width) {
+            int mid = left + width < n ? left + width : n;
+            int right = left + 2 * width < n ? left + 2 * width : n;
+            merge_keyed(src, left, mid, right, dst);
         }
+        KeyedItem *temp = src;
+        src = dst;
+        dst = temp;
     }
+    for (int i = 0; i < n; i++) list->list.elements[i] = src[i].item;
+    free(keyed);
+    free(buffer);
     return ast_new_number(1);
 }
 
+// Numeric reductions
+//
+// Lists hold pointers to value nodes, so numbers are packed a chunk at a time into a
+// stack buffer and handed to the vectorized kernels in simd.h. Non-number elements are
+// skipped.
+
+#define PACK_CHUNK 1024
+
+// Packs the numbers among the next PACK_CHUNK elements from list[*next] into buffer,
+// recording each one's list index in positions when given. Returns how many were packed.
+static int pack_numbers(ASTNode *list, int *next, double *buffer, int *positions) {
+    ASTNode **elements = list->list.elements;
+    int i = *next, end = list->list.count, packed = 0;
+    if (end - i > PACK_CHUNK) end = i + PACK_CHUNK;
+    for (; i < end; i++) {
+        ASTNode *element = elements[i];
+        if (element->type == NODE_NUMBER) {
+            if (positions) positions[packed] = i;
+            buffer[packed++] = element->number;
+        }
+    }
+    *next = i;
+    return packed;
+}
+
+// Sum and number count over the list's numbers
+static double sum_numbers(ASTNode *list, int *count) {
+    double buffer[PACK_CHUNK], total = 0;
+    int next = 0;
+    *count = 0;
+    while (next < list->list.count) {
+        int packed = pack_numbers(list, &next, buffer, NULL);
+        total += simd_sum(buffer, packed);
+        *count += packed;
+    }
+    return total;
+}
+
+ASTNode *tesseract_list_sum(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
+    int count;
+    return ast_new_number(sum_numbers(args[0], &count));
+}
+
+ASTNode *tesseract_list_mean(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
+    int count;
+    double total = sum_numbers(args[0], &count);
+    return ast_new_number(count > 0 ? total / count : 0);
+}
+
+// Population variance, computed in two passes for accuracy
+ASTNode *tesseract_list_variance(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
+    int count;
+    double mean = sum_numbers(args[0], &count);
+    if (count == 0) return ast_new_number(0);
+    mean /= count;
+
+    double buffer[PACK_CHUNK], total = 0;
+    int next = 0;
+    while (next < args[0]->list.count) {
+        int packed = pack_numbers(args[0], &next, buffer, NULL);
+        total += simd_squared_deviation(buffer, packed, mean);
+    }
+    return ast_new_number(total / count);
+}
+
+// Dot product over positions where both lists hold numbers
+ASTNode *tesseract_list_dot(ASTNode **args, int arg_count) {
+    if (arg_count != 2 || args[0]->type != NODE_LIST || args[1]->type != NODE_LIST) return ast_new_number(0);
+    ASTNode *a = args[0], *b = args[1];
+    int n = a->list.count < b->list.count ? a->list.count : b->list.count;
+    double left[PACK_CHUNK], right[PACK_CHUNK], total = 0;
+    int i = 0;
+    while (i < n) {
+        int packed = 0;
+        for (; i < n && packed < PACK_CHUNK; i++) {
+            if (a->list.elements[i]->type == NODE_NUMBER && b->list.elements[i]->type == NODE_NUMBER) {
+                left[packed] = a->list.elements[i]->number;
+                right[packed++] = b->list.elements[i]->number;
+            }
+        }
+        total += simd_dot(left, right, packed);
+    }
+    return ast_new_number(total);
+}
+
+// Index of the first smallest (want_max == 0) or largest number, or -1 if there is none
+static int extreme_index(ASTNode *list, int want_max) {
+    double buffer[PACK_CHUNK], best = 0;
+    int positions[PACK_CHUNK];
+    int next = 0, best_index = -1;
+    while (next < list->list.count) {
+        int packed = pack_numbers(list, &next, buffer, positions);
+        if (packed == 0) continue;
+        size_t local = want_max ? simd_argmax(buffer, packed) : simd_argmin(buffer, packed);
+        if (best_index < 0 || (want_max ? buffer[local] > best : buffer[local] < best)) {
+            best = buffer[local];
+            best_index = positions[local];
+        }
+    }
+    return best_index;
+}
+
+ASTNode *tesseract_list_argmax(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(-1);
+    return ast_new_number(extreme_index(args[0], 1));
+}
+
+ASTNode *tesseract_list_argmin(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(-1);
+    return ast_new_number(extreme_index(args[0], 0));
+}
+
+// list_count_if(list, "<", 10): how many numbers satisfy the comparison
+ASTNode *tesseract_list_count_if(ASTNode **args, int arg_count) {
+    if (arg_count != 3 || args[0]->type != NODE_LIST || args[1]->type != NODE_STRING ||
+        args[2]->type != NODE_NUMBER) return ast_new_number(0);
+
+    static const char *operators[] = {"<", "<=", ">", ">=", "==", "!="};
+    static const SimdCompare compares[] = {SIMD_LESS, SIMD_LESS_EQUAL, SIMD_GREATER,
+                                           SIMD_GREATER_EQUAL, SIMD_EQUAL, SIMD_NOT_EQUAL};
+    int op = -1;
+    for (int i = 0; i < 6; i++)
+        if (strcmp(args[1]->string, operators[i]) == 0) op = i;
+    if (op < 0) return ast_new_number(0);
+
+    double buffer[PACK_CHUNK];
+    int next = 0;
+    size_t matches = 0;
+    while (next < args[0]->list.count) {
+        int packed = pack_numbers(args[0], &next, buffer, NULL);
+        matches += simd_count_compare(buffer, packed, compares[op], args[2]->number);
+    }
+    return ast_new_number((double)matches);
+}
+
+// simd_backend(): name of the kernels the reductions above run on
+ASTNode *tesseract_simd_backend(ASTNode **args, int arg_count) {
+    (void)args;
+    if (arg_count != 0) return ast_new_string("");
+    return ast_new_string(simd_backend());
+}
+
+// simd_set_backend("scalar"): 1 if the backend was selected, 0 if this CPU lacks it
+ASTNode *tesseract_simd_set_backend(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_STRING) return ast_new_number(0);
+    return ast_new_number(simd_set_backend(args[0]->string));
+}
+
 // Search algorithms
 ASTNode *tesseract_binary_search(ASTNode **args, int arg_count) {
     if (arg_count != 2 || args[0]->type != NODE_LIST || args[1]->type != NODE_NUMBER) 
@@ -74,14 +526,13 @@ ASTNode *tesseract_linear_search(ASTNode **args, int arg_count) {
     if (arg_count != 2 || args[0]->type != NODE_LIST || args[1]->type != NODE_NUMBER) 
         return ast_new_number(-1);
     
-    ASTNode *list = args[0];
-    double target = args[1]->number;
-    
-    for (int i = 0; i < list->list.count; i++) {
-        if (list->list.elements[i]->type == NODE_NUMBER && 
-            list->list.elements[i]->number == target) {
-            return ast_new_number(i);
-        }
+    double buffer[PACK_CHUNK];
+    int positions[PACK_CHUNK];
+    int next = 0;
+    while (next < args[0]->list.count) {
+        int packed = pack_numbers(args[0], &next, buffer, positions);
+        size_t found = simd_find(buffer, packed, args[1]->number);
+        if (found < (size_t)packed) return ast_new_number(positions[found]);
     }
     return ast_new_number(-1);
 }
@@ -104,42 +555,37 @@ ASTNode *tesseract_reverse(ASTNode **args, int arg_count) {
 ASTNode *tesseract_find_max(ASTNode **args, int arg_count) {
     if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
     
-    ASTNode *list = args[0];
-    if (list->list.count == 0) return ast_new_number(0);
-    
-    double max_val = list->list.elements[0]->number;
-    for (int i = 1; i < list->list.count; i++) {
-        if (list->list.elements[i]->type == NODE_NUMBER && 
-            list->list.elements[i]->number > max_val) {
-            max_val = list->list.elements[i]->number;
-        }
-    }
-    return ast_new_number(max_val);
+    int index = extreme_index(args[0], 1);
+    return ast_new_number(index < 0 ? 0 : args[0]->list.elements[index]->number);
 }
 
 ASTNode *tesseract_find_min(ASTNode **args, int arg_count) {
     if (arg_count != 1 || args[0]->type != NODE_LIST) return ast_new_number(0);
     
-    ASTNode *list = args[0];
-    if (list->list.count == 0) return ast_new_number(0);
-    
-    double min_val = list->list.elements[0]->number;
-    for (int i = 1; i < list->list.count; i++) {
-        if (list->list.elements[i]->type == NODE_NUMBER && 
-            list->list.elements[i]->number < min_val) {
-            min_val = list->list.elements[i]->number;
-        }
-    }
-    return ast_new_number(min_val);
+    int index = extreme_index(args[0], 0);
+    return ast_new_number(index < 0 ? 0 : args[0]->list.elements[index]->number);
 }
 
 // Package initialization function
 void init_algorithms_package() {
     register_package_function("bubble_sort", tesseract_bubble_sort);
     register_package_function("quick_sort", tesseract_quick_sort);
+    register_package_function("merge_sort", tesseract_merge_sort);
+    register_package_function("radix_sort", tesseract_radix_sort);
+    register_package_function("parallel_sort", tesseract_parallel_sort);
+    register_package_function("sort_by", tesseract_sort_by);
     register_package_function("binary_search", tesseract_binary_search);
     register_package_function("linear_search", tesseract_linear_search);
     register_package_function("reverse", tesseract_reverse);
     register_package_function("find_max", tesseract_find_max);
     register_package_function("find_min", tesseract_find_min);
+    register_package_function("list_sum", tesseract_list_sum);
+    register_package_function("list_mean", tesseract_list_mean);
+    register_package_function("list_variance", tesseract_list_variance);
+    register_package_function("list_dot", tesseract_list_dot);
+    register_package_function("list_argmin", tesseract_list_argmin);
+    register_package_function("list_argmax", tesseract_list_argmax);
+    register_package_function("list_count_if", tesseract_list_count_if);
+    register_package_function("simd_backend", tesseract_simd_backend);
+    register_package_function("simd_set_backend", tesseract_simd_set_backend);
 }
\ No newline at end of file
@@ -0,0 +1,475 @@
+#include "../core/package_loader.h"
+#include "../../include/ast.h"
+#include "../../include/error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+// Graph algorithms over NODE_GRAPH. Every function works on the CSR snapshot
+// built by ast_graph_freeze, so vertices are dense IDs and edges are contiguous.
+
+// Distance of vertices not reached yet (not INFINITY, which -ffast-math may assume away)
+#define UNREACHED DBL_MAX
+
+static ASTNode *copy_vertex(ASTNode *graph, int id) {
+    ASTNode *vertex = graph->graph.vertices[id];
+    if (vertex->type == NODE_STRING) return ast_new_string(vertex->string);
+    return ast_new_number(vertex->number);
+}
+
+// Dense ID of a vertex argument, or -1 if it is not in the graph
+static int vertex_arg(ASTNode *graph, ASTNode *arg) {
+    if (arg->type != NODE_NUMBER && arg->type != NODE_STRING) return -1;
+    return ast_graph_find_vertex(graph, arg);
+}
+
+// Dict mapping every reached vertex to its value
+static ASTNode *vertex_dict(ASTNode *graph, const double *values) {
+    ASTNode *dict = ast_new_dict();
+    for (int v = 0; v < graph->graph.vertex_count; v++) {
+        if (values[v] != UNREACHED)
+            ast_dict_add_pair(dict, copy_vertex(graph, v), ast_new_number(values[v]));
+    }
+    return dict;
+}
+
+static ASTNode *vertex_list(ASTNode *graph, const int *ids, int count) {
+    ASTNode *list = ast_new_list();
+    if (count > 0) list->list.elements = malloc(sizeof(ASTNode *) * count);
+    for (int i = 0; i < count; i++) list->list.elements[i] = copy_vertex(graph, ids[i]);
+    list->list.count = count;
+    return list;
+}
+
+// Binary min-heap of (distance, vertex) entries with lazy deletion
+typedef struct {
+    double *keys;
+    int *vertices;
+    int count;
+    int capacity;
+} DistHeap;
+
+static void heap_push(DistHeap *heap, double key, int vertex) {
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : 64;
+        heap->keys = realloc(heap->keys, sizeof(double) * heap->capacity);
+        heap->vertices = realloc(heap->vertices, sizeof(int) * heap->capacity);
+    }
+    int i = heap->count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap->keys[parent] <= key) break;
+        heap->keys[i] = heap->keys[parent];
+        heap->vertices[i] = heap->vertices[parent];
+        i = parent;
+    }
+    heap->keys[i] = key;
+    heap->vertices[i] = vertex;
+}
+
+static void heap_pop(DistHeap *heap, double *key, int *vertex) {
+    *key = heap->keys[0];
+    *vertex = heap->vertices[0];
+    double last_key = heap->keys[--heap->count];
+    int last_vertex = heap->vertices[heap->count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && heap->keys[child + 1] < heap->keys[child]) child++;
+        if (last_key <= heap->keys[child]) break;
+        heap->keys[i] = heap->keys[child];
+        heap->vertices[i] = heap->vertices[child];
+        i = child;
+    }
+    heap->keys[i] = last_key;
+    heap->vertices[i] = last_vertex;
+}
+
+// Dijkstra from source; stops early once target (if >= 0) is settled.
+// Returns 0 if a negative edge weight is found.
+static int run_dijkstra(ASTNode *graph, int source, int target, double *dist, int *pred) {
+    const int *offsets = graph->graph.csr_offsets;
+    const int *targets = graph->graph.csr_targets;
+    const double *weights = graph->graph.csr_weights;
+    int n = graph->graph.vertex_count;
+
+    for (int e = 0; e < offsets[n]; e++) {
+        if (weights[e] < 0) return 0;
+    }
+    for (int v = 0; v < n; v++) {
+        dist[v] = UNREACHED;
+        if (pred) pred[v] = -1;
+    }
+
+    DistHeap heap = {0};
+    dist[source] = 0;
+    heap_push(&heap, 0, source);
+    while (heap.count > 0) {
+        double d;
+        int v;
+        heap_pop(&heap, &d, &v);
+        if (d > dist[v]) continue; // stale entry
+        if (v == target) break;
+        for (int e = offsets[v]; e < offsets[v + 1]; e++) {
+            int w = targets[e];
+            double candidate = d + weights[e];
+            if (candidate < dist[w]) {
+                dist[w] = candidate;
+                if (pred) pred[w] = v;
+                heap_push(&heap, candidate, w);
+            }
+        }
+    }
+    free(heap.keys);
+    free(heap.vertices);
+    return 1;
+}
+
+// dijkstra(graph, source) -> dict of vertex: distance for every reachable vertex
+ASTNode *tesseract_dijkstra(ASTNode **args, int arg_count) {
+    if (arg_count != 2 || args[0]->type != NODE_GRAPH) return ast_new_number(0);
+    ASTNode *graph = args[0];
+    int source = vertex_arg(graph, args[1]);
+    if (source < 0) return ast_new_dict();
+
+    ast_graph_freeze(graph);
+    double *dist = malloc(sizeof(double) * graph->graph.vertex_count);
+    if (!run_dijkstra(graph, source, -1, dist, NULL)) {
+        free(dist);
+        return ast_new_number(0);
+    }
+    ASTNode *result = vertex_dict(graph, dist);
+    free(dist);
+    return result;
+}
+
+// shortest_path(graph, source, target) -> list of vertices, empty if unreachable
+ASTNode *tesseract_shortest_path(ASTNode **args, int arg_count) {
+    if (arg_count != 3 || args[0]->type != NODE_GRAPH) return ast_new_number(0);
+    ASTNode *graph = args[0];
+    int source = vertex_arg(graph, args[1]);
+    int target = vertex_arg(graph, args[2]);
+    if (source < 0 || target < 0) return ast_new_list();
+
+    ast_graph_freeze(graph);
+    int n = graph->graph.vertex_count;
+    double *dist = malloc(sizeof(double) * n);
+    int *pred = malloc(sizeof(int) * n);
+    if (!run_dijkstra(graph, source, target, dist, pred)) {
+        free(dist);
+        free(pred);
+        return ast_new_number(0);
+    }
+
+    int *path = malloc(sizeof(int) * n);
+    int length = 0;
+    if (dist[target] != UNREACHED) {
+        for (int v = target; v >= 0; v = pred[v]) path[length++] = v;
+        for (int i = 0; i < length / 2; i++) {
+            int tmp = path[i];
+            path[i] = path[length - 1 - i];
+            path[length - 1 - i] = tmp;
+        }
+    }
+    ASTNode *result = vertex_list(graph, path, length);
+    free(dist);
+    free(pred);
+    free(path);
+    return result;
+}
+
+// bfs_distances(graph, source) -> dict of vertex: hop count for every reachable vertex
+ASTNode *tesseract_bfs_distances(ASTNode **args, int arg_count) {
+    if (arg_count != 2 || args[0]->type != NODE_GRAPH) return ast_new_number(0);
+    ASTNode *graph = args[0];
+    int source = vertex_arg(graph, args[1]);
+    if (source < 0) return ast_new_dict();
+
+    ast_graph_freeze(graph);
+    const int *offsets = graph->graph.csr_offsets;
+    const int *targets = graph->graph.csr_targets;
+    int n = graph->graph.vertex_count;
+    double *dist = malloc(sizeof(double) * n);
+    int *queue = malloc(sizeof(int) * n);
+    for (int v = 0; v < n; v++) dist[v] = UNREACHED;
+
+    int tail = 0;
+    dist[source] = 0;
+    queue[tail++] = source;
+    for (int head = 0; head < tail; head++) {
+        int v = queue[head];
+        for (int e = offsets[v]; e < offsets[v + 1]; e++) {
+            if (dist[targets[e]] == UNREACHED) {
+                dist[targets[e]] = dist[v] + 1;
+                queue[tail++] = targets[e];
+            }
+        }
+    }
+    ASTNode *result = vertex_dict(graph, dist);
+    free(dist);
+    free(queue);
+    return result;
+}
+
+// Append a vertex and sep to the message in out, which already holds used bytes
+static size_t append_vertex(char *out, size_t size, size_t used, ASTNode *vertex, const char *sep) {
+    if (used >= size) return used;
+    if (vertex->type == NODE_STRING) return used + snprintf(out + used, size - used, "%s%s", vertex->string, sep);
+    return used + snprintf(out + used, size - used, "%g%s", vertex->number, sep);
+}
+
+// Describe one cycle among the vertices Kahn's algorithm left with a nonzero
+// in-degree. Each of those has a predecessor that was also left, so walking
+// predecessors from any of them must come back to a vertex already on the walk.
+static void describe_cycle(ASTNode *graph, const int *in_degree, char *out, size_t size) {
+    const int *offsets = graph->graph.csr_offsets;
+    const int *targets = graph->graph.csr_targets;
+    int n = graph->graph.vertex_count;
+    int *pred = malloc(sizeof(int) * (n + 1));
+    int *step = malloc(sizeof(int) * (n + 1)); // Position on the walk, or -1
+    int *walk = malloc(sizeof(int) * (n + 1));
+    if (!pred || !step || !walk) {
+        perror("Failed to allocate cycle search");
+        exit(EXIT_FAILURE);
+    }
+    int start = -1;
+    for (int v = 0; v < n; v++) {
+        step[v] = -1;
+        if (in_degree[v] > 0 && start < 0) start = v;
+        for (int e = offsets[v]; e < offsets[v + 1]; e++) {
+            if (in_degree[v] > 0 && in_degree[targets[e]] > 0) pred[targets[e]] = v;
+        }
+    }
+
+    int length = 0, v = start;
+    while (step[v] < 0) {
+        step[v] = length;
+        walk[length++] = v;
+        v = pred[v];
+    }
+
+    // The walk runs against the edges, so list it backwards from where it closed,
+    // ending back at the first vertex listed
+    size_t used = snprintf(out, size, "topological_sort() found a cycle: ");
+    for (int i = length - 1; i >= step[v]; i--)
+        used = append_vertex(out, size, used, graph->graph.vertices[walk[i]], " -> ");
+    append_vertex(out, size, used, graph->graph.vertices[walk[length - 1]], "");
+    free(pred);
+    free(step);
+    free(walk);
+}
+
+// topological_sort(graph) -> list of vertices (Kahn's algorithm); a cycle raises a runtime error
+ASTNode *tesseract_topological_sort(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_GRAPH) return ast_new_number(0);
+    ASTNode *graph = args[0];
+
+    ast_graph_freeze(graph);
+    const int *offsets = graph->graph.csr_offsets;
+    const int *targets = graph->graph.csr_targets;
+    int n = graph->graph.vertex_count;
+    int *in_degree = calloc(n + 1, sizeof(int));
+    int *order = malloc(sizeof(int) * (n + 1));
+    for (int e = 0; e < offsets[n]; e++) in_degree[targets[e]]++;
+
+    // order doubles as the queue of vertices whose in-degree reached zero
+    int tail = 0;
+    for (int v = 0; v < n; v++) {
+        if (in_degree[v] == 0) order[tail++] = v;
+    }
+    for (int head = 0; head < tail; head++) {
+        int v = order[head];
+        for (int e = offsets[v]; e < offsets[v + 1]; e++) {
+            if (--in_degree[targets[e]] == 0) order[tail++] = targets[e];
+        }
+    }
+    if (tail < n) {
+        char message[256];
+        describe_cycle(graph, in_degree, message, sizeof(message));
+        free(in_degree);
+        free(order);
+        error_throw(ERROR_RUNTIME, message);
+    }
+    ASTNode *result = vertex_list(graph, order, n);
+    free(in_degree);
+    free(order);
+    return result;
+}
+
+static int find_root(int *parent, int v) {
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]]; // path halving
+        v = parent[v];
+    }
+    return v;
+}
+
+// connected_components(graph) -> dict of vertex: component number, ignoring edge direction
+ASTNode *tesseract_connected_components(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_GRAPH) return ast_new_number(0);
+    ASTNode *graph = args[0];
+
+    ast_graph_freeze(graph);
+    const int *offsets = graph->graph.csr_offsets;
+    const int *targets = graph->graph.csr_targets;
+    int n = graph->graph.vertex_count;
+    int *parent = malloc(sizeof(int) * (n + 1));
+    for (int v = 0; v < n; v++) parent[v] = v;
+    for (int v = 0; v < n; v++) {
+        for (int e = offsets[v]; e < offsets[v + 1]; e++) {
+            int a = find_root(parent, v);
+            int b = find_root(parent, targets[e]);
+            if (a != b) parent[a < b ? b : a] = a < b ? a : b;
+        }
+    }
+
+    // Number components in order of their first vertex
+    double *component = malloc(sizeof(double) * (n + 1));
+    int *label = malloc(sizeof(int) * (n + 1));
+    int next = 0;
+    for (int v = 0; v < n; v++) label[v] = -1;
+    for (int v = 0; v < n; v++) {
+        int root = find_root(parent, v);
+        if (label[root] < 0) label[root] = next++;
+        component[v] = label[root];
+    }
+    ASTNode *result = vertex_dict(graph, component);
+    free(parent);
+    free(component);
+    free(label);
+    return result;
+}
+
+// strongly_connected_components(graph) -> dict of vertex: component number (iterative Tarjan).
+// Components are numbered in reverse topological order of the condensation.
+ASTNode *tesseract_strongly_connected_components(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_GRAPH) return ast_new_number(0);
+    ASTNode *graph = args[0];
+
+    ast_graph_freeze(graph);
+    const int *offsets = graph->graph.csr_offsets;
+    const int *targets = graph->graph.csr_targets;
+    int n = graph->graph.vertex_count;
+    int *index = malloc(sizeof(int) * (n + 1));
+    int *low = malloc(sizeof(int) * (n + 1));
+    char *on_stack = calloc(n + 1, 1);
+    int *stack = malloc(sizeof(int) * (n + 1));
+    int *call_vertex = malloc(sizeof(int) * (n + 1));
+    int *call_edge = malloc(sizeof(int) * (n + 1));
+    double *component = malloc(sizeof(double) * (n + 1));
+    int counter = 0, stack_top = 0, components = 0;
+    for (int v = 0; v < n; v++) index[v] = -1;
+
+    for (int root = 0; root < n; root++) {
+        if (index[root] >= 0) continue;
+        int depth = 0;
+        call_vertex[0] = root;
+        call_edge[0] = offsets[root];
+        index[root] = low[root] = counter++;
+        stack[stack_top++] = root;
+        on_stack[root] = 1;
+
+        while (depth >= 0) {
+            int v = call_vertex[depth];
+            if (call_edge[depth] < offsets[v + 1]) {
+                int w = targets[call_edge[depth]++];
+                if (index[w] < 0) {
+                    index[w] = low[w] = counter++;
+                    stack[stack_top++] = w;
+                    on_stack[w] = 1;
+                    depth++;
+                    call_vertex[depth] = w;
+                    call_edge[depth] = offsets[w];
+                } else if (on_stack[w] && index[w] < low[v]) {
+                    low[v] = index[w];
+                }
+                continue;
+            }
+
+            // All edges of v explored: pop a component if v is its root
+            if (low[v] == index[v]) {
+                int w;
+                do {
+                    w = stack[--stack_top];
+                    on_stack[w] = 0;
+                    component[w] = components;
+                } while (w != v);
+                components++;
+            }
+            depth--;
+            if (depth >= 0 && low[v] < low[call_vertex[depth]]) low[call_vertex[depth]] = low[v];
+        }
+    }
+
+    ASTNode *result = vertex_dict(graph, component);
+    free(index);
+    free(low);
+    free(on_stack);
+    free(stack);
+    free(call_vertex);
+    free(call_edge);
+    free(component);
+    return result;
+}
+
+// pagerank(graph[, damping[, iterations]]) -> dict of vertex: rank.
+// Edge weights are ignored; rank from vertices without out-edges is spread evenly.
+ASTNode *tesseract_pagerank(ASTNode **args, int arg_count) {
+    if (arg_count < 1 || arg_count > 3 || args[0]->type != NODE_GRAPH) return ast_new_number(0);
+    ASTNode *graph = args[0];
+    double damping = 0.85;
+    int iterations = 100;
+    if (arg_count > 1 && args[1]->type == NODE_NUMBER) damping = args[1]->number;
+    if (arg_count > 2 && args[2]->type == NODE_NUMBER) iterations = (int)args[2]->number;
+
+    ast_graph_freeze(graph);
+    const int *offsets = graph->graph.csr_offsets;
+    const int *targets = graph->graph.csr_targets;
+    int n = graph->graph.vertex_count;
+    if (n == 0) return ast_new_dict();
+
+    double *rank = malloc(sizeof(double) * n);
+    double *next = malloc(sizeof(double) * n);
+    for (int v = 0; v < n; v++) rank[v] = 1.0 / n;
+
+    for (int iter = 0; iter < iterations; iter++) {
+        double dangling = 0;
+        for (int v = 0; v < n; v++) {
+            if (offsets[v + 1] == offsets[v]) dangling += rank[v];
+        }
+        double base = (1.0 - damping) / n + damping * dangling / n;
+        for (int v = 0; v < n; v++) next[v] = base;
+        for (int v = 0; v < n; v++) {
+            int degree = offsets[v + 1] - offsets[v];
+            if (degree == 0) continue;
+            double share = damping * rank[v] / degree;
+            for (int e = offsets[v]; e < offsets[v + 1]; e++) next[targets[e]] += share;
+        }
+
+        double delta = 0;
+        for (int v = 0; v < n; v++) delta += fabs(next[v] - rank[v]);
+        double *tmp = rank;
+        rank = next;
+        next = tmp;
+        if (delta < 1e-12) break;
+    }
+
+    ASTNode *result = vertex_dict(graph, rank);
+    free(rank);
+    free(next);
+    return result;
+}
+
+// Package initialization function
+void init_graph_algorithms_package() {
+    register_package_function("dijkstra", tesseract_dijkstra);
+    register_package_function("shortest_path", tesseract_shortest_path);
+    register_package_function("bfs_distances", tesseract_bfs_distances);
+    register_package_function("topological_sort", tesseract_topological_sort);
+    register_package_function("connected_components", tesseract_connected_components);
+    register_package_function("strongly_connected_components", tesseract_strongly_connected_components);
+    register_package_function("pagerank", tesseract_pagerank);
+}
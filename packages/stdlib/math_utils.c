@@ -1,8 +1,10 @@
 #include "../core/package_loader.h"
 #include "../../include/ast.h"
+#include "../../include/ndarray.h"
 #include <math.h>
 
-// Math package functions for Tesseract
+// Math package functions for Tesseract. The single-argument functions and power
+// also work elementwise on ndarrays (see ndarray_utils.c).
 ASTNode *tesseract_factorial(ASTNode **args, int arg_count)
 {
     if (arg_count != 1 || args[0]->type != NODE_NUMBER)
@@ -22,6 +24,13 @@ ASTNode *tesseract_factorial(ASTNode **args, int arg_count)
 
 ASTNode *tesseract_power(ASTNode **args, int arg_count)
 {
+    if (arg_count == 2 && args[0]->type == NODE_NDARRAY && args[1]->type == NODE_NUMBER)
+    {
+        ASTNode *exponent = ndarray_scalar(args[1]->number);
+        ASTNode *result = ndarray_binary(args[0], exponent, ND_POW);
+        ast_free(exponent);
+        return result;
+    }
     if (arg_count != 2 || args[0]->type != NODE_NUMBER || args[1]->type != NODE_NUMBER)
         return ast_new_number(0);
 
@@ -32,6 +41,8 @@ ASTNode *tesseract_power(ASTNode **args, int arg_count)
 
 ASTNode *tesseract_sqrt(ASTNode **args, int arg_count)
 {
+    if (arg_count == 1 && args[0]->type == NODE_NDARRAY)
+        return ndarray_map(args[0], sqrt);
     if (arg_count != 1 || args[0]->type != NODE_NUMBER)
         return ast_new_number(0);
 
@@ -44,6 +55,8 @@ ASTNode *tesseract_sqrt(ASTNode **args, int arg_count)
 
 ASTNode *tesseract_abs(ASTNode **args, int arg_count)
 {
+    if (arg_count == 1 && args[0]->type == NODE_NDARRAY)
+        return ndarray_map(args[0], fabs);
     if (arg_count != 1 || args[0]->type != NODE_NUMBER)
         return ast_new_number(0);
 
@@ -53,6 +66,8 @@ ASTNode *tesseract_abs(ASTNode **args, int arg_count)
 
 ASTNode *tesseract_sin(ASTNode **args, int arg_count)
 {
+    if (arg_count == 1 && args[0]->type == NODE_NDARRAY)
+        return ndarray_map(args[0], sin);
     if (arg_count != 1 || args[0]->type != NODE_NUMBER)
         return ast_new_number(0);
 
@@ -62,6 +77,8 @@ ASTNode *tesseract_sin(ASTNode **args, int arg_count)
 
 ASTNode *tesseract_cos(ASTNode **args, int arg_count)
 {
+    if (arg_count == 1 && args[0]->type == NODE_NDARRAY)
+        return ndarray_map(args[0], cos);
     if (arg_count != 1 || args[0]->type != NODE_NUMBER)
         return ast_new_number(0);
 
@@ -71,6 +88,8 @@ ASTNode *tesseract_cos(ASTNode **args, int arg_count)
 
 ASTNode *tesseract_tan(ASTNode **args, int arg_count)
 {
+    if (arg_count == 1 && args[0]->type == NODE_NDARRAY)
+        return ndarray_map(args[0], tan);
     if (arg_count != 1 || args[0]->type != NODE_NUMBER)
         return ast_new_number(0);
 
@@ -0,0 +1,316 @@
+#include "../core/package_loader.h"
+#include "../../include/ast.h"
+#include "../../include/ndarray.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// N-dimensional arrays for numeric work. Arrays live in one contiguous buffer of
+// doubles, so elementwise ops, reductions and matmul run as tight loops over
+// memory instead of walking nested lists. Wherever an array is expected, a list
+// (flat or nested) or a plain number is accepted too.
+
+// Argument as an array: arrays as they are, lists and numbers converted. Sets *owned
+// when the caller must free the result. NULL if the argument is not numeric.
+static ASTNode *as_array(ASTNode *arg, int *owned) {
+    *owned = 0;
+    if (arg->type == NODE_NDARRAY) return arg;
+    *owned = 1;
+    if (arg->type == NODE_NUMBER) return ndarray_scalar(arg->number);
+    if (arg->type == NODE_LIST) return ndarray_from_list(arg);
+    return NULL;
+}
+
+// Shape argument: a number for 1-D or a list of dimensions. Returns ndim, or -1
+static int shape_arg(ASTNode *arg, int *shape) {
+    if (arg->type == NODE_NUMBER) {
+        if (arg->number < 0) return -1;
+        shape[0] = (int)arg->number;
+        return 1;
+    }
+    if (arg->type != NODE_LIST || arg->list.count > NDARRAY_MAX_DIMS) return -1;
+    for (int d = 0; d < arg->list.count; d++) {
+        ASTNode *dim = arg->list.elements[d];
+        if (dim->type != NODE_NUMBER || dim->number < 0) return -1;
+        shape[d] = (int)dim->number;
+    }
+    return arg->list.count;
+}
+
+// Results of a 0-d array are handed back as plain numbers
+static ASTNode *array_result(ASTNode *array) {
+    if (array->ndarray.ndim > 0) return array;
+    ASTNode *number = ast_new_number(ndarray_data(array)[0]);
+    ast_free(array);
+    return number;
+}
+
+static void shape_error(const char *function, ASTNode *a, ASTNode *b) {
+    printf("Runtime error: %s() cannot combine arrays of shape (", function);
+    for (int d = 0; d < a->ndarray.ndim; d++) printf(d ? ", %d" : "%d", a->ndarray.shape[d]);
+    printf(") and (");
+    for (int d = 0; d < b->ndarray.ndim; d++) printf(d ? ", %d" : "%d", b->ndarray.shape[d]);
+    printf(")\n");
+    exit(1);
+}
+
+// --- Creation and conversion ---
+
+// nd_array([[1, 2], [3, 4]]): array from a list of numbers or a rectangular nested list
+ASTNode *tesseract_nd_array(ASTNode **args, int arg_count) {
+    if (arg_count != 1) return ast_new_number(0);
+    if (args[0]->type == NODE_NDARRAY) return ndarray_share(args[0]);
+    if (args[0]->type != NODE_LIST) return ast_new_number(0);
+    ASTNode *array = ndarray_from_list(args[0]);
+    if (!array) {
+        printf("Runtime error: nd_array() needs a list of numbers or equally sized lists of numbers\n");
+        exit(1);
+    }
+    return array;
+}
+
+static ASTNode *filled(ASTNode **args, int arg_count, double value) {
+    int shape[NDARRAY_MAX_DIMS];
+    int ndim = arg_count >= 1 ? shape_arg(args[0], shape) : -1;
+    if (ndim < 0) return ast_new_number(0);
+    ASTNode *array = ndarray_new(ndim, shape);
+    if (value != 0) {
+        double *data = ndarray_data(array);
+        long size = ndarray_size(array);
+        for (long i = 0; i < size; i++) data[i] = value;
+    }
+    return array;
+}
+
+ASTNode *tesseract_nd_zeros(ASTNode **args, int arg_count) {
+    if (arg_count != 1) return ast_new_number(0);
+    return filled(args, arg_count, 0);
+}
+
+ASTNode *tesseract_nd_ones(ASTNode **args, int arg_count) {
+    if (arg_count != 1) return ast_new_number(0);
+    return filled(args, arg_count, 1);
+}
+
+// nd_full(shape, value)
+ASTNode *tesseract_nd_full(ASTNode **args, int arg_count) {
+    if (arg_count != 2 || args[1]->type != NODE_NUMBER) return ast_new_number(0);
+    return filled(args, arg_count, args[1]->number);
+}
+
+// nd_arange(stop), nd_arange(start, stop) or nd_arange(start, stop, step)
+ASTNode *tesseract_nd_arange(ASTNode **args, int arg_count) {
+    if (arg_count < 1 || arg_count > 3) return ast_new_number(0);
+    for (int i = 0; i < arg_count; i++)
+        if (args[i]->type != NODE_NUMBER) return ast_new_number(0);
+    double start = arg_count > 1 ? args[0]->number : 0;
+    double stop = arg_count > 1 ? args[1]->number : args[0]->number;
+    double step = arg_count > 2 ? args[2]->number : 1;
+    if (step == 0) return ast_new_number(0);
+    double span = (stop - start) / step;
+    int count = span > 0 ? (int)span + (span > (int)span) : 0;
+    ASTNode *array = ndarray_new(1, &count);
+    double *data = ndarray_data(array);
+    for (int i = 0; i < count; i++) data[i] = start + i * step;
+    return array;
+}
+
+ASTNode *tesseract_nd_tolist(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_NDARRAY) return ast_new_number(0);
+    if (args[0]->ndarray.ndim == 0) return ast_new_number(ndarray_data(args[0])[0]);
+    return ndarray_to_list(args[0]);
+}
+
+// --- Shape ---
+
+ASTNode *tesseract_nd_shape(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_NDARRAY) return ast_new_number(0);
+    ASTNode *list = ast_new_list();
+    for (int d = 0; d < args[0]->ndarray.ndim; d++)
+        ast_list_add_element(list, ast_new_number(args[0]->ndarray.shape[d]));
+    return list;
+}
+
+ASTNode *tesseract_nd_size(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_NDARRAY) return ast_new_number(0);
+    return ast_new_number((double)ndarray_size(args[0]));
+}
+
+ASTNode *tesseract_nd_ndim(ASTNode **args, int arg_count) {
+    if (arg_count != 1 || args[0]->type != NODE_NDARRAY) return ast_new_number(0);
+    return ast_new_number(args[0]->ndarray.ndim);
+}
+
+// nd_reshape(a, [rows, cols]): a view when a is contiguous, else a copy
+ASTNode *tesseract_nd_reshape(ASTNode **args, int arg_count) {
+    int owned, shape[NDARRAY_MAX_DIMS];
+    if (arg_count != 2) return ast_new_number(0);
+    int ndim = shape_arg(args[1], shape);
+    ASTNode *array = as_array(args[0], &owned);
+    if (!array || ndim < 0) {
+        if (owned && array) ast_free(array);
+        return ast_new_number(0);
+    }
+    ASTNode *result = ndarray_reshape(array, ndim, shape);
+    if (!result) {
+        printf("Runtime error: nd_reshape() cannot reshape %ld elements into the given shape\n",
+               ndarray_size(array));
+        exit(1);
+    }
+    if (owned) ast_free(array);
+    return result;
+}
+
+// nd_transpose(a): view with the axes reversed, no copying
+ASTNode *tesseract_nd_transpose(ASTNode **args, int arg_count) {
+    int owned;
+    if (arg_count != 1) return ast_new_number(0);
+    ASTNode *array = as_array(args[0], &owned);
+    if (!array) return ast_new_number(0);
+    ASTNode *result = ndarray_transpose(array);
+    if (owned) ast_free(array);
+    return result;
+}
+
+// nd_get(a, i, j, k): the element at a full index, or a view of the sub-array at a
+// partial one (nd_get(matrix, 0) is the first row)
+ASTNode *tesseract_nd_get(ASTNode **args, int arg_count) {
+    if (arg_count < 2 || args[0]->type != NODE_NDARRAY) return ast_new_number(0);
+    ASTNode *array = args[0];
+    int count = arg_count - 1;
+    if (count > array->ndarray.ndim) return ast_new_number(0);
+    int index[NDARRAY_MAX_DIMS];
+    for (int d = 0; d < count; d++) {
+        if (args[d + 1]->type != NODE_NUMBER) return ast_new_number(0);
+        index[d] = (int)args[d + 1]->number;
+        if (index[d] < 0) index[d] += array->ndarray.shape[d];
+        if (index[d] < 0 || index[d] >= array->ndarray.shape[d]) {
+            printf("Runtime error: nd_get() index %d out of range for axis %d of length %d\n",
+                   (int)args[d + 1]->number, d, array->ndarray.shape[d]);
+            exit(1);
+        }
+    }
+    if (count == array->ndarray.ndim) return ast_new_number(ndarray_get(array, index));
+    ASTNode *view = ndarray_share(array);
+    for (int d = 0; d < count; d++) {
+        ASTNode *next = ndarray_index(view, index[d]);
+        ast_free(view);
+        view = next;
+    }
+    return view;
+}
+
+// --- Elementwise arithmetic with broadcasting ---
+
+static ASTNode *binary(ASTNode **args, int arg_count, NDBinaryOp op, const char *name) {
+    int owned_a, owned_b;
+    if (arg_count != 2) return ast_new_number(0);
+    ASTNode *a = as_array(args[0], &owned_a);
+    ASTNode *b = as_array(args[1], &owned_b);
+    ASTNode *result = a && b ? ndarray_binary(a, b, op) : NULL;
+    if (a && b && !result) shape_error(name, a, b);
+    if (owned_a && a) ast_free(a);
+    if (owned_b && b) ast_free(b);
+    return result ? array_result(result) : ast_new_number(0);
+}
+
+ASTNode *tesseract_nd_add(ASTNode **args, int arg_count) {
+    return binary(args, arg_count, ND_ADD, "nd_add");
+}
+
+ASTNode *tesseract_nd_sub(ASTNode **args, int arg_count) {
+    return binary(args, arg_count, ND_SUB, "nd_sub");
+}
+
+ASTNode *tesseract_nd_mul(ASTNode **args, int arg_count) {
+    return binary(args, arg_count, ND_MUL, "nd_mul");
+}
+
+ASTNode *tesseract_nd_div(ASTNode **args, int arg_count) {
+    return binary(args, arg_count, ND_DIV, "nd_div");
+}
+
+ASTNode *tesseract_nd_pow(ASTNode **args, int arg_count) {
+    return binary(args, arg_count, ND_POW, "nd_pow");
+}
+
+// --- Reductions ---
+
+// Over the whole array without an axis (a number), or along one axis (an array)
+static ASTNode *reduce(ASTNode **args, int arg_count, NDReduceOp op) {
+    int owned;
+    if (arg_count < 1 || arg_count > 2) return ast_new_number(0);
+    ASTNode *array = as_array(args[0], &owned);
+    if (!array) return ast_new_number(0);
+    ASTNode *result;
+    if (arg_count == 1) {
+        result = ast_new_number(ndarray_reduce_all(array, op));
+    } else {
+        int axis = args[1]->type == NODE_NUMBER ? (int)args[1]->number : 0;
+        if (axis < 0) axis += array->ndarray.ndim;
+        if (axis < 0 || axis >= array->ndarray.ndim) {
+            printf("Runtime error: axis %d is out of range for an array with %d dimensions\n",
+                   (int)args[1]->number, array->ndarray.ndim);
+            exit(1);
+        }
+        result = array_result(ndarray_reduce_axis(array, op, axis));
+    }
+    if (owned) ast_free(array);
+    return result;
+}
+
+ASTNode *tesseract_nd_sum(ASTNode **args, int arg_count) {
+    return reduce(args, arg_count, ND_SUM);
+}
+
+ASTNode *tesseract_nd_mean(ASTNode **args, int arg_count) {
+    return reduce(args, arg_count, ND_MEAN);
+}
+
+ASTNode *tesseract_nd_min(ASTNode **args, int arg_count) {
+    return reduce(args, arg_count, ND_MIN);
+}
+
+ASTNode *tesseract_nd_max(ASTNode **args, int arg_count) {
+    return reduce(args, arg_count, ND_MAX);
+}
+
+// --- Linear algebra ---
+
+// nd_matmul(a, b): matrix product, with 1-D operands as row or column vectors
+ASTNode *tesseract_nd_matmul(ASTNode **args, int arg_count) {
+    int owned_a, owned_b;
+    if (arg_count != 2) return ast_new_number(0);
+    ASTNode *a = as_array(args[0], &owned_a);
+    ASTNode *b = as_array(args[1], &owned_b);
+    ASTNode *result = a && b ? ndarray_matmul(a, b) : NULL;
+    if (a && b && !result) shape_error("nd_matmul", a, b);
+    if (owned_a && a) ast_free(a);
+    if (owned_b && b) ast_free(b);
+    return result ? array_result(result) : ast_new_number(0);
+}
+
+// Package initialization function
+void init_ndarray_utils_package() {
+    register_package_function("nd_array", tesseract_nd_array);
+    register_package_function("nd_zeros", tesseract_nd_zeros);
+    register_package_function("nd_ones", tesseract_nd_ones);
+    register_package_function("nd_full", tesseract_nd_full);
+    register_package_function("nd_arange", tesseract_nd_arange);
+    register_package_function("nd_tolist", tesseract_nd_tolist);
+    register_package_function("nd_shape", tesseract_nd_shape);
+    register_package_function("nd_size", tesseract_nd_size);
+    register_package_function("nd_ndim", tesseract_nd_ndim);
+    register_package_function("nd_reshape", tesseract_nd_reshape);
+    register_package_function("nd_transpose", tesseract_nd_transpose);
+    register_package_function("nd_get", tesseract_nd_get);
+    register_package_function("nd_add", tesseract_nd_add);
+    register_package_function("nd_sub", tesseract_nd_sub);
+    register_package_function("nd_mul", tesseract_nd_mul);
+    register_package_function("nd_div", tesseract_nd_div);
+    register_package_function("nd_pow", tesseract_nd_pow);
+    register_package_function("nd_sum", tesseract_nd_sum);
+    register_package_function("nd_mean", tesseract_nd_mean);
+    register_package_function("nd_min", tesseract_nd_min);
+    register_package_function("nd_max", tesseract_nd_max);
+    register_package_function("nd_matmul", tesseract_nd_matmul);
+}
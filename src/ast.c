@@ -1,7 +1,12 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "ast.h"
+#include "temporal.h"
+#include "persistent.h"
+#include "ndarray.h"
+#include "heap.h"
 
 // --- AST Node Creation ---
 
@@ -277,6 +282,9 @@ ASTNode *ast_new_list()
     node->type = NODE_LIST;
     node->list.elements = NULL;
     node->list.count = 0;
+    node->list.stride = 1;
+    node->list.refs = 0;
+    node->list.base = NULL;
     return node;
 }
 
@@ -292,19 +300,31 @@ ASTNode *ast_list_access(ASTNode *list, int index)
 {
     if (list->type != NODE_LIST || index < 0 || index >= list->list.count)
         return NULL;
-    return list->list.elements[index];
+    return list->list.elements[(size_t)index * list->list.stride];
 }
 
-ASTNode *ast_list_slice(ASTNode *list, int start, int end)
+// Elements start..end (end clamped to the length) taking every step-th one.
+// The view points into the parent's storage, so no elements are copied.
+ASTNode *ast_list_slice(ASTNode *list, int start, int end, int step)
 {
-    if (list->type != NODE_LIST || start < 0 || end > list->list.count || start > end)
+    if (list->type != NODE_LIST || step < 1)
         return NULL;
-    ASTNode *new_list = ast_new_list();
-    for (int i = start; i < end; i++)
-    {
-        ast_list_add_element(new_list, list->list.elements[i]);
-    }
-    return new_list;
+    if (end > list->list.count)
+        end = list->list.count;
+    if (start < 0 || start > end)
+        return NULL;
+
+    // Slices of views point straight at the owning list
+    ASTNode *owner = list->list.base ? list->list.base : list;
+    ASTNode *view = malloc(sizeof(ASTNode));
+    view->type = NODE_LIST;
+    view->list.elements = list->list.elements ? list->list.elements + (size_t)start * list->list.stride : NULL;
+    view->list.count = (end - start + step - 1) / step;
+    view->list.stride = list->list.stride * step;
+    view->list.refs = 0;
+    view->list.base = owner;
+    owner->list.refs++;
+    return view;
 }
 
 ASTNode *ast_new_list_access(ASTNode *list, ASTNode *index)
@@ -316,6 +336,17 @@ ASTNode *ast_new_list_access(ASTNode *list, ASTNode *index)
     return node;
 }
 
+ASTNode *ast_new_list_slice(ASTNode *list, ASTNode *start, ASTNode *end, ASTNode *step)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LIST_SLICE;
+    node->list_slice.list = list;
+    node->list_slice.start = start;
+    node->list_slice.end = end;
+    node->list_slice.step = step;
+    return node;
+}
+
 ASTNode *ast_new_list_len(ASTNode *list)
 {
     ASTNode *node = malloc(sizeof(ASTNode));
@@ -438,6 +469,14 @@ ASTNode *ast_new_pattern_match(ASTNode *pattern, ASTNode *noise)
     node->type = NODE_PATTERN_MATCH;
     node->pattern_match.pattern = pattern;
     node->pattern_match.noise = noise;
+    node->pattern_match.matcher = NULL;
+    return node;
+}
+
+ASTNode *ast_new_pattern_match_any(ASTNode *patterns, ASTNode *noise)
+{
+    ASTNode *node = ast_new_pattern_match(patterns, noise);
+    node->type = NODE_PATTERN_MATCH_ANY;
     return node;
 }
 
@@ -535,17 +574,135 @@ ASTNode *ast_new_dict()
     node->dict.keys = NULL;
     node->dict.values = NULL;
     node->dict.count = 0;
+    node->dict.capacity = 0;
+    node->dict.index = NULL;
+    node->dict.index_size = 0;
     return node;
 }
 
+// --- Value hashing ---
+
+static unsigned long mix_hash(unsigned long long h)
+{
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return (unsigned long)h;
+}
+
+unsigned long ast_value_hash(ASTNode *value)
+{
+    if (value->type == NODE_NUMBER)
+    {
+        double d = value->number == 0 ? 0.0 : value->number; // -0 and 0 are the same key
+        unsigned long long bits;
+        memcpy(&bits, &d, sizeof(bits));
+        return mix_hash(bits);
+    }
+    if (value->type == NODE_STRING)
+    {
+        // FNV-1a
+        unsigned long long h = 1469598103934665603ULL;
+        for (const unsigned char *p = (const unsigned char *)value->string; *p; p++)
+        {
+            h ^= *p;
+            h *= 1099511628211ULL;
+        }
+        return mix_hash(h ^ 0x5bd1e995ULL);
+    }
+    return mix_hash((unsigned long long)(size_t)value);
+}
+
+int ast_value_equals(ASTNode *a, ASTNode *b)
+{
+    if (a->type != b->type)
+        return 0;
+    if (a->type == NODE_NUMBER)
+        return a->number == b->number;
+    if (a->type == NODE_STRING)
+        return strcmp(a->string, b->string) == 0;
+    return a == b;
+}
+
+// --- Hash index shared by dicts and sets ---
+// The index is an open-addressing table of positions into an insertion-ordered
+// item array, probed linearly. -1 marks an empty slot and -2 a removed item, which
+// probes step over (only sets remove).
+
+static void hash_index_rebuild(ASTNode **items, int count, int **index, int *index_size, int new_size)
+{
+    free(*index);
+    *index = malloc(sizeof(int) * new_size);
+    *index_size = new_size;
+    for (int i = 0; i < new_size; i++)
+        (*index)[i] = -1;
+
+    unsigned long mask = (unsigned long)new_size - 1;
+    for (int i = 0; i < count; i++)
+    {
+        unsigned long slot = ast_value_hash(items[i]) & mask;
+        while ((*index)[slot] != -1)
+            slot = (slot + 1) & mask;
+        (*index)[slot] = i;
+    }
+}
+
+// Grow the index if one more item would push the load factor past 2/3
+static void hash_index_reserve(ASTNode **items, int count, int **index, int *index_size)
+{
+    if ((count + 1) * 3 > *index_size * 2)
+        hash_index_rebuild(items, count, index, index_size, *index_size ? *index_size * 2 : 8);
+}
+
+// Returns the slot holding key, or the empty slot where it would go
+static unsigned long hash_index_probe(ASTNode **items, int *index, int index_size, ASTNode *key)
+{
+    unsigned long mask = (unsigned long)index_size - 1;
+    unsigned long slot = ast_value_hash(key) & mask;
+    while (index[slot] != -1 && (index[slot] == -2 || !ast_value_equals(items[index[slot]], key)))
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+int ast_dict_find(ASTNode *dict, ASTNode *key)
+{
+    if (dict->type != NODE_DICT || dict->dict.count == 0 || !key)
+        return -1;
+    return dict->dict.index[hash_index_probe(dict->dict.keys, dict->dict.index, dict->dict.index_size, key)];
+}
+
 void ast_dict_add_pair(ASTNode *dict, ASTNode *key, ASTNode *value)
 {
     if (dict->type != NODE_DICT)
         return;
-    dict->dict.keys = realloc(dict->dict.keys, sizeof(ASTNode *) * (dict->dict.count + 1));
-    dict->dict.values = realloc(dict->dict.values, sizeof(ASTNode *) * (dict->dict.count + 1));
+
+    hash_index_reserve(dict->dict.keys, dict->dict.count, &dict->dict.index, &dict->dict.index_size);
+
+    unsigned long slot = hash_index_probe(dict->dict.keys, dict->dict.index, dict->dict.index_size, key);
+    int existing = dict->dict.index[slot];
+    if (existing != -1)
+    {
+        // Overwrite in place so iteration order stays that of first insertion
+        if (dict->dict.values[existing] != value)
+            ast_free(dict->dict.values[existing]);
+        if (key != dict->dict.keys[existing])
+            ast_free(key);
+        dict->dict.values[existing] = value;
+        return;
+    }
+
+    if (dict->dict.count == dict->dict.capacity)
+    {
+        dict->dict.capacity = dict->dict.capacity ? dict->dict.capacity * 2 : 8;
+        dict->dict.keys = realloc(dict->dict.keys, sizeof(ASTNode *) * dict->dict.capacity);
+        dict->dict.values = realloc(dict->dict.values, sizeof(ASTNode *) * dict->dict.capacity);
+    }
     dict->dict.keys[dict->dict.count] = key;
     dict->dict.values[dict->dict.count] = value;
+    dict->dict.index[slot] = dict->dict.count;
     dict->dict.count++;
 }
 
@@ -712,17 +869,155 @@ ASTNode *ast_new_linked_list()
 {
     ASTNode *node = malloc(sizeof(ASTNode));
     node->type = NODE_LINKED_LIST;
-    node->linked_list.elements = NULL;
+    node->linked_list.head = NULL;
+    node->linked_list.tail = NULL;
+    node->linked_list.cursor = NULL;
     node->linked_list.count = 0;
     return node;
 }
 
-void ast_linked_list_add_element(ASTNode *list, ASTNode *element)
+// Linked list nodes are carved out of blocks and recycled through a free list
+#define LINKED_POOL_BLOCK 256
+static LinkedNode *linked_free_nodes = NULL;
+
+static LinkedNode *linked_node_alloc(ASTNode *value)
+{
+    if (!linked_free_nodes)
+    {
+        LinkedNode *block = malloc(sizeof(LinkedNode) * LINKED_POOL_BLOCK);
+        for (int i = 0; i < LINKED_POOL_BLOCK; i++)
+        {
+            block[i].next = linked_free_nodes;
+            linked_free_nodes = &block[i];
+        }
+    }
+    LinkedNode *node = linked_free_nodes;
+    linked_free_nodes = node->next;
+    node->value = value;
+    node->prev = node->next = NULL;
+    return node;
+}
+
+static void linked_node_release(LinkedNode *node)
 {
-    if (list->type != NODE_LINKED_LIST)
+    node->next = linked_free_nodes;
+    linked_free_nodes = node;
+}
+
+// Detach a node, keeping the cursor on the element that followed it
+static void linked_unlink(ASTNode *list, LinkedNode *node)
+{
+    if (list->linked_list.cursor == node)
+        list->linked_list.cursor = node->next;
+    if (node->prev)
+        node->prev->next = node->next;
+    else
+        list->linked_list.head = node->next;
+    if (node->next)
+        node->next->prev = node->prev;
+    else
+        list->linked_list.tail = node->prev;
+    list->linked_list.count--;
+}
+
+void ast_linked_list_push_front(ASTNode *list, ASTNode *value)
+{
+    ast_linked_list_insert_before(list, list->linked_list.head, value);
+}
+
+void ast_linked_list_push_back(ASTNode *list, ASTNode *value)
+{
+    ast_linked_list_insert_before(list, NULL, value);
+}
+
+// Insert before position, or at the end when position is NULL
+void ast_linked_list_insert_before(ASTNode *list, LinkedNode *position, ASTNode *value)
+{
+    LinkedNode *node = linked_node_alloc(value);
+    node->next = position;
+    node->prev = position ? position->prev : list->linked_list.tail;
+    if (node->prev)
+        node->prev->next = node;
+    else
+        list->linked_list.head = node;
+    if (position)
+        position->prev = node;
+    else
+        list->linked_list.tail = node;
+    list->linked_list.count++;
+}
+
+ASTNode *ast_linked_list_pop_front(ASTNode *list)
+{
+    LinkedNode *node = list->linked_list.head;
+    if (!node)
+        return NULL;
+    ASTNode *value = node->value;
+    linked_unlink(list, node);
+    linked_node_release(node);
+    return value;
+}
+
+ASTNode *ast_linked_list_pop_back(ASTNode *list)
+{
+    LinkedNode *node = list->linked_list.tail;
+    if (!node)
+        return NULL;
+    ASTNode *value = node->value;
+    linked_unlink(list, node);
+    linked_node_release(node);
+    return value;
+}
+
+// Node at index, walking from whichever end is closer; NULL if out of range
+LinkedNode *ast_linked_list_at(ASTNode *list, int index)
+{
+    if (index < 0 || index >= list->linked_list.count)
+        return NULL;
+    LinkedNode *node;
+    if (index < list->linked_list.count / 2)
+    {
+        node = list->linked_list.head;
+        while (index-- > 0)
+            node = node->next;
+    }
+    else
+    {
+        node = list->linked_list.tail;
+        for (int i = list->linked_list.count - 1; i > index; i--)
+            node = node->prev;
+    }
+    return node;
+}
+
+// Remove a node and free its value, returning the node that followed it
+LinkedNode *ast_linked_list_erase(ASTNode *list, LinkedNode *node)
+{
+    LinkedNode *next = node->next;
+    linked_unlink(list, node);
+    ast_free(node->value);
+    linked_node_release(node);
+    return next;
+}
+
+// Move every element of source onto the end of list in O(1), leaving source empty
+void ast_linked_list_splice(ASTNode *list, ASTNode *source)
+{
+    if (list == source || !source->linked_list.head)
         return;
-    list->linked_list.elements = realloc(list->linked_list.elements, sizeof(ASTNode *) * (list->linked_list.count + 1));
-    list->linked_list.elements[list->linked_list.count++] = element;
+    if (list->linked_list.tail)
+    {
+        list->linked_list.tail->next = source->linked_list.head;
+        source->linked_list.head->prev = list->linked_list.tail;
+    }
+    else
+    {
+        list->linked_list.head = source->linked_list.head;
+    }
+    list->linked_list.tail = source->linked_list.tail;
+    list->linked_list.count += source->linked_list.count;
+    source->linked_list.head = source->linked_list.tail = source->linked_list.cursor = NULL;
+    source->linked_list.count = 0;
 }
 
 ASTNode *ast_new_linked_list_add(ASTNode *list, ASTNode *value)
@@ -768,6 +1063,87 @@ ASTNode *ast_new_linked_list_isempty(ASTNode *list)
     return node;
 }
 
+ASTNode *ast_new_linked_list_push_front(ASTNode *list, ASTNode *value)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_PUSH_FRONT;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = value;
+    return node;
+}
+
+ASTNode *ast_new_linked_list_pop_front(ASTNode *list)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_POP_FRONT;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_linked_list_pop_back(ASTNode *list)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_POP_BACK;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_linked_list_cursor(ASTNode *list, ASTNode *index)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_CURSOR;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = index;
+    return node;
+}
+
+ASTNode *ast_new_linked_list_next(ASTNode *list)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_NEXT;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_linked_list_current(ASTNode *list)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_CURRENT;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_linked_list_insert(ASTNode *list, ASTNode *value)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_INSERT;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = value;
+    return node;
+}
+
+ASTNode *ast_new_linked_list_erase(ASTNode *list)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_ERASE;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_linked_list_splice(ASTNode *list, ASTNode *source)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_LINKED_LIST_SPLICE;
+    node->linked_list_op.list = list;
+    node->linked_list_op.value = source;
+    return node;
+}
+
 ASTNode *ast_new_file_open(ASTNode *filename, ASTNode *mode)
 {
     ASTNode *node = malloc(sizeof(ASTNode));
@@ -864,6 +1240,7 @@ ASTNode *ast_new_regex(const char *pattern, const char *flags)
     node->regex.pattern[sizeof(node->regex.pattern) - 1] = '\0';
     strncpy(node->regex.flags, flags, sizeof(node->regex.flags));
     node->regex.flags[sizeof(node->regex.flags) - 1] = '\0';
+    node->regex.program = NULL;
     return node;
 }
 
@@ -895,6 +1272,25 @@ ASTNode *ast_new_regex_find_all(ASTNode *regex, ASTNode *text)
     return node;
 }
 
+ASTNode *ast_new_regex_next(ASTNode *regex, ASTNode *text, ASTNode *from)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_REGEX_NEXT;
+    node->regex_next.regex = regex;
+    node->regex_next.text = text;
+    node->regex_next.from = from;
+    return node;
+}
+
+ASTNode *ast_new_regex_group(ASTNode *regex, ASTNode *name)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_REGEX_GROUP;
+    node->regex_group.regex = regex;
+    node->regex_group.name = name;
+    return node;
+}
+
 ASTNode *ast_new_ternary(ASTNode *condition, ASTNode *true_expr, ASTNode *false_expr)
 {
     ASTNode *node = malloc(sizeof(ASTNode));
@@ -935,6 +1331,9 @@ ASTNode *ast_new_temporal_aggregate(const char *varname, const char *operation,
     node->temporal_aggregate.varname[sizeof(node->temporal_aggregate.varname) - 1] = '\0';
     strncpy(node->temporal_aggregate.operation, operation, sizeof(node->temporal_aggregate.operation));
     node->temporal_aggregate.operation[sizeof(node->temporal_aggregate.operation) - 1] = '\0';
+    // Resolved once here so evaluation never compares strings
+    int stat = temporal_stat_by_name(operation);
+    node->temporal_aggregate.stat = stat >= TEMPORAL_SUM && stat <= TEMPORAL_MAX ? stat : -1;
     node->temporal_aggregate.window_size = window_size;
     return node;
 }
@@ -947,6 +1346,7 @@ ASTNode *ast_new_temporal_pattern(const char *varname, const char *pattern_type,
     node->temporal_pattern.varname[sizeof(node->temporal_pattern.varname) - 1] = '\0';
     strncpy(node->temporal_pattern.pattern_type, pattern_type, sizeof(node->temporal_pattern.pattern_type));
     node->temporal_pattern.pattern_type[sizeof(node->temporal_pattern.pattern_type) - 1] = '\0';
+    node->temporal_pattern.has_spec = temporal_parse_pattern(pattern_type, &node->temporal_pattern.spec);
     node->temporal_pattern.threshold = threshold;
     return node;
 }
@@ -959,6 +1359,7 @@ ASTNode *ast_new_temporal_condition(const char *varname, const char *condition,
     node->temporal_condition.varname[sizeof(node->temporal_condition.varname) - 1] = '\0';
     strncpy(node->temporal_condition.condition, condition, sizeof(node->temporal_condition.condition));
     node->temporal_condition.condition[sizeof(node->temporal_condition.condition) - 1] = '\0';
+    temporal_parse_condition(condition, &node->temporal_condition.predicate);
     node->temporal_condition.start_index = start_index;
     node->temporal_condition.window_size = window_size;
     return node;
@@ -973,6 +1374,8 @@ ASTNode *ast_new_sliding_window_stats(const char *varname, ASTNode *window_size,
     node->sliding_window_stats.window_size = window_size;
     strncpy(node->sliding_window_stats.stat_type, stat_type, sizeof(node->sliding_window_stats.stat_type));
     node->sliding_window_stats.stat_type[sizeof(node->sliding_window_stats.stat_type) - 1] = '\0';
+    int stat = temporal_stat_by_name(stat_type);
+    node->sliding_window_stats.stat = stat >= TEMPORAL_VARIANCE && stat <= TEMPORAL_MEDIAN ? stat : -1;
     return node;
 }
 
@@ -997,6 +1400,8 @@ ASTNode *ast_new_temporal_query(const char *varname, const char *time_window, co
     node->temporal_query.time_window[sizeof(node->temporal_query.time_window) - 1] = '\0';
     strncpy(node->temporal_query.condition, condition, sizeof(node->temporal_query.condition));
     node->temporal_query.condition[sizeof(node->temporal_query.condition) - 1] = '\0';
+    node->temporal_query.has_span = temporal_parse_span(time_window, &node->temporal_query.span);
+    temporal_parse_condition(condition, &node->temporal_query.predicate);
     return node;
 }
 
@@ -1022,6 +1427,119 @@ ASTNode *ast_new_temporal_interpolate(const char *varname, ASTNode *missing_inde
     return node;
 }
 
+ASTNode *ast_new_temporal_correlate_matrix(ASTNode *names, ASTNode *window_size)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TEMPORAL_CORRELATE_MATRIX;
+    node->temporal_correlate_matrix.names = names;
+    node->temporal_correlate_matrix.window_size = window_size;
+    node->temporal_correlate_matrix.cache = temporal_correlation_new();
+    return node;
+}
+
+ASTNode *ast_new_temporal_xcorr(const char *var1, const char *var2, ASTNode *window_size, ASTNode *max_lag)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TEMPORAL_XCORR;
+    strncpy(node->temporal_xcorr.var1, var1, sizeof(node->temporal_xcorr.var1));
+    node->temporal_xcorr.var1[sizeof(node->temporal_xcorr.var1) - 1] = '\0';
+    strncpy(node->temporal_xcorr.var2, var2, sizeof(node->temporal_xcorr.var2));
+    node->temporal_xcorr.var2[sizeof(node->temporal_xcorr.var2) - 1] = '\0';
+    node->temporal_xcorr.window_size = window_size;
+    node->temporal_xcorr.max_lag = max_lag;
+    return node;
+}
+
+ASTNode *ast_new_temporal_new(int max_history, long long archived)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TEMPORAL_NEW;
+    node->temporal_new.max_history = max_history;
+    node->temporal_new.archived = archived;
+    return node;
+}
+
+ASTNode *ast_new_temporal_persist(const char *varname, const char *path)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TEMPORAL_PERSIST;
+    strncpy(node->temporal_persist.varname, varname, sizeof(node->temporal_persist.varname));
+    node->temporal_persist.varname[sizeof(node->temporal_persist.varname) - 1] = '\0';
+    strncpy(node->temporal_persist.path, path, sizeof(node->temporal_persist.path));
+    node->temporal_persist.path[sizeof(node->temporal_persist.path) - 1] = '\0';
+    return node;
+}
+
+ASTNode *ast_new_temporal_fill(const char *varname, const char *method)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TEMPORAL_FILL;
+    strncpy(node->temporal_fill.varname, varname, sizeof(node->temporal_fill.varname));
+    node->temporal_fill.varname[sizeof(node->temporal_fill.varname) - 1] = '\0';
+    strncpy(node->temporal_fill.method, method, sizeof(node->temporal_fill.method));
+    node->temporal_fill.method[sizeof(node->temporal_fill.method) - 1] = '\0';
+    node->temporal_fill.fill = temporal_fill_by_name(method);
+    return node;
+}
+
+ASTNode *ast_new_temporal_resample(const char *varname, const char *bucket, const char *operation)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TEMPORAL_RESAMPLE;
+    strncpy(node->temporal_resample.varname, varname, sizeof(node->temporal_resample.varname));
+    node->temporal_resample.varname[sizeof(node->temporal_resample.varname) - 1] = '\0';
+    strncpy(node->temporal_resample.bucket, bucket, sizeof(node->temporal_resample.bucket));
+    node->temporal_resample.bucket[sizeof(node->temporal_resample.bucket) - 1] = '\0';
+    strncpy(node->temporal_resample.operation, operation, sizeof(node->temporal_resample.operation));
+    node->temporal_resample.operation[sizeof(node->temporal_resample.operation) - 1] = '\0';
+    long long bucket_ns;
+    int has_unit;
+    node->temporal_resample.bucket_ns =
+        temporal_parse_duration(bucket, &bucket_ns, &has_unit) && has_unit && bucket_ns > 0 ? bucket_ns : 0;
+    node->temporal_resample.stat = temporal_stat_by_name(operation);
+    return node;
+}
+
+ASTNode *ast_new_temporal_trigger(const char *varname, const char *condition, const char *callback)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TEMPORAL_TRIGGER;
+    strncpy(node->temporal_trigger.varname, varname, sizeof(node->temporal_trigger.varname));
+    node->temporal_trigger.varname[sizeof(node->temporal_trigger.varname) - 1] = '\0';
+    strncpy(node->temporal_trigger.condition, condition, sizeof(node->temporal_trigger.condition));
+    node->temporal_trigger.condition[sizeof(node->temporal_trigger.condition) - 1] = '\0';
+    strncpy(node->temporal_trigger.callback, callback, sizeof(node->temporal_trigger.callback));
+    node->temporal_trigger.callback[sizeof(node->temporal_trigger.callback) - 1] = '\0';
+    node->temporal_trigger.has_spec = temporal_parse_trigger(condition, &node->temporal_trigger.spec);
+    return node;
+}
+
+// Same fields as a trigger, naming the one to detach
+ASTNode *ast_new_temporal_untrigger(const char *varname, const char *condition, const char *callback)
+{
+    ASTNode *node = ast_new_temporal_trigger(varname, condition, callback);
+    node->type = NODE_TEMPORAL_UNTRIGGER;
+    return node;
+}
+
+ASTNode *ast_new_temporal_downsample(const char *varname, const char *bucket, const char *operation)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TEMPORAL_DOWNSAMPLE;
+    strncpy(node->temporal_downsample.varname, varname, sizeof(node->temporal_downsample.varname));
+    node->temporal_downsample.varname[sizeof(node->temporal_downsample.varname) - 1] = '\0';
+    strncpy(node->temporal_downsample.bucket, bucket, sizeof(node->temporal_downsample.bucket));
+    node->temporal_downsample.bucket[sizeof(node->temporal_downsample.bucket) - 1] = '\0';
+    strncpy(node->temporal_downsample.operation, operation, sizeof(node->temporal_downsample.operation));
+    node->temporal_downsample.operation[sizeof(node->temporal_downsample.operation) - 1] = '\0';
+    long long bucket_ns;
+    int has_unit;
+    node->temporal_downsample.bucket_ns =
+        temporal_parse_duration(bucket, &bucket_ns, &has_unit) && has_unit && bucket_ns > 0 ? bucket_ns : 0;
+    node->temporal_downsample.stat = temporal_stat_by_name(operation);
+    return node;
+}
+
 // Exception handling AST functions
 ASTNode *ast_new_try(ASTNode *try_body, ASTNode **catch_blocks, int catch_count, ASTNode *finally_block)
 {
@@ -1091,23 +1609,88 @@ ASTNode *ast_new_set()
     node->type = NODE_SET;
     node->set.elements = NULL;
     node->set.count = 0;
+    node->set.removed = 0;
+    node->set.capacity = 0;
+    node->set.index = NULL;
+    node->set.index_size = 0;
     return node;
 }
 
-void ast_set_add_element(ASTNode *set, ASTNode *element)
+// Adds element unless an equal one is present. Returns 1 if the set took ownership of it.
+int ast_set_add_element(ASTNode *set, ASTNode *element)
+{
+    if (set->type != NODE_SET) return 0;
+
+    // Holes still take index slots, so drop them rather than grow the index for them
+    int used = set->set.count + set->set.removed;
+    if (set->set.removed && (used + 1) * 3 > set->set.index_size * 2) {
+        ast_set_compact(set);
+        used = set->set.count;
+    }
+    hash_index_reserve(set->set.elements, used, &set->set.index, &set->set.index_size);
+    unsigned long slot = hash_index_probe(set->set.elements, set->set.index, set->set.index_size, element);
+    if (set->set.index[slot] != -1) return 0;
+
+    if (used == set->set.capacity) {
+        set->set.capacity = set->set.capacity ? set->set.capacity * 2 : 8;
+        set->set.elements = realloc(set->set.elements, sizeof(ASTNode*) * set->set.capacity);
+    }
+    set->set.elements[used] = element;
+    set->set.index[slot] = used;
+    set->set.count++;
+    return 1;
+}
+
+int ast_set_find(ASTNode *set, ASTNode *element)
+{
+    if (set->type != NODE_SET || set->set.count == 0 || !element) return -1;
+    return set->set.index[hash_index_probe(set->set.elements, set->set.index, set->set.index_size, element)];
+}
+
+int ast_set_remove_element(ASTNode *set, ASTNode *element)
+{
+    if (set->type != NODE_SET || set->set.count == 0 || !element) return 0;
+    unsigned long slot = hash_index_probe(set->set.elements, set->set.index, set->set.index_size, element);
+    int pos = set->set.index[slot];
+    if (pos < 0) return 0;
+
+    // O(1): the element leaves a hole, so the others keep their positions and order
+    ast_free(set->set.elements[pos]);
+    set->set.elements[pos] = NULL;
+    set->set.index[slot] = -2;
+    set->set.count--;
+    set->set.removed++;
+    if (set->set.removed > set->set.count)
+        ast_set_compact(set);
+    return 1;
+}
+
+// Squeezes out the holes left by removals, keeping insertion order. Anything that
+// walks elements calls this first; it is O(n) only when there are holes.
+void ast_set_compact(ASTNode *set)
+{
+    if (set->type != NODE_SET || set->set.removed == 0) return;
+    int used = set->set.count + set->set.removed;
+    int kept = 0;
+    for (int i = 0; i < used; i++) {
+        if (set->set.elements[i])
+            set->set.elements[kept++] = set->set.elements[i];
+    }
+    set->set.removed = 0;
+    hash_index_rebuild(set->set.elements, kept, &set->set.index, &set->set.index_size, set->set.index_size);
+}
+
+void ast_set_clear(ASTNode *set)
 {
     if (set->type != NODE_SET) return;
-    
-    // Check for duplicates (simple value comparison)
-    for (int i = 0; i < set->set.count; i++) {
-        if (set->set.elements[i]->type == element->type) {
-            if (element->type == NODE_NUMBER && set->set.elements[i]->number == element->number) return;
-            if (element->type == NODE_STRING && strcmp(set->set.elements[i]->string, element->string) == 0) return;
-        }
+    for (int i = 0; i < set->set.count + set->set.removed; i++) {
+        ast_free(set->set.elements[i]);
+    }
+    set->set.count = 0;
+    set->set.removed = 0;
+    for (int i = 0; i < set->set.index_size; i++) {
+        set->set.index[i] = -1;
     }
-    
-    set->set.elements = realloc(set->set.elements, sizeof(ASTNode*) * (set->set.count + 1));
-    set->set.elements[set->set.count++] = element;
 }
 
 ASTNode *ast_new_type(ASTNode *value)
@@ -1223,6 +1806,186 @@ ASTNode *ast_new_set_copy(ASTNode *set)
     return node;
 }
 
+ASTNode *ast_new_pvec_push(ASTNode *collection, ASTNode *value)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PVEC_PUSH;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = NULL;
+    node->persistent_op.value = value;
+    return node;
+}
+
+ASTNode *ast_new_pvec_set(ASTNode *collection, ASTNode *key, ASTNode *value)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PVEC_SET;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = key;
+    node->persistent_op.value = value;
+    return node;
+}
+
+ASTNode *ast_new_pvec_pop(ASTNode *collection)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PVEC_POP;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = NULL;
+    node->persistent_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_pvec_get(ASTNode *collection, ASTNode *key)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PVEC_GET;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = key;
+    node->persistent_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_pvec_size(ASTNode *collection)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PVEC_SIZE;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = NULL;
+    node->persistent_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_pmap_put(ASTNode *collection, ASTNode *key, ASTNode *value)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PMAP_PUT;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = key;
+    node->persistent_op.value = value;
+    return node;
+}
+
+ASTNode *ast_new_pmap_remove(ASTNode *collection, ASTNode *key)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PMAP_REMOVE;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = key;
+    node->persistent_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_pmap_get(ASTNode *collection, ASTNode *key)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PMAP_GET;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = key;
+    node->persistent_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_pmap_has(ASTNode *collection, ASTNode *key)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PMAP_HAS;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = key;
+    node->persistent_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_pmap_size(ASTNode *collection)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_PMAP_SIZE;
+    node->persistent_op.collection = collection;
+    node->persistent_op.key = NULL;
+    node->persistent_op.value = NULL;
+    return node;
+}
+
+ASTNode *ast_new_heap_push(ASTNode *heap, ASTNode *value, ASTNode *priority)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_HEAP_PUSH;
+    node->heap_op.heap = heap;
+    node->heap_op.value = value;
+    node->heap_op.priority = priority;
+    return node;
+}
+
+ASTNode *ast_new_heap_pop(ASTNode *heap)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_HEAP_POP;
+    node->heap_op.heap = heap;
+    node->heap_op.value = NULL;
+    node->heap_op.priority = NULL;
+    return node;
+}
+
+ASTNode *ast_new_heap_peek(ASTNode *heap)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_HEAP_PEEK;
+    node->heap_op.heap = heap;
+    node->heap_op.value = NULL;
+    node->heap_op.priority = NULL;
+    return node;
+}
+
+ASTNode *ast_new_heap_size(ASTNode *heap)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_HEAP_SIZE;
+    node->heap_op.heap = heap;
+    node->heap_op.value = NULL;
+    node->heap_op.priority = NULL;
+    return node;
+}
+
+ASTNode *ast_new_heap_update(ASTNode *heap, ASTNode *handle, ASTNode *priority)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_HEAP_UPDATE;
+    node->heap_op.heap = heap;
+    node->heap_op.value = handle;
+    node->heap_op.priority = priority;
+    return node;
+}
+
+ASTNode *ast_new_heap_key(ASTNode *heap, ASTNode *function)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_HEAP_KEY;
+    node->heap_op.heap = heap;
+    node->heap_op.value = function;
+    node->heap_op.priority = NULL;
+    return node;
+}
+
+ASTNode *ast_new_heap_compare(ASTNode *heap, ASTNode *function)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_HEAP_COMPARE;
+    node->heap_op.heap = heap;
+    node->heap_op.value = function;
+    node->heap_op.priority = NULL;
+    return node;
+}
+
+ASTNode *ast_new_heapify(ASTNode *list, ASTNode *key_function)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_HEAPIFY;
+    node->heap_op.heap = list;
+    node->heap_op.value = key_function;
+    node->heap_op.priority = NULL;
+    return node;
+}
+
 void ast_set_node_location(ASTNode *node, int line, int column)
 {
     ast_set_location(node, line, column);
@@ -1347,7 +2110,7 @@ ASTNode *ast_new_tree()
 {
     ASTNode *node = malloc(sizeof(ASTNode));
     node->type = NODE_TREE;
-    node->tree.elements = NULL;
+    node->tree.root = NULL;
     node->tree.count = 0;
     return node;
 }
@@ -1403,10 +2166,246 @@ ASTNode *ast_new_tree_postorder(ASTNode *tree)
     return node;
 }
 
-void ast_tree_add_element(ASTNode *tree, ASTNode *element)
+ASTNode *ast_new_tree_range(ASTNode *tree, ASTNode *lo, ASTNode *hi)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TREE_RANGE;
+    node->tree_range.tree = tree;
+    node->tree_range.lo = lo;
+    node->tree_range.hi = hi;
+    return node;
+}
+
+ASTNode *ast_new_tree_floor(ASTNode *tree, ASTNode *value)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TREE_FLOOR;
+    node->tree_search.tree = tree;
+    node->tree_search.value = value;
+    return node;
+}
+
+ASTNode *ast_new_tree_ceil(ASTNode *tree, ASTNode *value)
+{
+    ASTNode *node = malloc(sizeof(ASTNode));
+    node->type = NODE_TREE_CEIL;
+    node->tree_search.tree = tree;
+    node->tree_search.value = value;
+    return node;
+}
+
+// --- AVL tree backing <tree> (an ordered set of numbers) ---
+
+static int tree_height(TreeNode *n)
+{
+    return n ? n->height : 0;
+}
+
+static void tree_update(TreeNode *n)
 {
-    tree->tree.elements = realloc(tree->tree.elements, sizeof(ASTNode *) * (tree->tree.count + 1));
-    tree->tree.elements[tree->tree.count++] = element;
+    int lh = tree_height(n->left);
+    int rh = tree_height(n->right);
+    n->height = (lh > rh ? lh : rh) + 1;
+}
+
+static TreeNode *tree_rotate_right(TreeNode *n)
+{
+    TreeNode *l = n->left;
+    n->left = l->right;
+    l->right = n;
+    tree_update(n);
+    tree_update(l);
+    return l;
+}
+
+static TreeNode *tree_rotate_left(TreeNode *n)
+{
+    TreeNode *r = n->right;
+    n->right = r->left;
+    r->left = n;
+    tree_update(n);
+    tree_update(r);
+    return r;
+}
+
+static TreeNode *tree_rebalance(TreeNode *n)
+{
+    tree_update(n);
+    int balance = tree_height(n->left) - tree_height(n->right);
+    if (balance > 1)
+    {
+        if (tree_height(n->left->left) < tree_height(n->left->right))
+            n->left = tree_rotate_left(n->left);
+        return tree_rotate_right(n);
+    }
+    if (balance < -1)
+    {
+        if (tree_height(n->right->right) < tree_height(n->right->left))
+            n->right = tree_rotate_right(n->right);
+        return tree_rotate_left(n);
+    }
+    return n;
+}
+
+static TreeNode *tree_insert_node(TreeNode *n, double value, int *inserted)
+{
+    if (!n)
+    {
+        TreeNode *leaf = malloc(sizeof(TreeNode));
+        leaf->value = value;
+        leaf->height = 1;
+        leaf->left = NULL;
+        leaf->right = NULL;
+        *inserted = 1;
+        return leaf;
+    }
+    if (value < n->value)
+        n->left = tree_insert_node(n->left, value, inserted);
+    else if (value > n->value)
+        n->right = tree_insert_node(n->right, value, inserted);
+    else
+        return n; // Already present
+    return tree_rebalance(n);
+}
+
+static TreeNode *tree_remove_node(TreeNode *n, double value, int *removed)
+{
+    if (!n)
+        return NULL;
+    if (value < n->value)
+        n->left = tree_remove_node(n->left, value, removed);
+    else if (value > n->value)
+        n->right = tree_remove_node(n->right, value, removed);
+    else
+    {
+        *removed = 1;
+        if (!n->left || !n->right)
+        {
+            TreeNode *child = n->left ? n->left : n->right;
+            free(n);
+            return child;
+        }
+        // Replace with the in-order successor, then remove that from the right subtree
+        TreeNode *succ = n->right;
+        while (succ->left)
+            succ = succ->left;
+        n->value = succ->value;
+        int dummy = 0;
+        n->right = tree_remove_node(n->right, succ->value, &dummy);
+    }
+    return tree_rebalance(n);
+}
+
+static void tree_free_nodes(TreeNode *n)
+{
+    if (!n)
+        return;
+    tree_free_nodes(n->left);
+    tree_free_nodes(n->right);
+    free(n);
+}
+
+int ast_tree_insert(ASTNode *tree, double value)
+{
+    int inserted = 0;
+    tree->tree.root = tree_insert_node(tree->tree.root, value, &inserted);
+    tree->tree.count += inserted;
+    return inserted;
+}
+
+int ast_tree_contains(ASTNode *tree, double value)
+{
+    TreeNode *n = tree->tree.root;
+    while (n)
+    {
+        if (value < n->value)
+            n = n->left;
+        else if (value > n->value)
+            n = n->right;
+        else
+            return 1;
+    }
+    return 0;
+}
+
+int ast_tree_remove(ASTNode *tree, double value)
+{
+    int removed = 0;
+    tree->tree.root = tree_remove_node(tree->tree.root, value, &removed);
+    tree->tree.count -= removed;
+    return removed;
+}
+
+int ast_tree_floor(ASTNode *tree, double value, double *out)
+{
+    int found = 0;
+    for (TreeNode *n = tree->tree.root; n;)
+    {
+        if (n->value <= value)
+        {
+            *out = n->value;
+            found = 1;
+            n = n->right;
+        }
+        else
+            n = n->left;
+    }
+    return found;
+}
+
+int ast_tree_ceiling(ASTNode *tree, double value, double *out)
+{
+    int found = 0;
+    for (TreeNode *n = tree->tree.root; n;)
+    {
+        if (n->value >= value)
+        {
+            *out = n->value;
+            found = 1;
+            n = n->left;
+        }
+        else
+            n = n->right;
+    }
+    return found;
+}
+
+static void tree_walk_node(TreeNode *n, TreeOrder order, TreeVisitor visit, void *ctx)
+{
+    if (!n)
+        return;
+    if (order == TREE_PREORDER)
+        visit(n->value, ctx);
+    tree_walk_node(n->left, order, visit, ctx);
+    if (order == TREE_INORDER)
+        visit(n->value, ctx);
+    tree_walk_node(n->right, order, visit, ctx);
+    if (order == TREE_POSTORDER)
+        visit(n->value, ctx);
+}
+
+// Recursion depth is bounded by the AVL height (about 1.44 log2 n)
+void ast_tree_walk(ASTNode *tree, TreeOrder order, TreeVisitor visit, void *ctx)
+{
+    tree_walk_node(tree->tree.root, order, visit, ctx);
+}
+
+static void tree_range_node(TreeNode *n, double lo, double hi, TreeVisitor visit, void *ctx)
+{
+    if (!n)
+        return;
+    if (lo < n->value)
+        tree_range_node(n->left, lo, hi, visit, ctx);
+    if (lo <= n->value && n->value <= hi)
+        visit(n->value, ctx);
+    if (n->value < hi)
+        tree_range_node(n->right, lo, hi, visit, ctx);
+}
+
+// Visits values in [lo, hi] in ascending order, touching only O(log n + k) nodes
+void ast_tree_range(ASTNode *tree, double lo, double hi, TreeVisitor visit, void *ctx)
+{
+    tree_range_node(tree->tree.root, lo, hi, visit, ctx);
 }
 
 // Graph functions
@@ -1415,9 +2414,17 @@ ASTNode *ast_new_graph()
     ASTNode *node = malloc(sizeof(ASTNode));
     node->type = NODE_GRAPH;
     node->graph.vertices = NULL;
-    node->graph.edges = NULL;
+    node->graph.out = NULL;
+    node->graph.in = NULL;
     node->graph.vertex_count = 0;
+    node->graph.vertex_capacity = 0;
     node->graph.edge_count = 0;
+    node->graph.index = NULL;
+    node->graph.index_size = 0;
+    node->graph.csr_offsets = NULL;
+    node->graph.csr_targets = NULL;
+    node->graph.csr_weights = NULL;
+    node->graph.csr_valid = 0;
     return node;
 }
 
@@ -1430,13 +2437,14 @@ ASTNode *ast_new_graph_add_vertex(ASTNode *graph, ASTNode *vertex)
     return node;
 }
 
-ASTNode *ast_new_graph_add_edge(ASTNode *graph, ASTNode *from, ASTNode *to)
+ASTNode *ast_new_graph_add_edge(ASTNode *graph, ASTNode *from, ASTNode *to, ASTNode *weight)
 {
     ASTNode *node = malloc(sizeof(ASTNode));
     node->type = NODE_GRAPH_ADD_EDGE;
     node->graph_edge_op.graph = graph;
     node->graph_edge_op.from = from;
     node->graph_edge_op.to = to;
+    node->graph_edge_op.weight = weight;
     return node;
 }
 
@@ -1456,6 +2464,7 @@ ASTNode *ast_new_graph_remove_edge(ASTNode *graph, ASTNode *from, ASTNode *to)
     node->graph_edge_op.graph = graph;
     node->graph_edge_op.from = from;
     node->graph_edge_op.to = to;
+    node->graph_edge_op.weight = NULL;
     return node;
 }
 
@@ -1466,6 +2475,7 @@ ASTNode *ast_new_graph_has_edge(ASTNode *graph, ASTNode *from, ASTNode *to)
     node->graph_edge_op.graph = graph;
     node->graph_edge_op.from = from;
     node->graph_edge_op.to = to;
+    node->graph_edge_op.weight = NULL;
     return node;
 }
 
@@ -1496,19 +2506,258 @@ ASTNode *ast_new_graph_bfs(ASTNode *graph, ASTNode *start)
     return node;
 }
 
-void ast_graph_add_vertex(ASTNode *graph, ASTNode *vertex)
+// --- Graph storage ---
+// Vertices get dense IDs in insertion order; the hash index maps a vertex value
+// to its ID. Edges live in per-vertex adjacency vectors in both directions, and
+// a vector with many edges is hashed too, so finding one edge is O(1).
+
+int ast_graph_find_vertex(ASTNode *graph, ASTNode *vertex)
+{
+    if (graph->graph.vertex_count == 0 || !vertex)
+        return -1;
+    return graph->graph.index[hash_index_probe(graph->graph.vertices, graph->graph.index, graph->graph.index_size, vertex)];
+}
+
+// Returns the vertex ID. The graph owns vertex afterwards; a duplicate is freed.
+int ast_graph_add_vertex(ASTNode *graph, ASTNode *vertex)
+{
+    hash_index_reserve(graph->graph.vertices, graph->graph.vertex_count, &graph->graph.index, &graph->graph.index_size);
+    unsigned long slot = hash_index_probe(graph->graph.vertices, graph->graph.index, graph->graph.index_size, vertex);
+    if (graph->graph.index[slot] != -1)
+    {
+        if (graph->graph.vertices[graph->graph.index[slot]] != vertex)
+            ast_free(vertex);
+        return graph->graph.index[slot];
+    }
+
+    if (graph->graph.vertex_count == graph->graph.vertex_capacity)
+    {
+        int capacity = graph->graph.vertex_capacity ? graph->graph.vertex_capacity * 2 : 8;
+        graph->graph.vertices = realloc(graph->graph.vertices, sizeof(ASTNode *) * capacity);
+        graph->graph.out = realloc(graph->graph.out, sizeof(GraphAdjacency) * capacity);
+        graph->graph.in = realloc(graph->graph.in, sizeof(GraphAdjacency) * capacity);
+        graph->graph.vertex_capacity = capacity;
+    }
+    int id = graph->graph.vertex_count++;
+    graph->graph.vertices[id] = vertex;
+    memset(&graph->graph.out[id], 0, sizeof(GraphAdjacency));
+    memset(&graph->graph.in[id], 0, sizeof(GraphAdjacency));
+    graph->graph.index[slot] = id;
+    graph->graph.csr_valid = 0;
+    return id;
+}
+
+// Vertices with fewer edges than this are scanned; past it each side gets a hash
+// of target to position, so edge lookups stay O(1) on high-degree vertices
+#define ADJACENCY_INDEX_MIN 16
+
+static unsigned long adjacency_slot(int target, int slot_count)
+{
+    return ((unsigned long)(unsigned)target * 2654435761UL) & (unsigned long)(slot_count - 1);
+}
+
+static void adjacency_index_insert(GraphAdjacency *adj, int pos)
+{
+    unsigned long slot = adjacency_slot(adj->targets[pos], adj->slot_count);
+    while (adj->slots[slot] != -1)
+        slot = (slot + 1) & (unsigned long)(adj->slot_count - 1);
+    adj->slots[slot] = pos;
+}
+
+// Rebuilds the hash from the targets, dropping it once the vector is short again
+static void adjacency_reindex(GraphAdjacency *adj)
+{
+    if (adj->count < ADJACENCY_INDEX_MIN)
+    {
+        free(adj->slots);
+        adj->slots = NULL;
+        adj->slot_count = 0;
+        return;
+    }
+    if (adj->slot_count < adj->count * 2)
+    {
+        int size = 2 * ADJACENCY_INDEX_MIN;
+        while (size < adj->count * 4)
+            size *= 2;
+        free(adj->slots);
+        adj->slots = malloc(sizeof(int) * size);
+        if (!adj->slots)
+        {
+            perror("Failed to allocate graph edge index");
+            exit(EXIT_FAILURE);
+        }
+        adj->slot_count = size;
+    }
+    memset(adj->slots, -1, sizeof(int) * adj->slot_count);
+    for (int i = 0; i < adj->count; i++)
+        adjacency_index_insert(adj, i);
+}
+
+static void adjacency_push(GraphAdjacency *adj, int target, double weight)
+{
+    if (adj->count == adj->capacity)
+    {
+        adj->capacity = adj->capacity ? adj->capacity * 2 : 4;
+        adj->targets = realloc(adj->targets, sizeof(int) * adj->capacity);
+        adj->weights = realloc(adj->weights, sizeof(double) * adj->capacity);
+    }
+    adj->targets[adj->count] = target;
+    adj->weights[adj->count] = weight;
+    adj->count++;
+    if (adj->slots && adj->count * 2 <= adj->slot_count)
+        adjacency_index_insert(adj, adj->count - 1);
+    else if (adj->count >= ADJACENCY_INDEX_MIN)
+        adjacency_reindex(adj);
+}
+
+static int adjacency_find(GraphAdjacency *adj, int target)
+{
+    if (adj->slots)
+    {
+        unsigned long slot = adjacency_slot(target, adj->slot_count);
+        while (adj->slots[slot] != -1)
+        {
+            if (adj->targets[adj->slots[slot]] == target)
+                return adj->slots[slot];
+            slot = (slot + 1) & (unsigned long)(adj->slot_count - 1);
+        }
+        return -1;
+    }
+    for (int i = 0; i < adj->count; i++)
+    {
+        if (adj->targets[i] == target)
+            return i;
+    }
+    return -1;
+}
+
+// Order-preserving removal so traversals keep following insertion order; the
+// positions after pos shift, so a hashed vector is reindexed in the same O(degree)
+static void adjacency_remove_at(GraphAdjacency *adj, int pos)
+{
+    memmove(&adj->targets[pos], &adj->targets[pos + 1], sizeof(int) * (adj->count - pos - 1));
+    memmove(&adj->weights[pos], &adj->weights[pos + 1], sizeof(double) * (adj->count - pos - 1));
+    adj->count--;
+    if (adj->slots)
+        adjacency_reindex(adj);
+}
+
+// Adds a directed edge, or updates its weight if it already exists
+void ast_graph_add_edge(ASTNode *graph, int from, int to, double weight)
+{
+    int pos = adjacency_find(&graph->graph.out[from], to);
+    if (pos >= 0)
+    {
+        graph->graph.out[from].weights[pos] = weight;
+        graph->graph.in[to].weights[adjacency_find(&graph->graph.in[to], from)] = weight;
+    }
+    else
+    {
+        adjacency_push(&graph->graph.out[from], to, weight);
+        adjacency_push(&graph->graph.in[to], from, weight);
+        graph->graph.edge_count++;
+    }
+    graph->graph.csr_valid = 0;
+}
+
+int ast_graph_has_edge(ASTNode *graph, int from, int to)
 {
-    graph->graph.vertices = realloc(graph->graph.vertices, sizeof(ASTNode *) * (graph->graph.vertex_count + 1));
-    graph->graph.vertices[graph->graph.vertex_count++] = vertex;
+    // Scan whichever side has the smaller degree
+    if (graph->graph.out[from].count <= graph->graph.in[to].count)
+        return adjacency_find(&graph->graph.out[from], to) >= 0;
+    return adjacency_find(&graph->graph.in[to], from) >= 0;
 }
 
-void ast_graph_add_edge(ASTNode *graph, ASTNode *from, ASTNode *to)
+int ast_graph_remove_edge(ASTNode *graph, int from, int to)
 {
-    ASTNode *edge = ast_new_list();
-    ast_list_add_element(edge, from);
-    ast_list_add_element(edge, to);
-    graph->graph.edges = realloc(graph->graph.edges, sizeof(ASTNode *) * (graph->graph.edge_count + 1));
-    graph->graph.edges[graph->graph.edge_count++] = edge;
+    int pos = adjacency_find(&graph->graph.out[from], to);
+    if (pos < 0)
+        return 0;
+    adjacency_remove_at(&graph->graph.out[from], pos);
+    adjacency_remove_at(&graph->graph.in[to], adjacency_find(&graph->graph.in[to], from));
+    graph->graph.edge_count--;
+    graph->graph.csr_valid = 0;
+    return 1;
+}
+
+// Removes a vertex and its edges, then compacts IDs so they stay dense. O(V + E).
+int ast_graph_remove_vertex(ASTNode *graph, int id)
+{
+    if (id < 0 || id >= graph->graph.vertex_count)
+        return 0;
+
+    int n = graph->graph.vertex_count;
+    graph->graph.edge_count -= graph->graph.out[id].count + graph->graph.in[id].count;
+    if (adjacency_find(&graph->graph.out[id], id) >= 0)
+        graph->graph.edge_count++; // A self-loop was counted on both sides
+
+    ast_free(graph->graph.vertices[id]);
+    free(graph->graph.out[id].targets);
+    free(graph->graph.out[id].weights);
+    free(graph->graph.in[id].targets);
+    free(graph->graph.in[id].weights);
+    free(graph->graph.out[id].slots);
+    free(graph->graph.in[id].slots);
+    memmove(&graph->graph.vertices[id], &graph->graph.vertices[id + 1], sizeof(ASTNode *) * (n - id - 1));
+    memmove(&graph->graph.out[id], &graph->graph.out[id + 1], sizeof(GraphAdjacency) * (n - id - 1));
+    memmove(&graph->graph.in[id], &graph->graph.in[id + 1], sizeof(GraphAdjacency) * (n - id - 1));
+    graph->graph.vertex_count = --n;
+
+    // Drop edges into the removed vertex and shift the IDs above it down by one
+    for (int v = 0; v < n; v++)
+    {
+        GraphAdjacency *lists[2] = {&graph->graph.out[v], &graph->graph.in[v]};
+        for (int l = 0; l < 2; l++)
+        {
+            GraphAdjacency *adj = lists[l];
+            int kept = 0;
+            for (int i = 0; i < adj->count; i++)
+            {
+                int target = adj->targets[i];
+                if (target == id)
+                    continue;
+                adj->targets[kept] = target > id ? target - 1 : target;
+                adj->weights[kept] = adj->weights[i];
+                kept++;
+            }
+            adj->count = kept;
+            if (adj->slots)
+                adjacency_reindex(adj);
+        }
+    }
+
+    hash_index_rebuild(graph->graph.vertices, n, &graph->graph.index, &graph->graph.index_size, graph->graph.index_size);
+    graph->graph.csr_valid = 0;
+    return 1;
+}
+
+// Pack the out edges into compressed sparse row arrays for traversal
+void ast_graph_freeze(ASTNode *graph)
+{
+    if (graph->graph.csr_valid)
+        return;
+
+    int n = graph->graph.vertex_count;
+    free(graph->graph.csr_offsets);
+    free(graph->graph.csr_targets);
+    free(graph->graph.csr_weights);
+    graph->graph.csr_offsets = malloc(sizeof(int) * (n + 1));
+    graph->graph.csr_targets = malloc(sizeof(int) * (graph->graph.edge_count + 1));
+    graph->graph.csr_weights = malloc(sizeof(double) * (graph->graph.edge_count + 1));
+
+    int offset = 0;
+    for (int v = 0; v < n; v++)
+    {
+        GraphAdjacency *adj = &graph->graph.out[v];
+        graph->graph.csr_offsets[v] = offset;
+        if (adj->count == 0)
+            continue; // targets may still be NULL
+        memcpy(&graph->graph.csr_targets[offset], adj->targets, sizeof(int) * adj->count);
+        memcpy(&graph->graph.csr_weights[offset], adj->weights, sizeof(double) * adj->count);
+        offset += adj->count;
+    }
+    graph->graph.csr_offsets[n] = offset;
+    graph->graph.csr_valid = 1;
 }
 
 // --- AST Free ---
@@ -1584,12 +2833,29 @@ void ast_free(ASTNode *node)
         }
         break;
     case NODE_LIST:
+        if (node->list.refs > 0)
+        {
+            // Still shared by slice views; the last one to be released frees it
+            node->list.refs--;
+            return;
+        }
+        if (node->list.base)
+        {
+            ast_free(node->list.base);
+            break;
+        }
         for (int i = 0; i < node->list.count; i++)
         {
             ast_free(node->list.elements[i]);
         }
         free(node->list.elements);
         break;
+    case NODE_LIST_SLICE:
+        ast_free(node->list_slice.list);
+        ast_free(node->list_slice.start);
+        ast_free(node->list_slice.end);
+        ast_free(node->list_slice.step);
+        break;
     case NODE_LIST_ACCESS:
         ast_free(node->list_access.list);
         ast_free(node->list_access.index);
@@ -1618,6 +2884,7 @@ void ast_free(ASTNode *node)
         }
         free(node->dict.keys);
         free(node->dict.values);
+        free(node->dict.index);
         break;
     case NODE_DICT_GET:
     case NODE_DICT_KEYS:
@@ -1667,14 +2934,25 @@ void ast_free(ASTNode *node)
         ast_free(node->queue_op.queue);
         break;
     case NODE_LINKED_LIST:
-        for (int i = 0; i < node->linked_list.count; i++)
+        for (LinkedNode *item = node->linked_list.head; item;)
         {
-            ast_free(node->linked_list.elements[i]);
+            LinkedNode *next = item->next;
+            ast_free(item->value);
+            linked_node_release(item);
+            item = next;
         }
-        free(node->linked_list.elements);
         break;
     case NODE_LINKED_LIST_ADD:
     case NODE_LINKED_LIST_REMOVE:
+    case NODE_LINKED_LIST_PUSH_FRONT:
+    case NODE_LINKED_LIST_POP_FRONT:
+    case NODE_LINKED_LIST_POP_BACK:
+    case NODE_LINKED_LIST_CURSOR:
+    case NODE_LINKED_LIST_NEXT:
+    case NODE_LINKED_LIST_CURRENT:
+    case NODE_LINKED_LIST_INSERT:
+    case NODE_LINKED_LIST_ERASE:
+    case NODE_LINKED_LIST_SPLICE:
         ast_free(node->linked_list_op.list);
         ast_free(node->linked_list_op.value);
         break;
@@ -1727,7 +3005,7 @@ void ast_free(ASTNode *node)
             ast_free(node->http_delete.headers);
         break;
     case NODE_REGEX:
-        // No dynamic memory to free for regex pattern and flags
+        regex_free(node->regex.program);
         break;
     case NODE_REGEX_MATCH:
     case NODE_REGEX_FIND_ALL:
@@ -1739,6 +3017,21 @@ void ast_free(ASTNode *node)
         ast_free(node->regex_replace.text);
         ast_free(node->regex_replace.replacement);
         break;
+    case NODE_REGEX_NEXT:
+        ast_free(node->regex_next.regex);
+        ast_free(node->regex_next.text);
+        ast_free(node->regex_next.from);
+        break;
+    case NODE_REGEX_GROUP:
+        ast_free(node->regex_group.regex);
+        ast_free(node->regex_group.name);
+        break;
+    case NODE_PATTERN_MATCH:
+    case NODE_PATTERN_MATCH_ANY:
+        ast_free(node->pattern_match.pattern);
+        ast_free(node->pattern_match.noise);
+        text_matcher_free(node->pattern_match.matcher);
+        break;
     case NODE_TERNARY:
         ast_free(node->ternary.condition);
         ast_free(node->ternary.true_expr);
@@ -1767,6 +3060,15 @@ void ast_free(ASTNode *node)
         ast_free(node->sensitivity_threshold.threshold_value);
         ast_free(node->sensitivity_threshold.sensitivity_percent);
         break;
+    case NODE_TEMPORAL_CORRELATE_MATRIX:
+        ast_free(node->temporal_correlate_matrix.names);
+        ast_free(node->temporal_correlate_matrix.window_size);
+        temporal_correlation_free(node->temporal_correlate_matrix.cache);
+        break;
+    case NODE_TEMPORAL_XCORR:
+        ast_free(node->temporal_xcorr.window_size);
+        ast_free(node->temporal_xcorr.max_lag);
+        break;
     case NODE_TYPE:
         ast_free(node->type_check.value);
         break;
@@ -1774,10 +3076,12 @@ void ast_free(ASTNode *node)
         // No dynamic memory to free
         break;
     case NODE_SET:
-        if (node->set.elements)
+        for (int i = 0; i < node->set.count + node->set.removed; i++)
         {
-            free(node->set.elements);
+            ast_free(node->set.elements[i]);
         }
+        free(node->set.elements);
+        free(node->set.index);
         break;
     case NODE_STRING_SPLIT:
         ast_free(node->string_split.string);
@@ -1820,6 +3124,64 @@ void ast_free(ASTNode *node)
     case NODE_NEXT:
         ast_free(node->next_stmt.iterator);
         break;
+    case NODE_TREE:
+        tree_free_nodes(node->tree.root);
+        break;
+    case NODE_PVEC:
+    case NODE_PMAP:
+        persistent_release(node);
+        break;
+    case NODE_NDARRAY:
+        ndarray_release(node);
+        break;
+    case NODE_HEAP:
+        heap_release(node);
+        break;
+    case NODE_HEAP_PUSH:
+    case NODE_HEAP_POP:
+    case NODE_HEAP_PEEK:
+    case NODE_HEAP_SIZE:
+    case NODE_HEAP_UPDATE:
+    case NODE_HEAP_KEY:
+    case NODE_HEAP_COMPARE:
+    case NODE_HEAPIFY:
+        ast_free(node->heap_op.heap);
+        ast_free(node->heap_op.value);
+        ast_free(node->heap_op.priority);
+        break;
+    case NODE_PVEC_PUSH:
+    case NODE_PVEC_SET:
+    case NODE_PVEC_POP:
+    case NODE_PVEC_GET:
+    case NODE_PVEC_SIZE:
+    case NODE_PMAP_PUT:
+    case NODE_PMAP_REMOVE:
+    case NODE_PMAP_GET:
+    case NODE_PMAP_HAS:
+    case NODE_PMAP_SIZE:
+        ast_free(node->persistent_op.collection);
+        ast_free(node->persistent_op.key);
+        ast_free(node->persistent_op.value);
+        break;
+    case NODE_GRAPH:
+        for (int i = 0; i < node->graph.vertex_count; i++)
+        {
+            ast_free(node->graph.vertices[i]);
+            free(node->graph.out[i].targets);
+            free(node->graph.out[i].weights);
+            free(node->graph.in[i].targets);
+            free(node->graph.in[i].weights);
+            free(node->graph.out[i].slots);
+            free(node->graph.in[i].slots);
+        }
+        free(node->graph.vertices);
+        free(node->graph.out);
+        free(node->graph.in);
+        free(node->graph.index);
+        free(node->graph.csr_offsets);
+        free(node->graph.csr_targets);
+        free(node->graph.csr_weights);
+        break;
     case NODE_SET_UNION:
     case NODE_SET_INTERSECTION:
     case NODE_SET_DIFFERENCE:
@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <string.h>
+#include "gorilla.h"
+
+// --- Bit stream ---
+
+static void write_bits(GorillaBlock *block, uint64_t value, int n)
+{
+    size_t needed = (block->bits + n + 63) / 64;
+    if (needed > block->capacity)
+    {
+        size_t capacity = block->capacity ? block->capacity * 2 : 4;
+        while (capacity < needed)
+            capacity *= 2;
+        block->words = realloc(block->words, sizeof(uint64_t) * capacity);
+        memset(block->words + block->capacity, 0, sizeof(uint64_t) * (capacity - block->capacity));
+        block->capacity = capacity;
+    }
+    if (n < 64)
+        value &= (1ULL << n) - 1;
+
+    size_t word = block->bits / 64;
+    int room = 64 - (int)(block->bits % 64);
+    if (n <= room)
+    {
+        block->words[word] |= value << (room - n);
+    }
+    else
+    {
+        int spill = n - room;
+        block->words[word] |= value >> spill;
+        block->words[word + 1] |= value << (64 - spill);
+    }
+    block->bits += n;
+}
+
+static uint64_t read_bits(GorillaReader *reader, int n)
+{
+    const uint64_t *words = reader->block->words;
+    size_t word = reader->bit / 64;
+    int used = (int)(reader->bit % 64);
+    uint64_t value = words[word] << used;
+    if (n <= 64 - used)
+    {
+        value = n == 64 ? value : value >> (64 - n);
+    }
+    else
+    {
+        int spill = n - (64 - used);
+        value = value >> (64 - n) | words[word + 1] >> (64 - spill);
+    }
+    reader->bit += n;
+    return value;
+}
+
+static int fits(int64_t value, int bits)
+{
+    int64_t limit = (int64_t)1 << (bits - 1);
+    return value >= -limit && value < limit;
+}
+
+static int64_t sign_extend(uint64_t value, int bits)
+{
+    if (bits == 64)
+        return (int64_t)value;
+    uint64_t sign = 1ULL << (bits - 1);
+    return (int64_t)((value ^ sign) - sign);
+}
+
+// --- Blocks ---
+
+void gorilla_init(GorillaBlock *block)
+{
+    memset(block, 0, sizeof(GorillaBlock));
+    block->prev_leading = -1;
+}
+
+void gorilla_free(GorillaBlock *block)
+{
+    free(block->words);
+    gorilla_init(block);
+}
+
+void gorilla_append(GorillaBlock *block, int64_t time, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (block->count++ == 0)
+    {
+        write_bits(block, (uint64_t)time, 64);
+        write_bits(block, bits, 64);
+        block->prev_time = time;
+        block->prev_value = bits;
+        return;
+    }
+
+    // Time: '0' for an unchanged interval, else a prefix saying how many bits follow
+    // Wrapping arithmetic, so no interval can overflow
+    int64_t delta = (int64_t)((uint64_t)time - (uint64_t)block->prev_time);
+    int64_t dod = (int64_t)((uint64_t)delta - (uint64_t)block->prev_delta);
+    if (dod == 0)
+    {
+        write_bits(block, 0, 1);
+    }
+    else if (fits(dod, 7))
+    {
+        write_bits(block, 0x2, 2);
+        write_bits(block, (uint64_t)dod, 7);
+    }
+    else if (fits(dod, 9))
+    {
+        write_bits(block, 0x6, 3);
+        write_bits(block, (uint64_t)dod, 9);
+    }
+    else if (fits(dod, 12))
+    {
+        write_bits(block, 0xE, 4);
+        write_bits(block, (uint64_t)dod, 12);
+    }
+    else
+    {
+        write_bits(block, 0xF, 4);
+        write_bits(block, (uint64_t)dod, 64);
+    }
+    block->prev_time = time;
+    block->prev_delta = delta;
+
+    // Value: '0' for a repeat, '10' for an XOR inside the previous window of
+    // meaningful bits, '11' plus a new window otherwise
+    uint64_t xor = bits ^ block->prev_value;
+    if (xor == 0)
+    {
+        write_bits(block, 0, 1);
+    }
+    else
+    {
+        int leading = __builtin_clzll(xor);
+        int trailing = __builtin_ctzll(xor);
+        if (leading > 31)
+            leading = 31; // 5 bits
+        if (block->prev_leading >= 0 && leading >= block->prev_leading && trailing >= block->prev_trailing)
+        {
+            write_bits(block, 0x2, 2);
+            write_bits(block, xor >> block->prev_trailing, 64 - block->prev_leading - block->prev_trailing);
+        }
+        else
+        {
+            int length = 64 - leading - trailing;
+            write_bits(block, 0x3, 2);
+            write_bits(block, (uint64_t)leading, 5);
+            write_bits(block, (uint64_t)(length - 1), 6);
+            write_bits(block, xor >> trailing, length);
+            block->prev_leading = leading;
+            block->prev_trailing = trailing;
+        }
+    }
+    block->prev_value = bits;
+}
+
+void gorilla_seal(GorillaBlock *block)
+{
+    size_t needed = (block->bits + 63) / 64;
+    if (needed == 0 || needed == block->capacity)
+        return;
+    block->words = realloc(block->words, sizeof(uint64_t) * needed);
+    block->capacity = needed;
+}
+
+size_t gorilla_bytes(const GorillaBlock *block)
+{
+    return sizeof(uint64_t) * block->capacity;
+}
+
+void gorilla_reader_init(GorillaReader *reader, const GorillaBlock *block)
+{
+    memset(reader, 0, sizeof(GorillaReader));
+    reader->block = block;
+}
+
+int gorilla_next(GorillaReader *reader, int64_t *time, double *value)
+{
+    if (reader->index >= reader->block->count)
+        return 0;
+    if (reader->index == 0)
+    {
+        reader->time = (int64_t)read_bits(reader, 64);
+        reader->value = read_bits(reader, 64);
+    }
+    else
+    {
+        int64_t dod;
+        if (!read_bits(reader, 1))
+            dod = 0;
+        else if (!read_bits(reader, 1))
+            dod = sign_extend(read_bits(reader, 7), 7);
+        else if (!read_bits(reader, 1))
+            dod = sign_extend(read_bits(reader, 9), 9);
+        else if (!read_bits(reader, 1))
+            dod = sign_extend(read_bits(reader, 12), 12);
+        else
+            dod = (int64_t)read_bits(reader, 64);
+        reader->delta = (int64_t)((uint64_t)reader->delta + (uint64_t)dod);
+        reader->time = (int64_t)((uint64_t)reader->time + (uint64_t)reader->delta);
+
+        if (read_bits(reader, 1))
+        {
+            if (read_bits(reader, 1))
+            {
+                reader->leading = (int)read_bits(reader, 5);
+                int length = (int)read_bits(reader, 6) + 1;
+                reader->trailing = 64 - reader->leading - length;
+            }
+            int length = 64 - reader->leading - reader->trailing;
+            reader->value ^= read_bits(reader, length) << reader->trailing;
+        }
+    }
+    reader->index++;
+    *time = reader->time;
+    memcpy(value, &reader->value, sizeof(*value));
+    return 1;
+}
@@ -0,0 +1,377 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heap.h"
+#include "../packages/core/package_loader.h"
+
+// Children of entry i are ARITY*i+1 .. ARITY*i+ARITY. The array starts LINE_OFFSET
+// entries into a 64-byte aligned block, which puts every sibling group (four
+// 16-byte entries) exactly on one cache line.
+#define HEAP_ARITY 4
+#define HEAP_LINE_OFFSET 3
+#define HEAP_LINE_BYTES 64
+// A handle is slot + (generation << HEAP_SLOT_BITS). Generations wrap at 2^21 so
+// every handle stays below 2^52 and survives the round trip through a double.
+#define HEAP_SLOT_BITS 31
+#define HEAP_GENERATION_MASK 0x1fffffu
+
+static HeapEntry *alloc_entries(int capacity)
+{
+    void *block = NULL;
+    if (posix_memalign(&block, HEAP_LINE_BYTES, sizeof(HeapEntry) * (capacity + HEAP_LINE_OFFSET)) != 0)
+        return NULL;
+    return (HeapEntry *)block + HEAP_LINE_OFFSET;
+}
+
+static void free_entries(HeapEntry *entries)
+{
+    if (entries)
+        free(entries - HEAP_LINE_OFFSET);
+}
+
+static void *checked_realloc(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (!p)
+    {
+        perror("Failed to allocate heap");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static ASTNode *copy_value(ASTNode *value)
+{
+    return value->type == NODE_STRING ? ast_new_string(value->string) : ast_new_number(value->number);
+}
+
+ASTNode *heap_new(void)
+{
+    ASTNode *heap = malloc(sizeof(ASTNode));
+    heap->type = NODE_HEAP;
+    heap->heap.entries = NULL;
+    heap->heap.count = 0;
+    heap->heap.capacity = 0;
+    heap->heap.values = NULL;
+    heap->heap.positions = NULL;
+    heap->heap.generations = NULL;
+    heap->heap.free_slots = NULL;
+    heap->heap.free_count = 0;
+    heap->heap.handle_count = 0;
+    heap->heap.handle_capacity = 0;
+    heap->heap.key_fn[0] = '\0';
+    heap->heap.compare_fn[0] = '\0';
+    return heap;
+}
+
+// --- Ordering ---
+
+// Whether a should come out before b
+static int comes_before(ASTNode *heap, const HeapEntry *a, const HeapEntry *b)
+{
+    if (heap->heap.compare_fn[0])
+    {
+        ASTNode *args[2] = {heap->heap.values[a->handle], heap->heap.values[b->handle]};
+        return call_user_function(heap->heap.compare_fn, args, 2) != 0;
+    }
+    return a->priority < b->priority;
+}
+
+static void place(ASTNode *heap, int index, HeapEntry entry)
+{
+    heap->heap.entries[index] = entry;
+    heap->heap.positions[entry.handle] = index;
+}
+
+static void sift_up(ASTNode *heap, int index)
+{
+    HeapEntry entry = heap->heap.entries[index];
+    while (index > 0)
+    {
+        int parent = (index - 1) / HEAP_ARITY;
+        if (!comes_before(heap, &entry, &heap->heap.entries[parent]))
+            break;
+        place(heap, index, heap->heap.entries[parent]);
+        index = parent;
+    }
+    place(heap, index, entry);
+}
+
+static void sift_down(ASTNode *heap, int index)
+{
+    HeapEntry entry = heap->heap.entries[index];
+    HeapEntry *entries = heap->heap.entries;
+    for (;;)
+    {
+        int first = HEAP_ARITY * index + 1;
+        if (first >= heap->heap.count)
+            break;
+        int last = first + HEAP_ARITY < heap->heap.count ? first + HEAP_ARITY : heap->heap.count;
+        int best = first;
+        for (int child = first + 1; child < last; child++)
+            if (comes_before(heap, &entries[child], &entries[best]))
+                best = child;
+        if (!comes_before(heap, &entries[best], &entry))
+            break;
+        place(heap, index, entries[best]);
+        index = best;
+    }
+    place(heap, index, entry);
+}
+
+// Restore heap order over the whole array bottom-up, O(n)
+static void heapify(ASTNode *heap)
+{
+    if (heap->heap.count < 2)
+        return;
+    for (int i = (heap->heap.count - 2) / HEAP_ARITY; i >= 0; i--)
+        sift_down(heap, i);
+}
+
+int heap_priority(ASTNode *heap, ASTNode *value, double *priority)
+{
+    if (heap->heap.key_fn[0])
+    {
+        *priority = call_user_function(heap->heap.key_fn, &value, 1);
+        return 1;
+    }
+    if (value->type == NODE_NUMBER)
+    {
+        *priority = value->number;
+        return 1;
+    }
+    // Comparator heaps never look at priorities
+    *priority = 0;
+    return heap->heap.compare_fn[0] != '\0';
+}
+
+// --- Updates ---
+
+static void reserve(ASTNode *heap, int count, int handles)
+{
+    if (count > heap->heap.capacity)
+    {
+        int capacity = heap->heap.capacity ? heap->heap.capacity : 16;
+        while (capacity < count)
+            capacity *= 2;
+        HeapEntry *entries = alloc_entries(capacity);
+        if (!entries)
+        {
+            perror("Failed to allocate heap");
+            exit(EXIT_FAILURE);
+        }
+        if (heap->heap.count > 0)
+            memcpy(entries, heap->heap.entries, sizeof(HeapEntry) * heap->heap.count);
+        free_entries(heap->heap.entries);
+        heap->heap.entries = entries;
+        heap->heap.capacity = capacity;
+    }
+    if (handles > heap->heap.handle_capacity)
+    {
+        int capacity = heap->heap.handle_capacity ? heap->heap.handle_capacity : 16;
+        while (capacity < handles)
+            capacity *= 2;
+        heap->heap.values = checked_realloc(heap->heap.values, sizeof(ASTNode *) * capacity);
+        heap->heap.positions = checked_realloc(heap->heap.positions, sizeof(int) * capacity);
+        heap->heap.generations = checked_realloc(heap->heap.generations, sizeof(unsigned) * capacity);
+        heap->heap.free_slots = checked_realloc(heap->heap.free_slots, sizeof(int) * capacity);
+        heap->heap.handle_capacity = capacity;
+    }
+}
+
+static HeapHandle slot_handle(ASTNode *heap, int slot)
+{
+    return (HeapHandle)slot + ((HeapHandle)heap->heap.generations[slot] << HEAP_SLOT_BITS);
+}
+
+// Append an entry without restoring order, in a popped slot when there is one;
+// returns its slot
+static int append(ASTNode *heap, ASTNode *value, double priority)
+{
+    int slot;
+    if (heap->heap.free_count > 0)
+    {
+        reserve(heap, heap->heap.count + 1, heap->heap.handle_count);
+        slot = heap->heap.free_slots[--heap->heap.free_count];
+    }
+    else
+    {
+        reserve(heap, heap->heap.count + 1, heap->heap.handle_count + 1);
+        slot = heap->heap.handle_count++;
+        heap->heap.generations[slot] = 0;
+    }
+    heap->heap.values[slot] = value;
+    HeapEntry entry = {priority, slot};
+    place(heap, heap->heap.count++, entry);
+    return slot;
+}
+
+HeapHandle heap_push(ASTNode *heap, ASTNode *value, double priority)
+{
+    int slot = append(heap, value, priority);
+    sift_up(heap, heap->heap.count - 1);
+    return slot_handle(heap, slot);
+}
+
+ASTNode *heap_from_list(ASTNode *list, const char *key_fn)
+{
+    ASTNode *heap = heap_new();
+    if (key_fn)
+    {
+        strncpy(heap->heap.key_fn, key_fn, sizeof(heap->heap.key_fn) - 1);
+        heap->heap.key_fn[sizeof(heap->heap.key_fn) - 1] = '\0';
+    }
+    reserve(heap, list->list.count, list->list.count);
+    for (int i = 0; i < list->list.count; i++)
+    {
+        ASTNode *value = copy_value(ast_list_access(list, i));
+        double priority;
+        if (!heap_priority(heap, value, &priority))
+        {
+            ast_free(value);
+            ast_free(heap);
+            return NULL;
+        }
+        append(heap, value, priority);
+    }
+    heapify(heap);
+    return heap;
+}
+
+// Drop the first entry, leaving its value to the caller
+static void remove_first(ASTNode *heap)
+{
+    heap->heap.positions[heap->heap.entries[0].handle] = -1;
+    if (--heap->heap.count > 0)
+    {
+        place(heap, 0, heap->heap.entries[heap->heap.count]);
+        sift_down(heap, 0);
+    }
+}
+
+ASTNode *heap_pop(ASTNode *heap)
+{
+    if (heap->heap.count == 0)
+        return NULL;
+    int slot = heap->heap.entries[0].handle;
+    ASTNode *value = heap->heap.values[slot];
+    heap->heap.values[slot] = NULL;
+    remove_first(heap);
+    heap->heap.generations[slot] = (heap->heap.generations[slot] + 1) & HEAP_GENERATION_MASK;
+    heap->heap.free_slots[heap->heap.free_count++] = slot;
+    return value;
+}
+
+ASTNode *heap_peek(ASTNode *heap)
+{
+    return heap->heap.count > 0 ? heap->heap.values[heap->heap.entries[0].handle] : NULL;
+}
+
+// Entry index of a handle's value, or -1 if the handle is stale or was never issued
+static int live_position(ASTNode *heap, HeapHandle handle, int *slot)
+{
+    if (handle < 0)
+        return -1;
+    *slot = (int)(handle & ((1LL << HEAP_SLOT_BITS) - 1));
+    if (*slot >= heap->heap.handle_count || (handle >> HEAP_SLOT_BITS) != heap->heap.generations[*slot])
+        return -1;
+    return heap->heap.positions[*slot];
+}
+
+int heap_update(ASTNode *heap, HeapHandle handle, double priority)
+{
+    int slot;
+    int index = live_position(heap, handle, &slot);
+    if (index < 0)
+        return 0;
+    double old = heap->heap.entries[index].priority;
+    heap->heap.entries[index].priority = priority;
+    if (priority < old)
+        sift_up(heap, index);
+    else
+        sift_down(heap, index);
+    return 1;
+}
+
+int heap_update_value(ASTNode *heap, HeapHandle handle, ASTNode *value)
+{
+    int slot;
+    int index = live_position(heap, handle, &slot);
+    if (index < 0)
+        return 0;
+    ast_free(heap->heap.values[slot]);
+    heap->heap.values[slot] = value;
+    // The comparator decides the direction, so try both; one of them does nothing
+    sift_up(heap, index);
+    sift_down(heap, heap->heap.positions[slot]);
+    return 1;
+}
+
+int heap_set_order(ASTNode *heap, const char *key_fn, const char *compare_fn)
+{
+    char old_key[64], old_compare[64];
+    strcpy(old_key, heap->heap.key_fn);
+    strcpy(old_compare, heap->heap.compare_fn);
+    strncpy(heap->heap.key_fn, key_fn, sizeof(heap->heap.key_fn) - 1);
+    heap->heap.key_fn[sizeof(heap->heap.key_fn) - 1] = '\0';
+    strncpy(heap->heap.compare_fn, compare_fn, sizeof(heap->heap.compare_fn) - 1);
+    heap->heap.compare_fn[sizeof(heap->heap.compare_fn) - 1] = '\0';
+
+    double *priorities = malloc(sizeof(double) * (heap->heap.count > 0 ? heap->heap.count : 1));
+    for (int i = 0; i < heap->heap.count; i++)
+    {
+        if (!heap_priority(heap, heap->heap.values[heap->heap.entries[i].handle], &priorities[i]))
+        {
+            strcpy(heap->heap.key_fn, old_key);
+            strcpy(heap->heap.compare_fn, old_compare);
+            free(priorities);
+            return 0;
+        }
+    }
+    for (int i = 0; i < heap->heap.count; i++)
+        heap->heap.entries[i].priority = priorities[i];
+    free(priorities);
+    heapify(heap);
+    return 1;
+}
+
+// --- Whole-heap views ---
+
+ASTNode *heap_to_list(ASTNode *heap)
+{
+    // Pop from a scratch copy of the entry array; the values themselves are shared
+    ASTNode scratch = *heap;
+    scratch.heap.entries = alloc_entries(heap->heap.count > 0 ? heap->heap.count : 1);
+    scratch.heap.positions = malloc(sizeof(int) * (heap->heap.handle_count > 0 ? heap->heap.handle_count : 1));
+    if (!scratch.heap.entries || !scratch.heap.positions)
+    {
+        perror("Failed to allocate heap");
+        exit(EXIT_FAILURE);
+    }
+    if (heap->heap.count > 0)
+        memcpy(scratch.heap.entries, heap->heap.entries, sizeof(HeapEntry) * heap->heap.count);
+    if (heap->heap.handle_count > 0)
+        memcpy(scratch.heap.positions, heap->heap.positions, sizeof(int) * heap->heap.handle_count);
+
+    ASTNode *list = ast_new_list();
+    while (scratch.heap.count > 0)
+    {
+        ast_list_add_element(list, copy_value(heap->heap.values[scratch.heap.entries[0].handle]));
+        remove_first(&scratch);
+    }
+    free_entries(scratch.heap.entries);
+    free(scratch.heap.positions);
+    return list;
+}
+
+void heap_release(ASTNode *heap)
+{
+    for (int i = 0; i < heap->heap.count; i++)
+        ast_free(heap->heap.values[heap->heap.entries[i].handle]);
+    free_entries(heap->heap.entries);
+    free(heap->heap.values);
+    free(heap->heap.positions);
+    free(heap->heap.generations);
+    free(heap->heap.free_slots);
+}
@@ -2,8 +2,12 @@
 #include <string.h>
 #include "tesseract_pch.h"
 #include "error.h"
+#include "persistent.h"
+#include "ndarray.h"
+#include "heap.h"
 #include "../packages/core/package_loader.h"
 #include <ctype.h>
+#include <errno.h>
 
 extern int debug_mode;
 
@@ -22,6 +26,8 @@ void init_database_package();
 void init_console_utils_package();
 void init_time_package();
 void init_burger_package();
+void init_graph_algorithms_package();
+void init_ndarray_utils_package();
 
 #define MAX_FUNCTIONS 1000000
 #define MAX_CLASSES 1000000
@@ -200,6 +206,34 @@ static int class_count = 0;
 static double eval_expression(ASTNode *node);
 static char *list_to_string(ASTNode *list);
 static char *get_string_value(ASTNode *node);
+static ASTNode *eval_value_node(ASTNode *node);
+static double scalar_number(const char *name, const char *text);
+static ASTNode *eval_dict_get(ASTNode *node);
+static ASTNode *dict_lookup(ASTNode *dict_node, ASTNode *key_expr);
+static int is_set_result_node(ASTNode *node);
+static ASTNode *eval_set_result(ASTNode *node);
+static void set_add_filtered(ASTNode *result, ASTNode *src, ASTNode *other, int keep_common);
+static int is_list_result_node(ASTNode *node);
+static ASTNode *eval_list_result(ASTNode *node);
+static ASTNode *unshare_list(const char *name, ASTNode *list);
+static ASTNode *copy_list_values(ASTNode *list);
+static ASTNode *resolve_tree(ASTNode *operand, const char *op_name, int line);
+static double eval_tree_key(ASTNode *expr, const char *op_name, int line);
+static ASTNode *resolve_graph(ASTNode *operand);
+static int graph_vertex_id(ASTNode *graph_node, ASTNode *vertex_expr);
+static ASTNode *call_package(ASTNode *call);
+static ASTNode *resolve_linked_list(ASTNode *operand, const char *op_name);
+static int is_linked_value_node(ASTNode *node);
+static ASTNode *eval_linked_value(ASTNode *node);
+static ASTNode *resolve_persistent(ASTNode *operand, NodeType expected, const char *op_name);
+static int is_persistent_result_node(ASTNode *node);
+static ASTNode *eval_persistent_result(ASTNode *node);
+static int is_persistent_value_node(ASTNode *node);
+static ASTNode *eval_persistent_value(ASTNode *node);
+static ASTNode *resolve_heap(ASTNode *operand, const char *op_name);
+static ASTNode *build_heap(ASTNode *node);
+static int is_heap_value_node(ASTNode *node);
+static ASTNode *eval_heap_value(ASTNode *node);
 
 // Forward declaration for file reading
 char *read_file(const char *filename);
@@ -243,12 +277,13 @@ static char *perform_http_request(const char *url, const char *method, const cha
 static void init_http();
 
 // Forward declarations for regex functions
-static int regex_match_pattern(const char *pattern, const char *text, const char *flags);
-static void regex_find_all_matches(const char *pattern, const char *text, const char *flags, ASTNode *result_list);
-static char *regex_replace_pattern(const char *pattern, const char *text, const char *replacement, const char *flags);
-static int regex_match_at_position(const char *pattern, const char *text, int case_insensitive);
-static int regex_get_match_length(const char *pattern, const char *text, int case_insensitive);
-static int regex_match_char(char pattern_char, char text_char, int case_insensitive);
+static ASTNode *regex_operand(ASTNode *regex_node, const char *operation);
+static RegexProgram *regex_program(ASTNode *regex_node);
+static ASTNode *regex_match_list(RegexProgram *program, const size_t *spans);
+static void regex_find_all_matches(RegexProgram *program, const char *text, ASTNode *result_list);
+static char *regex_replace_pattern(RegexProgram *program, const char *text, const char *replacement, int global);
+static ASTNode *eval_regex_matches(ASTNode *node);
+static ASTNode *eval_pattern_match(ASTNode *node);
 
 static FieldEntry *object_get_field(ObjectInstance *obj, const char *field);
 
@@ -553,8 +588,28 @@ static void initialize_builtin_functions() {
     register_function("lerp", lerp_params, 3, lerp_body);
 }
 
+// Runs a user-defined function for package code such as sort_by
+static double call_user_function_from_package(const char *func_name, ASTNode **args, int arg_count)
+{
+    ASTNode *call = ast_new_func_call(func_name, args, arg_count);
+    call->line = 0;
+    double result = eval_expression(call);
+    free(call); // The arguments belong to the package
+    return result;
+}
+
+// Runs a temporal trigger's callback as a statement, so its value is discarded
+static void run_trigger_callback(const char *callback, ASTNode **args, int arg_count)
+{
+    ASTNode *call = ast_new_func_call(callback, args, arg_count);
+    call->line = 0;
+    interpret(call);
+    free(call); // The arguments belong to the caller
+}
+
 static void initialize_packages() {
     if (!packages_initialized) {
+        set_user_function_caller(call_user_function_from_package);
         init_date_time_package();
         init_math_utils_package();
         init_string_utils_package();
@@ -569,6 +624,8 @@ static void initialize_packages() {
         init_console_utils_package();
         init_time_package();
         init_burger_package();
+        init_graph_algorithms_package();
+        init_ndarray_utils_package();
         initialize_builtin_functions();
         packages_initialized = 1;
     }
@@ -605,19 +662,31 @@ void interpret(ASTNode *root)
             printf("[DEBUG] Assignment: %s\n", root->assign.varname);
         }
         ASTNode *value_node = root->assign.value;
+        ASTNode *package_result = NULL;
         
         // Check if this is a temporal variable initialization (let$ x := <temp@5>)
-        if (value_node->type == NODE_TEMPORAL_VAR)
+        if (value_node->type == NODE_TEMPORAL_NEW)
         {
-            int max_history = (int)value_node->number;
             // Initialize with empty value - will be set on first assignment
-            set_temporal_variable(root->assign.varname, "0", max_history);
+            set_temporal_variable(root->assign.varname, "0", value_node->temporal_new.max_history);
+            if (value_node->temporal_new.archived > 0)
+                temporal_enable_archive(get_temporal_var_struct(root->assign.varname),
+                                        value_node->temporal_new.archived);
             return;
         }
         
         if (value_node->type == NODE_STRING)
         {
-            set_variable(root->assign.varname, value_node->string);
+            TemporalVariable *temp_var = get_temporal_var_struct(root->assign.varname);
+            if (temp_var)
+            {
+                // Text samples such as states go to the history's text side channel
+                set_temporal_variable(root->assign.varname, value_node->string, temp_var->max_history);
+            }
+            else
+            {
+                set_variable(root->assign.varname, value_node->string);
+            }
         }
         else if (value_node->type == NODE_INPUT)
         {
@@ -630,7 +699,9 @@ void interpret(ASTNode *root)
         }
         else if (value_node->type == NODE_LIST)
         {
-            set_list_variable(root->assign.varname, value_node);
+            // As with sets, the literal stays with the parse tree and the variable
+            // gets its own list, with any variables in it read now
+            set_list_variable(root->assign.varname, copy_list_values(value_node));
         }
         else if (value_node->type == NODE_DICT)
         {
@@ -654,7 +725,11 @@ void interpret(ASTNode *root)
         }
         else if (value_node->type == NODE_SET)
         {
-            set_set_variable(root->assign.varname, value_node);
+            // The literal stays with the parse tree, which may run it again, so the
+            // variable gets a set of its own that it is free to change and release
+            ASTNode *set = ast_new_set();
+            set_add_filtered(set, value_node, NULL, 1);
+            set_set_variable(root->assign.varname, set);
         }
         else if (value_node->type == NODE_TREE)
         {
@@ -666,7 +741,12 @@ void interpret(ASTNode *root)
         }
         else if (value_node->type == NODE_UNDEF)
         {
-            set_undef_variable(root->assign.varname);
+            // On a temporal variable undef records a missing sample
+            TemporalVariable *temp_var = get_temporal_var_struct(root->assign.varname);
+            if (temp_var)
+                temporal_push_missing(temp_var);
+            else
+                set_undef_variable(root->assign.varname);
         }
         else if (value_node->type == NODE_FILE_READ)
         {
@@ -677,6 +757,69 @@ void interpret(ASTNode *root)
                 set_variable(root->assign.varname, read_val);
             }
         }
+        else if (is_set_result_node(value_node))
+        {
+            set_set_variable(root->assign.varname, eval_set_result(value_node));
+        }
+        else if (is_list_result_node(value_node))
+        {
+            set_list_variable(root->assign.varname, eval_list_result(value_node));
+        }
+        else if (value_node->type == NODE_PVEC || value_node->type == NODE_PMAP)
+        {
+            set_persistent_variable(root->assign.varname, persistent_snapshot(value_node));
+        }
+        else if (value_node->type == NODE_VAR && get_persistent_variable(value_node->varname))
+        {
+            // Versions share structure, so copying a persistent collection is an O(1) snapshot
+            set_persistent_variable(root->assign.varname,
+                                    persistent_snapshot(get_persistent_variable(value_node->varname)));
+        }
+        else if (is_persistent_result_node(value_node))
+        {
+            set_persistent_variable(root->assign.varname, eval_persistent_result(value_node));
+        }
+        else if (value_node->type == NODE_VAR && get_ndarray_variable(value_node->varname))
+        {
+            // Array operations never write in place, so the copy can share the buffer
+            set_ndarray_variable(root->assign.varname, ndarray_share(get_ndarray_variable(value_node->varname)));
+        }
+        else if (value_node->type == NODE_HEAP)
+        {
+            set_heap_variable(root->assign.varname, heap_new());
+        }
+        else if (value_node->type == NODE_HEAPIFY)
+        {
+            set_heap_variable(root->assign.varname, build_heap(value_node));
+        }
+        else if (is_linked_value_node(value_node) || is_persistent_value_node(value_node) ||
+                 is_heap_value_node(value_node))
+        {
+            ASTNode *element = is_linked_value_node(value_node)     ? eval_linked_value(value_node)
+                               : is_persistent_value_node(value_node) ? eval_persistent_value(value_node)
+                                                                      : eval_heap_value(value_node);
+            if (element->type == NODE_STRING)
+            {
+                set_variable(root->assign.varname, element->string);
+            }
+            else
+            {
+                set_number_variable(root->assign.varname, element->number);
+            }
+            ast_free(element);
+        }
+        else if (value_node->type == NODE_DICT_GET)
+        {
+            ASTNode *found = eval_dict_get(value_node);
+            if (found->type == NODE_STRING)
+            {
+                set_variable(root->assign.varname, found->string);
+            }
+            else
+            {
+                set_number_variable(root->assign.varname, found->type == NODE_NUMBER ? found->number : 0);
+            }
+        }
         else if (value_node->type == NODE_TO_STR)
         {
             double result = eval_expression(value_node);
@@ -690,9 +833,7 @@ void interpret(ASTNode *root)
             }
             else
             {
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%g", result);
-                set_variable(root->assign.varname, buf);
+                set_number_variable(root->assign.varname, result);
             }
         }
         else if (value_node->type == NODE_TYPE)
@@ -748,10 +889,36 @@ void interpret(ASTNode *root)
                 }
                 else
                 {
-                    char buf[64];
-                    snprintf(buf, sizeof(buf), "%g", val);
-                    set_variable(root->assign.varname, buf);
+                    set_number_variable(root->assign.varname, val);
+                }
+            }
+        }
+        else if (value_node->type == NODE_FUNC_CALL && (package_result = call_package(value_node)))
+        {
+            // Package functions may hand back a collection or a string rather than a number
+            if (package_result->type == NODE_LIST)
+            {
+                set_list_variable(root->assign.varname, package_result);
+            }
+            else if (package_result->type == NODE_DICT)
+            {
+                set_dict_variable(root->assign.varname, package_result);
+            }
+            else if (package_result->type == NODE_NDARRAY)
+            {
+                set_ndarray_variable(root->assign.varname, package_result);
+            }
+            else
+            {
+                if (package_result->type == NODE_STRING)
+                {
+                    set_variable(root->assign.varname, package_result->string);
+                }
+                else
+                {
+                    set_number_variable(root->assign.varname, eval_expression(package_result));
                 }
+                ast_free(package_result);
             }
         }
         else if (value_node->type == NODE_FUNC_CALL)
@@ -763,15 +930,17 @@ void interpret(ASTNode *root)
             const char *str_result = get_variable("__function_return_str");
             if (str_result)
             {
-                set_variable(root->assign.varname, str_result);
+                // A returned number variable stays a number
+                if (is_number_variable("__function_return_str"))
+                    set_number_variable(root->assign.varname, scalar_number("__function_return_str", str_result));
+                else
+                    set_variable(root->assign.varname, str_result);
                 // Clear the temporary variable
                 set_variable("__function_return_str", "");
             }
             else
             {
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%g", result);
-                set_variable(root->assign.varname, buf);
+                set_number_variable(root->assign.varname, result);
             }
         }
         else if (value_node->type == NODE_CLASS_INSTANCE)
@@ -820,18 +989,15 @@ void interpret(ASTNode *root)
         else
         {
             double val = eval_expression(value_node);
-            char buf[64];
-            snprintf(buf, sizeof(buf), "%g", val);
             
             // Check if this is a temporal variable
-            TemporalVariable *temp_var = get_temporal_var_struct(root->assign.varname);
-            if (temp_var)
+            if (get_temporal_var_struct(root->assign.varname))
             {
-                set_temporal_variable(root->assign.varname, buf, temp_var->max_history);
+                set_temporal_number(root->assign.varname, val);
             }
             else
             {
-                set_variable(root->assign.varname, buf);
+                set_number_variable(root->assign.varname, val);
             }
         }
     }
@@ -839,7 +1005,7 @@ void interpret(ASTNode *root)
     {
         // Handle compound assignment operators (+=, -=, *=, /=, %=)
         const char *current_val = get_variable(root->compound_assign.varname);
-        double current_num = current_val ? strtod(current_val, NULL) : 0.0;
+        double current_num = scalar_number(root->compound_assign.varname, current_val);
         double new_val = eval_expression(root->compound_assign.value);
         double result;
         
@@ -873,18 +1039,13 @@ void interpret(ASTNode *root)
         }
         
         // Store the result back in the variable
-        char buf[64];
-        snprintf(buf, sizeof(buf), "%g", result);
-        
-        // Check if this is a temporal variable
-        TemporalVariable *temp_var = get_temporal_var_struct(root->compound_assign.varname);
-        if (temp_var)
+        if (get_temporal_var_struct(root->compound_assign.varname))
         {
-            set_temporal_variable(root->compound_assign.varname, buf, temp_var->max_history);
+            set_temporal_number(root->compound_assign.varname, result);
         }
         else
         {
-            set_variable(root->compound_assign.varname, buf);
+            set_number_variable(root->compound_assign.varname, result);
         }
     }
     else if (root->type == NODE_INPUT)
@@ -1054,9 +1215,7 @@ void interpret(ASTNode *root)
             // Positive increment (ascending)
             for (double i = start; i <= end; i += increment)
             {
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%g", i);
-                set_variable(root->loop_stmt.varname, buf);
+                set_number_variable(root->loop_stmt.varname, i);
                 interpret(root->loop_stmt.body);
                 
                 if (break_flag)
@@ -1076,9 +1235,7 @@ void interpret(ASTNode *root)
             // Negative increment (descending)
             for (double i = start; i >= end; i += increment)
             {
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%g", i);
-                set_variable(root->loop_stmt.varname, buf);
+                set_number_variable(root->loop_stmt.varname, i);
                 interpret(root->loop_stmt.body);
                 
                 if (break_flag)
@@ -1125,16 +1282,14 @@ void interpret(ASTNode *root)
                 // Iterate through list elements
                 for (int i = 0; i < list->list.count; i++)
                 {
-                    ASTNode *element = list->list.elements[i];
+                    ASTNode *element = ast_list_access(list, i);
                     if (element->type == NODE_STRING)
                     {
                         set_variable(root->foreach_stmt.varname, element->string);
                     }
                     else if (element->type == NODE_NUMBER)
                     {
-                        char buf[64];
-                        snprintf(buf, sizeof(buf), "%g", element->number);
-                        set_variable(root->foreach_stmt.varname, buf);
+                        set_number_variable(root->foreach_stmt.varname, element->number);
                     }
                     else if (element->type == NODE_LIST)
                     {
@@ -1172,9 +1327,7 @@ void interpret(ASTNode *root)
                 }
                 else if (element->type == NODE_NUMBER)
                 {
-                    char buf[64];
-                    snprintf(buf, sizeof(buf), "%g", element->number);
-                    set_variable(root->foreach_stmt.varname, buf);
+                    set_number_variable(root->foreach_stmt.varname, element->number);
                 }
                 else if (element->type == NODE_LIST)
                 {
@@ -1214,7 +1367,7 @@ void interpret(ASTNode *root)
         for (int i = 0; i < temp_var->count; i++)
         {
             // Set the loop variable to current history entry
-            set_variable(root->temporal_loop.varname, temp_var->history[i].value);
+            set_variable(root->temporal_loop.varname, temporal_text(temp_var, i));
             interpret(root->temporal_loop.body);
             
             if (break_flag)
@@ -1365,9 +1518,10 @@ void interpret(ASTNode *root)
         }
         
         // Try package functions first
-        ASTNode *package_result = call_package_function(root->func_call.name, root->func_call.args, root->func_call.arg_count);
+        ASTNode *package_result = call_package(root);
         if (package_result) {
             // Package function found and executed
+            ast_free(package_result);
             return;
         }
         
@@ -1394,9 +1548,7 @@ void interpret(ASTNode *root)
             else
             {
                 double val = eval_expression(arg);
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%g", val);
-                set_variable(fn->params[i], buf);
+                set_number_variable(fn->params[i], val);
             }
         }
 
@@ -1513,9 +1665,7 @@ void interpret(ASTNode *root)
             else
             {
                 double val = eval_expression(arg);
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%g", val);
-                set_variable(method_def->method_def.params[i], buf);
+                set_number_variable(method_def->method_def.params[i], val);
             }
         }
         interpret(method_def->method_def.body);
@@ -1610,12 +1760,20 @@ void interpret(ASTNode *root)
              root->type == NODE_QUEUE_ISEMPTY || root->type == NODE_QUEUE_SIZE ||
              root->type == NODE_LINKED_LIST_ADD || root->type == NODE_LINKED_LIST_REMOVE ||
              root->type == NODE_LINKED_LIST_GET || root->type == NODE_LINKED_LIST_SIZE ||
-             root->type == NODE_LINKED_LIST_ISEMPTY || root->type == NODE_REGEX ||
+             root->type == NODE_LINKED_LIST_ISEMPTY || root->type == NODE_LINKED_LIST_PUSH_FRONT ||
+             root->type == NODE_LINKED_LIST_POP_FRONT || root->type == NODE_LINKED_LIST_POP_BACK ||
+             root->type == NODE_LINKED_LIST_CURSOR || root->type == NODE_LINKED_LIST_NEXT ||
+             root->type == NODE_LINKED_LIST_CURRENT || root->type == NODE_LINKED_LIST_INSERT ||
+             root->type == NODE_LINKED_LIST_ERASE || root->type == NODE_LINKED_LIST_SPLICE ||
+             root->type == NODE_REGEX ||
              root->type == NODE_REGEX_MATCH || root->type == NODE_REGEX_REPLACE ||
-             root->type == NODE_REGEX_FIND_ALL || root->type == NODE_TREE ||
+             root->type == NODE_REGEX_FIND_ALL || root->type == NODE_REGEX_NEXT ||
+             root->type == NODE_REGEX_GROUP || root->type == NODE_TREE ||
              root->type == NODE_TREE_INSERT || root->type == NODE_TREE_SEARCH ||
              root->type == NODE_TREE_DELETE || root->type == NODE_TREE_INORDER ||
              root->type == NODE_TREE_PREORDER || root->type == NODE_TREE_POSTORDER ||
+             root->type == NODE_TREE_RANGE || root->type == NODE_TREE_FLOOR ||
+             root->type == NODE_TREE_CEIL ||
              root->type == NODE_GRAPH || root->type == NODE_GRAPH_ADD_VERTEX ||
              root->type == NODE_GRAPH_ADD_EDGE || root->type == NODE_GRAPH_REMOVE_VERTEX ||
              root->type == NODE_GRAPH_REMOVE_EDGE || root->type == NODE_GRAPH_HAS_EDGE ||
@@ -1625,21 +1783,34 @@ void interpret(ASTNode *root)
              root->type == NODE_SET_SYMMETRIC_DIFF || root->type == NODE_SET_ADD ||
              root->type == NODE_SET_REMOVE || root->type == NODE_SET_CONTAINS ||
              root->type == NODE_SET_SIZE || root->type == NODE_SET_EMPTY ||
-             root->type == NODE_SET_CLEAR || root->type == NODE_SET_COPY)
+             root->type == NODE_SET_CLEAR || root->type == NODE_SET_COPY ||
+             root->type == NODE_PVEC_SIZE || root->type == NODE_PMAP_SIZE || root->type == NODE_PMAP_HAS ||
+             is_persistent_result_node(root) || is_persistent_value_node(root) ||
+             root->type == NODE_HEAP_PUSH || root->type == NODE_HEAP_POP ||
+             root->type == NODE_HEAP_PEEK || root->type == NODE_HEAP_SIZE ||
+             root->type == NODE_HEAP_UPDATE || root->type == NODE_HEAP_KEY ||
+             root->type == NODE_HEAP_COMPARE || root->type == NODE_HEAPIFY ||
+             root->type == NODE_LIST_SLICE || root->type == NODE_TEMPORAL_DOWNSAMPLE ||
+             root->type == NODE_TEMPORAL_CORRELATE_MATRIX || root->type == NODE_TEMPORAL_XCORR ||
+             root->type == NODE_TEMPORAL_FILL || root->type == NODE_TEMPORAL_RESAMPLE)
     {
         // For linked list remove operations, don't print the result
         if (root->type == NODE_LINKED_LIST_REMOVE)
         {
             eval_expression(root); // Just execute without printing
         }
+        else if (is_list_result_node(root))
+        {
+            print_node(root); // A bare traversal statement shows its values
+        }
         else
         {
             eval_expression(root);
         }
     }
-    else if (root->type == NODE_PATTERN_MATCH)
+    else if (root->type == NODE_PATTERN_MATCH || root->type == NODE_PATTERN_MATCH_ANY)
     {
-        eval_expression(root); // Call eval_expression without expecting a return value
+        print_node(root); // A bare search shows where it found its needles
     }
     else if (root->type == NODE_BINOP || root->type == NODE_VAR || root->type == NODE_NUMBER || root->type == NODE_STRING)
     {
@@ -1707,6 +1878,8 @@ void interpret(ASTNode *root)
              root->type == NODE_TEMPORAL_CONDITION || root->type == NODE_SLIDING_WINDOW_STATS ||
              root->type == NODE_SENSITIVITY_THRESHOLD || root->type == NODE_TEMPORAL_QUERY ||
              root->type == NODE_TEMPORAL_CORRELATE || root->type == NODE_TEMPORAL_INTERPOLATE ||
+             root->type == NODE_TEMPORAL_PERSIST || root->type == NODE_TEMPORAL_TRIGGER ||
+             root->type == NODE_TEMPORAL_UNTRIGGER ||
              root->type == NODE_STRING_SPLIT || root->type == NODE_STRING_JOIN ||
              root->type == NODE_STRING_REPLACE || root->type == NODE_STRING_SUBSTRING ||
              root->type == NODE_STRING_LENGTH || root->type == NODE_STRING_UPPER ||
@@ -1725,20 +1898,16 @@ void interpret(ASTNode *root)
     else if (root->type == NODE_INCREMENT)
     {
         const char *val = get_variable(root->inc_dec.varname);
-        double current = val ? strtod(val, NULL) : 0.0;
+        double current = scalar_number(root->inc_dec.varname, val);
         current += 1.0;
-        char buf[64];
-        snprintf(buf, sizeof(buf), "%g", current);
-        set_variable(root->inc_dec.varname, buf);
+        set_number_variable(root->inc_dec.varname, current);
     }
     else if (root->type == NODE_DECREMENT)
     {
         const char *val = get_variable(root->inc_dec.varname);
-        double current = val ? strtod(val, NULL) : 0.0;
+        double current = scalar_number(root->inc_dec.varname, val);
         current -= 1.0;
-        char buf[64];
-        snprintf(buf, sizeof(buf), "%g", current);
-        set_variable(root->inc_dec.varname, buf);
+        set_number_variable(root->inc_dec.varname, current);
     }
     else
     {
@@ -1805,6 +1974,9 @@ static double eval_expression(ASTNode *node)
         {
             return 0.0; // Undefined variables are treated as UNDEF (0)
         }
+        double number;
+        if (get_number_variable(node->varname, &number))
+            return number;
         char *endptr;
         double dval = strtod(val, &endptr);
         if (endptr == val)
@@ -1899,7 +2071,7 @@ static double eval_expression(ASTNode *node)
             error_throw_at_line(ERROR_INDEX_OUT_OF_BOUNDS, "List index out of bounds", node->line);
         }
 
-        ASTNode *element = list_node->list.elements[i];
+        ASTNode *element = ast_list_access(list_node, i);
         if (element->type == NODE_NUMBER)
         {
             return element->number;
@@ -1918,6 +2090,10 @@ static double eval_expression(ASTNode *node)
     case NODE_LIST_LEN:
     {
         ASTNode *list_node = node->list_access.list;
+        if (is_list_result_node(list_node))
+        {
+            return eval_expression(list_node);
+        }
         if (list_node->type == NODE_VAR)
         {
             list_node = get_list_variable(list_node->varname);
@@ -1947,7 +2123,7 @@ static double eval_expression(ASTNode *node)
                 printf("Runtime error: Undefined list variable\n");
                 exit(1);
             }
-            list_node = list;
+            list_node = unshare_list(list_node->varname, list);
         }
 
         if (list_node->type != NODE_LIST)
@@ -1955,7 +2131,7 @@ static double eval_expression(ASTNode *node)
             error_throw_at_line(ERROR_TYPE_MISMATCH, "append() expects a list", node->line);
         }
 
-        ast_list_add_element(list_node, value_node);
+        ast_list_add_element(list_node, eval_value_node(value_node));
         return 0; // Return success
     }
 
@@ -1972,7 +2148,7 @@ static double eval_expression(ASTNode *node)
                 printf("Runtime error: Undefined list variable\n");
                 exit(1);
             }
-            list_node = list;
+            list_node = unshare_list(list_node->varname, list);
         }
 
         if (list_node->type != NODE_LIST)
@@ -1987,7 +2163,7 @@ static double eval_expression(ASTNode *node)
         {
             list_node->list.elements[i] = list_node->list.elements[i - 1];
         }
-        list_node->list.elements[0] = value_node;
+        list_node->list.elements[0] = eval_value_node(value_node);
         list_node->list.count++;
         return 0; // Return success
     }
@@ -2003,7 +2179,7 @@ static double eval_expression(ASTNode *node)
                 printf("Runtime error: Undefined list variable\n");
                 exit(1);
             }
-            list_node = list;
+            list_node = unshare_list(list_node->varname, list);
         }
 
         if (list_node->type != NODE_LIST || list_node->list.count == 0)
@@ -2074,7 +2250,7 @@ static double eval_expression(ASTNode *node)
                 printf("Runtime error: Undefined list variable\n");
                 exit(1);
             }
-            list_node = list;
+            list_node = unshare_list(list_node->varname, list);
         }
 
         if (list_node->type != NODE_LIST)
@@ -2163,74 +2339,6 @@ static double eval_expression(ASTNode *node)
         return value;
     }
 
-    case NODE_PATTERN_MATCH:
-    {
-        // Get the pattern and noise strings
-        const char *pattern_str = NULL;
-        const char *noise_str = NULL;
-
-        if (node->pattern_match.pattern->type == NODE_STRING)
-        {
-            pattern_str = node->pattern_match.pattern->string;
-        }
-        else if (node->pattern_match.pattern->type == NODE_VAR)
-        {
-            pattern_str = get_variable(node->pattern_match.pattern->varname);
-        }
-
-        if (node->pattern_match.noise->type == NODE_STRING)
-        {
-            noise_str = node->pattern_match.noise->string;
-        }
-        else if (node->pattern_match.noise->type == NODE_VAR)
-        {
-            noise_str = get_variable(node->pattern_match.noise->varname);
-        }
-
-        if (!pattern_str || !noise_str)
-        {
-            printf("Runtime error: pattern_match expects string arguments\n");
-            exit(1);
-        }
-
-        int pattern_len = strlen(pattern_str);
-        int noise_len = strlen(noise_str);
-
-        if (pattern_len == 0 || noise_len == 0)
-        {
-            return 0; // No matches if either string is empty
-        }
-
-        // Create a list to store the match positions
-        ASTNode *result_list = ast_new_list();
-
-        // Naive pattern matching algorithm
-        for (int i = 0; i <= noise_len - pattern_len; i++)
-        {
-            int match = 1;
-            for (int j = 0; j < pattern_len; j++)
-            {
-                if (noise_str[i + j] != pattern_str[j])
-                {
-                    match = 0;
-                    break;
-                }
-            }
-            if (match)
-            {
-                // Add the position to the result list
-                ast_list_add_element(result_list, ast_new_number(i));
-            }
-        }
-
-        // Store the result in a special variable or print it directly
-        char *list_str = list_to_string(result_list);
-        printf("%s\n", list_str); // Print the result
-        free(list_str);
-        ast_free(result_list);
-        return 0;
-    }
-
     case NODE_FORMAT_STRING:
     {
         char buffer[1024];
@@ -2306,27 +2414,13 @@ static double eval_expression(ASTNode *node)
                         }
                         if (dict_node && dict_node->type == NODE_DICT)
                         {
-                            ASTNode *key = arg->dict_get.key;
-                            int found = 0;
-                            for (int i = 0; i < dict_node->dict.count; i++)
-                            {
-                                if (dict_node->dict.keys[i]->type == NODE_STRING && key->type == NODE_STRING)
-                                {
-                                    if (strcmp(dict_node->dict.keys[i]->string, key->string) == 0)
-                                    {
-                                        if (dict_node->dict.values[i]->type == NODE_STRING)
-                                            dest += sprintf(dest, "%s", dict_node->dict.values[i]->string);
-                                        else if (dict_node->dict.values[i]->type == NODE_NUMBER)
-                                            dest += sprintf(dest, "%g", dict_node->dict.values[i]->number);
-                                        found = 1;
-                                        break;
-                                    }
-                                }
-                            }
-                            if (!found)
-                            {
+                            ASTNode *value = dict_lookup(dict_node, arg->dict_get.key);
+                            if (!value)
                                 dest += sprintf(dest, "(not found)");
-                            }
+                            else if (value->type == NODE_STRING)
+                                dest += sprintf(dest, "%s", value->string);
+                            else if (value->type == NODE_NUMBER)
+                                dest += sprintf(dest, "%g", value->number);
                         }
                     }
                     else if (arg->type == NODE_MEMBER_ACCESS)
@@ -2474,37 +2568,10 @@ static double eval_expression(ASTNode *node)
         return 0;
     case NODE_DICT_GET:
     {
-        ASTNode *dict_node = node->dict_get.dict;
-        if (dict_node->type == NODE_VAR)
-        {
-            dict_node = get_dict_variable(dict_node->varname);
-            if (!dict_node)
-            {
-                printf("Runtime error: Undefined dict variable\n");
-                exit(1);
-            }
-        }
-        if (dict_node->type != NODE_DICT)
-        {
-            error_throw_at_line(ERROR_TYPE_MISMATCH, "get() expects a dictionary", node->line);
-        }
-
-        ASTNode *key = node->dict_get.key;
-        for (int i = 0; i < dict_node->dict.count; i++)
-        {
-            if (dict_node->dict.keys[i]->type == NODE_STRING && key->type == NODE_STRING)
-            {
-                if (strcmp(dict_node->dict.keys[i]->string, key->string) == 0)
-                {
-                    if (dict_node->dict.values[i]->type == NODE_NUMBER)
-                        return dict_node->dict.values[i]->number;
-                    else if (dict_node->dict.values[i]->type == NODE_STRING)
-                        return 0;
-                    return 0;
-                }
-            }
-        }
-        error_throw_at_line(ERROR_RUNTIME, "Key not found in dictionary", node->line);
+        ASTNode *value = eval_dict_get(node);
+        if (value->type == NODE_NUMBER)
+            return value->number;
+        return 0;
     }
     case NODE_DICT_SET:
     {
@@ -2523,21 +2590,9 @@ static double eval_expression(ASTNode *node)
             error_throw_at_line(ERROR_TYPE_MISMATCH, "set() expects a dictionary", node->line);
         }
 
-        ASTNode *key = node->dict_set.key;
-        ASTNode *value = node->dict_set.value;
-
-        // Find existing key or add new one
-        for (int i = 0; i < dict_node->dict.count; i++)
-        {
-            if (dict_node->dict.keys[i]->type == NODE_STRING && key->type == NODE_STRING)
-            {
-                if (strcmp(dict_node->dict.keys[i]->string, key->string) == 0)
-                {
-                    dict_node->dict.values[i] = value;
-                    return 0;
-                }
-            }
-        }
+        // Keys and values are evaluated now so variables and expressions work as keys
+        ASTNode *key = eval_value_node(node->dict_set.key);
+        ASTNode *value = eval_value_node(node->dict_set.value);
         ast_dict_add_pair(dict_node, key, value);
         return 0;
     }
@@ -2889,217 +2944,142 @@ static double eval_expression(ASTNode *node)
         print_node(node);
         return 0;
     case NODE_SET_UNION:
+    case NODE_SET_INTERSECTION:
+    case NODE_SET_DIFFERENCE:
+    case NODE_SET_SYMMETRIC_DIFF:
+    case NODE_SET_COPY:
+    {
+        // Set-valued results are picked up by assignment and print; as a number they give the size
+        ASTNode *result = eval_set_result(node);
+        double size = result->set.count;
+        ast_free(result);
+        return size;
+    }
+    case NODE_SET_ADD:
     {
-        ASTNode *set1_node = node->set_binop.set1;
-        ASTNode *set2_node = node->set_binop.set2;
+        ASTNode *set_node = node->set_element_op.set;
+        ASTNode *element = node->set_element_op.element;
         
-        if (set1_node->type == NODE_VAR)
-        {
-            set1_node = get_set_variable(set1_node->varname);
-        }
-        if (set2_node->type == NODE_VAR)
+        if (set_node->type == NODE_VAR)
         {
-            set2_node = get_set_variable(set2_node->varname);
+            set_node = get_set_variable(set_node->varname);
         }
         
-        if (!set1_node || !set2_node || set1_node->type != NODE_SET || set2_node->type != NODE_SET)
+        if (!set_node || set_node->type != NODE_SET)
         {
-            printf("Runtime error: Union operation expects two sets\n");
+            printf("Runtime error: Set add operation expects a set\n");
             exit(1);
         }
         
-        ASTNode *result = ast_new_set();
-        
-        // Add all elements from set1
-        for (int i = 0; i < set1_node->set.count; i++)
-        {
-            ast_set_add_element(result, set1_node->set.elements[i]);
-        }
+        // A list argument adds every element in one call
+        ASTNode *list = NULL;
+        if (element->type == NODE_LIST)
+            list = element;
+        else if (element->type == NODE_VAR)
+            list = get_list_variable(element->varname);
         
-        // Add all elements from set2 (duplicates will be filtered by ast_set_add_element)
-        for (int i = 0; i < set2_node->set.count; i++)
+        if (list)
         {
-            ast_set_add_element(result, set2_node->set.elements[i]);
+            for (int i = 0; i < list->list.count; i++)
+            {
+                ASTNode *value = eval_value_node(ast_list_access(list, i));
+                if (!ast_set_add_element(set_node, value))
+                    ast_free(value);
+            }
+            return 0;
         }
         
-        print_node(result);
-        ast_free(result);
+        ASTNode *value = eval_value_node(element);
+        if (!ast_set_add_element(set_node, value))
+            ast_free(value);
         return 0;
     }
-    case NODE_SET_INTERSECTION:
+    case NODE_SET_REMOVE:
     {
-        ASTNode *set1_node = node->set_binop.set1;
-        ASTNode *set2_node = node->set_binop.set2;
+        ASTNode *set_node = node->set_element_op.set;
+        ASTNode *element = node->set_element_op.element;
         
-        if (set1_node->type == NODE_VAR)
-        {
-            set1_node = get_set_variable(set1_node->varname);
-        }
-        if (set2_node->type == NODE_VAR)
+        if (set_node->type == NODE_VAR)
         {
-            set2_node = get_set_variable(set2_node->varname);
+            set_node = get_set_variable(set_node->varname);
         }
         
-        if (!set1_node || !set2_node || set1_node->type != NODE_SET || set2_node->type != NODE_SET)
+        if (!set_node || set_node->type != NODE_SET)
         {
-            printf("Runtime error: Intersection operation expects two sets\n");
+            printf("Runtime error: Set remove operation expects a set\n");
             exit(1);
         }
         
-        ASTNode *result = ast_new_set();
-        
-        // Add elements that exist in both sets
-        for (int i = 0; i < set1_node->set.count; i++)
-        {
-            ASTNode *elem1 = set1_node->set.elements[i];
-            for (int j = 0; j < set2_node->set.count; j++)
-            {
-                ASTNode *elem2 = set2_node->set.elements[j];
-                if (elem1->type == elem2->type)
-                {
-                    if ((elem1->type == NODE_NUMBER && elem1->number == elem2->number) ||
-                        (elem1->type == NODE_STRING && strcmp(elem1->string, elem2->string) == 0))
-                    {
-                        ast_set_add_element(result, elem1);
-                        break;
-                    }
-                }
-            }
-        }
+        if (element->type == NODE_NUMBER || element->type == NODE_STRING)
+            return ast_set_remove_element(set_node, element);
         
-        print_node(result);
-        ast_free(result);
-        return 0;
+        ASTNode *value = eval_value_node(element);
+        int removed = ast_set_remove_element(set_node, value);
+        ast_free(value);
+        return removed;
     }
-    case NODE_SET_DIFFERENCE:
+    case NODE_SET_CONTAINS:
     {
-        ASTNode *set1_node = node->set_binop.set1;
-        ASTNode *set2_node = node->set_binop.set2;
+        ASTNode *set_node = node->set_element_op.set;
+        ASTNode *element = node->set_element_op.element;
         
-        if (set1_node->type == NODE_VAR)
-        {
-            set1_node = get_set_variable(set1_node->varname);
-        }
-        if (set2_node->type == NODE_VAR)
+        if (set_node->type == NODE_VAR)
         {
-            set2_node = get_set_variable(set2_node->varname);
+            set_node = get_set_variable(set_node->varname);
         }
         
-        if (!set1_node || !set2_node || set1_node->type != NODE_SET || set2_node->type != NODE_SET)
+        if (!set_node || set_node->type != NODE_SET)
         {
-            printf("Runtime error: Difference operation expects two sets\n");
+            printf("Runtime error: Set contains operation expects a set\n");
             exit(1);
         }
         
-        ASTNode *result = ast_new_set();
-        
-        // Add elements from set1 that are not in set2
-        for (int i = 0; i < set1_node->set.count; i++)
-        {
-            ASTNode *elem1 = set1_node->set.elements[i];
-            int found = 0;
-            for (int j = 0; j < set2_node->set.count; j++)
-            {
-                ASTNode *elem2 = set2_node->set.elements[j];
-                if (elem1->type == elem2->type)
-                {
-                    if ((elem1->type == NODE_NUMBER && elem1->number == elem2->number) ||
-                        (elem1->type == NODE_STRING && strcmp(elem1->string, elem2->string) == 0))
-                    {
-                        found = 1;
-                        break;
-                    }
-                }
-            }
-            if (!found)
-            {
-                ASTNode *elem_copy = (elem1->type == NODE_NUMBER) ? ast_new_number(elem1->number) : ast_new_string(elem1->string);
-                ast_set_add_element(result, elem_copy);
-            }
-        }
+        // Literals are probed directly without building a temporary node
+        if (element->type == NODE_NUMBER || element->type == NODE_STRING)
+            return ast_set_find(set_node, element) >= 0;
         
-        print_node(result);
-        ast_free(result);
-        return 0;
+        ASTNode *value = eval_value_node(element);
+        int found = ast_set_find(set_node, value) >= 0;
+        ast_free(value);
+        return found;
     }
-    case NODE_SET_SYMMETRIC_DIFF:
+    case NODE_SET_SIZE:
     {
-        ASTNode *set1_node = node->set_binop.set1;
-        ASTNode *set2_node = node->set_binop.set2;
+        ASTNode *set_node = node->set_op.set;
         
-        if (set1_node->type == NODE_VAR)
-        {
-            set1_node = get_set_variable(set1_node->varname);
-        }
-        if (set2_node->type == NODE_VAR)
+        if (set_node->type == NODE_VAR)
         {
-            set2_node = get_set_variable(set2_node->varname);
+            set_node = get_set_variable(set_node->varname);
         }
         
-        if (!set1_node || !set2_node || set1_node->type != NODE_SET || set2_node->type != NODE_SET)
+        if (!set_node || set_node->type != NODE_SET)
         {
-            printf("Runtime error: Symmetric difference operation expects two sets\n");
+            printf("Runtime error: Set size operation expects a set\n");
             exit(1);
         }
         
-        ASTNode *result = ast_new_set();
+        return set_node->set.count;
+    }
+    case NODE_SET_EMPTY:
+    {
+        ASTNode *set_node = node->set_op.set;
         
-        // Add elements from set1 that are not in set2
-        for (int i = 0; i < set1_node->set.count; i++)
+        if (set_node->type == NODE_VAR)
         {
-            ASTNode *elem1 = set1_node->set.elements[i];
-            int found = 0;
-            for (int j = 0; j < set2_node->set.count; j++)
-            {
-                ASTNode *elem2 = set2_node->set.elements[j];
-                if (elem1->type == elem2->type)
-                {
-                    if ((elem1->type == NODE_NUMBER && elem1->number == elem2->number) ||
-                        (elem1->type == NODE_STRING && strcmp(elem1->string, elem2->string) == 0))
-                    {
-                        found = 1;
-                        break;
-                    }
-                }
-            }
-            if (!found)
-            {
-                ast_set_add_element(result, elem1);
-            }
+            set_node = get_set_variable(set_node->varname);
         }
         
-        // Add elements from set2 that are not in set1
-        for (int i = 0; i < set2_node->set.count; i++)
+        if (!set_node || set_node->type != NODE_SET)
         {
-            ASTNode *elem2 = set2_node->set.elements[i];
-            int found = 0;
-            for (int j = 0; j < set1_node->set.count; j++)
-            {
-                ASTNode *elem1 = set1_node->set.elements[j];
-                if (elem1->type == elem2->type)
-                {
-                    if ((elem1->type == NODE_NUMBER && elem1->number == elem2->number) ||
-                        (elem1->type == NODE_STRING && strcmp(elem1->string, elem2->string) == 0))
-                    {
-                        found = 1;
-                        break;
-                    }
-                }
-            }
-            if (!found)
-            {
-                ast_set_add_element(result, elem2);
-            }
+            printf("Runtime error: Set empty operation expects a set\n");
+            exit(1);
         }
         
-        print_node(result);
-        ast_free(result);
-        return 0;
+        return set_node->set.count == 0 ? 1 : 0;
     }
-    case NODE_SET_ADD:
+    case NODE_SET_CLEAR:
     {
-        ASTNode *set_node = node->set_element_op.set;
-        ASTNode *element = node->set_element_op.element;
+        ASTNode *set_node = node->set_op.set;
         
         if (set_node->type == NODE_VAR)
         {
@@ -3108,366 +3088,207 @@ static double eval_expression(ASTNode *node)
         
         if (!set_node || set_node->type != NODE_SET)
         {
-            printf("Runtime error: Set add operation expects a set\n");
+            printf("Runtime error: Set clear operation expects a set\n");
             exit(1);
         }
         
-        ast_set_add_element(set_node, element);
+        ast_set_clear(set_node);
         return 0;
     }
-    case NODE_SET_REMOVE:
+    case NODE_PVEC:
+        return node->pvec.count;
+    case NODE_PMAP:
+        return node->pmap.count;
+    case NODE_PVEC_PUSH:
+    case NODE_PVEC_SET:
+    case NODE_PVEC_POP:
+    case NODE_PMAP_PUT:
+    case NODE_PMAP_REMOVE:
+    {
+        // The new version is picked up by assignment and print; as a number it gives the size
+        ASTNode *result = eval_persistent_result(node);
+        double count = result->type == NODE_PVEC ? result->pvec.count : result->pmap.count;
+        ast_free(result);
+        return count;
+    }
+    case NODE_PVEC_GET:
+    case NODE_PMAP_GET:
     {
-        ASTNode *set_node = node->set_element_op.set;
-        ASTNode *element = node->set_element_op.element;
-        
-        if (set_node->type == NODE_VAR)
-        {
-            set_node = get_set_variable(set_node->varname);
-        }
-        
-        if (!set_node || set_node->type != NODE_SET)
-        {
-            printf("Runtime error: Set remove operation expects a set\n");
-            exit(1);
-        }
-        
-        // Find and remove the element
-        for (int i = 0; i < set_node->set.count; i++)
-        {
-            ASTNode *elem = set_node->set.elements[i];
-            if (elem->type == element->type)
-            {
-                if ((elem->type == NODE_NUMBER && elem->number == element->number) ||
-                    (elem->type == NODE_STRING && strcmp(elem->string, element->string) == 0))
-                {
-                    // Shift elements to fill the gap
-                    for (int j = i; j < set_node->set.count - 1; j++)
-                    {
-                        set_node->set.elements[j] = set_node->set.elements[j + 1];
-                    }
-                    set_node->set.count--;
-                    return 1; // Element removed
-                }
-            }
-        }
-        return 0; // Element not found
+        ASTNode *value = eval_persistent_value(node);
+        double result = value->type == NODE_NUMBER ? value->number : 0;
+        ast_free(value);
+        return result;
     }
-    case NODE_SET_CONTAINS:
+    case NODE_PVEC_SIZE:
+        return resolve_persistent(node->persistent_op.collection, NODE_PVEC, "pvsize()")->pvec.count;
+    case NODE_PMAP_SIZE:
+        return resolve_persistent(node->persistent_op.collection, NODE_PMAP, "pmsize()")->pmap.count;
+    case NODE_HEAP:
+        return node->heap.count;
+    case NODE_HEAP_PUSH:
     {
-        ASTNode *set_node = node->set_element_op.set;
-        ASTNode *element = node->set_element_op.element;
-        
-        if (set_node->type == NODE_VAR)
+        ASTNode *heap = resolve_heap(node->heap_op.heap, "hpush()");
+        ASTNode *value = eval_value_node(node->heap_op.value);
+        double priority;
+        if (node->heap_op.priority)
         {
-            set_node = get_set_variable(set_node->varname);
+            priority = eval_expression(node->heap_op.priority);
         }
-        
-        if (!set_node || set_node->type != NODE_SET)
+        else if (!heap_priority(heap, value, &priority))
         {
-            printf("Runtime error: Set contains operation expects a set\n");
+            printf("Runtime error: hpush() needs a priority for a string value without a key function or comparator\n");
             exit(1);
         }
-        
-        // Check if element exists in set
-        for (int i = 0; i < set_node->set.count; i++)
-        {
-            ASTNode *elem = set_node->set.elements[i];
-            if (elem->type == element->type)
-            {
-                if ((elem->type == NODE_NUMBER && elem->number == element->number) ||
-                    (elem->type == NODE_STRING && strcmp(elem->string, element->string) == 0))
-                {
-                    return 1; // Element found
-                }
-            }
-        }
-        return 0; // Element not found
+        return (double)heap_push(heap, value, priority);
     }
-    case NODE_SET_SIZE:
+    case NODE_HEAP_POP:
+    case NODE_HEAP_PEEK:
     {
-        ASTNode *set_node = node->set_op.set;
-        
-        if (set_node->type == NODE_VAR)
-        {
-            set_node = get_set_variable(set_node->varname);
-        }
-        
-        if (!set_node || set_node->type != NODE_SET)
-        {
-            printf("Runtime error: Set size operation expects a set\n");
-            exit(1);
-        }
-        
-        return set_node->set.count;
+        ASTNode *value = eval_heap_value(node);
+        double result = value->type == NODE_NUMBER ? value->number : 0;
+        ast_free(value);
+        return result;
     }
-    case NODE_SET_EMPTY:
+    case NODE_HEAP_SIZE:
+        return resolve_heap(node->heap_op.heap, "hsize()")->heap.count;
+    case NODE_HEAP_UPDATE:
     {
-        ASTNode *set_node = node->set_op.set;
-        
-        if (set_node->type == NODE_VAR)
-        {
-            set_node = get_set_variable(set_node->varname);
-        }
-        
-        if (!set_node || set_node->type != NODE_SET)
+        ASTNode *heap = resolve_heap(node->heap_op.heap, "hupdate()");
+        HeapHandle handle = (HeapHandle)eval_expression(node->heap_op.value);
+        int updated;
+        if (heap->heap.compare_fn[0])
         {
-            printf("Runtime error: Set empty operation expects a set\n");
-            exit(1);
+            // A comparator heap is reordered by giving the handle a new value
+            updated = heap_update_value(heap, handle, eval_value_node(node->heap_op.priority));
         }
-        
-        return set_node->set.count == 0 ? 1 : 0;
-    }
-    case NODE_SET_CLEAR:
-    {
-        ASTNode *set_node = node->set_op.set;
-        
-        if (set_node->type == NODE_VAR)
+        else
         {
-            set_node = get_set_variable(set_node->varname);
+            updated = heap_update(heap, handle, eval_expression(node->heap_op.priority));
         }
-        
-        if (!set_node || set_node->type != NODE_SET)
+        if (!updated)
         {
-            printf("Runtime error: Set clear operation expects a set\n");
+            printf("Runtime error: hupdate() handle %lld is not in the heap\n", handle);
             exit(1);
         }
-        
-        // Clear elements array only
-        set_node->set.count = 0;
-        
-        return 0;
+        return 1;
     }
-    case NODE_SET_COPY:
+    case NODE_HEAP_KEY:
+    case NODE_HEAP_COMPARE:
     {
-        ASTNode *set_node = node->set_op.set;
-        
-        if (set_node->type == NODE_VAR)
-        {
-            set_node = get_set_variable(set_node->varname);
-        }
-        
-        if (!set_node || set_node->type != NODE_SET)
+        int key = node->type == NODE_HEAP_KEY;
+        ASTNode *heap = resolve_heap(node->heap_op.heap, key ? "hkey()" : "hcompare()");
+        ASTNode *function = eval_value_node(node->heap_op.value);
+        if (function->type != NODE_STRING || !find_function(function->string))
         {
-            printf("Runtime error: Set copy operation expects a set\n");
+            printf("Runtime error: %s expects the name of a defined function\n", key ? "hkey()" : "hcompare()");
             exit(1);
         }
-        
-        // Create a new set and copy all elements
-        ASTNode *new_set = ast_new_set();
-        for (int i = 0; i < set_node->set.count; i++)
-        {
-            // Create copies of the elements
-            ASTNode *elem_copy;
-            if (set_node->set.elements[i]->type == NODE_NUMBER)
-            {
-                elem_copy = ast_new_number(set_node->set.elements[i]->number);
-            }
-            else if (set_node->set.elements[i]->type == NODE_STRING)
-            {
-                elem_copy = ast_new_string(set_node->set.elements[i]->string);
-            }
-            else
-            {
-                // For other types, just reference the same node (shallow copy)
-                elem_copy = set_node->set.elements[i];
-            }
-            ast_set_add_element(new_set, elem_copy);
-        }
-        
-        print_node(new_set);
-        ast_free(new_set);
-        return 0;
+        // With a key function or comparator every value has an order, so this cannot fail
+        heap_set_order(heap, key ? function->string : "", key ? "" : function->string);
+        ast_free(function);
+        return heap->heap.count;
+    }
+    case NODE_HEAPIFY:
+    {
+        ASTNode *heap = build_heap(node);
+        double count = heap->heap.count;
+        ast_free(heap);
+        return count;
+    }
+    case NODE_PMAP_HAS:
+    {
+        ASTNode *key = eval_value_node(node->persistent_op.key);
+        ASTNode *value = pmap_get(resolve_persistent(node->persistent_op.collection, NODE_PMAP, "pmhas()"), key);
+        int found = value != NULL;
+        ast_free(key);
+        ast_free(value);
+        return found;
     }
     case NODE_LINKED_LIST_ADD:
+    case NODE_LINKED_LIST_PUSH_FRONT:
     {
-        ASTNode *list_node = node->linked_list_op.list;
-        ASTNode *value_node = node->linked_list_op.value;
-
-        if (list_node->type == NODE_VAR)
-        {
-            list_node = get_linked_list_variable(list_node->varname);
-            if (!list_node)
-            {
-                printf("Runtime error: Undefined linked list variable\n");
-                exit(1);
-            }
-        }
-
-        if (list_node->type != NODE_LINKED_LIST)
-        {
-            printf("Runtime error: ladd() expects a linked list\n");
-            exit(1);
-        }
-
-        ast_linked_list_add_element(list_node, value_node);
+        ASTNode *list_node = resolve_linked_list(node->linked_list_op.list,
+                                                 node->type == NODE_LINKED_LIST_ADD ? "ladd()" : "lpush_front()");
+        ASTNode *value = eval_value_node(node->linked_list_op.value);
+        if (node->type == NODE_LINKED_LIST_ADD)
+            ast_linked_list_push_back(list_node, value);
+        else
+            ast_linked_list_push_front(list_node, value);
         return 0;
     }
     case NODE_LINKED_LIST_REMOVE:
     {
-        ASTNode *list_node = node->linked_list_op.list;
-        ASTNode *value_node = node->linked_list_op.value;
-
-        if (list_node->type == NODE_VAR)
-        {
-            list_node = get_linked_list_variable(list_node->varname);
-            if (!list_node)
-            {
-                printf("Runtime error: Undefined linked list variable\n");
-                exit(1);
-            }
-        }
-
-        if (list_node->type != NODE_LINKED_LIST)
-        {
-            printf("Runtime error: lremove() expects a linked list\n");
+        ASTNode *list_node = resolve_linked_list(node->linked_list_op.list, "lremove()");
+        ASTNode *value = eval_value_node(node->linked_list_op.value);
+        LinkedNode *item = list_node->linked_list.head;
+        while (item && !ast_value_equals(item->value, value))
+            item = item->next;
+        int is_string = value->type == NODE_STRING;
+        ast_free(value);
+        if (!item)
+        {
+            printf(is_string ? "Runtime error: String value not found in linked list\n"
+                             : "Runtime error: Value not found in linked list\n");
             exit(1);
         }
-
-        // Handle string values specially
-        if (value_node->type == NODE_STRING)
-        {
-            const char *str_value = value_node->string;
-            int found = 0;
-
-            for (int i = 0; i < list_node->linked_list.count; i++)
-            {
-                if (list_node->linked_list.elements[i]->type == NODE_STRING &&
-                    strcmp(list_node->linked_list.elements[i]->string, str_value) == 0)
-                {
-                    found = 1;
-                    // Shift elements to fill the gap
-                    for (int j = i; j < list_node->linked_list.count - 1; j++)
-                    {
-                        list_node->linked_list.elements[j] = list_node->linked_list.elements[j + 1];
-                    }
-                    list_node->linked_list.count--;
-                    break;
-                }
-            }
-
-            if (!found)
-            {
-                printf("Runtime error: String value not found in linked list\n");
-                exit(1);
-            }
-        }
-        else
-        {
-            double value = eval_expression(value_node);
-            int found = 0;
-
-            for (int i = 0; i < list_node->linked_list.count; i++)
-            {
-                double element = eval_expression(list_node->linked_list.elements[i]);
-                if (element == value)
-                {
-                    found = 1;
-                    // Shift elements to fill the gap
-                    for (int j = i; j < list_node->linked_list.count - 1; j++)
-                    {
-                        list_node->linked_list.elements[j] = list_node->linked_list.elements[j + 1];
-                    }
-                    list_node->linked_list.count--;
-                    break;
-                }
-            }
-
-            if (!found)
-            {
-                printf("Runtime error: Value not found in linked list\n");
-                exit(1);
-            }
-        }
-
+        ast_linked_list_erase(list_node, item);
         return 0; // Return 0 for consistency
     }
     case NODE_LINKED_LIST_GET:
+    case NODE_LINKED_LIST_CURRENT:
+    case NODE_LINKED_LIST_POP_FRONT:
+    case NODE_LINKED_LIST_POP_BACK:
+    {
+        // Numbers come back as themselves; strings are picked up by assignment and print
+        ASTNode *value = eval_linked_value(node);
+        double result = value->type == NODE_NUMBER ? value->number : 0;
+        ast_free(value);
+        return result;
+    }
+    case NODE_LINKED_LIST_CURSOR:
     {
-        ASTNode *list_node = node->linked_list_get.list;
-        ASTNode *index_node = node->linked_list_get.index;
-
-        if (list_node->type == NODE_VAR)
-        {
-            list_node = get_linked_list_variable(list_node->varname);
-            if (!list_node)
-            {
-                printf("Runtime error: Undefined linked list variable\n");
-                exit(1);
-            }
-        }
-
-        if (list_node->type != NODE_LINKED_LIST)
-        {
-            printf("Runtime error: lget() expects a linked list\n");
-            exit(1);
-        }
-
-        int index = (int)eval_expression(index_node);
-        if (index < 0 || index >= list_node->linked_list.count)
-        {
-            printf("Runtime error: Linked list index out of bounds\n");
-            exit(1);
-        }
-
-        ASTNode *element = list_node->linked_list.elements[index];
-        if (element->type == NODE_NUMBER)
-        {
-            return element->number;
-        }
-        else if (element->type == NODE_STRING)
-        {
-            // For string elements, return a special value and let print_node handle it
-            return -999;
-        }
-        else
-        {
-            return eval_expression(element);
-        }
+        ASTNode *list_node = resolve_linked_list(node->linked_list_op.list, "lcursor()");
+        int index = (int)eval_expression(node->linked_list_op.value);
+        list_node->linked_list.cursor = ast_linked_list_at(list_node, index);
+        return list_node->linked_list.cursor != NULL;
     }
-    case NODE_LINKED_LIST_SIZE:
+    case NODE_LINKED_LIST_NEXT:
     {
-        ASTNode *list_node = node->linked_list_op.list;
-
-        if (list_node->type == NODE_VAR)
-        {
-            list_node = get_linked_list_variable(list_node->varname);
-            if (!list_node)
-            {
-                printf("Runtime error: Undefined linked list variable\n");
-                exit(1);
-            }
-        }
-
-        if (list_node->type != NODE_LINKED_LIST)
-        {
-            printf("Runtime error: lsize() expects a linked list\n");
-            exit(1);
-        }
-
-        return list_node->linked_list.count;
+        ASTNode *list_node = resolve_linked_list(node->linked_list_op.list, "lnext()");
+        if (list_node->linked_list.cursor)
+            list_node->linked_list.cursor = list_node->linked_list.cursor->next;
+        return list_node->linked_list.cursor != NULL;
     }
-    case NODE_LINKED_LIST_ISEMPTY:
+    case NODE_LINKED_LIST_INSERT:
     {
-        ASTNode *list_node = node->linked_list_op.list;
-
-        if (list_node->type == NODE_VAR)
-        {
-            list_node = get_linked_list_variable(list_node->varname);
-            if (!list_node)
-            {
-                printf("Runtime error: Undefined linked list variable\n");
-                exit(1);
-            }
-        }
-
-        if (list_node->type != NODE_LINKED_LIST)
+        // Inserts before the cursor (at the end once the cursor has run off), cursor stays put
+        ASTNode *list_node = resolve_linked_list(node->linked_list_op.list, "linsert()");
+        ast_linked_list_insert_before(list_node, list_node->linked_list.cursor,
+                                      eval_value_node(node->linked_list_op.value));
+        return 0;
+    }
+    case NODE_LINKED_LIST_ERASE:
+    {
+        ASTNode *list_node = resolve_linked_list(node->linked_list_op.list, "lerase()");
+        if (!list_node->linked_list.cursor)
         {
-            printf("Runtime error: lisEmpty() expects a linked list\n");
+            printf("Runtime error: lerase() needs the cursor on an element\n");
             exit(1);
         }
-
-        return list_node->linked_list.count == 0 ? 1 : 0;
+        ast_linked_list_erase(list_node, list_node->linked_list.cursor); // Cursor moves to the next element
+        return list_node->linked_list.cursor != NULL;
+    }
+    case NODE_LINKED_LIST_SPLICE:
+    {
+        ASTNode *list_node = resolve_linked_list(node->linked_list_op.list, "lsplice()");
+        ASTNode *source = resolve_linked_list(node->linked_list_op.value, "lsplice()");
+        ast_linked_list_splice(list_node, source);
+        return list_node->linked_list.count;
     }
+    case NODE_LINKED_LIST_SIZE:
+        return resolve_linked_list(node->linked_list_op.list, "lsize()")->linked_list.count;
+    case NODE_LINKED_LIST_ISEMPTY:
+        return resolve_linked_list(node->linked_list_op.list, "lisEmpty()")->linked_list.count == 0 ? 1 : 0;
     case NODE_FILE_OPEN:
     {
         char *filename = get_string_value(node->file_open_stmt.filename);
@@ -3711,53 +3532,16 @@ static double eval_expression(ASTNode *node)
             exit(1);
         }
         
+        // Out-of-range sizes cover the whole history
         int window_size = (int)eval_expression(node->temporal_aggregate.window_size);
-        if (window_size <= 0 || window_size > temp_var->count)
-            window_size = temp_var->count;
         
-        const char *operation = node->temporal_aggregate.operation;
-        double result = 0.0;
-        
-        if (strcmp(operation, "sum") == 0)
+        if (node->temporal_aggregate.stat < 0)
         {
-            for (int i = temp_var->count - window_size; i < temp_var->count; i++)
-            {
-                result += strtod(temp_var->history[i].value, NULL);
-            }
-        }
-        else if (strcmp(operation, "avg") == 0)
-        {
-            for (int i = temp_var->count - window_size; i < temp_var->count; i++)
-            {
-                result += strtod(temp_var->history[i].value, NULL);
-            }
-            result /= window_size;
-        }
-        else if (strcmp(operation, "min") == 0)
-        {
-            result = strtod(temp_var->history[temp_var->count - window_size].value, NULL);
-            for (int i = temp_var->count - window_size + 1; i < temp_var->count; i++)
-            {
-                double val = strtod(temp_var->history[i].value, NULL);
-                if (val < result) result = val;
-            }
-        }
-        else if (strcmp(operation, "max") == 0)
-        {
-            result = strtod(temp_var->history[temp_var->count - window_size].value, NULL);
-            for (int i = temp_var->count - window_size + 1; i < temp_var->count; i++)
-            {
-                double val = strtod(temp_var->history[i].value, NULL);
-                if (val > result) result = val;
-            }
-        }
-        else
-        {
-            printf("Runtime error: Unknown aggregation operation '%s'\n", operation);
-            exit(1);
+            printf("Runtime error: Unknown aggregation operation '%s'\n", node->temporal_aggregate.operation);
+            exit(1);
         }
         
-        return result;
+        return temporal_window_stat(temp_var, window_size, node->temporal_aggregate.stat);
     }
     case NODE_TEMPORAL_PATTERN:
     {
@@ -3774,81 +3558,14 @@ static double eval_expression(ASTNode *node)
         }
         
         double threshold = eval_expression(node->temporal_pattern.threshold);
-        const char *pattern_type = node->temporal_pattern.pattern_type;
-        
-        if (strcmp(pattern_type, "trend") == 0)
-        {
-            // Detect upward or downward trend
-            int increasing = 0, decreasing = 0;
-            for (int i = 1; i < temp_var->count; i++)
-            {
-                double prev = strtod(temp_var->history[i-1].value, NULL);
-                double curr = strtod(temp_var->history[i].value, NULL);
-                double change = (curr - prev) / (prev == 0 ? 1 : prev) * 100; // percentage change
-                
-                if (change > threshold) increasing++;
-                else if (change < -threshold) decreasing++;
-            }
-            
-            if (increasing > decreasing) return 1; // upward trend
-            else if (decreasing > increasing) return -1; // downward trend
-            else return 0; // no clear trend
-        }
-        else if (strcmp(pattern_type, "cycle") == 0)
-        {
-            // Simple cycle detection - look for alternating increases/decreases
-            if (temp_var->count < 4) return 0;
-            
-            int pattern_matches = 0;
-            for (int i = 2; i < temp_var->count - 1; i++)
-            {
-                double val1 = strtod(temp_var->history[i-2].value, NULL);
-                double val2 = strtod(temp_var->history[i-1].value, NULL);
-                double val3 = strtod(temp_var->history[i].value, NULL);
-                double val4 = strtod(temp_var->history[i+1].value, NULL);
-                
-                // Check for peak or valley pattern
-                if ((val2 > val1 && val2 > val3) || (val2 < val1 && val2 < val3))
-                {
-                    pattern_matches++;
-                }
-            }
-            
-            return pattern_matches >= 2 ? 1 : 0; // cycle detected if multiple peaks/valleys
-        }
-        else if (strcmp(pattern_type, "anomaly") == 0)
-        {
-            // Detect values that deviate significantly from the mean
-            double sum = 0, mean, variance = 0, std_dev;
-            
-            // Calculate mean
-            for (int i = 0; i < temp_var->count; i++)
-            {
-                sum += strtod(temp_var->history[i].value, NULL);
-            }
-            mean = sum / temp_var->count;
-            
-            // Calculate standard deviation
-            for (int i = 0; i < temp_var->count; i++)
-            {
-                double val = strtod(temp_var->history[i].value, NULL);
-                variance += (val - mean) * (val - mean);
-            }
-            std_dev = sqrt(variance / temp_var->count);
-            
-            // Check if current value is an anomaly
-            double current = strtod(temp_var->history[temp_var->count - 1].value, NULL);
-            double z_score = (current - mean) / (std_dev == 0 ? 1 : std_dev);
-            
-            return fabs(z_score) > threshold ? 1 : 0; // anomaly if z-score exceeds threshold
-        }
-        else
+        if (!node->temporal_pattern.has_spec)
         {
-            printf("Runtime error: Unknown pattern type '%s'\n", pattern_type);
+            printf("Runtime error: Unknown pattern type '%s'\n", node->temporal_pattern.pattern_type);
             exit(1);
         }
         
-        return 0;
+        // Detectors attached to the variable keep this up to date on every write
+        return temporal_pattern(temp_var, &node->temporal_pattern.spec, threshold);
     }
     case NODE_TEMPORAL_CONDITION:
     {
@@ -3861,7 +3578,7 @@ static double eval_expression(ASTNode *node)
         
         int start_index = (int)eval_expression(node->temporal_condition.start_index);
         int window_size = (int)eval_expression(node->temporal_condition.window_size);
-        const char *condition = node->temporal_condition.condition;
+        const TemporalCondition *condition = &node->temporal_condition.predicate;
         
         // Validate indices
         if (start_index < 0 || start_index >= temp_var->count)
@@ -3869,172 +3586,72 @@ static double eval_expression(ASTNode *node)
         if (window_size <= 0 || start_index + window_size > temp_var->count)
             window_size = temp_var->count - start_index; // Adjust window size
         
-        // Parse condition string
-        if (strncmp(condition, "> ", 2) == 0)
-        {
-            double threshold = strtod(condition + 2, NULL);
-            for (int i = start_index; i < start_index + window_size; i++)
-            {
-                double val = strtod(temp_var->history[temp_var->count - 1 - i].value, NULL);
-                if (val <= threshold) return 0;
-            }
-            return 1;
-        }
-        else if (strncmp(condition, "< ", 2) == 0)
-        {
-            double threshold = strtod(condition + 2, NULL);
-            for (int i = start_index; i < start_index + window_size; i++)
-            {
-                double val = strtod(temp_var->history[temp_var->count - 1 - i].value, NULL);
-                if (val >= threshold) return 0;
-            }
-            return 1;
-        }
-        else if (strncmp(condition, "== ", 3) == 0)
-        {
-            double target = strtod(condition + 3, NULL);
-            for (int i = start_index; i < start_index + window_size; i++)
-            {
-                double val = strtod(temp_var->history[temp_var->count - 1 - i].value, NULL);
-                if (val == target) return 1; // Any match returns true
-            }
-            return 0;
-        }
-        else if (strncmp(condition, "between ", 8) == 0)
-        {
-            char *rest = (char *)(condition + 8);
-            double min_val = strtod(rest, &rest);
-            while (*rest == ' ') rest++; // Skip spaces
-            double max_val = strtod(rest, NULL);
-            
-            for (int i = start_index; i < start_index + window_size; i++)
-            {
-                double val = strtod(temp_var->history[temp_var->count - 1 - i].value, NULL);
-                if (val < min_val || val > max_val) return 0;
-            }
-            return 1;
-        }
-        else if (strcmp(condition, "increasing") == 0)
-        {
+        // Samples start_index .. start_index + window_size - 1 steps back are [first, last)
+        int last = temp_var->count - start_index;
+        int first = last - window_size;
+        switch (condition->op)
+        {
+        case TEMPORAL_COND_GT:
+        case TEMPORAL_COND_LT:
+        case TEMPORAL_COND_BETWEEN:
+            // Every value in the window must satisfy the condition
+            return temporal_count_matches(temp_var, first, last, condition) == window_size;
+        case TEMPORAL_COND_EQ:
+            return temporal_count_matches(temp_var, first, last, condition) > 0; // Any match returns true
+        case TEMPORAL_COND_INCREASING:
             if (window_size < 2) return 0;
-            for (int i = start_index; i < start_index + window_size - 1; i++)
+            for (int i = first + 1; i < last; i++)
             {
-                double curr = strtod(temp_var->history[temp_var->count - 1 - i].value, NULL);
-                double next = strtod(temp_var->history[temp_var->count - 1 - (i + 1)].value, NULL);
-                if (curr <= next) return 0; // Not strictly increasing
+                if (temporal_value(temp_var, i) <= temporal_value(temp_var, i - 1)) return 0; // Not strictly increasing
             }
             return 1;
-        }
-        else if (strncmp(condition, "stable ", 7) == 0)
-        {
-            double variance_threshold = strtod(condition + 7, NULL);
+        case TEMPORAL_COND_STABLE:
             if (window_size < 2) return 1;
-            
-            // Calculate variance
-            double sum = 0, mean, variance = 0;
-            for (int i = start_index; i < start_index + window_size; i++)
-            {
-                sum += strtod(temp_var->history[temp_var->count - 1 - i].value, NULL);
-            }
-            mean = sum / window_size;
-            
-            for (int i = start_index; i < start_index + window_size; i++)
-            {
-                double val = strtod(temp_var->history[temp_var->count - 1 - i].value, NULL);
-                variance += (val - mean) * (val - mean);
-            }
-            variance /= window_size;
-            
-            return variance < variance_threshold ? 1 : 0;
-        }
-        else
-        {
-            printf("Runtime error: Unknown temporal condition '%s'\n", condition);
+            return temporal_range_stat(temp_var, first, last, TEMPORAL_VARIANCE) < condition->a ? 1 : 0;
+        default:
+            printf("Runtime error: Unknown temporal condition '%s'\n", node->temporal_condition.condition);
             exit(1);
         }
-        
-        return 0;
     }
 
     case NODE_REGEX_MATCH:
     {
-        ASTNode *regex_node = node->regex_match.regex;
-        ASTNode *text_node = node->regex_match.text;
-
-        if (regex_node->type == NODE_VAR)
-        {
-            regex_node = get_regex_variable(regex_node->varname);
-        }
-
-        if (!regex_node || regex_node->type != NODE_REGEX)
-        {
-            printf("Runtime error: Invalid regex in match operation\n");
-            exit(1);
-        }
-
-        char *text_str = get_string_value(text_node);
+        ASTNode *regex_node = regex_operand(node->regex_match.regex, "match");
+        char *text_str = get_string_value(node->regex_match.text);
         if (!text_str)
         {
             printf("Runtime error: Invalid text in regex match\n");
             exit(1);
         }
 
-        int result = regex_match_pattern(regex_node->regex.pattern, text_str, regex_node->regex.flags);
+        int result = regex_test(regex_program(regex_node), text_str, strlen(text_str));
         free(text_str);
         return result;
     }
-    case NODE_REGEX_FIND_ALL:
+    case NODE_REGEX_GROUP:
     {
-        ASTNode *regex_node = node->regex_find_all.regex;
-        ASTNode *text_node = node->regex_find_all.text;
-
-        if (regex_node->type == NODE_VAR)
+        RegexProgram *program = regex_program(regex_operand(node->regex_group.regex, "group"));
+        char *name = get_string_value(node->regex_group.name);
+        if (!name)
         {
-            regex_node = get_regex_variable(regex_node->varname);
-        }
-
-        if (!regex_node || regex_node->type != NODE_REGEX)
-        {
-            printf("Runtime error: Invalid regex in find_all operation\n");
+            printf("Runtime error: Invalid group name in regex group\n");
             exit(1);
         }
 
-        char *text_str = get_string_value(text_node);
-        if (!text_str)
+        int index = regex_group_index(program, name);
+        if (index < 0)
         {
-            printf("Runtime error: Invalid text in regex find_all\n");
+            printf("Runtime error: Regex has no group named '%s'\n", name);
             exit(1);
         }
-
-        ASTNode *result_list = ast_new_list();
-        regex_find_all_matches(regex_node->regex.pattern, text_str, regex_node->regex.flags, result_list);
-
-        char *list_str = list_to_string(result_list);
-        printf("%s\n", list_str);
-        free(list_str);
-        free(text_str);
-        ast_free(result_list);
-        return 0;
+        free(name);
+        return index;
     }
     case NODE_REGEX_REPLACE:
     {
-        ASTNode *regex_node = node->regex_replace.regex;
-        ASTNode *text_node = node->regex_replace.text;
-        ASTNode *replacement_node = node->regex_replace.replacement;
-
-        if (regex_node->type == NODE_VAR)
-        {
-            regex_node = get_regex_variable(regex_node->varname);
-        }
-
-        if (!regex_node || regex_node->type != NODE_REGEX)
-        {
-            printf("Runtime error: Invalid regex in replace operation\n");
-            exit(1);
-        }
-
-        char *text_str = get_string_value(text_node);
-        char *replacement_str = get_string_value(replacement_node);
+        ASTNode *regex_node = regex_operand(node->regex_replace.regex, "replace");
+        char *text_str = get_string_value(node->regex_replace.text);
+        char *replacement_str = get_string_value(node->regex_replace.replacement);
 
         if (!text_str || !replacement_str)
         {
@@ -4042,7 +3659,8 @@ static double eval_expression(ASTNode *node)
             exit(1);
         }
 
-        char *result = regex_replace_pattern(regex_node->regex.pattern, text_str, replacement_str, regex_node->regex.flags);
+        char *result = regex_replace_pattern(regex_program(regex_node), text_str, replacement_str,
+                                             strchr(regex_node->regex.flags, 'g') != NULL);
         printf("%s\n", result);
         free(result);
         free(text_str);
@@ -4058,95 +3676,16 @@ static double eval_expression(ASTNode *node)
             exit(1);
         }
         
+        // Out-of-range sizes cover the whole history
         int window_size = (int)eval_expression(node->sliding_window_stats.window_size);
-        if (window_size <= 0 || window_size > temp_var->count)
-            window_size = temp_var->count;
-        
-        const char *stat_type = node->sliding_window_stats.stat_type;
         
-        if (strcmp(stat_type, "variance") == 0)
-        {
-            double sum = 0, mean, variance = 0;
-            for (int i = temp_var->count - window_size; i < temp_var->count; i++)
-            {
-                sum += strtod(temp_var->history[i].value, NULL);
-            }
-            mean = sum / window_size;
-            
-            for (int i = temp_var->count - window_size; i < temp_var->count; i++)
-            {
-                double val = strtod(temp_var->history[i].value, NULL);
-                variance += (val - mean) * (val - mean);
-            }
-            return variance / window_size;
-        }
-        else if (strcmp(stat_type, "stddev") == 0)
-        {
-            double sum = 0, mean, variance = 0;
-            for (int i = temp_var->count - window_size; i < temp_var->count; i++)
-            {
-                sum += strtod(temp_var->history[i].value, NULL);
-            }
-            mean = sum / window_size;
-            
-            for (int i = temp_var->count - window_size; i < temp_var->count; i++)
-            {
-                double val = strtod(temp_var->history[i].value, NULL);
-                variance += (val - mean) * (val - mean);
-            }
-            return sqrt(variance / window_size);
-        }
-        else if (strcmp(stat_type, "range") == 0)
+        if (node->sliding_window_stats.stat < 0)
         {
-            double min_val = strtod(temp_var->history[temp_var->count - window_size].value, NULL);
-            double max_val = min_val;
-            
-            for (int i = temp_var->count - window_size + 1; i < temp_var->count; i++)
-            {
-                double val = strtod(temp_var->history[i].value, NULL);
-                if (val < min_val) min_val = val;
-                if (val > max_val) max_val = val;
-            }
-            return max_val - min_val;
-        }
-        else if (strcmp(stat_type, "median") == 0)
-        {
-            double values[window_size];
-            for (int i = 0; i < window_size; i++)
-            {
-                values[i] = strtod(temp_var->history[temp_var->count - window_size + i].value, NULL);
-            }
-            
-            // Simple bubble sort
-            for (int i = 0; i < window_size - 1; i++)
-            {
-                for (int j = 0; j < window_size - i - 1; j++)
-                {
-                    if (values[j] > values[j + 1])
-                    {
-                        double temp = values[j];
-                        values[j] = values[j + 1];
-                        values[j + 1] = temp;
-                    }
-                }
-            }
-            
-            if (window_size % 2 == 0)
-            {
-                return (values[window_size / 2 - 1] + values[window_size / 2]) / 2.0;
-            }
-            else
-            {
-                return values[window_size / 2];
-            }
-        }
-        else
-        {
-            printf("Runtime error: Unknown statistic type '%s'\n", stat_type);
+            printf("Runtime error: Unknown statistic type '%s'\n", node->sliding_window_stats.stat_type);
             exit(1);
         }
         
-        return 0;
+        return temporal_window_stat(temp_var, window_size, node->sliding_window_stats.stat);
     }
     case NODE_SENSITIVITY_THRESHOLD:
     {
@@ -4166,7 +3705,7 @@ static double eval_expression(ASTNode *node)
         double sensitivity_percent = eval_expression(node->sensitivity_threshold.sensitivity_percent);
         
         // Get current value
-        double current_value = strtod(temp_var->history[temp_var->count - 1].value, NULL);
+        double current_value = temporal_value(temp_var, temp_var->count - 1);
         
         // Calculate upper and lower bounds
         double upper_bound = threshold_value + (threshold_value * sensitivity_percent / 100.0);
@@ -4194,67 +3733,16 @@ static double eval_expression(ASTNode *node)
             exit(1);
         }
         
-        const char *time_window = node->temporal_query.time_window;
-        const char *condition = node->temporal_query.condition;
-        
-        // Simple time window parsing
-        if (strncmp(time_window, "last ", 5) == 0)
-        {
-            int count = atoi(time_window + 5);
-            if (count <= 0 || count > temp_var->count) count = temp_var->count;
-            
-            // Check condition on last N values
-            int matches = 0;
-            for (int i = temp_var->count - count; i < temp_var->count; i++)
-            {
-                double val = strtod(temp_var->history[i].value, NULL);
-                
-                if (strncmp(condition, "> ", 2) == 0)
-                {
-                    double threshold = strtod(condition + 2, NULL);
-                    if (val > threshold) matches++;
-                }
-                else if (strncmp(condition, "< ", 2) == 0)
-                {
-                    double threshold = strtod(condition + 2, NULL);
-                    if (val < threshold) matches++;
-                }
-                else if (strncmp(condition, "== ", 3) == 0)
-                {
-                    double target = strtod(condition + 3, NULL);
-                    if (val == target) matches++;
-                }
-            }
-            return matches;
-        }
-        else if (strncmp(time_window, "between ", 8) == 0)
+        if (!node->temporal_query.has_span)
         {
-            // Simple between parsing - check all history
-            int matches = 0;
-            for (int i = 0; i < temp_var->count; i++)
-            {
-                double val = strtod(temp_var->history[i].value, NULL);
-                
-                if (strncmp(condition, "> ", 2) == 0)
-                {
-                    double threshold = strtod(condition + 2, NULL);
-                    if (val > threshold) matches++;
-                }
-                else if (strncmp(condition, "< ", 2) == 0)
-                {
-                    double threshold = strtod(condition + 2, NULL);
-                    if (val < threshold) matches++;
-                }
-                else if (strncmp(condition, "== ", 3) == 0)
-                {
-                    double target = strtod(condition + 3, NULL);
-                    if (val == target) matches++;
-                }
-            }
-            return matches;
+            printf("Runtime error: Unknown time window '%s'\n", node->temporal_query.time_window);
+            exit(1);
         }
         
-        return 0;
+        // Samples are in time order, so the window is one contiguous run
+        long long start, end;
+        temporal_span_range(temp_var, &node->temporal_query.span, &start, &end);
+        return temporal_full_count_matches(temp_var, start, end, &node->temporal_query.predicate);
     }
     case NODE_TEMPORAL_CORRELATE:
     {
@@ -4275,28 +3763,10 @@ static double eval_expression(ASTNode *node)
         
         if (window_size < 2) return 0; // Need at least 2 points for correlation
         
-        // Calculate Pearson correlation coefficient
-        double sum_x = 0, sum_y = 0, sum_xy = 0, sum_x2 = 0, sum_y2 = 0;
-        
-        for (int i = 0; i < window_size; i++)
-        {
-            double x = strtod(var1->history[var1->count - window_size + i].value, NULL);
-            double y = strtod(var2->history[var2->count - window_size + i].value, NULL);
-            
-            sum_x += x;
-            sum_y += y;
-            sum_xy += x * y;
-            sum_x2 += x * x;
-            sum_y2 += y * y;
-        }
-        
-        double n = window_size;
-        double numerator = n * sum_xy - sum_x * sum_y;
-        double denominator = sqrt((n * sum_x2 - sum_x * sum_x) * (n * sum_y2 - sum_y * sum_y));
-        
-        if (denominator == 0) return 0; // No correlation if denominator is 0
-        
-        return numerator / denominator;
+        // Pearson correlation coefficient; 0 if either side is constant
+        double r = 0;
+        temporal_cross_correlation(var1, var2, window_size, 0, &r);
+        return r;
     }
     case NODE_TEMPORAL_INTERPOLATE:
     {
@@ -4315,24 +3785,74 @@ static double eval_expression(ASTNode *node)
             exit(1);
         }
         
-        // Simple linear interpolation
-        if (missing_index == 0)
+        // A missing sample gets a straight line between the samples either side
+        double value = temporal_interpolate(temp_var, missing_index);
+        return temporal_missing(value) ? 0 : value;
+    }
+    case NODE_TEMPORAL_PERSIST:
+    {
+        TemporalVariable *temp_var = get_temporal_var_struct(node->temporal_persist.varname);
+        if (!temp_var)
         {
-            // Use next value if first is missing
-            if (temp_var->count > 1)
-                return strtod(temp_var->history[1].value, NULL);
-            return strtod(temp_var->history[0].value, NULL);
+            printf("Runtime error: Variable '%s' is not a temporal variable\n", node->temporal_persist.varname);
+            exit(1);
         }
-        else if (missing_index == temp_var->count - 1)
+        
+        // Restores the history from an existing log, and logs every write from here on
+        long long restored = temporal_persist(temp_var, node->temporal_persist.path);
+        if (restored < 0)
         {
-            // Use previous value if last is missing
-            return strtod(temp_var->history[missing_index - 1].value, NULL);
+            printf("Runtime error: Cannot open temporal log '%s': %s\n", node->temporal_persist.path, strerror(errno));
+            exit(1);
         }
-        else
+        return restored;
+    }
+    case NODE_TEMPORAL_TRIGGER:
+    {
+        TemporalVariable *temp_var = get_temporal_var_struct(node->temporal_trigger.varname);
+        if (!temp_var)
+        {
+            printf("Runtime error: Variable '%s' is not a temporal variable\n", node->temporal_trigger.varname);
+            exit(1);
+        }
+        if (!node->temporal_trigger.has_spec)
+        {
+            printf("Runtime error: Unknown trigger condition '%s'\n", node->temporal_trigger.condition);
+            exit(1);
+        }
+        Function *fn = find_function(node->temporal_trigger.callback);
+        if (!fn || fn->param_count != 3)
+        {
+            printf("Runtime error: temporal_trigger expects the name of a function taking (name, state, value)\n");
+            exit(1);
+        }
+        
+        // Checked on every write from here on; returns the state the history is in now
+        set_trigger_callback_runner(run_trigger_callback);
+        TemporalTrigger *trigger = temporal_add_trigger(temp_var, &node->temporal_trigger.spec,
+                                                        node->temporal_trigger.callback);
+        if (!trigger)
+        {
+            printf("Runtime error: Variable '%s' already has %d triggers\n", node->temporal_trigger.varname,
+                   TEMPORAL_MAX_TRIGGERS);
+            exit(1);
+        }
+        return trigger->state;
+    }
+    case NODE_TEMPORAL_UNTRIGGER:
+    {
+        TemporalVariable *temp_var = get_temporal_var_struct(node->temporal_trigger.varname);
+        if (!temp_var)
+        {
+            printf("Runtime error: Variable '%s' is not a temporal variable\n", node->temporal_trigger.varname);
+            exit(1);
+        }
+        if (!node->temporal_trigger.has_spec)
         {
-            // Return the actual value at the index (not interpolating missing data)
-            return strtod(temp_var->history[missing_index].value, NULL);
+            printf("Runtime error: Unknown trigger condition '%s'\n", node->temporal_trigger.condition);
+            exit(1);
         }
+        return temporal_remove_trigger(temp_var, &node->temporal_trigger.spec, node->temporal_trigger.callback);
     }
     case NODE_LAMBDA:
     {
@@ -4422,6 +3942,18 @@ static double eval_expression(ASTNode *node)
             {
                 type_name = "graph";
             }
+            else if (get_persistent_variable(value->varname))
+            {
+                type_name = get_persistent_variable(value->varname)->type == NODE_PVEC ? "pvec" : "pmap";
+            }
+            else if (get_ndarray_variable(value->varname))
+            {
+                type_name = "ndarray";
+            }
+            else if (get_heap_variable(value->varname))
+            {
+                type_name = "heap";
+            }
             else if (get_temporal_var_struct(value->varname))
             {
                 type_name = "temporal";
@@ -4493,6 +4025,22 @@ static double eval_expression(ASTNode *node)
         {
             type_name = "graph";
         }
+        else if (value->type == NODE_PVEC)
+        {
+            type_name = "pvec";
+        }
+        else if (value->type == NODE_PMAP)
+        {
+            type_name = "pmap";
+        }
+        else if (value->type == NODE_NDARRAY)
+        {
+            type_name = "ndarray";
+        }
+        else if (value->type == NODE_HEAP)
+        {
+            type_name = "heap";
+        }
         else if (value->type == NODE_UNDEF)
         {
             type_name = "undef";
@@ -4563,11 +4111,11 @@ static double eval_expression(ASTNode *node)
         
         char result[1024] = "";
         for (int i = 0; i < list_node->list.count; i++) {
-            if (list_node->list.elements[i]->type == NODE_STRING) {
-                strcat(result, list_node->list.elements[i]->string);
-            } else if (list_node->list.elements[i]->type == NODE_NUMBER) {
+            if (ast_list_access(list_node, i)->type == NODE_STRING) {
+                strcat(result, ast_list_access(list_node, i)->string);
+            } else if (ast_list_access(list_node, i)->type == NODE_NUMBER) {
                 char num_str[64];
-                snprintf(num_str, sizeof(num_str), "%g", list_node->list.elements[i]->number);
+                snprintf(num_str, sizeof(num_str), "%g", ast_list_access(list_node, i)->number);
                 strcat(result, num_str);
             }
             if (i < list_node->list.count - 1) {
@@ -4733,53 +4281,54 @@ static double eval_expression(ASTNode *node)
     case NODE_INCREMENT:
     {
         const char *val = get_variable(node->inc_dec.varname);
-        double current = val ? strtod(val, NULL) : 0.0;
+        double current = scalar_number(node->inc_dec.varname, val);
         if (node->inc_dec.is_prefix)
         {
             current += 1.0;
-            char buf[64];
-            snprintf(buf, sizeof(buf), "%g", current);
-            set_variable(node->inc_dec.varname, buf);
+            set_number_variable(node->inc_dec.varname, current);
             return current;
         }
         else
         {
-            char buf[64];
-            snprintf(buf, sizeof(buf), "%g", current + 1.0);
-            set_variable(node->inc_dec.varname, buf);
+            set_number_variable(node->inc_dec.varname, current + 1.0);
             return current;
         }
     }
     case NODE_DECREMENT:
     {
         const char *val = get_variable(node->inc_dec.varname);
-        double current = val ? strtod(val, NULL) : 0.0;
+        double current = scalar_number(node->inc_dec.varname, val);
         if (node->inc_dec.is_prefix)
         {
             current -= 1.0;
-            char buf[64];
-            snprintf(buf, sizeof(buf), "%g", current);
-            set_variable(node->inc_dec.varname, buf);
+            set_number_variable(node->inc_dec.varname, current);
             return current;
         }
         else
         {
-            char buf[64];
-            snprintf(buf, sizeof(buf), "%g", current - 1.0);
-            set_variable(node->inc_dec.varname, buf);
+            set_number_variable(node->inc_dec.varname, current - 1.0);
             return current;
         }
     }
     case NODE_FUNC_CALL:
     {
         // Try package functions first
-        ASTNode *package_result = call_package_function(node->func_call.name, node->func_call.args, node->func_call.arg_count);
+        ASTNode *package_result = call_package(node);
         if (package_result) {
+            double value;
             if (package_result->type == NODE_NUMBER) {
-                return package_result->number;
+                value = package_result->number;
+            } else if (package_result->type == NODE_LIST) {
+                value = package_result->list.count;
+            } else if (package_result->type == NODE_DICT) {
+                value = package_result->dict.count;
+            } else if (package_result->type == NODE_NDARRAY) {
+                value = ndarray_size(package_result);
             } else {
-                return eval_expression(package_result);
+                value = eval_expression(package_result);
             }
+            ast_free(package_result);
+            return value;
         }
         
         Function *fn = find_function(node->func_call.name);
@@ -4811,9 +4360,7 @@ static double eval_expression(ASTNode *node)
             else
             {
                 double val = eval_expression(arg);
-                char buf[64];
-                snprintf(buf, sizeof(buf), "%g", val);
-                set_variable(fn->params[i], buf);
+                set_number_variable(fn->params[i], val);
             }
         }
 
@@ -4839,7 +4386,10 @@ static double eval_expression(ASTNode *node)
                     if (val)
                     {
                         // Store the return value for string results
-                        set_variable("__function_return_str", val);
+                        if (is_number_variable(last_stmt->varname))
+                            set_number_variable("__function_return_str", scalar_number(last_stmt->varname, val));
+                        else
+                            set_variable("__function_return_str", val);
                         char *endptr;
                         double dval = strtod(val, &endptr);
                         if (endptr == val)
@@ -4866,7 +4416,10 @@ static double eval_expression(ASTNode *node)
                 const char *val = get_variable(fn->body->varname);
                 if (val)
                 {
-                    set_variable("__function_return_str", val);
+                    if (is_number_variable(fn->body->varname))
+                        set_number_variable("__function_return_str", scalar_number(fn->body->varname, val));
+                    else
+                        set_variable("__function_return_str", val);
                     char *endptr;
                     double dval = strtod(val, &endptr);
                     if (endptr == val)
@@ -4887,457 +4440,116 @@ static double eval_expression(ASTNode *node)
         return 0;
     case NODE_TREE_INSERT:
     {
-        ASTNode *tree_node = node->tree_insert.tree;
-        if (tree_node->type == NODE_VAR)
+        ASTNode *tree_node = resolve_tree(node->tree_insert.tree, "tinsert()", node->line);
+        return ast_tree_insert(tree_node, eval_tree_key(node->tree_insert.value, "tinsert()", node->line));
+    }
+    case NODE_TREE_SEARCH:
+    {
+        ASTNode *tree_node = resolve_tree(node->tree_search.tree, "tsearch()", node->line);
+        return ast_tree_contains(tree_node, eval_tree_key(node->tree_search.value, "tsearch()", node->line));
+    }
+    case NODE_TREE_DELETE:
+    {
+        ASTNode *tree_node = resolve_tree(node->tree_delete.tree, "tdelete()", node->line);
+        return ast_tree_remove(tree_node, eval_tree_key(node->tree_delete.value, "tdelete()", node->line));
+    }
+    case NODE_TREE_FLOOR:
+    case NODE_TREE_CEIL:
+    {
+        const char *op_name = node->type == NODE_TREE_FLOOR ? "tfloor()" : "tceil()";
+        ASTNode *tree_node = resolve_tree(node->tree_search.tree, op_name, node->line);
+        double value = eval_tree_key(node->tree_search.value, op_name, node->line);
+        double result;
+        int found = node->type == NODE_TREE_FLOOR ? ast_tree_floor(tree_node, value, &result)
+                                                  : ast_tree_ceiling(tree_node, value, &result);
+        if (!found)
         {
-            tree_node = get_tree_variable(tree_node->varname);
+            error_throw_at_line(ERROR_RUNTIME, node->type == NODE_TREE_FLOOR ? "No tree value at or below the given value"
+                                                                             : "No tree value at or above the given value",
+                                node->line);
         }
-        if (tree_node && tree_node->type == NODE_TREE)
+        return result;
+    }
+    case NODE_TREE_INORDER:
+    case NODE_TREE_PREORDER:
+    case NODE_TREE_POSTORDER:
+    case NODE_TREE_RANGE:
+    {
+        // The list itself is picked up by assignment and print; as a number it gives the length
+        ASTNode *list = eval_list_result(node);
+        double count = list->list.count;
+        ast_free(list);
+        return count;
+    }
+    case NODE_GRAPH:
+        print_node(node);
+        return 0;
+    case NODE_GRAPH_ADD_VERTEX:
+    {
+        ASTNode *graph_node = resolve_graph(node->graph_vertex_op.graph);
+        if (graph_node)
         {
-            ast_tree_add_element(tree_node, node->tree_insert.value);
+            ast_graph_add_vertex(graph_node, eval_value_node(node->graph_vertex_op.vertex));
         }
         return 0;
     }
-    case NODE_TREE_SEARCH:
+    case NODE_GRAPH_ADD_EDGE:
     {
-        ASTNode *tree_node = node->tree_search.tree;
-        if (tree_node->type == NODE_VAR)
+        ASTNode *graph_node = resolve_graph(node->graph_edge_op.graph);
+        if (graph_node)
         {
-            tree_node = get_tree_variable(tree_node->varname);
-        }
-        if (tree_node && tree_node->type == NODE_TREE)
-        {
-            double search_val = eval_expression(node->tree_search.value);
-            for (int i = 0; i < tree_node->tree.count; i++)
-            {
-                if (tree_node->tree.elements[i]->type == NODE_NUMBER &&
-                    tree_node->tree.elements[i]->number == search_val)
-                {
-                    return 1; // Found
-                }
-            }
-        }
-        return 0; // Not found
-    }
-    case NODE_TREE_DELETE:
-    {
-        ASTNode *tree_node = node->tree_delete.tree;
-        if (tree_node->type == NODE_VAR)
-        {
-            tree_node = get_tree_variable(tree_node->varname);
-        }
-        if (tree_node && tree_node->type == NODE_TREE)
-        {
-            double delete_val = eval_expression(node->tree_delete.value);
-            for (int i = 0; i < tree_node->tree.count; i++)
-            {
-                if (tree_node->tree.elements[i]->type == NODE_NUMBER &&
-                    tree_node->tree.elements[i]->number == delete_val)
-                {
-                    for (int j = i; j < tree_node->tree.count - 1; j++)
-                    {
-                        tree_node->tree.elements[j] = tree_node->tree.elements[j + 1];
-                    }
-                    tree_node->tree.count--;
-                    return 1; // Deleted
-                }
-            }
-        }
-        return 0; // Not found
-    }
-    case NODE_TREE_INORDER:
-    {
-        ASTNode *tree_node = node->tree_traversal.tree;
-        if (tree_node->type == NODE_VAR)
-        {
-            tree_node = get_tree_variable(tree_node->varname);
-        }
-        if (tree_node && tree_node->type == NODE_TREE)
-        {
-            // Sort elements for inorder traversal (BST property)
-            double values[tree_node->tree.count];
-            int count = 0;
-            for (int i = 0; i < tree_node->tree.count; i++)
-            {
-                if (tree_node->tree.elements[i]->type == NODE_NUMBER)
-                {
-                    values[count++] = tree_node->tree.elements[i]->number;
-                }
-            }
-            // Simple bubble sort
-            for (int i = 0; i < count - 1; i++)
-            {
-                for (int j = 0; j < count - i - 1; j++)
-                {
-                    if (values[j] > values[j + 1])
-                    {
-                        double temp = values[j];
-                        values[j] = values[j + 1];
-                        values[j + 1] = temp;
-                    }
-                }
-            }
-            printf("[");
-            for (int i = 0; i < count; i++)
-            {
-                printf("%g", values[i]);
-                if (i < count - 1)
-                    printf(", ");
-            }
-            printf("]\n");
-        }
-        return 0;
-    }
-    case NODE_TREE_PREORDER:
-    {
-        ASTNode *tree_node = node->tree_traversal.tree;
-        if (tree_node->type == NODE_VAR)
-        {
-            tree_node = get_tree_variable(tree_node->varname);
-        }
-        if (tree_node && tree_node->type == NODE_TREE)
-        {
-            // Preorder: root, left subtree, right subtree
-            // For simplicity, assume first element is root, then left subtree, then right subtree
-            printf("[");
-            if (tree_node->tree.count > 0)
-            {
-                // Print root first (element at index 0 - the first inserted)
-                if (tree_node->tree.elements[0]->type == NODE_NUMBER)
-                    printf("%g", tree_node->tree.elements[0]->number);
-                
-                // Print remaining elements
-                for (int i = 1; i < tree_node->tree.count; i++)
-                {
-                    printf(", ");
-                    if (tree_node->tree.elements[i]->type == NODE_NUMBER)
-                        printf("%g", tree_node->tree.elements[i]->number);
-                }
-            }
-            printf("]\n");
-        }
-        return 0;
-    }
-    case NODE_TREE_POSTORDER:
-    {
-        ASTNode *tree_node = node->tree_traversal.tree;
-        if (tree_node->type == NODE_VAR)
-        {
-            tree_node = get_tree_variable(tree_node->varname);
-        }
-        if (tree_node && tree_node->type == NODE_TREE)
-        {
-            // Postorder: left subtree, right subtree, root
-            // Print all elements except root, then root last
-            printf("[");
-            if (tree_node->tree.count > 1)
-            {
-                // Print all elements except the first (root)
-                for (int i = 1; i < tree_node->tree.count; i++)
-                {
-                    if (tree_node->tree.elements[i]->type == NODE_NUMBER)
-                        printf("%g", tree_node->tree.elements[i]->number);
-                    if (i < tree_node->tree.count - 1)
-                        printf(", ");
-                }
-                if (tree_node->tree.count > 1) printf(", ");
-            }
-            // Print root last
-            if (tree_node->tree.count > 0 && tree_node->tree.elements[0]->type == NODE_NUMBER)
-                printf("%g", tree_node->tree.elements[0]->number);
-            printf("]\n");
-        }
-        return 0;
-    }
-    case NODE_GRAPH:
-        print_node(node);
-        return 0;
-    case NODE_GRAPH_ADD_VERTEX:
-    {
-        ASTNode *graph_node = node->graph_vertex_op.graph;
-        if (graph_node->type == NODE_VAR)
-        {
-            graph_node = get_graph_variable(graph_node->varname);
-        }
-        if (graph_node && graph_node->type == NODE_GRAPH)
-        {
-            ast_graph_add_vertex(graph_node, node->graph_vertex_op.vertex);
-        }
-        return 0;
-    }
-    case NODE_GRAPH_ADD_EDGE:
-    {
-        ASTNode *graph_node = node->graph_edge_op.graph;
-        if (graph_node->type == NODE_VAR)
-        {
-            graph_node = get_graph_variable(graph_node->varname);
-        }
-        if (graph_node && graph_node->type == NODE_GRAPH)
-        {
-            ast_graph_add_edge(graph_node, node->graph_edge_op.from, node->graph_edge_op.to);
+            // Endpoints that are not vertices yet are added automatically
+            int from = ast_graph_add_vertex(graph_node, eval_value_node(node->graph_edge_op.from));
+            int to = ast_graph_add_vertex(graph_node, eval_value_node(node->graph_edge_op.to));
+            double weight = node->graph_edge_op.weight ? eval_expression(node->graph_edge_op.weight) : 1.0;
+            ast_graph_add_edge(graph_node, from, to, weight);
         }
         return 0;
     }
     case NODE_GRAPH_REMOVE_VERTEX:
     {
-        ASTNode *graph_node = node->graph_vertex_op.graph;
-        if (graph_node->type == NODE_VAR)
+        ASTNode *graph_node = resolve_graph(node->graph_vertex_op.graph);
+        if (graph_node)
         {
-            graph_node = get_graph_variable(graph_node->varname);
-        }
-        if (graph_node && graph_node->type == NODE_GRAPH)
-        {
-            double vertex_val = eval_expression(node->graph_vertex_op.vertex);
-            for (int i = 0; i < graph_node->graph.vertex_count; i++)
-            {
-                if (graph_node->graph.vertices[i]->type == NODE_NUMBER &&
-                    graph_node->graph.vertices[i]->number == vertex_val)
-                {
-                    for (int j = i; j < graph_node->graph.vertex_count - 1; j++)
-                    {
-                        graph_node->graph.vertices[j] = graph_node->graph.vertices[j + 1];
-                    }
-                    graph_node->graph.vertex_count--;
-                    return 1;
-                }
-            }
+            return ast_graph_remove_vertex(graph_node, graph_vertex_id(graph_node, node->graph_vertex_op.vertex));
         }
         return 0;
     }
     case NODE_GRAPH_HAS_EDGE:
+    case NODE_GRAPH_REMOVE_EDGE:
     {
-        ASTNode *graph_node = node->graph_edge_op.graph;
-        if (graph_node->type == NODE_VAR)
+        ASTNode *graph_node = resolve_graph(node->graph_edge_op.graph);
+        if (graph_node)
         {
-            graph_node = get_graph_variable(graph_node->varname);
-        }
-        if (graph_node && graph_node->type == NODE_GRAPH)
-        {
-            double from_val = eval_expression(node->graph_edge_op.from);
-            double to_val = eval_expression(node->graph_edge_op.to);
-            for (int i = 0; i < graph_node->graph.edge_count; i++)
-            {
-                ASTNode *edge = graph_node->graph.edges[i];
-                if (edge->type == NODE_LIST && edge->list.count >= 2)
-                {
-                    double edge_from = eval_expression(edge->list.elements[0]);
-                    double edge_to = eval_expression(edge->list.elements[1]);
-                    if (edge_from == from_val && edge_to == to_val)
-                    {
-                        return 1;
-                    }
-                }
-            }
+            int from = graph_vertex_id(graph_node, node->graph_edge_op.from);
+            int to = graph_vertex_id(graph_node, node->graph_edge_op.to);
+            if (from < 0 || to < 0)
+                return 0;
+            if (node->type == NODE_GRAPH_HAS_EDGE)
+                return ast_graph_has_edge(graph_node, from, to);
+            return ast_graph_remove_edge(graph_node, from, to);
         }
         return 0;
     }
     case NODE_GRAPH_NEIGHBORS:
-    {
-        ASTNode *graph_node = node->graph_neighbors.graph;
-        if (graph_node->type == NODE_VAR)
-        {
-            graph_node = get_graph_variable(graph_node->varname);
-        }
-        if (graph_node && graph_node->type == NODE_GRAPH)
-        {
-            double vertex_val = eval_expression(node->graph_neighbors.vertex);
-            printf("[");
-            int first = 1;
-            for (int i = 0; i < graph_node->graph.edge_count; i++)
-            {
-                ASTNode *edge = graph_node->graph.edges[i];
-                if (edge->type == NODE_LIST && edge->list.count >= 2)
-                {
-                    double edge_from = eval_expression(edge->list.elements[0]);
-                    double edge_to = eval_expression(edge->list.elements[1]);
-                    
-                    // Check both directions for undirected graph
-                    if (edge_from == vertex_val)
-                    {
-                        if (!first) printf(", ");
-                        printf("%g", edge_to);
-                        first = 0;
-                    }
-                    else if (edge_to == vertex_val)
-                    {
-                        if (!first) printf(", ");
-                        printf("%g", edge_from);
-                        first = 0;
-                    }
-                }
-            }
-            printf("]\n");
-        }
-        return 0;
-    }
     case NODE_GRAPH_DFS:
-    {
-        ASTNode *graph_node = node->graph_traversal.graph;
-        if (graph_node->type == NODE_VAR)
-        {
-            graph_node = get_graph_variable(graph_node->varname);
-        }
-        if (graph_node && graph_node->type == NODE_GRAPH)
-        {
-            double start_vertex = eval_expression(node->graph_traversal.start);
-            int visited[graph_node->graph.vertex_count];
-            double result[graph_node->graph.vertex_count];
-            int result_count = 0;
-            
-            // Initialize visited array
-            for (int i = 0; i < graph_node->graph.vertex_count; i++)
-                visited[i] = 0;
-            
-            // Simple DFS implementation using recursion simulation with stack
-            double stack[graph_node->graph.vertex_count];
-            int stack_top = 0;
-            stack[stack_top++] = start_vertex;
-            
-            while (stack_top > 0)
-            {
-                double current = stack[--stack_top];
-                
-                // Find vertex index
-                int vertex_idx = -1;
-                for (int i = 0; i < graph_node->graph.vertex_count; i++)
-                {
-                    if (graph_node->graph.vertices[i]->type == NODE_NUMBER &&
-                        graph_node->graph.vertices[i]->number == current)
-                    {
-                        vertex_idx = i;
-                        break;
-                    }
-                }
-                
-                if (vertex_idx != -1 && !visited[vertex_idx])
-                {
-                    visited[vertex_idx] = 1;
-                    result[result_count++] = current;
-                    
-                    // Add neighbors to stack (in reverse order for correct DFS order)
-                    for (int i = graph_node->graph.edge_count - 1; i >= 0; i--)
-                    {
-                        ASTNode *edge = graph_node->graph.edges[i];
-                        if (edge->type == NODE_LIST && edge->list.count >= 2)
-                        {
-                            double edge_from = eval_expression(edge->list.elements[0]);
-                            double edge_to = eval_expression(edge->list.elements[1]);
-                            
-                            if (edge_from == current)
-                            {
-                                // Check if neighbor is not visited
-                                int neighbor_idx = -1;
-                                for (int j = 0; j < graph_node->graph.vertex_count; j++)
-                                {
-                                    if (graph_node->graph.vertices[j]->type == NODE_NUMBER &&
-                                        graph_node->graph.vertices[j]->number == edge_to)
-                                    {
-                                        neighbor_idx = j;
-                                        break;
-                                    }
-                                }
-                                if (neighbor_idx != -1 && !visited[neighbor_idx])
-                                {
-                                    stack[stack_top++] = edge_to;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-            
-            printf("[");
-            for (int i = 0; i < result_count; i++)
-            {
-                printf("%g", result[i]);
-                if (i < result_count - 1)
-                    printf(", ");
-            }
-            printf("]\n");
-        }
-        return 0;
-    }
     case NODE_GRAPH_BFS:
+    case NODE_LIST_SLICE:
+    case NODE_TEMPORAL_DOWNSAMPLE:
+    case NODE_TEMPORAL_CORRELATE_MATRIX:
+    case NODE_TEMPORAL_XCORR:
+    case NODE_TEMPORAL_FILL:
+    case NODE_TEMPORAL_RESAMPLE:
+    case NODE_REGEX_FIND_ALL:
+    case NODE_REGEX_NEXT:
+    case NODE_PATTERN_MATCH:
+    case NODE_PATTERN_MATCH_ANY:
     {
-        ASTNode *graph_node = node->graph_traversal.graph;
-        if (graph_node->type == NODE_VAR)
-        {
-            graph_node = get_graph_variable(graph_node->varname);
-        }
-        if (graph_node && graph_node->type == NODE_GRAPH)
-        {
-            double start_vertex = eval_expression(node->graph_traversal.start);
-            int visited[graph_node->graph.vertex_count];
-            double result[graph_node->graph.vertex_count];
-            int result_count = 0;
-            
-            // Initialize visited array
-            for (int i = 0; i < graph_node->graph.vertex_count; i++)
-                visited[i] = 0;
-            
-            // BFS implementation using queue
-            double queue[graph_node->graph.vertex_count];
-            int queue_front = 0, queue_rear = 0;
-            queue[queue_rear++] = start_vertex;
-            
-            // Mark start vertex as visited
-            for (int i = 0; i < graph_node->graph.vertex_count; i++)
-            {
-                if (graph_node->graph.vertices[i]->type == NODE_NUMBER &&
-                    graph_node->graph.vertices[i]->number == start_vertex)
-                {
-                    visited[i] = 1;
-                    break;
-                }
-            }
-            
-            while (queue_front < queue_rear)
-            {
-                double current = queue[queue_front++];
-                result[result_count++] = current;
-                
-                // Add neighbors to queue
-                for (int i = 0; i < graph_node->graph.edge_count; i++)
-                {
-                    ASTNode *edge = graph_node->graph.edges[i];
-                    if (edge->type == NODE_LIST && edge->list.count >= 2)
-                    {
-                        double edge_from = eval_expression(edge->list.elements[0]);
-                        double edge_to = eval_expression(edge->list.elements[1]);
-                        
-                        if (edge_from == current)
-                        {
-                            // Check if neighbor is not visited
-                            int neighbor_idx = -1;
-                            for (int j = 0; j < graph_node->graph.vertex_count; j++)
-                            {
-                                if (graph_node->graph.vertices[j]->type == NODE_NUMBER &&
-                                    graph_node->graph.vertices[j]->number == edge_to)
-                                {
-                                    neighbor_idx = j;
-                                    break;
-                                }
-                            }
-                            if (neighbor_idx != -1 && !visited[neighbor_idx])
-                            {
-                                visited[neighbor_idx] = 1;
-                                queue[queue_rear++] = edge_to;
-                            }
-                        }
-                    }
-                }
-            }
-            
-            printf("[");
-            for (int i = 0; i < result_count; i++)
-            {
-                printf("%g", result[i]);
-                if (i < result_count - 1)
-                    printf(", ");
-            }
-            printf("]\n");
-        }
-        return 0;
+        // The list itself is picked up by assignment and print; as a number it gives the length
+        ASTNode *list = eval_list_result(node);
+        double count = list->list.count;
+        ast_free(list);
+        return count;
     }
     default:
         {
@@ -5400,1154 +4612,1901 @@ static char *get_string_value(ASTNode *node)
     }
 }
 
-// Function to convert a list to a string representation
-static char *list_to_string(ASTNode *list)
+// A scalar variable's value as a number: exact when it was stored as one, else
+// parsed from its text
+static double scalar_number(const char *name, const char *text)
 {
-    if (list->type != NODE_LIST)
+    double number;
+    if (get_number_variable(name, &number))
+        return number;
+    return text ? strtod(text, NULL) : 0.0;
+}
+
+// Evaluate an expression into a fresh number or string node that a collection can own
+static ASTNode *eval_value_node(ASTNode *node)
+{
+    if (node->type == NODE_STRING)
+        return ast_new_string(node->string);
+    if (node->type == NODE_NUMBER)
+        return ast_new_number(node->number);
+    if (node->type == NODE_VAR && !get_temporal_var_struct(node->varname))
     {
-        return strdup("Not a list");
+        const char *val = get_variable(node->varname);
+        if (val)
+        {
+            // Numbers are stored as text too, so the variable says which it holds
+            if (is_number_variable(node->varname))
+                return ast_new_number(scalar_number(node->varname, val));
+            return ast_new_string(val);
+        }
     }
+    return ast_new_number(eval_expression(node));
+}
 
-    char *result = strdup("[");
-    for (int i = 0; i < list->list.count; i++)
-    {
-        char buffer[256];
-        ASTNode *element = list->list.elements[i];
+// Stored collection node behind a variable, or NULL for scalars and unknown names
+static ASTNode *get_collection_variable(const char *name)
+{
+    ASTNode *value;
+    if ((value = get_list_variable(name)) || (value = get_dict_variable(name)) ||
+        (value = get_set_variable(name)) || (value = get_tree_variable(name)) ||
+        (value = get_graph_variable(name)) || (value = get_stack_variable(name)) ||
+        (value = get_queue_variable(name)) || (value = get_linked_list_variable(name)) ||
+        (value = get_persistent_variable(name)) || (value = get_ndarray_variable(name)) ||
+        (value = get_heap_variable(name)))
+        return value;
+    return NULL;
+}
 
-        if (element->type == NODE_NUMBER)
+// Call a package function with evaluated arguments. Collection variables are passed as
+// their stored node, expressions as fresh values and literals unchanged. Returns the
+// package's (owned) result, or NULL when no package function has this name.
+static ASTNode *call_package(ASTNode *call)
+{
+    // Checked before any argument is evaluated, so a user function's arguments
+    // are left for the call itself to evaluate once
+    if (!has_package_function(call->func_call.name))
+        return NULL;
+
+    int argc = call->func_call.arg_count;
+    ASTNode **args = malloc(sizeof(ASTNode *) * (argc > 0 ? argc : 1));
+    char *owned = calloc(argc > 0 ? argc : 1, 1);
+    for (int i = 0; i < argc; i++)
+    {
+        ASTNode *arg = call->func_call.args[i];
+        args[i] = arg;
+        if (arg->type == NODE_VAR)
         {
-            snprintf(buffer, sizeof(buffer), "%g", element->number);
+            args[i] = get_collection_variable(arg->varname);
+            if (!args[i])
+            {
+                args[i] = eval_value_node(arg);
+                owned[i] = 1;
+            }
         }
-        else if (element->type == NODE_STRING)
+        else if (is_list_result_node(arg))
         {
-            snprintf(buffer, sizeof(buffer), "%s", element->string);
+            args[i] = eval_list_result(arg);
+            owned[i] = 1;
         }
-        else
+        else if (is_set_result_node(arg))
         {
-            snprintf(buffer, sizeof(buffer), "Unknown");
+            args[i] = eval_set_result(arg);
+            owned[i] = 1;
         }
-
-        result = realloc(result, strlen(result) + strlen(buffer) + 3);
-        strcat(result, buffer);
-
-        if (i < list->list.count - 1)
+        else if (arg->type == NODE_FUNC_CALL && has_package_function(arg->func_call.name))
         {
-            strcat(result, ", ");
+            args[i] = call_package(arg);
+            // Nested package calls pass their result through, so arrays and lists chain
+            owned[i] = 1;
+        }
+        else if (arg->type == NODE_BINOP || arg->type == NODE_FUNC_CALL)
+        {
+            args[i] = eval_value_node(arg);
+            owned[i] = 1;
+        }
+        // Packages index elements directly and the sorts write to them, so a slice
+        // view, or a list whose storage views share, gets storage of its own first:
+        // a variable keeps the unshared list, a temporary is copied
+        if (args[i]->type == NODE_LIST && (args[i]->list.base || args[i]->list.refs > 0))
+        {
+            if (arg->type == NODE_VAR && !owned[i])
+            {
+                args[i] = unshare_list(arg->varname, args[i]);
+            }
+            else
+            {
+                ASTNode *copy = copy_list_values(args[i]);
+                if (owned[i])
+                    ast_free(args[i]);
+                args[i] = copy;
+                owned[i] = 1;
+            }
         }
     }
-
-    strcat(result, "]");
+    ASTNode *result = call_package_function(call->func_call.name, args, argc);
+    for (int i = 0; i < argc; i++)
+    {
+        if (owned[i])
+            ast_free(args[i]);
+    }
+    free(args);
+    free(owned);
     return result;
 }
 
-// Modify your print logic to handle lists
-static void print_node(ASTNode *node)
+// Look up a key expression in a dict, returning the stored value node or NULL
+static ASTNode *dict_lookup(ASTNode *dict_node, ASTNode *key_expr)
 {
-    switch (node->type)
-    {
-    case NODE_NUMBER:
-        printf("%g\n", node->number);
-        break;
-    case NODE_STRING:
-        printf("%s\n", node->string);
-        break;
-    case NODE_LIST:
+    if (!dict_node || dict_node->type != NODE_DICT)
+        return NULL;
+    if (key_expr->type == NODE_STRING || key_expr->type == NODE_NUMBER)
     {
-        char *list_str = list_to_string(node);
-        printf("%s\n", list_str);
-        free(list_str);
-        break;
+        int idx = ast_dict_find(dict_node, key_expr);
+        return idx >= 0 ? dict_node->dict.values[idx] : NULL;
     }
-    case NODE_DICT:
-    {
-        printf("{");
-        for (int i = 0; i < node->dict.count; i++)
+    ASTNode *key = eval_value_node(key_expr);
+    int idx = ast_dict_find(dict_node, key);
+    ast_free(key);
+    return idx >= 0 ? dict_node->dict.values[idx] : NULL;
+}
+
+// The stored value a get() expression finds; throws when the key is missing
+static ASTNode *eval_dict_get(ASTNode *node)
+{
+    ASTNode *dict_node = node->dict_get.dict;
+    if (dict_node->type == NODE_VAR)
+    {
+        dict_node = get_dict_variable(dict_node->varname);
+        if (!dict_node)
         {
-            if (node->dict.keys[i]->type == NODE_STRING)
-                printf("\"%s\"", node->dict.keys[i]->string);
-            else if (node->dict.keys[i]->type == NODE_NUMBER)
-                printf("%g", node->dict.keys[i]->number);
-            printf(" := ");
-            if (node->dict.values[i]->type == NODE_STRING)
-                printf("\"%s\"", node->dict.values[i]->string);
-            else if (node->dict.values[i]->type == NODE_NUMBER)
-                printf("%g", node->dict.values[i]->number);
-            if (i < node->dict.count - 1)
-                printf(", ");
+            printf("Runtime error: Undefined dict variable\n");
+            exit(1);
         }
-        printf("}\n");
-        break;
     }
-    case NODE_STACK:
+    if (dict_node->type != NODE_DICT)
     {
-        printf("<");
-        for (int i = 0; i < node->stack.count; i++)
+        error_throw_at_line(ERROR_TYPE_MISMATCH, "get() expects a dictionary", node->line);
+    }
+    ASTNode *value = dict_lookup(dict_node, node->dict_get.key);
+    if (!value)
+    {
+        error_throw_at_line(ERROR_RUNTIME, "Key not found in dictionary", node->line);
+    }
+    return value;
+}
+
+// Set operations that produce a new set rather than a number
+static int is_set_result_node(ASTNode *node)
+{
+    return node->type == NODE_SET_UNION || node->type == NODE_SET_INTERSECTION ||
+           node->type == NODE_SET_DIFFERENCE || node->type == NODE_SET_SYMMETRIC_DIFF ||
+           node->type == NODE_SET_COPY;
+}
+
+// Resolve a set operand (variable, literal or nested set operation).
+// Sets *owned when the caller must free the returned set.
+static ASTNode *resolve_set_operand(ASTNode *operand, int *owned)
+{
+    *owned = 0;
+    if (operand->type == NODE_VAR)
+        return get_set_variable(operand->varname);
+    if (operand->type == NODE_SET)
+        return operand;
+    if (is_set_result_node(operand))
+    {
+        *owned = 1;
+        return eval_set_result(operand);
+    }
+    return NULL;
+}
+
+// Copy every element of src that is (keep_common) or is not (!keep_common) in other
+static void set_add_filtered(ASTNode *result, ASTNode *src, ASTNode *other, int keep_common)
+{
+    ast_set_compact(src);
+    for (int i = 0; i < src->set.count; i++)
+    {
+        ASTNode *elem = src->set.elements[i];
+        if (other && (ast_set_find(other, elem) >= 0) != keep_common)
+            continue;
+        ASTNode *copy = eval_value_node(elem);
+        if (!ast_set_add_element(result, copy))
+            ast_free(copy);
+    }
+}
+
+// Build the new set produced by union, intersection, difference, symmetric difference or copy.
+// Every operation is a single pass over each input with O(1) hash probes.
+static ASTNode *eval_set_result(ASTNode *node)
+{
+    const char *op_name = "Union";
+    if (node->type == NODE_SET_INTERSECTION)
+        op_name = "Intersection";
+    else if (node->type == NODE_SET_DIFFERENCE)
+        op_name = "Difference";
+    else if (node->type == NODE_SET_SYMMETRIC_DIFF)
+        op_name = "Symmetric difference";
+
+    ASTNode *result = ast_new_set();
+
+    if (node->type == NODE_SET_COPY)
+    {
+        int owned;
+        ASTNode *set_node = resolve_set_operand(node->set_op.set, &owned);
+        if (!set_node)
         {
-            if (node->stack.elements[i]->type == NODE_STRING)
-                printf("%s", node->stack.elements[i]->string);
-            else if (node->stack.elements[i]->type == NODE_NUMBER)
-                printf("%g", node->stack.elements[i]->number);
-            if (i < node->stack.count - 1)
-                printf(", ");
+            printf("Runtime error: Set copy operation expects a set\n");
+            exit(1);
         }
-        printf(">\n");
+        set_add_filtered(result, set_node, NULL, 1);
+        if (owned)
+            ast_free(set_node);
+        return result;
+    }
+
+    int owned1, owned2;
+    ASTNode *set1_node = resolve_set_operand(node->set_binop.set1, &owned1);
+    ASTNode *set2_node = resolve_set_operand(node->set_binop.set2, &owned2);
+    if (!set1_node || !set2_node)
+    {
+        printf("Runtime error: %s operation expects two sets\n", op_name);
+        exit(1);
+    }
+
+    switch (node->type)
+    {
+    case NODE_SET_UNION:
+        set_add_filtered(result, set1_node, NULL, 1);
+        set_add_filtered(result, set2_node, NULL, 1);
+        break;
+    case NODE_SET_INTERSECTION:
+        set_add_filtered(result, set1_node, set2_node, 1);
+        break;
+    case NODE_SET_DIFFERENCE:
+        set_add_filtered(result, set1_node, set2_node, 0);
+        break;
+    default: // NODE_SET_SYMMETRIC_DIFF
+        set_add_filtered(result, set1_node, set2_node, 0);
+        set_add_filtered(result, set2_node, set1_node, 0);
         break;
     }
-    case NODE_QUEUE:
+
+    if (owned1)
+        ast_free(set1_node);
+    if (owned2)
+        ast_free(set2_node);
+    return result;
+}
+
+// Resolve a tree operand (variable or literal) to its NODE_TREE
+static ASTNode *resolve_tree(ASTNode *operand, const char *op_name, int line)
+{
+    ASTNode *tree = operand->type == NODE_VAR ? get_tree_variable(operand->varname) : operand;
+    if (!tree || tree->type != NODE_TREE)
     {
-        printf("<");
-        for (int i = 0; i < node->queue.count; i++)
+        char error_msg[64];
+        snprintf(error_msg, sizeof(error_msg), "%s expects a tree", op_name);
+        error_throw_at_line(ERROR_TYPE_MISMATCH, error_msg, line);
+    }
+    return tree;
+}
+
+// Trees hold numbers only, so a string value is a type error rather than a silent 0
+static double eval_tree_key(ASTNode *expr, const char *op_name, int line)
+{
+    ASTNode *value = eval_value_node(expr);
+    if (value->type != NODE_NUMBER)
+    {
+        char error_msg[64];
+        snprintf(error_msg, sizeof(error_msg), "%s expects a number", op_name);
+        ast_free(value);
+        error_throw_at_line(ERROR_TYPE_MISMATCH, error_msg, line);
+    }
+    double key = value->number;
+    ast_free(value);
+    return key;
+}
+
+// Tree and graph operations that produce a list of values
+static int is_list_result_node(ASTNode *node)
+{
+    return node->type == NODE_TREE_INORDER || node->type == NODE_TREE_PREORDER ||
+           node->type == NODE_TREE_POSTORDER || node->type == NODE_TREE_RANGE ||
+           node->type == NODE_GRAPH_NEIGHBORS || node->type == NODE_GRAPH_DFS ||
+           node->type == NODE_GRAPH_BFS || node->type == NODE_LIST_SLICE ||
+           node->type == NODE_TEMPORAL_DOWNSAMPLE || node->type == NODE_TEMPORAL_CORRELATE_MATRIX ||
+           node->type == NODE_TEMPORAL_XCORR || node->type == NODE_TEMPORAL_FILL ||
+           node->type == NODE_TEMPORAL_RESAMPLE || node->type == NODE_REGEX_FIND_ALL ||
+           node->type == NODE_REGEX_NEXT || node->type == NODE_PATTERN_MATCH ||
+           node->type == NODE_PATTERN_MATCH_ANY;
+}
+
+// Appends numeric results to a list node, growing its element array as needed.
+typedef struct
+{
+    ASTNode *list;
+    int capacity;
+} ListCollector;
+
+static void list_collect(double value, void *ctx)
+{
+    ListCollector *collector = ctx;
+    ASTNode *list = collector->list;
+    if (list->list.count == collector->capacity)
+    {
+        collector->capacity = collector->capacity ? collector->capacity * 2 : 16;
+        list->list.elements = realloc(list->list.elements, sizeof(ASTNode *) * collector->capacity);
+    }
+    list->list.elements[list->list.count++] = ast_new_number(value);
+}
+
+// Stream a traversal or range query straight out of the tree into a new list
+static ASTNode *eval_tree_list(ASTNode *node)
+{
+    ASTNode *list = ast_new_list();
+    ListCollector collector = {list, 0};
+    if (node->type == NODE_TREE_RANGE)
+    {
+        ASTNode *tree_node = resolve_tree(node->tree_range.tree, "trange()", node->line);
+        double lo = eval_tree_key(node->tree_range.lo, "trange()", node->line);
+        double hi = eval_tree_key(node->tree_range.hi, "trange()", node->line);
+        ast_tree_range(tree_node, lo, hi, list_collect, &collector);
+        return list;
+    }
+
+    const char *op_name = node->type == NODE_TREE_PREORDER    ? "tpreorder()"
+                          : node->type == NODE_TREE_POSTORDER ? "tpostorder()"
+                                                              : "tinorder()";
+    ASTNode *tree_node = resolve_tree(node->tree_traversal.tree, op_name, node->line);
+
+    // Traversals know their final size up front
+    collector.capacity = tree_node->tree.count;
+    if (collector.capacity > 0)
+        list->list.elements = malloc(sizeof(ASTNode *) * collector.capacity);
+    TreeOrder order = node->type == NODE_TREE_PREORDER    ? TREE_PREORDER
+                      : node->type == NODE_TREE_POSTORDER ? TREE_POSTORDER
+                                                          : TREE_INORDER;
+    ast_tree_walk(tree_node, order, list_collect, &collector);
+    return list;
+}
+
+// Resolve a linked list operand, exiting with a runtime error like the other collections
+static ASTNode *resolve_linked_list(ASTNode *operand, const char *op_name)
+{
+    ASTNode *list_node = operand;
+    if (operand->type == NODE_VAR)
+    {
+        list_node = get_linked_list_variable(operand->varname);
+        if (!list_node)
         {
-            if (node->queue.elements[i]->type == NODE_STRING)
-                printf("%s", node->queue.elements[i]->string);
-            else if (node->queue.elements[i]->type == NODE_NUMBER)
-                printf("%g", node->queue.elements[i]->number);
-            if (i < node->queue.count - 1)
-                printf(", ");
+            printf("Runtime error: Undefined linked list variable\n");
+            exit(1);
         }
-        printf(">\n");
-        break;
     }
-    case NODE_LINKED_LIST:
+    if (list_node->type != NODE_LINKED_LIST)
     {
-        printf("[");
-        for (int i = 0; i < node->linked_list.count; i++)
+        printf("Runtime error: %s expects a linked list\n", op_name);
+        exit(1);
+    }
+    return list_node;
+}
+
+// Linked list operations that yield an element
+static int is_linked_value_node(ASTNode *node)
+{
+    return node->type == NODE_LINKED_LIST_GET || node->type == NODE_LINKED_LIST_CURRENT ||
+           node->type == NODE_LINKED_LIST_POP_FRONT || node->type == NODE_LINKED_LIST_POP_BACK;
+}
+
+// Element for lget / lcurrent (copied) or lpop_front / lpop_back (removed); the caller frees it
+static ASTNode *eval_linked_value(ASTNode *node)
+{
+    if (node->type == NODE_LINKED_LIST_GET)
+    {
+        ASTNode *list_node = resolve_linked_list(node->linked_list_get.list, "lget()");
+        LinkedNode *item = ast_linked_list_at(list_node, (int)eval_expression(node->linked_list_get.index));
+        if (!item)
         {
-            if (node->linked_list.elements[i]->type == NODE_STRING)
-                printf("%s", node->linked_list.elements[i]->string);
-            else if (node->linked_list.elements[i]->type == NODE_NUMBER)
-                printf("%g", node->linked_list.elements[i]->number);
-            if (i < node->linked_list.count - 1)
-                printf(", ");
+            printf("Runtime error: Linked list index out of bounds\n");
+            exit(1);
         }
-        printf("]\n");
-        break;
+        return eval_value_node(item->value);
     }
-    case NODE_REGEX:
+    if (node->type == NODE_LINKED_LIST_CURRENT)
     {
-        printf("/%s/%s\n", node->regex.pattern, node->regex.flags);
-        break;
+        ASTNode *list_node = resolve_linked_list(node->linked_list_op.list, "lcurrent()");
+        if (!list_node->linked_list.cursor)
+        {
+            printf("Runtime error: lcurrent() needs the cursor on an element\n");
+            exit(1);
+        }
+        return eval_value_node(list_node->linked_list.cursor->value);
     }
-    case NODE_SET:
+    int front = node->type == NODE_LINKED_LIST_POP_FRONT;
+    ASTNode *list_node = resolve_linked_list(node->linked_list_op.list, front ? "lpop_front()" : "lpop_back()");
+    ASTNode *value = front ? ast_linked_list_pop_front(list_node) : ast_linked_list_pop_back(list_node);
+    if (!value)
     {
-        printf("{");
-        for (int i = 0; i < node->set.count; i++)
+        printf("Runtime error: Cannot pop from an empty linked list\n");
+        exit(1);
+    }
+    return value;
+}
+
+// Resolve a persistent vector or map operand, exiting with a runtime error otherwise
+static ASTNode *resolve_persistent(ASTNode *operand, NodeType expected, const char *op_name)
+{
+    ASTNode *collection = operand;
+    if (operand->type == NODE_VAR)
+        collection = get_persistent_variable(operand->varname);
+    if (!collection || collection->type != expected)
+    {
+        printf("Runtime error: %s expects a %s\n", op_name,
+               expected == NODE_PVEC ? "persistent vector" : "persistent map");
+        exit(1);
+    }
+    return collection;
+}
+
+// Persistent collection updates, which produce a new version
+static int is_persistent_result_node(ASTNode *node)
+{
+    return node->type == NODE_PVEC_PUSH || node->type == NODE_PVEC_SET || node->type == NODE_PVEC_POP ||
+           node->type == NODE_PMAP_PUT || node->type == NODE_PMAP_REMOVE;
+}
+
+// Build the new version for an update; the operand keeps its old contents
+static ASTNode *eval_persistent_result(ASTNode *node)
+{
+    // Nested updates such as ::pvpush(::pvpush(v, 1), 2) work on a temporary version
+    ASTNode *source = is_persistent_result_node(node->persistent_op.collection)
+                          ? eval_persistent_result(node->persistent_op.collection)
+                          : node->persistent_op.collection;
+    ASTNode *key = node->persistent_op.key ? eval_value_node(node->persistent_op.key) : NULL;
+    ASTNode *value = node->persistent_op.value ? eval_value_node(node->persistent_op.value) : NULL;
+    ASTNode *result = NULL;
+    switch (node->type)
+    {
+    case NODE_PVEC_PUSH:
+        result = pvec_push(resolve_persistent(source, NODE_PVEC, "pvpush()"), value);
+        break;
+    case NODE_PVEC_SET:
+        result = pvec_set(resolve_persistent(source, NODE_PVEC, "pvset()"), (int)key->number, value);
+        if (!result)
         {
-            if (node->set.elements[i]->type == NODE_STRING)
-                printf("%s", node->set.elements[i]->string);
-            else if (node->set.elements[i]->type == NODE_NUMBER)
-                printf("%g", node->set.elements[i]->number);
-            if (i < node->set.count - 1)
-                printf(", ");
+            printf("Runtime error: Persistent vector index out of bounds\n");
+            exit(1);
         }
-        printf("}\n");
+        break;
+    case NODE_PVEC_POP:
+        result = pvec_pop(resolve_persistent(source, NODE_PVEC, "pvpop()"));
+        break;
+    case NODE_PMAP_PUT:
+        result = pmap_put(resolve_persistent(source, NODE_PMAP, "pmput()"), key, value);
+        break;
+    default:
+        result = pmap_remove(resolve_persistent(source, NODE_PMAP, "pmremove()"), key);
         break;
     }
-    case NODE_TREE:
+    if (source != node->persistent_op.collection)
+        ast_free(source);
+    ast_free(key);
+    ast_free(value);
+    return result;
+}
+
+static int is_persistent_value_node(ASTNode *node)
+{
+    return node->type == NODE_PVEC_GET || node->type == NODE_PMAP_GET;
+}
+
+// Element for pvget / pmget as a new value node
+static ASTNode *eval_persistent_value(ASTNode *node)
+{
+    ASTNode *key = eval_value_node(node->persistent_op.key);
+    ASTNode *value;
+    if (node->type == NODE_PVEC_GET)
     {
-        printf("<tree: ");
-        for (int i = 0; i < node->tree.count; i++)
+        value = pvec_get(resolve_persistent(node->persistent_op.collection, NODE_PVEC, "pvget()"), (int)key->number);
+        if (!value)
         {
-            if (node->tree.elements[i]->type == NODE_STRING)
-                printf("%s", node->tree.elements[i]->string);
-            else if (node->tree.elements[i]->type == NODE_NUMBER)
-                printf("%g", node->tree.elements[i]->number);
-            if (i < node->tree.count - 1)
-                printf(", ");
+            printf("Runtime error: Persistent vector index out of bounds\n");
+            exit(1);
         }
-        printf(">\n");
-        break;
     }
-    case NODE_GRAPH:
+    else
     {
-        printf("<graph: vertices[");
-        for (int i = 0; i < node->graph.vertex_count; i++)
+        value = pmap_get(resolve_persistent(node->persistent_op.collection, NODE_PMAP, "pmget()"), key);
+        if (!value)
         {
-            if (node->graph.vertices[i]->type == NODE_STRING)
-                printf("%s", node->graph.vertices[i]->string);
-            else if (node->graph.vertices[i]->type == NODE_NUMBER)
-                printf("%g", node->graph.vertices[i]->number);
-            if (i < node->graph.vertex_count - 1)
-                printf(", ");
+            printf("Runtime error: Key not found in persistent map\n");
+            exit(1);
         }
-        printf("] edges[");
-        for (int i = 0; i < node->graph.edge_count; i++)
-        {
-            ASTNode *edge = node->graph.edges[i];
-            if (edge->type == NODE_LIST && edge->list.count >= 2)
-            {
-                printf("(");
-                if (edge->list.elements[0]->type == NODE_NUMBER)
-                    printf("%g", edge->list.elements[0]->number);
-                else if (edge->list.elements[0]->type == NODE_STRING)
-                    printf("%s", edge->list.elements[0]->string);
-                printf(",");
-                if (edge->list.elements[1]->type == NODE_NUMBER)
-                    printf("%g", edge->list.elements[1]->number);
-                else if (edge->list.elements[1]->type == NODE_STRING)
-                    printf("%s", edge->list.elements[1]->string);
-                printf(")");
+    }
+    ast_free(key);
+    return value;
+}
+
+// Resolve a heap operand, exiting with a runtime error otherwise
+static ASTNode *resolve_heap(ASTNode *operand, const char *op_name)
+{
+    ASTNode *heap = operand;
+    if (operand->type == NODE_VAR)
+        heap = get_heap_variable(operand->varname);
+    if (!heap || heap->type != NODE_HEAP)
+    {
+        printf("Runtime error: %s expects a heap\n", op_name);
+        exit(1);
+    }
+    return heap;
+}
+
+// New heap for ::heapify(list[, "key"]); the list is left as it was
+static ASTNode *build_heap(ASTNode *node)
+{
+    ASTNode *list = node->heap_op.heap;
+    if (list->type == NODE_VAR)
+        list = get_list_variable(list->varname);
+    if (!list || list->type != NODE_LIST)
+    {
+        printf("Runtime error: heapify() expects a list\n");
+        exit(1);
+    }
+    ASTNode *key = node->heap_op.value ? eval_value_node(node->heap_op.value) : NULL;
+    if (key && (key->type != NODE_STRING || !find_function(key->string)))
+    {
+        printf("Runtime error: heapify() expects the name of a defined function\n");
+        exit(1);
+    }
+    ASTNode *values = copy_list_values(list);
+    ASTNode *heap = heap_from_list(values, key ? key->string : NULL);
+    ast_free(values);
+    ast_free(key);
+    if (!heap)
+    {
+        printf("Runtime error: heapify() needs a key function for string values\n");
+        exit(1);
+    }
+    return heap;
+}
+
+static int is_heap_value_node(ASTNode *node)
+{
+    return node->type == NODE_HEAP_POP || node->type == NODE_HEAP_PEEK;
+}
+
+// First value for hpop (removed) or hpeek (copied); the caller frees it
+static ASTNode *eval_heap_value(ASTNode *node)
+{
+    int pop = node->type == NODE_HEAP_POP;
+    ASTNode *heap = resolve_heap(node->heap_op.heap, pop ? "hpop()" : "hpeek()");
+    ASTNode *value = pop ? heap_pop(heap) : heap_peek(heap);
+    if (!value)
+    {
+        printf("Runtime error: Cannot %s an empty heap\n", pop ? "pop from" : "peek at");
+        exit(1);
+    }
+    return pop ? value : eval_value_node(value);
+}
+
+// Print a number or string value without a trailing newline
+static void print_value_inline(ASTNode *value)
+{
+    if (value->type == NODE_NUMBER)
+        printf("%g", value->number);
+    else if (value->type == NODE_STRING)
+        printf("%s", value->string);
+}
+
+// Resolve a graph operand (variable or literal) to its NODE_GRAPH, or NULL
+static ASTNode *resolve_graph(ASTNode *operand)
+{
+    if (operand->type == NODE_VAR)
+        return get_graph_variable(operand->varname);
+    return operand->type == NODE_GRAPH ? operand : NULL;
+}
+
+// Dense ID of the vertex an expression evaluates to, or -1
+static int graph_vertex_id(ASTNode *graph_node, ASTNode *vertex_expr)
+{
+    if (vertex_expr->type == NODE_NUMBER || vertex_expr->type == NODE_STRING)
+        return ast_graph_find_vertex(graph_node, vertex_expr);
+    ASTNode *vertex = eval_value_node(vertex_expr);
+    int id = ast_graph_find_vertex(graph_node, vertex);
+    ast_free(vertex);
+    return id;
+}
+
+// Build a list holding copies of the given vertices' values
+static ASTNode *graph_ids_to_list(ASTNode *graph_node, const int *ids, int count)
+{
+    ASTNode *list = ast_new_list();
+    if (count > 0)
+        list->list.elements = malloc(sizeof(ASTNode *) * count);
+    for (int i = 0; i < count; i++)
+        list->list.elements[i] = eval_value_node(graph_node->graph.vertices[ids[i]]);
+    list->list.count = count;
+    return list;
+}
+
+// Neighbors (both directions), DFS preorder or BFS order over the CSR snapshot in O(V + E)
+static ASTNode *eval_graph_list(ASTNode *node)
+{
+    ASTNode *graph_node = resolve_graph(node->type == NODE_GRAPH_NEIGHBORS ? node->graph_neighbors.graph
+                                                                           : node->graph_traversal.graph);
+    if (!graph_node)
+        return ast_new_list();
+    int start = graph_vertex_id(graph_node, node->type == NODE_GRAPH_NEIGHBORS ? node->graph_neighbors.vertex
+                                                                               : node->graph_traversal.start);
+    if (start < 0)
+        return ast_new_list();
+
+    if (node->type == NODE_GRAPH_NEIGHBORS)
+    {
+        GraphAdjacency *out = &graph_node->graph.out[start];
+        GraphAdjacency *in = &graph_node->graph.in[start];
+        int *ids = malloc(sizeof(int) * (out->count + in->count + 1));
+        int count = 0;
+        for (int i = 0; i < in->count; i++)
+            ids[count++] = in->targets[i];
+        for (int i = 0; i < out->count; i++)
+        {
+            // Skip targets already listed through an edge in the other direction;
+            // the check scans at most a short vector or probes a hashed one
+            if (!ast_graph_has_edge(graph_node, out->targets[i], start))
+                ids[count++] = out->targets[i];
+        }
+        ASTNode *list = graph_ids_to_list(graph_node, ids, count);
+        free(ids);
+        return list;
+    }
+
+    ast_graph_freeze(graph_node);
+    const int *offsets = graph_node->graph.csr_offsets;
+    const int *targets = graph_node->graph.csr_targets;
+    int n = graph_node->graph.vertex_count;
+    char *visited = calloc(n, 1);
+    int *order = malloc(sizeof(int) * n);
+    int count = 0;
+
+    if (node->type == NODE_GRAPH_BFS)
+    {
+        // order doubles as the queue: everything enqueued is eventually emitted
+        visited[start] = 1;
+        order[count++] = start;
+        for (int head = 0; head < count; head++)
+        {
+            int v = order[head];
+            for (int e = offsets[v]; e < offsets[v + 1]; e++)
+            {
+                if (!visited[targets[e]])
+                {
+                    visited[targets[e]] = 1;
+                    order[count++] = targets[e];
+                }
             }
-            if (i < node->graph.edge_count - 1)
-                printf(", ");
         }
-        printf("]>\n");
-        break;
     }
-
-    case NODE_VAR:
+    else
     {
-        // Check if it's a temporal variable first
-        TemporalVariable *temp_var = get_temporal_var_struct(node->varname);
-        if (temp_var)
-        {
-            const char *val = get_temporal_variable(node->varname, 0);
-            if (val)
-            {
-                printf("%s\n", val);
+        // Explicit stack of (vertex, next edge) frames gives recursive preorder without recursion
+        int *stack_vertex = malloc(sizeof(int) * n);
+        int *stack_edge = malloc(sizeof(int) * n);
+        int top = 0;
+        visited[start] = 1;
+        order[count++] = start;
+        stack_vertex[top] = start;
+        stack_edge[top++] = offsets[start];
+        while (top > 0)
+        {
+            int v = stack_vertex[top - 1];
+            int e = stack_edge[top - 1];
+            if (e == offsets[v + 1])
+            {
+                top--;
+                continue;
             }
-            else
+            stack_edge[top - 1] = e + 1;
+            int w = targets[e];
+            if (!visited[w])
             {
-                printf("Runtime Error: Cannot access temporal variable '%s'\n", node->varname);
+                visited[w] = 1;
+                order[count++] = w;
+                stack_vertex[top] = w;
+                stack_edge[top++] = offsets[w];
             }
         }
-        // Check if it's a set variable
-        else if (get_set_variable(node->varname))
+        free(stack_vertex);
+        free(stack_edge);
+    }
+
+    ASTNode *list = graph_ids_to_list(graph_node, order, count);
+    free(visited);
+    free(order);
+    return list;
+}
+
+// Slice view over a list variable, a list literal or another list result
+static ASTNode *eval_list_slice(ASTNode *node)
+{
+    ASTNode *source = node->list_slice.list;
+    ASTNode *temporary = NULL;
+    if (source->type == NODE_VAR)
+    {
+        source = get_list_variable(source->varname);
+        if (!source)
         {
-            ASTNode *set = get_set_variable(node->varname);
-            print_node(set);
+            printf("Runtime error: Undefined list variable '%s'\n", node->list_slice.list->varname);
+            exit(1);
         }
-        // Check if it's a dict variable
-        else if ((temp_var = NULL, get_dict_variable(node->varname)))
+    }
+    else if (is_list_result_node(source))
+    {
+        source = temporary = eval_list_result(source);
+    }
+    if (source->type != NODE_LIST)
+    {
+        error_throw_at_line(ERROR_TYPE_MISMATCH, "slice() expects a list", node->line);
+    }
+
+    int start = (int)eval_expression(node->list_slice.start);
+    int end = (int)eval_expression(node->list_slice.end);
+    int step = node->list_slice.step ? (int)eval_expression(node->list_slice.step) : 1;
+    ASTNode *view = ast_list_slice(source, start, end, step);
+    ast_free(temporary); // The view holds its own reference to the storage
+    if (!view)
+    {
+        error_throw_at_line(ERROR_INDEX_OUT_OF_BOUNDS, "Invalid slice bounds", node->line);
+    }
+    return view;
+}
+
+static void collect_occurrence(size_t start, int needle, void *ctx)
+{
+    ListCollector *collector = ctx;
+    ASTNode *list = collector->list;
+    if (list->list.count == collector->capacity)
+    {
+        collector->capacity = collector->capacity ? collector->capacity * 2 : 16;
+        list->list.elements = realloc(list->list.elements, sizeof(ASTNode *) * collector->capacity);
+    }
+    ASTNode *pair = ast_new_list();
+    pair->list.elements = malloc(sizeof(ASTNode *) * 2);
+    pair->list.elements[0] = ast_new_number((double)start);
+    pair->list.elements[1] = ast_new_number(needle);
+    pair->list.count = 2;
+    list->list.elements[list->list.count++] = pair;
+}
+
+// Where one needle occurs in a text, or where each of a list of needles does, as
+// [position, needle index] pairs. The automaton for a list is kept on the node
+// and rebuilt only when the needles change.
+static ASTNode *eval_pattern_match(ASTNode *node)
+{
+    const char *op_name = node->type == NODE_PATTERN_MATCH ? "pattern_match" : "pattern_match_any";
+    char *text = get_string_value(node->pattern_match.noise);
+    if (!text)
+    {
+        printf("Runtime error: %s expects a string to search\n", op_name);
+        exit(1);
+    }
+    size_t length = strlen(text);
+    ASTNode *result = ast_new_list();
+    ListCollector collector = {result, 0};
+
+    if (node->type == NODE_PATTERN_MATCH)
+    {
+        char *pattern = get_string_value(node->pattern_match.pattern);
+        if (!pattern)
         {
-            ASTNode *dict = get_dict_variable(node->varname);
-            print_node(dict);
+            printf("Runtime error: pattern_match expects string arguments\n");
+            exit(1);
         }
-        // Check if it's a list variable
-        else if (get_list_variable(node->varname))
+        TextNeedle needle;
+        text_needle_init(&needle, pattern, strlen(pattern));
+        // Occurrences may overlap; an empty needle occurs nowhere
+        for (size_t pos = needle.length ? text_find(&needle, text, length, 0) : TEXT_NONE; pos != TEXT_NONE;
+             pos = text_find(&needle, text, length, pos + 1))
+            list_collect((double)pos, &collector);
+        free(pattern);
+        free(text);
+        return result;
+    }
+
+    ASTNode *source = node->pattern_match.pattern;
+    ASTNode *temporary = NULL;
+    if (source->type == NODE_VAR)
+    {
+        source = get_list_variable(source->varname);
+    }
+    else if (is_list_result_node(source))
+    {
+        source = temporary = eval_list_result(source);
+    }
+    if (!source || source->type != NODE_LIST)
+    {
+        printf("Runtime error: pattern_match_any expects a list of needles\n");
+        exit(1);
+    }
+
+    int count = source->list.count;
+    const char **needles = malloc(sizeof(char *) * (count ? count : 1));
+    size_t *lengths = malloc(sizeof(size_t) * (count ? count : 1));
+    for (int i = 0; i < count; i++)
+    {
+        ASTNode *element = ast_list_access(source, i);
+        if (element->type != NODE_STRING)
         {
-            ASTNode *list = get_list_variable(node->varname);
-            char *list_str = list_to_string(list);
-            printf("%s\n", list_str);
-            free(list_str);
+            printf("Runtime error: pattern_match_any needles must be strings\n");
+            exit(1);
         }
-        // Check if it's a stack variable
-        else if (get_stack_variable(node->varname))
+        needles[i] = element->string;
+        lengths[i] = strlen(element->string);
+    }
+    TextMatcher *matcher = node->pattern_match.matcher;
+    if (!matcher || !text_matcher_same(matcher, needles, lengths, count))
+    {
+        text_matcher_free(matcher);
+        matcher = node->pattern_match.matcher = text_matcher_new(needles, lengths, count);
+    }
+    text_matcher_scan(matcher, text, length, collect_occurrence, &collector);
+
+    free(needles);
+    free(lengths);
+    ast_free(temporary);
+    free(text);
+    return result;
+}
+
+// One value per bucket of the given width, oldest first; empty buckets are skipped
+static ASTNode *eval_temporal_downsample(ASTNode *node)
+{
+    TemporalVariable *temp_var = get_temporal_var_struct(node->temporal_downsample.varname);
+    if (!temp_var)
+    {
+        printf("Runtime error: Variable '%s' is not a temporal variable\n", node->temporal_downsample.varname);
+        exit(1);
+    }
+
+    if (node->temporal_downsample.bucket_ns == 0)
+    {
+        printf("Runtime error: Invalid bucket width '%s'\n", node->temporal_downsample.bucket);
+        exit(1);
+    }
+    if (node->temporal_downsample.stat < 0)
+    {
+        printf("Runtime error: Unknown downsample operation '%s'\n", node->temporal_downsample.operation);
+        exit(1);
+    }
+
+    ASTNode *list = ast_new_list();
+    long long length = temporal_archived(temp_var) + temp_var->count;
+    if (length == 0)
+        return list;
+    double *values = malloc(sizeof(double) * length);
+    int buckets = (int)temporal_full_downsample(temp_var, 0, length, node->temporal_downsample.bucket_ns,
+                                                node->temporal_downsample.stat, values);
+    list->list.elements = malloc(sizeof(ASTNode *) * buckets);
+    for (int i = 0; i < buckets; i++)
+        list->list.elements[i] = ast_new_number(values[i]);
+    list->list.count = buckets;
+    free(values);
+    return list;
+}
+
+static TemporalVariable *require_temporal(const char *name)
+{
+    TemporalVariable *temp_var = get_temporal_var_struct(name);
+    if (!temp_var)
+    {
+        printf("Runtime error: Variable '%s' is not a temporal variable\n", name);
+        exit(1);
+    }
+    return temp_var;
+}
+
+static ASTNode *number_list(const double *values, int count)
+{
+    ASTNode *list = ast_new_list();
+    if (count > 0)
+        list->list.elements = malloc(sizeof(ASTNode *) * count);
+    for (int i = 0; i < count; i++)
+        list->list.elements[i] = ast_new_number(values[i]);
+    list->list.count = count;
+    return list;
+}
+
+// The buffer's samples, oldest first, with the missing ones filled in
+static ASTNode *eval_temporal_fill(ASTNode *node)
+{
+    TemporalVariable *temp_var = require_temporal(node->temporal_fill.varname);
+    if (node->temporal_fill.fill < 0)
+    {
+        printf("Runtime error: Unknown fill method '%s'\n", node->temporal_fill.method);
+        exit(1);
+    }
+
+    double *values = malloc(sizeof(double) * (temp_var->count > 0 ? temp_var->count : 1));
+    temporal_fill(temp_var, (TemporalFill)node->temporal_fill.fill, values);
+    ASTNode *list = number_list(values, temp_var->count);
+    for (int i = 0; i < temp_var->count; i++)
+    {
+        // Still missing when there is no sample to fill from
+        if (temporal_missing(values[i]))
         {
-            ASTNode *stack = get_stack_variable(node->varname);
-            print_node(stack);
+            ast_free(list->list.elements[i]);
+            list->list.elements[i] = ast_new_undef();
         }
-        // Check if it's a queue variable
-        else if (get_queue_variable(node->varname))
+    }
+    free(values);
+    return list;
+}
+
+// One value per bucket of a fixed grid over the full history, undef for buckets
+// without a sample
+static ASTNode *eval_temporal_resample(ASTNode *node)
+{
+    TemporalVariable *temp_var = require_temporal(node->temporal_resample.varname);
+    if (node->temporal_resample.bucket_ns == 0)
+    {
+        printf("Runtime error: Invalid bucket width '%s'\n", node->temporal_resample.bucket);
+        exit(1);
+    }
+    if (node->temporal_resample.stat < 0 || node->temporal_resample.stat == TEMPORAL_MEDIAN)
+    {
+        printf("Runtime error: Unknown resample operation '%s'\n", node->temporal_resample.operation);
+        exit(1);
+    }
+
+    long long size = temporal_grid_size(temp_var, node->temporal_resample.bucket_ns);
+    if (size > TEMPORAL_MAX_GRID)
+    {
+        printf("Runtime error: Resampling '%s' every %s needs %lld buckets\n", node->temporal_resample.varname,
+               node->temporal_resample.bucket, size);
+        exit(1);
+    }
+    double *values = malloc(sizeof(double) * (size > 0 ? size : 1));
+    temporal_resample(temp_var, node->temporal_resample.bucket_ns, node->temporal_resample.stat, values);
+    ASTNode *list = number_list(values, (int)size);
+    for (int i = 0; i < size; i++)
+    {
+        if (temporal_missing(values[i]))
         {
-            ASTNode *queue = get_queue_variable(node->varname);
-            print_node(queue);
+            ast_free(list->list.elements[i]);
+            list->list.elements[i] = ast_new_undef();
         }
-        // Check if it's a linked list variable
-        else if (get_linked_list_variable(node->varname))
+    }
+    free(values);
+    return list;
+}
+
+// Correlation matrix as a list of rows, one per variable in the order given
+static ASTNode *eval_temporal_correlate_matrix(ASTNode *node)
+{
+    ASTNode *names = node->temporal_correlate_matrix.names;
+    ASTNode *temporary = NULL;
+    if (names->type == NODE_VAR)
+        names = get_list_variable(names->varname);
+    else if (is_list_result_node(names))
+        names = temporary = eval_list_result(names);
+    if (!names || names->type != NODE_LIST)
+    {
+        printf("Runtime error: temporal_correlate_matrix expects a list of variable names\n");
+        exit(1);
+    }
+
+    int series = names->list.count;
+    TemporalVariable **vars = malloc(sizeof(TemporalVariable *) * (series > 0 ? series : 1));
+    for (int i = 0; i < series; i++)
+    {
+        ASTNode *name = ast_list_access(names, i);
+        if (name->type != NODE_STRING)
         {
-            ASTNode *linked_list = get_linked_list_variable(node->varname);
-            print_node(linked_list);
+            printf("Runtime error: temporal_correlate_matrix expects a list of variable names\n");
+            exit(1);
         }
-        // Check if it's a regex variable
-        else if (get_regex_variable(node->varname))
+        vars[i] = require_temporal(name->string);
+    }
+    ast_free(temporary);
+
+    int window_size = (int)eval_expression(node->temporal_correlate_matrix.window_size);
+    if (window_size <= 0) window_size = 5; // default, as in temporal_correlate
+
+    double *matrix = malloc(sizeof(double) * (series > 0 ? series * series : 1));
+    if (series > 0)
+        temporal_correlation_matrix(node->temporal_correlate_matrix.cache, vars, series, window_size, matrix);
+    ASTNode *rows = ast_new_list();
+    if (series > 0)
+        rows->list.elements = malloc(sizeof(ASTNode *) * series);
+    for (int i = 0; i < series; i++)
+        rows->list.elements[i] = number_list(matrix + (size_t)i * series, series);
+    rows->list.count = series;
+    free(matrix);
+    free(vars);
+    return rows;
+}
+
+// Correlations of var1 lag values back against var2 now, for lag 0, 1, ... max_lag
+static ASTNode *eval_temporal_xcorr(ASTNode *node)
+{
+    TemporalVariable *var1 = require_temporal(node->temporal_xcorr.var1);
+    TemporalVariable *var2 = require_temporal(node->temporal_xcorr.var2);
+    int window_size = (int)eval_expression(node->temporal_xcorr.window_size);
+    if (window_size <= 0) window_size = 5;
+    int max_lag = (int)eval_expression(node->temporal_xcorr.max_lag);
+    if (max_lag < 0)
+    {
+        printf("Runtime error: temporal_xcorr expects a non-negative lag\n");
+        exit(1);
+    }
+    if (max_lag > var1->count) max_lag = var1->count; // Lags past the history give nothing
+
+    double *values = malloc(sizeof(double) * (max_lag + 1));
+    int lags = temporal_cross_correlation(var1, var2, window_size, max_lag, values);
+    ASTNode *list = number_list(values, lags);
+    free(values);
+    return list;
+}
+
+// Evaluate a slice, tree, graph or temporal operation into a new list
+static ASTNode *eval_list_result(ASTNode *node)
+{
+    if (node->type == NODE_TEMPORAL_CORRELATE_MATRIX)
+        return eval_temporal_correlate_matrix(node);
+    if (node->type == NODE_TEMPORAL_XCORR)
+        return eval_temporal_xcorr(node);
+    if (node->type == NODE_LIST_SLICE)
+        return eval_list_slice(node);
+    if (node->type == NODE_TEMPORAL_DOWNSAMPLE)
+        return eval_temporal_downsample(node);
+    if (node->type == NODE_TEMPORAL_FILL)
+        return eval_temporal_fill(node);
+    if (node->type == NODE_TEMPORAL_RESAMPLE)
+        return eval_temporal_resample(node);
+    if (node->type == NODE_REGEX_FIND_ALL || node->type == NODE_REGEX_NEXT)
+        return eval_regex_matches(node);
+    if (node->type == NODE_PATTERN_MATCH || node->type == NODE_PATTERN_MATCH_ANY)
+        return eval_pattern_match(node);
+    if (node->type == NODE_GRAPH_NEIGHBORS || node->type == NODE_GRAPH_DFS || node->type == NODE_GRAPH_BFS)
+        return eval_graph_list(node);
+    return eval_tree_list(node);
+}
+
+// Element-by-element copy of a list or slice view into storage of its own
+static ASTNode *copy_list_values(ASTNode *list)
+{
+    ASTNode *copy = ast_new_list();
+    if (list->list.count > 0)
+        copy->list.elements = malloc(sizeof(ASTNode *) * list->list.count);
+    for (int i = 0; i < list->list.count; i++)
+    {
+        ASTNode *element = ast_list_access(list, i);
+        if (element->type == NODE_LIST)
+            copy->list.elements[i] = copy_list_values(element);
+        else if (element->type == NODE_UNDEF)
+            copy->list.elements[i] = ast_new_undef();
+        else
+            copy->list.elements[i] = eval_value_node(element);
+    }
+    copy->list.count = list->list.count;
+    return copy;
+}
+
+// List variable ready for in-place updates. A list shared with slice views, or a view
+// itself, is copied into the variable first so the views keep their contents.
+static ASTNode *unshare_list(const char *name, ASTNode *list)
+{
+    if (list->list.refs == 0 && !list->list.base)
+        return list;
+    ASTNode *copy = copy_list_values(list);
+    set_list_variable(name, copy);
+    return copy;
+}
+
+// Function to convert a list to a string representation
+static char *list_to_string(ASTNode *list)
+{
+    if (list->type != NODE_LIST)
+    {
+        return strdup("Not a list");
+    }
+
+    char *result = strdup("[");
+    for (int i = 0; i < list->list.count; i++)
+    {
+        char buffer[256];
+        char *nested = NULL;
+        ASTNode *element = ast_list_access(list, i);
+
+        if (element->type == NODE_NUMBER)
         {
-            ASTNode *regex = get_regex_variable(node->varname);
-            print_node(regex);
+            snprintf(buffer, sizeof(buffer), "%g", element->number);
         }
-        // Check if it's a set variable
-        else if (get_set_variable(node->varname))
+        else if (element->type == NODE_STRING)
         {
-            ASTNode *set = get_set_variable(node->varname);
-            print_node(set);
+            snprintf(buffer, sizeof(buffer), "%s", element->string);
         }
-        // Check if it's a tree variable
-        else if (get_tree_variable(node->varname))
+        else if (element->type == NODE_LIST)
         {
-            ASTNode *tree = get_tree_variable(node->varname);
-            print_node(tree);
+            nested = list_to_string(element);
         }
-        // Check if it's a graph variable
-        else if (get_graph_variable(node->varname))
+        else if (element->type == NODE_UNDEF)
         {
-            ASTNode *graph = get_graph_variable(node->varname);
-            print_node(graph);
+            snprintf(buffer, sizeof(buffer), "UNDEF");
         }
-        // Check if it's an UNDEF variable
-        else if (is_undef_variable(node->varname))
+        else
         {
-            printf("UNDEF\n");
+            snprintf(buffer, sizeof(buffer), "Unknown");
         }
-        else
+
+        const char *text = nested ? nested : buffer;
+        result = realloc(result, strlen(result) + strlen(text) + 3);
+        strcat(result, text);
+        free(nested);
+
+        if (i < list->list.count - 1)
         {
-            const char *val = get_variable(node->varname);
-            if (val)
-            {
-                printf("%s\n", val);
-            }
-            else
-            {
-                printf("UNDEF\n"); // Undefined variables are UNDEF
-            }
+            strcat(result, ", ");
         }
+    }
+
+    result = realloc(result, strlen(result) + 2);
+    strcat(result, "]");
+    return result;
+}
 
+// Modify your print logic to handle lists
+static void print_node(ASTNode *node)
+{
+    switch (node->type)
+    {
+    case NODE_NUMBER:
+        printf("%g\n", node->number);
+        break;
+    case NODE_STRING:
+        printf("%s\n", node->string);
+        break;
+    case NODE_LIST:
+    {
+        char *list_str = list_to_string(node);
+        printf("%s\n", list_str);
+        free(list_str);
         break;
     }
-    case NODE_TEMPORAL_VAR:
+    case NODE_DICT:
     {
-        if (node->temporal_var.time_offset)
+        printf("{");
+        for (int i = 0; i < node->dict.count; i++)
         {
-            double result = eval_expression(node);
-            printf("%g\n", result);
+            if (node->dict.keys[i]->type == NODE_STRING)
+                printf("\"%s\"", node->dict.keys[i]->string);
+            else if (node->dict.keys[i]->type == NODE_NUMBER)
+                printf("%g", node->dict.keys[i]->number);
+            printf(" := ");
+            if (node->dict.values[i]->type == NODE_STRING)
+                printf("\"%s\"", node->dict.values[i]->string);
+            else if (node->dict.values[i]->type == NODE_NUMBER)
+                printf("%g", node->dict.values[i]->number);
+            if (i < node->dict.count - 1)
+                printf(", ");
         }
-        else
+        printf("}\n");
+        break;
+    }
+    case NODE_STACK:
+    {
+        printf("<");
+        for (int i = 0; i < node->stack.count; i++)
         {
-            printf("<temp@%g>\n", node->number);
+            if (node->stack.elements[i]->type == NODE_STRING)
+                printf("%s", node->stack.elements[i]->string);
+            else if (node->stack.elements[i]->type == NODE_NUMBER)
+                printf("%g", node->stack.elements[i]->number);
+            if (i < node->stack.count - 1)
+                printf(", ");
         }
+        printf(">\n");
         break;
     }
-    case NODE_FORMAT_STRING:
-        eval_expression(node);
-        break;
-    case NODE_TO_STR:
+    case NODE_QUEUE:
     {
-        double result = eval_expression(node);
-        if (result == -12345.6789)
+        printf("<");
+        for (int i = 0; i < node->queue.count; i++)
         {
-            const char *str_result = get_variable("__to_str_result");
-            if (str_result)
-            {
-                printf("%s\n", str_result);
-            }
+            if (node->queue.elements[i]->type == NODE_STRING)
+                printf("%s", node->queue.elements[i]->string);
+            else if (node->queue.elements[i]->type == NODE_NUMBER)
+                printf("%g", node->queue.elements[i]->number);
+            if (i < node->queue.count - 1)
+                printf(", ");
         }
-        else
+        printf(">\n");
+        break;
+    }
+    case NODE_LINKED_LIST:
+    {
+        printf("[");
+        for (LinkedNode *item = node->linked_list.head; item; item = item->next)
         {
-            printf("%g\n", result);
+            print_value_inline(item->value);
+            if (item->next)
+                printf(", ");
         }
+        printf("]\n");
         break;
     }
-    case NODE_TYPE:
+    case NODE_REGEX:
     {
-        double result = eval_expression(node);
-        if (result == -12345.6789)
+        printf("/%s/%s\n", node->regex.pattern, node->regex.flags);
+        break;
+    }
+    case NODE_SET:
+    {
+        ast_set_compact(node);
+        printf("{");
+        for (int i = 0; i < node->set.count; i++)
         {
-            const char *str_result = get_variable("__type_result");
-            if (str_result)
-            {
-                printf("%s\n", str_result);
-            }
+            if (node->set.elements[i]->type == NODE_STRING)
+                printf("%s", node->set.elements[i]->string);
+            else if (node->set.elements[i]->type == NODE_NUMBER)
+                printf("%g", node->set.elements[i]->number);
+            if (i < node->set.count - 1)
+                printf(", ");
         }
+        printf("}\n");
         break;
     }
-    case NODE_UNDEF:
+    case NODE_SET_UNION:
+    case NODE_SET_INTERSECTION:
+    case NODE_SET_DIFFERENCE:
+    case NODE_SET_SYMMETRIC_DIFF:
+    case NODE_SET_COPY:
     {
-        printf("UNDEF\n");
+        ASTNode *result = eval_set_result(node);
+        print_node(result);
+        ast_free(result);
         break;
     }
-    case NODE_HTTP_GET:
-    case NODE_HTTP_POST:
-    case NODE_HTTP_PUT:
-    case NODE_HTTP_DELETE:
+    case NODE_SET_CONTAINS:
+        printf("%s\n", bool_to_str((bool)eval_expression(node)));
+        break;
+    case NODE_TREE:
     {
-        // HTTP requests are handled directly in eval_expression
-        // which will print the response
-        eval_expression(node);
+        ASTNode *values = ast_new_list();
+        ListCollector collector = {values, 0};
+        ast_tree_walk(node, TREE_INORDER, list_collect, &collector);
+        printf("<tree: ");
+        for (int i = 0; i < values->list.count; i++)
+        {
+            printf("%g", values->list.elements[i]->number);
+            if (i < values->list.count - 1)
+                printf(", ");
+        }
+        printf(">\n");
+        ast_free(values);
         break;
     }
-    case NODE_DICT_GET:
+    case NODE_TREE_INORDER:
+    case NODE_TREE_PREORDER:
+    case NODE_TREE_POSTORDER:
+    case NODE_TREE_RANGE:
+    case NODE_GRAPH_NEIGHBORS:
+    case NODE_GRAPH_DFS:
+    case NODE_GRAPH_BFS:
+    case NODE_LIST_SLICE:
+    case NODE_TEMPORAL_DOWNSAMPLE:
+    case NODE_TEMPORAL_CORRELATE_MATRIX:
+    case NODE_TEMPORAL_XCORR:
+    case NODE_TEMPORAL_FILL:
+    case NODE_TEMPORAL_RESAMPLE:
+    case NODE_REGEX_FIND_ALL:
+    case NODE_REGEX_NEXT:
+    case NODE_PATTERN_MATCH:
+    case NODE_PATTERN_MATCH_ANY:
     {
-        ASTNode *dict_node = node->dict_get.dict;
-        if (dict_node->type == NODE_VAR)
+        ASTNode *values = eval_list_result(node);
+        char *list_str = list_to_string(values);
+        printf("%s\n", list_str);
+        free(list_str);
+        ast_free(values);
+        break;
+    }
+    case NODE_TREE_SEARCH:
+    case NODE_GRAPH_HAS_EDGE:
+    case NODE_PMAP_HAS:
+        printf("%s\n", bool_to_str((bool)eval_expression(node)));
+        break;
+    case NODE_GRAPH:
+    {
+        printf("<graph: vertices[");
+        for (int i = 0; i < node->graph.vertex_count; i++)
         {
-            dict_node = get_dict_variable(dict_node->varname);
+            print_value_inline(node->graph.vertices[i]);
+            if (i < node->graph.vertex_count - 1)
+                printf(", ");
         }
-        if (dict_node && dict_node->type == NODE_DICT)
+        printf("] edges[");
+        int printed = 0;
+        for (int v = 0; v < node->graph.vertex_count; v++)
         {
-            ASTNode *key = node->dict_get.key;
-            for (int i = 0; i < dict_node->dict.count; i++)
+            GraphAdjacency *adj = &node->graph.out[v];
+            for (int i = 0; i < adj->count; i++)
             {
-                if (dict_node->dict.keys[i]->type == NODE_STRING && key->type == NODE_STRING)
-                {
-                    if (strcmp(dict_node->dict.keys[i]->string, key->string) == 0)
-                    {
-                        if (dict_node->dict.values[i]->type == NODE_STRING)
-                            printf("%s\n", dict_node->dict.values[i]->string);
-                        else if (dict_node->dict.values[i]->type == NODE_NUMBER)
-                            printf("%g\n", dict_node->dict.values[i]->number);
-                        return;
-                    }
-                }
+                if (printed++ > 0)
+                    printf(", ");
+                printf("(");
+                print_value_inline(node->graph.vertices[v]);
+                printf(",");
+                print_value_inline(node->graph.vertices[adj->targets[i]]);
+                if (adj->weights[i] != 1.0)
+                    printf(":%g", adj->weights[i]);
+                printf(")");
             }
         }
-        printf("(not found)\n");
+        printf("]>\n");
         break;
     }
-    case NODE_MEMBER_ACCESS:
-    {
-        ASTNode *object = node->member_access.object;
-        const char *member_name = node->member_access.member_name;
-        ObjectInstance *obj = NULL;
 
-        // Handle self.member access
-        if (object->type == NODE_VAR && strcmp(object->varname, "self") == 0 && current_self)
-        {
-            obj = current_self;
-        }
-        // Handle obj.member access
-        else if (object->type == NODE_VAR)
+    case NODE_VAR:
+    {
+        // Check if it's a temporal variable first
+        TemporalVariable *temp_var = get_temporal_var_struct(node->varname);
+        if (temp_var)
         {
-            const char *obj_ptr_str = get_variable(object->varname);
-            if (obj_ptr_str)
+            const char *val = get_temporal_variable(node->varname, 0);
+            if (val)
             {
-                sscanf(obj_ptr_str, "%p", (void **)&obj);
+                printf("%s\n", val);
             }
-        }
-
-        if (obj)
-        {
-            FieldEntry *field = object_get_field(obj, member_name);
-            if (field)
+            else
             {
-                if (field->type == FIELD_STRING)
-                {
-                    printf("%s\n", field->string_value);
-                    return;
-                }
-                else if (field->type == FIELD_NUMBER)
-                {
-                    printf("%g\n", field->number_value);
-                    return;
-                }
+                printf("Runtime Error: Cannot access temporal variable '%s'\n", node->varname);
             }
         }
-        printf("(unknown member)\n");
-        break;
-    }
-    case NODE_LINKED_LIST_GET:
-    {
-        ASTNode *list_node = node->linked_list_get.list;
-        int index = (int)eval_expression(node->linked_list_get.index);
-
-        if (list_node->type == NODE_VAR)
+        // Check if it's a set variable
+        else if (get_set_variable(node->varname))
+        {
+            ASTNode *set = get_set_variable(node->varname);
+            print_node(set);
+        }
+        // Check if it's a dict variable
+        else if ((temp_var = NULL, get_dict_variable(node->varname)))
+        {
+            ASTNode *dict = get_dict_variable(node->varname);
+            print_node(dict);
+        }
+        // Check if it's a list variable
+        else if (get_list_variable(node->varname))
+        {
+            ASTNode *list = get_list_variable(node->varname);
+            char *list_str = list_to_string(list);
+            printf("%s\n", list_str);
+            free(list_str);
+        }
+        // Check if it's a stack variable
+        else if (get_stack_variable(node->varname))
+        {
+            ASTNode *stack = get_stack_variable(node->varname);
+            print_node(stack);
+        }
+        // Check if it's a queue variable
+        else if (get_queue_variable(node->varname))
+        {
+            ASTNode *queue = get_queue_variable(node->varname);
+            print_node(queue);
+        }
+        // Check if it's a linked list variable
+        else if (get_linked_list_variable(node->varname))
+        {
+            ASTNode *linked_list = get_linked_list_variable(node->varname);
+            print_node(linked_list);
+        }
+        // Check if it's a regex variable
+        else if (get_regex_variable(node->varname))
+        {
+            ASTNode *regex = get_regex_variable(node->varname);
+            print_node(regex);
+        }
+        // Check if it's a set variable
+        else if (get_set_variable(node->varname))
+        {
+            ASTNode *set = get_set_variable(node->varname);
+            print_node(set);
+        }
+        // Check if it's a tree variable
+        else if (get_tree_variable(node->varname))
+        {
+            ASTNode *tree = get_tree_variable(node->varname);
+            print_node(tree);
+        }
+        // Check if it's a graph variable
+        else if (get_graph_variable(node->varname))
+        {
+            ASTNode *graph = get_graph_variable(node->varname);
+            print_node(graph);
+        }
+        else if (get_persistent_variable(node->varname))
+        {
+            print_node(get_persistent_variable(node->varname));
+        }
+        else if (get_ndarray_variable(node->varname))
+        {
+            print_node(get_ndarray_variable(node->varname));
+        }
+        else if (get_heap_variable(node->varname))
         {
-            list_node = get_linked_list_variable(list_node->varname);
+            print_node(get_heap_variable(node->varname));
         }
-
-        if (list_node && list_node->type == NODE_LINKED_LIST &&
-            index >= 0 && index < list_node->linked_list.count)
+        // Check if it's an UNDEF variable
+        else if (is_undef_variable(node->varname))
         {
-            ASTNode *element = list_node->linked_list.elements[index];
-            if (element->type == NODE_STRING)
+            printf("UNDEF\n");
+        }
+        else
+        {
+            const char *val = get_variable(node->varname);
+            if (val)
             {
-                printf("%s\n", element->string);
-                return;
+                printf("%s\n", val);
             }
-            else if (element->type == NODE_NUMBER)
+            else
             {
-                printf("%g\n", element->number);
-                return;
+                printf("UNDEF\n"); // Undefined variables are UNDEF
             }
         }
-        // If we get here, something went wrong
-        double result = eval_expression(node);
-        printf("%g\n", result);
+
         break;
     }
-    case NODE_STRING_INTERPOLATION:
+    case NODE_TEMPORAL_VAR:
     {
-        eval_expression(node);
-        const char *result = get_variable("__string_interp_result");
-        if (result) {
-            printf("%s\n", result);
+        if (node->temporal_var.time_offset)
+        {
+            int time_offset = (int)eval_expression(node->temporal_var.time_offset);
+            const char *val = get_temporal_variable(node->temporal_var.varname, time_offset);
+            if (!val)
+            {
+                printf("Runtime error: Cannot access temporal variable '%s' at offset %d\n",
+                       node->temporal_var.varname, time_offset);
+                exit(1);
+            }
+            printf("%s\n", val);
+        }
+        else
+        {
+            printf("<temp@%g>\n", node->number);
         }
         break;
     }
-    default:
+    case NODE_FORMAT_STRING:
+        eval_expression(node);
+        break;
+    case NODE_TO_STR:
     {
         double result = eval_expression(node);
-        // Handle ternary operator specially for printing
-        if (node->type == NODE_TERNARY)
+        if (result == -12345.6789)
         {
-            double condition = eval_expression(node->ternary.condition);
-            ASTNode *result_expr = (condition != 0) ? node->ternary.true_expr : node->ternary.false_expr;
-            
-            if (result_expr->type == NODE_STRING)
-            {
-                printf("%s\n", result_expr->string);
-            }
-            else
+            const char *str_result = get_variable("__to_str_result");
+            if (str_result)
             {
-                double expr_result = eval_expression(result_expr);
-                
-                // Check if this is a boolean context (ternary with true/false literals)
-                int is_boolean_context = 0;
-                if ((node->ternary.true_expr->type == NODE_NUMBER && 
-                     (node->ternary.true_expr->number == 1.0 || node->ternary.true_expr->number == 0.0)) ||
-                    (node->ternary.false_expr->type == NODE_NUMBER && 
-                     (node->ternary.false_expr->number == 1.0 || node->ternary.false_expr->number == 0.0)))
-                {
-                    is_boolean_context = 1;
-                }
-                
-                // Also check if the condition is a boolean operation
-                if ((node->ternary.condition->type == NODE_BINOP &&
-                     (node->ternary.condition->binop.op == TOK_EQ || node->ternary.condition->binop.op == TOK_NEQ ||
-                      node->ternary.condition->binop.op == TOK_LT || node->ternary.condition->binop.op == TOK_GT ||
-                      node->ternary.condition->binop.op == TOK_LTE || node->ternary.condition->binop.op == TOK_GTE)) ||
-                    node->ternary.condition->type == NODE_AND || node->ternary.condition->type == NODE_OR || node->ternary.condition->type == NODE_NOT)
-                {
-                    is_boolean_context = 1;
-                }
-                
-                // Check if the result expression itself is a boolean operation
-                if ((result_expr->type == NODE_BINOP &&
-                     (result_expr->binop.op == TOK_EQ || result_expr->binop.op == TOK_NEQ ||
-                      result_expr->binop.op == TOK_LT || result_expr->binop.op == TOK_GT ||
-                      result_expr->binop.op == TOK_LTE || result_expr->binop.op == TOK_GTE)) ||
-                    result_expr->type == NODE_AND || result_expr->type == NODE_OR || result_expr->type == NODE_NOT)
-                {
-                    is_boolean_context = 1;
-                }
-                
-                if (is_boolean_context && (expr_result == 1.0 || expr_result == 0.0))
-                {
-                    printf("%s\n", bool_to_str((bool)expr_result));
-                }
-                else
-                {
-                    printf("%g\n", expr_result);
-                }
+                printf("%s\n", str_result);
             }
         }
-        // Check if this is a boolean result (0 or 1 from boolean operations)
-        else if ((result == 0.0 || result == 1.0) && 
-            (node->type == NODE_AND || node->type == NODE_OR || node->type == NODE_NOT ||
-             node->type == NODE_TEMPORAL_CONDITION ||
-             (node->type == NODE_BINOP && 
-              (node->binop.op == TOK_EQ || node->binop.op == TOK_NEQ ||
-               node->binop.op == TOK_LT || node->binop.op == TOK_GT ||
-               node->binop.op == TOK_LTE || node->binop.op == TOK_GTE))))
-        {
-            printf("%s\n", bool_to_str((bool)result));
-        }
         else
         {
             printf("%g\n", result);
         }
         break;
     }
+    case NODE_TYPE:
+    {
+        double result = eval_expression(node);
+        if (result == -12345.6789)
+        {
+            const char *str_result = get_variable("__type_result");
+            if (str_result)
+            {
+                printf("%s\n", str_result);
+            }
+        }
+        break;
     }
-}
-
-// Helper function to convert boolean to string
-const char *bool_to_str(bool value)
-{
-    return value ? "true" : "false";
-}
-
-// Simple regex engine implementation
-static int regex_match_char(char pattern_char, char text_char, int case_insensitive)
-{
-    if (case_insensitive)
+    case NODE_UNDEF:
     {
-        return tolower(pattern_char) == tolower(text_char);
+        printf("UNDEF\n");
+        break;
     }
-    return pattern_char == text_char;
-}
-
-static int regex_match_at_position(const char *pattern, const char *text, int case_insensitive)
-{
-    int p = 0, t = 0;
-    
-
-    
-    while (pattern[p])
+    case NODE_HTTP_GET:
+    case NODE_HTTP_POST:
+    case NODE_HTTP_PUT:
+    case NODE_HTTP_DELETE:
+    {
+        // HTTP requests are handled directly in eval_expression
+        // which will print the response
+        eval_expression(node);
+        break;
+    }
+    case NODE_DICT_GET:
     {
-        // Handle escape sequences - check for double backslash from Tesseract parsing
-        if ((pattern[p] == '\\' && pattern[p + 1] == '\\' && pattern[p + 2]) || 
-            (pattern[p] == '\\' && pattern[p + 1]))
+        ASTNode *dict_node = node->dict_get.dict;
+        if (dict_node->type == NODE_VAR)
         {
-            char next;
-            int base_skip;
-            if (pattern[p + 1] == '\\' && pattern[p + 2])
-            {
-                // Double backslash case: \\d
-                next = pattern[p + 2];
-                base_skip = 3;
-            }
-            else
-            {
-                // Single backslash case: \d
-                next = pattern[p + 1];
-                base_skip = 2;
-            }
-            
-            if (next == 'd')
-            {
-                // Check for quantifier after \d
-                if (pattern[p + base_skip] == '+')
-                {
-                    // \d+ - one or more digits
-                    if (!text[t] || !isdigit(text[t])) return 0;
-                    while (text[t] && isdigit(text[t])) t++;
-                    p += base_skip + 1;
-                }
-                else if (pattern[p + base_skip] == '*')
-                {
-                    // \d* - zero or more digits
-                    while (text[t] && isdigit(text[t])) t++;
-                    p += base_skip + 1;
-                }
-                else if (pattern[p + base_skip] == '{')
-                {
-                    // \d{n} - exactly n digits
-                    int brace_end = p + base_skip + 1;
-                    while (pattern[brace_end] && pattern[brace_end] != '}') brace_end++;
-                    if (!pattern[brace_end]) return 0;
-                    
-                    int count = 0;
-                    for (int i = p + base_skip + 1; i < brace_end; i++)
-                    {
-                        if (isdigit(pattern[i]))
-                            count = count * 10 + (pattern[i] - '0');
-                        else
-                            break;
-                    }
-                    
-                    for (int i = 0; i < count; i++)
-                    {
-                        if (!text[t] || !isdigit(text[t])) return 0;
-                        t++;
-                    }
-                    p = brace_end + 1;
-                }
-                else
-                {
-                    // \d - single digit
-                    if (!text[t] || !isdigit(text[t])) return 0;
-                    t++;
-                    p += base_skip;
-                }
-            }
-            else if (next == 'w')
-            {
-                if (pattern[p + base_skip] == '+')
-                {
-                    if (!text[t] || (!isalnum(text[t]) && text[t] != '_')) return 0;
-                    while (text[t] && (isalnum(text[t]) || text[t] == '_')) t++;
-                    p += base_skip + 1;
-                }
-                else
-                {
-                    if (!text[t] || (!isalnum(text[t]) && text[t] != '_')) return 0;
-                    t++;
-                    p += base_skip;
-                }
-            }
-            else if (next == 's')
-            {
-                if (pattern[p + base_skip] == '+')
-                {
-                    if (!text[t] || !isspace(text[t])) return 0;
-                    while (text[t] && isspace(text[t])) t++;
-                    p += base_skip + 1;
-                }
-                else
-                {
-                    if (!text[t] || !isspace(text[t])) return 0;
-                    t++;
-                    p += base_skip;
-                }
-            }
-            else if (next == '(' || next == ')')
-            {
-                // Handle escaped parentheses - check for optional quantifier
-                if (pattern[p + base_skip] == '?')
-                {
-                    // Optional parenthesis - try with and without
-                    if (text[t] && regex_match_char(next, text[t], case_insensitive))
-                    {
-                        if (regex_match_at_position(pattern + p + base_skip + 1, text + t + 1, case_insensitive))
-                            return 1;
-                    }
-                    return regex_match_at_position(pattern + p + base_skip + 1, text + t, case_insensitive);
-                }
-                else
-                {
-                    // Literal parenthesis
-                    if (!text[t] || !regex_match_char(next, text[t], case_insensitive)) return 0;
-                    p += base_skip;
-                    t++;
-                }
-            }
-            else
-            {
-                // Literal escaped character
-                if (!text[t] || !regex_match_char(next, text[t], case_insensitive)) return 0;
-                p += base_skip;
-                t++;
-            }
+            dict_node = get_dict_variable(dict_node->varname);
         }
-        // Handle character classes
-        else if (pattern[p] == '[')
+        if (dict_node && dict_node->type == NODE_DICT)
         {
-            int class_end = p + 1;
-            while (pattern[class_end] && pattern[class_end] != ']') class_end++;
-            if (!pattern[class_end]) return 0; // Malformed class
-            
-            int match = 0;
-            for (int i = p + 1; i < class_end; i++)
-            {
-                if (i + 2 < class_end && pattern[i + 1] == '-')
-                {
-                    // Range like a-z or 0-9
-                    if (text[t] >= pattern[i] && text[t] <= pattern[i + 2])
-                    {
-                        match = 1;
-                        break;
-                    }
-                    i += 2;
-                }
-                else
-                {
-                    if (regex_match_char(pattern[i], text[t], case_insensitive))
-                    {
-                        match = 1;
-                        break;
-                    }
-                }
-            }
-            if (!match) return 0;
-            
-            // Check for quantifier after character class
-            if (pattern[class_end + 1] == '+')
-            {
-                // One or more matches
-                t++; // We already matched one
-                while (text[t])
-                {
-                    int class_match = 0;
-                    for (int i = p + 1; i < class_end; i++)
-                    {
-                        if (i + 2 < class_end && pattern[i + 1] == '-')
-                        {
-                            if (text[t] >= pattern[i] && text[t] <= pattern[i + 2])
-                            {
-                                class_match = 1;
-                                break;
-                            }
-                            i += 2;
-                        }
-                        else
-                        {
-                            if (regex_match_char(pattern[i], text[t], case_insensitive))
-                            {
-                                class_match = 1;
-                                break;
-                            }
-                        }
-                    }
-                    if (!class_match) break;
-                    t++;
-                }
-                p = class_end + 2;
-            }
-            else if (pattern[class_end + 1] == '?')
-            {
-                // Optional character class - try with and without
-                if (text[t])
-                {
-                    int class_match = 0;
-                    for (int i = p + 1; i < class_end; i++)
-                    {
-                        if (i + 2 < class_end && pattern[i + 1] == '-')
-                        {
-                            if (text[t] >= pattern[i] && text[t] <= pattern[i + 2])
-                            {
-                                class_match = 1;
-                                break;
-                            }
-                            i += 2;
-                        }
-                        else
-                        {
-                            if (regex_match_char(pattern[i], text[t], case_insensitive))
-                            {
-                                class_match = 1;
-                                break;
-                            }
-                        }
-                    }
-                    if (class_match)
-                    {
-                        if (regex_match_at_position(pattern + class_end + 2, text + t + 1, case_insensitive))
-                            return 1;
-                    }
-                }
-                return regex_match_at_position(pattern + class_end + 2, text + t, case_insensitive);
-            }
-            else
+            ASTNode *value = dict_lookup(dict_node, node->dict_get.key);
+            if (value)
             {
-                p = class_end + 1;
-                t++;
+                if (value->type == NODE_STRING)
+                    printf("%s\n", value->string);
+                else if (value->type == NODE_NUMBER)
+                    printf("%g\n", value->number);
+                return;
             }
         }
-        else if (pattern[p] == '.')
+        printf("(not found)\n");
+        break;
+    }
+    case NODE_MEMBER_ACCESS:
+    {
+        ASTNode *object = node->member_access.object;
+        const char *member_name = node->member_access.member_name;
+        ObjectInstance *obj = NULL;
+
+        // Handle self.member access
+        if (object->type == NODE_VAR && strcmp(object->varname, "self") == 0 && current_self)
         {
-            // Match any character
-            if (!text[t]) return 0;
-            p++;
-            t++;
+            obj = current_self;
         }
-        else
+        // Handle obj.member access
+        else if (object->type == NODE_VAR)
         {
-            // Check for quantifiers after literal characters
-            if (pattern[p + 1] == '?')
-            {
-                // Optional character - try with and without
-                if (text[t] && regex_match_char(pattern[p], text[t], case_insensitive))
-                {
-                    // Try matching with the character
-                    if (regex_match_at_position(pattern + p + 2, text + t + 1, case_insensitive))
-                        return 1;
-                }
-                // Try matching without the character
-                return regex_match_at_position(pattern + p + 2, text + t, case_insensitive);
-            }
-            else if (pattern[p + 1] == '*')
-            {
-                // Zero or more - try all possibilities
-                // First try without matching any
-                if (regex_match_at_position(pattern + p + 2, text + t, case_insensitive))
-                    return 1;
-                // Then try matching one or more
-                while (text[t] && regex_match_char(pattern[p], text[t], case_insensitive))
-                {
-                    t++;
-                    if (regex_match_at_position(pattern + p + 2, text + t, case_insensitive))
-                        return 1;
-                }
-                return 0;
-            }
-            else if (pattern[p + 1] == '+')
+            const char *obj_ptr_str = get_variable(object->varname);
+            if (obj_ptr_str)
             {
-                // One or more
-                if (!text[t] || !regex_match_char(pattern[p], text[t], case_insensitive)) return 0;
-                t++;
-                while (text[t] && regex_match_char(pattern[p], text[t], case_insensitive))
-                {
-                    t++;
-                }
-                p += 2;
+                sscanf(obj_ptr_str, "%p", (void **)&obj);
             }
-            else if (pattern[p + 1] == '{')
+        }
+
+        if (obj)
+        {
+            FieldEntry *field = object_get_field(obj, member_name);
+            if (field)
             {
-                // Quantifier like {3} or {2,4}
-                int brace_end = p + 2;
-                while (pattern[brace_end] && pattern[brace_end] != '}') brace_end++;
-                if (!pattern[brace_end]) return 0; // Malformed quantifier
-                
-                // Extract number from {n}
-                int count = 0;
-                for (int i = p + 2; i < brace_end; i++)
+                if (field->type == FIELD_STRING)
                 {
-                    if (isdigit(pattern[i]))
-                        count = count * 10 + (pattern[i] - '0');
-                    else
-                        break; // Stop at comma or other chars for now
+                    printf("%s\n", field->string_value);
+                    return;
                 }
-                
-                // Match exactly 'count' occurrences
-                for (int i = 0; i < count; i++)
+                else if (field->type == FIELD_NUMBER)
                 {
-                    if (!text[t] || !regex_match_char(pattern[p], text[t], case_insensitive)) return 0;
-                    t++;
+                    printf("%g\n", field->number_value);
+                    return;
                 }
-                p = brace_end + 1;
-            }
-            else
-            {
-                // Literal character match
-                if (!text[t] || !regex_match_char(pattern[p], text[t], case_insensitive)) return 0;
-                p++;
-                t++;
             }
         }
+        printf("(unknown member)\n");
+        break;
     }
-    
-
-    return 1; // Successfully matched entire pattern
-}
-
-static int regex_match_pattern(const char *pattern, const char *text, const char *flags)
-{
-    int case_insensitive = (strchr(flags, 'i') != NULL);
-    int text_len = strlen(text);
-    
-    // Try matching at each position in the text
-    for (int i = 0; i <= text_len; i++)
+    case NODE_LINKED_LIST_GET:
+    case NODE_LINKED_LIST_CURRENT:
+    case NODE_LINKED_LIST_POP_FRONT:
+    case NODE_LINKED_LIST_POP_BACK:
+    case NODE_PVEC_GET:
+    case NODE_PMAP_GET:
+    case NODE_HEAP_POP:
+    case NODE_HEAP_PEEK:
+    {
+        ASTNode *value = is_linked_value_node(node)     ? eval_linked_value(node)
+                         : is_persistent_value_node(node) ? eval_persistent_value(node)
+                                                          : eval_heap_value(node);
+        print_node(value);
+        ast_free(value);
+        break;
+    }
+    case NODE_PVEC:
+    case NODE_PMAP:
+    {
+        ASTNode *contents = node->type == NODE_PVEC ? pvec_to_list(node) : pmap_to_dict(node);
+        print_node(contents);
+        ast_free(contents);
+        break;
+    }
+    case NODE_NDARRAY:
     {
-        if (regex_match_at_position(pattern, text + i, case_insensitive))
+        if (node->ndarray.ndim == 0)
         {
-            return 1;
+            printf("%g\n", ndarray_data(node)[0]);
+            break;
         }
+        ASTNode *contents = ndarray_to_list(node);
+        print_node(contents);
+        ast_free(contents);
+        break;
     }
-    
-    return 0;
-}
-
-static int regex_get_match_length(const char *pattern, const char *text, int case_insensitive)
-{
-    int p = 0, t = 0;
-    
-    while (pattern[p])
+    case NODE_PVEC_PUSH:
+    case NODE_PVEC_SET:
+    case NODE_PVEC_POP:
+    case NODE_PMAP_PUT:
+    case NODE_PMAP_REMOVE:
     {
-        if ((pattern[p] == '\\' && pattern[p + 1] == '\\' && pattern[p + 2]) || 
-            (pattern[p] == '\\' && pattern[p + 1]))
+        ASTNode *result = eval_persistent_result(node);
+        print_node(result);
+        ast_free(result);
+        break;
+    }
+    case NODE_PVEC_SIZE:
+    case NODE_PMAP_SIZE:
+    case NODE_HEAP_PUSH:
+    case NODE_HEAP_SIZE:
+    case NODE_HEAP_UPDATE:
+    case NODE_HEAP_KEY:
+    case NODE_HEAP_COMPARE:
+        printf("%g\n", eval_expression(node));
+        break;
+    case NODE_HEAP:
+    {
+        ASTNode *contents = heap_to_list(node);
+        print_node(contents);
+        ast_free(contents);
+        break;
+    }
+    case NODE_HEAPIFY:
+    {
+        ASTNode *heap = build_heap(node);
+        print_node(heap);
+        ast_free(heap);
+        break;
+    }
+    case NODE_FUNC_CALL:
+    {
+        ASTNode *package_result = call_package(node);
+        if (!package_result)
+        {
+            printf("%g\n", eval_expression(node));
+            break;
+        }
+        print_node(package_result);
+        ast_free(package_result);
+        break;
+    }
+    case NODE_STRING_INTERPOLATION:
+    {
+        eval_expression(node);
+        const char *result = get_variable("__string_interp_result");
+        if (result) {
+            printf("%s\n", result);
+        }
+        break;
+    }
+    default:
+    {
+        double result = eval_expression(node);
+        // Handle ternary operator specially for printing
+        if (node->type == NODE_TERNARY)
         {
-            char next;
-            int base_skip;
-            if (pattern[p + 1] == '\\' && pattern[p + 2])
+            double condition = eval_expression(node->ternary.condition);
+            ASTNode *result_expr = (condition != 0) ? node->ternary.true_expr : node->ternary.false_expr;
+            
+            if (result_expr->type == NODE_STRING)
             {
-                next = pattern[p + 2];
-                base_skip = 3;
+                printf("%s\n", result_expr->string);
             }
             else
             {
-                next = pattern[p + 1];
-                base_skip = 2;
-            }
-            if (next == 'd')
-            {
-                if (pattern[p + base_skip] == '+')
-                {
-                    if (!text[t] || !isdigit(text[t])) return 0;
-                    while (text[t] && isdigit(text[t])) t++;
-                    p += base_skip + 1;
-                }
-                else if (pattern[p + base_skip] == '*')
+                double expr_result = eval_expression(result_expr);
+                
+                // Check if this is a boolean context (ternary with true/false literals)
+                int is_boolean_context = 0;
+                if ((node->ternary.true_expr->type == NODE_NUMBER && 
+                     (node->ternary.true_expr->number == 1.0 || node->ternary.true_expr->number == 0.0)) ||
+                    (node->ternary.false_expr->type == NODE_NUMBER && 
+                     (node->ternary.false_expr->number == 1.0 || node->ternary.false_expr->number == 0.0)))
                 {
-                    while (text[t] && isdigit(text[t])) t++;
-                    p += base_skip + 1;
+                    is_boolean_context = 1;
                 }
-                else if (pattern[p + base_skip] == '{')
+                
+                // Also check if the condition is a boolean operation
+                if ((node->ternary.condition->type == NODE_BINOP &&
+                     (node->ternary.condition->binop.op == TOK_EQ || node->ternary.condition->binop.op == TOK_NEQ ||
+                      node->ternary.condition->binop.op == TOK_LT || node->ternary.condition->binop.op == TOK_GT ||
+                      node->ternary.condition->binop.op == TOK_LTE || node->ternary.condition->binop.op == TOK_GTE)) ||
+                    node->ternary.condition->type == NODE_AND || node->ternary.condition->type == NODE_OR || node->ternary.condition->type == NODE_NOT)
                 {
-                    int brace_end = p + base_skip + 1;
-                    while (pattern[brace_end] && pattern[brace_end] != '}') brace_end++;
-                    if (!pattern[brace_end]) return 0;
-                    
-                    int count = 0;
-                    for (int i = p + base_skip + 1; i < brace_end; i++)
-                    {
-                        if (isdigit(pattern[i]))
-                            count = count * 10 + (pattern[i] - '0');
-                        else
-                            break;
-                    }
-                    
-                    for (int i = 0; i < count; i++)
-                    {
-                        if (!text[t] || !isdigit(text[t])) return 0;
-                        t++;
-                    }
-                    p = brace_end + 1;
+                    is_boolean_context = 1;
                 }
-                else
+                
+                // Check if the result expression itself is a boolean operation
+                if ((result_expr->type == NODE_BINOP &&
+                     (result_expr->binop.op == TOK_EQ || result_expr->binop.op == TOK_NEQ ||
+                      result_expr->binop.op == TOK_LT || result_expr->binop.op == TOK_GT ||
+                      result_expr->binop.op == TOK_LTE || result_expr->binop.op == TOK_GTE)) ||
+                    result_expr->type == NODE_AND || result_expr->type == NODE_OR || result_expr->type == NODE_NOT)
                 {
-                    if (!text[t] || !isdigit(text[t])) return 0;
-                    t++;
-                    p += base_skip;
+                    is_boolean_context = 1;
                 }
-            }
-            else if (next == 'w')
-            {
-                if (pattern[p + base_skip] == '+')
+                
+                if (is_boolean_context && (expr_result == 1.0 || expr_result == 0.0))
                 {
-                    if (!text[t] || (!isalnum(text[t]) && text[t] != '_')) return 0;
-                    while (text[t] && (isalnum(text[t]) || text[t] == '_')) t++;
-                    p += base_skip + 1;
+                    printf("%s\n", bool_to_str((bool)expr_result));
                 }
                 else
                 {
-                    if (!text[t] || (!isalnum(text[t]) && text[t] != '_')) return 0;
-                    t++;
-                    p += base_skip;
+                    printf("%g\n", expr_result);
                 }
             }
-            else
-            {
-                if (!text[t] || !regex_match_char(next, text[t], case_insensitive)) return 0;
-                p += base_skip;
-                t++;
-            }
         }
-        else if (pattern[p] == '[')
+        // Check if this is a boolean result (0 or 1 from boolean operations)
+        else if ((result == 0.0 || result == 1.0) && 
+            (node->type == NODE_AND || node->type == NODE_OR || node->type == NODE_NOT ||
+             node->type == NODE_TEMPORAL_CONDITION ||
+             (node->type == NODE_BINOP && 
+              (node->binop.op == TOK_EQ || node->binop.op == TOK_NEQ ||
+               node->binop.op == TOK_LT || node->binop.op == TOK_GT ||
+               node->binop.op == TOK_LTE || node->binop.op == TOK_GTE))))
         {
-            int class_end = p + 1;
-            while (pattern[class_end] && pattern[class_end] != ']') class_end++;
-            if (!pattern[class_end]) return 0;
-            
-            if (pattern[class_end + 1] == '+')
-            {
-                // Character class with +
-                int matched = 0;
-                while (text[t])
-                {
-                    int class_match = 0;
-                    for (int i = p + 1; i < class_end; i++)
-                    {
-                        if (i + 2 < class_end && pattern[i + 1] == '-')
-                        {
-                            if (text[t] >= pattern[i] && text[t] <= pattern[i + 2])
-                            {
-                                class_match = 1;
-                                break;
-                            }
-                            i += 2;
-                        }
-                        else
-                        {
-                            if (regex_match_char(pattern[i], text[t], case_insensitive))
-                            {
-                                class_match = 1;
-                                break;
-                            }
-                        }
-                    }
-                    if (!class_match) break;
-                    t++;
-                    matched = 1;
-                }
-                if (!matched) return 0;
-                p = class_end + 2;
-            }
-            else
-            {
-                // Single character class match
-                if (!text[t]) return 0;
-                t++;
-                p = class_end + 1;
-            }
+            printf("%s\n", bool_to_str((bool)result));
         }
         else
         {
-            // Handle quantifiers for literal characters
-            if (pattern[p + 1] == '+')
-            {
-                if (!text[t] || !regex_match_char(pattern[p], text[t], case_insensitive)) return 0;
-                while (text[t] && regex_match_char(pattern[p], text[t], case_insensitive)) t++;
-                p += 2;
-            }
-            else if (pattern[p + 1] == '*')
-            {
-                while (text[t] && regex_match_char(pattern[p], text[t], case_insensitive)) t++;
-                p += 2;
-            }
-            else if (pattern[p + 1] == '?')
-            {
-                if (text[t] && regex_match_char(pattern[p], text[t], case_insensitive)) t++;
-                p += 2;
-            }
-            else if (pattern[p + 1] == '{')
-            {
-                int brace_end = p + 2;
-                while (pattern[brace_end] && pattern[brace_end] != '}') brace_end++;
-                if (!pattern[brace_end]) return 0;
-                
-                int count = 0;
-                for (int i = p + 2; i < brace_end; i++)
-                {
-                    if (isdigit(pattern[i]))
-                        count = count * 10 + (pattern[i] - '0');
-                    else
-                        break;
-                }
-                
-                for (int i = 0; i < count; i++)
-                {
-                    if (!text[t] || !regex_match_char(pattern[p], text[t], case_insensitive)) return 0;
-                    t++;
-                }
-                p = brace_end + 1;
-            }
-            else
-            {
-                if (!text[t] || !regex_match_char(pattern[p], text[t], case_insensitive)) return 0;
-                p++;
-                t++;
-            }
+            printf("%g\n", result);
         }
+        break;
     }
-    
-    return t; // Return length of match
+    }
+}
+
+// Helper function to convert boolean to string
+const char *bool_to_str(bool value)
+{
+    return value ? "true" : "false";
 }
 
-static void regex_find_all_matches(const char *pattern, const char *text, const char *flags, ASTNode *result_list)
+// The regex an operation applies to: a literal, or a variable holding one
+static ASTNode *regex_operand(ASTNode *regex_node, const char *operation)
 {
-    int case_insensitive = (strchr(flags, 'i') != NULL);
-    int text_len = strlen(text);
-    
-    for (int i = 0; i < text_len; i++)
+    if (regex_node->type == NODE_VAR)
     {
-        if (regex_match_at_position(pattern, text + i, case_insensitive))
-        {
-            ast_list_add_element(result_list, ast_new_number(i));
-            
-            // Calculate match length to skip ahead properly
-            int match_len = regex_get_match_length(pattern, text + i, case_insensitive);
-            if (match_len > 1)
-            {
-                i += match_len - 1; // -1 because loop will increment
-            }
-        }
+        regex_node = get_regex_variable(regex_node->varname);
+    }
+
+    if (!regex_node || regex_node->type != NODE_REGEX)
+    {
+        printf("Runtime error: Invalid regex in %s operation\n", operation);
+        exit(1);
     }
+    return regex_node;
 }
 
-static char *regex_replace_pattern(const char *pattern, const char *text, const char *replacement, const char *flags)
+// Compiles a regex literal the first time it is used; the program stays on the
+// node, so a regex in a loop or a variable is compiled once
+static RegexProgram *regex_program(ASTNode *regex_node)
 {
-    int case_insensitive = (strchr(flags, 'i') != NULL);
-    int global_flag = (strchr(flags, 'g') != NULL);
-    int text_len = strlen(text);
-    int replacement_len = strlen(replacement);
-    
-    // Allocate generous buffer for result
-    char *result = malloc(text_len * 3 + 1);
-    int result_pos = 0;
-    int text_pos = 0;
-    
-    while (text_pos < text_len)
+    if (!regex_node->regex.program)
     {
-        if (regex_match_at_position(pattern, text + text_pos, case_insensitive))
+        char error[128];
+        int flags = (strchr(regex_node->regex.flags, 'i') ? REGEX_CASE_INSENSITIVE : 0) |
+                    (strchr(regex_node->regex.flags, 'm') ? REGEX_MULTILINE : 0);
+        regex_node->regex.program = regex_compile(regex_node->regex.pattern, flags, error, sizeof(error));
+        if (!regex_node->regex.program)
         {
-            // Found a match, add replacement
-            strcpy(result + result_pos, replacement);
-            result_pos += replacement_len;
-            
-            // Skip the matched portion
-            int match_len = regex_get_match_length(pattern, text + text_pos, case_insensitive);
-            if (match_len <= 0) match_len = 1; // Ensure we advance at least 1 character
-            text_pos += match_len;
-            
-            if (!global_flag) break;
-        }
-        else
-        {
-            // No match, copy character as-is
-            result[result_pos++] = text[text_pos++];
+            printf("Runtime error: Invalid regex '%s': %s\n", regex_node->regex.pattern, error);
+            exit(1);
         }
     }
-    
-    // Copy remaining text if we stopped early (non-global replace)
-    if (text_pos < text_len)
+    return regex_node->regex.program;
+}
+
+// One match as a flat list of offsets into the text: where the match starts and
+// ends, then where each group does, with UNDEF for a group that took no part
+static ASTNode *regex_match_list(RegexProgram *program, const size_t *spans)
+{
+    ASTNode *match = ast_new_list();
+    match->list.elements = malloc(sizeof(ASTNode *) * program->slots);
+    for (int i = 0; i < program->slots; i++)
+        match->list.elements[i] = spans[i] == REGEX_NONE ? ast_new_undef() : ast_new_number((double)spans[i]);
+    match->list.count = program->slots;
+    return match;
+}
+
+static void regex_collect(RegexProgram *program, const size_t *spans, ASTNode *result_list, int *capacity)
+{
+    if (result_list->list.count == *capacity)
     {
-        strcpy(result + result_pos, text + text_pos);
-        result_pos += text_len - text_pos;
+        *capacity = *capacity ? *capacity * 2 : 16;
+        result_list->list.elements = realloc(result_list->list.elements, sizeof(ASTNode *) * *capacity);
     }
-    
+    result_list->list.elements[result_list->list.count++] = regex_match_list(program, spans);
+}
+
+static void regex_find_all_matches(RegexProgram *program, const char *text, ASTNode *result_list)
+{
+    size_t *spans = malloc(sizeof(size_t) * program->slots);
+    int capacity = 0;
+    RegexIterator iter;
+    regex_iter_init(&iter, program, text, strlen(text));
+    while (regex_iter_next(&iter, spans))
+        regex_collect(program, spans, result_list, &capacity);
+    free(spans);
+}
+
+static char *regex_replace_pattern(RegexProgram *program, const char *text, const char *replacement, int global)
+{
+    size_t text_len = strlen(text);
+    size_t replacement_len = strlen(replacement);
+    size_t capacity = text_len + replacement_len + 1;
+    char *result = malloc(capacity);
+    size_t result_pos = 0;
+    size_t copied = 0; // Text up to here is in the result
+    size_t *spans = malloc(sizeof(size_t) * program->slots);
+    RegexIterator iter;
+    regex_iter_init(&iter, program, text, text_len);
+
+    while (regex_iter_next(&iter, spans))
+    {
+        size_t needed = result_pos + (spans[0] - copied) + replacement_len + (text_len - spans[1]) + 1;
+        if (needed > capacity)
+        {
+            capacity = needed * 2;
+            result = realloc(result, capacity);
+        }
+        memcpy(result + result_pos, text + copied, spans[0] - copied);
+        result_pos += spans[0] - copied;
+        memcpy(result + result_pos, replacement, replacement_len);
+        result_pos += replacement_len;
+        copied = spans[1];
+        if (!global)
+            break;
+    }
+
+    // Copy the rest of the text after the last match
+    memcpy(result + result_pos, text + copied, text_len - copied);
+    result_pos += text_len - copied;
     result[result_pos] = '\0';
+    free(spans);
     return result;
 }
 
+// Matches of a regex over a text: all of them, or the first from an offset on
+static ASTNode *eval_regex_matches(ASTNode *node)
+{
+    int find_all = node->type == NODE_REGEX_FIND_ALL;
+    ASTNode *regex_node = regex_operand(find_all ? node->regex_find_all.regex : node->regex_next.regex,
+                                        find_all ? "find_all" : "next");
+    char *text_str = get_string_value(find_all ? node->regex_find_all.text : node->regex_next.text);
+    if (!text_str)
+    {
+        printf("Runtime error: Invalid text in regex %s\n", find_all ? "find_all" : "next");
+        exit(1);
+    }
+
+    RegexProgram *program = regex_program(regex_node);
+    ASTNode *result_list = ast_new_list();
+    if (find_all)
+    {
+        regex_find_all_matches(program, text_str, result_list);
+    }
+    else
+    {
+        double from = eval_expression(node->regex_next.from);
+        size_t text_len = strlen(text_str);
+        size_t *spans = malloc(sizeof(size_t) * program->slots);
+        if (from < 0)
+        {
+            printf("Runtime error: Regex next offset must not be negative\n");
+            exit(1);
+        }
+        if (from <= text_len && regex_search(program, text_str, text_len, (size_t)from, spans))
+        {
+            ast_free(result_list);
+            result_list = regex_match_list(program, spans);
+        }
+        free(spans);
+    }
+    free(text_str);
+    return result_list;
+}
+
 // Modify your print function (if you have one)
 void interpret_print(ASTNode *node)
 {
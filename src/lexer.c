@@ -426,6 +426,20 @@ Token lexer_next_token()
         pos += 8;
         return token;
     }
+    if (starts_with("::slice"))
+    {
+        token.type = TOK_LIST_SLICE;
+        strcpy(token.text, "::slice");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::pattern_match_any"))
+    {
+        token.type = TOK_PATTERN_MATCH_ANY;
+        strcpy(token.text, "::pattern_match_any");
+        pos += 19;
+        return token;
+    }
     if (starts_with("::pattern_match"))
     {
         token.type = TOK_PATTERN_MATCH;
@@ -491,10 +505,15 @@ Token lexer_next_token()
     }
     if (starts_with("<temp@"))
     {
-        // Parse <temp@N>
+        // Parse <temp@N> or <temp@N+M>
         int start_pos = pos;
         pos += 6; // Skip "<temp@"
         while (isdigit(input[pos])) pos++; // Skip digits
+        if (input[pos] == '+' && isdigit(input[pos + 1]))
+        {
+            pos++; // Skip '+'
+            while (isdigit(input[pos])) pos++; // Skip archive size
+        }
         if (input[pos] == '>')
         {
             pos++; // Skip '>'
@@ -545,6 +564,76 @@ Token lexer_next_token()
         pos += 10;
         return token;
     }
+    if (starts_with("::lpush_front"))
+    {
+        token.type = TOK_LINKED_LIST_PUSH_FRONT;
+        strcpy(token.text, "::lpush_front");
+        pos += 13;
+        return token;
+    }
+    if (starts_with("::lpush_back"))
+    {
+        token.type = TOK_LINKED_LIST_PUSH_BACK;
+        strcpy(token.text, "::lpush_back");
+        pos += 12;
+        return token;
+    }
+    if (starts_with("::lpop_front"))
+    {
+        token.type = TOK_LINKED_LIST_POP_FRONT;
+        strcpy(token.text, "::lpop_front");
+        pos += 12;
+        return token;
+    }
+    if (starts_with("::lpop_back"))
+    {
+        token.type = TOK_LINKED_LIST_POP_BACK;
+        strcpy(token.text, "::lpop_back");
+        pos += 11;
+        return token;
+    }
+    if (starts_with("::lcursor"))
+    {
+        token.type = TOK_LINKED_LIST_CURSOR;
+        strcpy(token.text, "::lcursor");
+        pos += 9;
+        return token;
+    }
+    if (starts_with("::lnext"))
+    {
+        token.type = TOK_LINKED_LIST_NEXT;
+        strcpy(token.text, "::lnext");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::lcurrent"))
+    {
+        token.type = TOK_LINKED_LIST_CURRENT;
+        strcpy(token.text, "::lcurrent");
+        pos += 10;
+        return token;
+    }
+    if (starts_with("::linsert"))
+    {
+        token.type = TOK_LINKED_LIST_INSERT;
+        strcpy(token.text, "::linsert");
+        pos += 9;
+        return token;
+    }
+    if (starts_with("::lerase"))
+    {
+        token.type = TOK_LINKED_LIST_ERASE;
+        strcpy(token.text, "::lerase");
+        pos += 8;
+        return token;
+    }
+    if (starts_with("::lsplice"))
+    {
+        token.type = TOK_LINKED_LIST_SPLICE;
+        strcpy(token.text, "::lsplice");
+        pos += 9;
+        return token;
+    }
     if (starts_with("::fopen"))
     {
         token.type = TOK_FILE_OPEN;
@@ -699,6 +788,20 @@ Token lexer_next_token()
         pos += 11;
         return token;
     }
+    if (starts_with("::rnext"))
+    {
+        token.type = TOK_REGEX_NEXT;
+        strcpy(token.text, "::rnext");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::rgroup"))
+    {
+        token.type = TOK_REGEX_GROUP;
+        strcpy(token.text, "::rgroup");
+        pos += 8;
+        return token;
+    }
     if (starts_with("::temporal_aggregate"))
     {
         token.type = TOK_TEMPORAL_AGGREGATE;
@@ -741,6 +844,13 @@ Token lexer_next_token()
         pos += 16;
         return token;
     }
+    if (starts_with("::temporal_correlate_matrix"))
+    {
+        token.type = TOK_TEMPORAL_CORRELATE_MATRIX;
+        strcpy(token.text, "::temporal_correlate_matrix");
+        pos += 27;
+        return token;
+    }
     if (starts_with("::temporal_correlate"))
     {
         token.type = TOK_TEMPORAL_CORRELATE;
@@ -755,6 +865,55 @@ Token lexer_next_token()
         pos += 22;
         return token;
     }
+    if (starts_with("::temporal_downsample"))
+    {
+        token.type = TOK_TEMPORAL_DOWNSAMPLE;
+        strcpy(token.text, "::temporal_downsample");
+        pos += 21;
+        return token;
+    }
+    if (starts_with("::temporal_xcorr"))
+    {
+        token.type = TOK_TEMPORAL_XCORR;
+        strcpy(token.text, "::temporal_xcorr");
+        pos += 16;
+        return token;
+    }
+    if (starts_with("::temporal_persist"))
+    {
+        token.type = TOK_TEMPORAL_PERSIST;
+        strcpy(token.text, "::temporal_persist");
+        pos += 18;
+        return token;
+    }
+    if (starts_with("::temporal_fill"))
+    {
+        token.type = TOK_TEMPORAL_FILL;
+        strcpy(token.text, "::temporal_fill");
+        pos += 15;
+        return token;
+    }
+    if (starts_with("::temporal_resample"))
+    {
+        token.type = TOK_TEMPORAL_RESAMPLE;
+        strcpy(token.text, "::temporal_resample");
+        pos += 19;
+        return token;
+    }
+    if (starts_with("::temporal_trigger"))
+    {
+        token.type = TOK_TEMPORAL_TRIGGER;
+        strcpy(token.text, "::temporal_trigger");
+        pos += 18;
+        return token;
+    }
+    if (starts_with("::temporal_untrigger"))
+    {
+        token.type = TOK_TEMPORAL_UNTRIGGER;
+        strcpy(token.text, "::temporal_untrigger");
+        pos += 20;
+        return token;
+    }
     if (starts_with("temporal$"))
     {
         token.type = TOK_TEMPORAL;
@@ -839,6 +998,153 @@ Token lexer_next_token()
         pos += 7;
         return token;
     }
+    if (starts_with("<pvec>"))
+    {
+        token.type = TOK_PVEC_NEW;
+        strcpy(token.text, "<pvec>");
+        pos += 6;
+        return token;
+    }
+    if (starts_with("<pmap>"))
+    {
+        token.type = TOK_PMAP_NEW;
+        strcpy(token.text, "<pmap>");
+        pos += 6;
+        return token;
+    }
+    if (starts_with("::pvpush"))
+    {
+        token.type = TOK_PVEC_PUSH;
+        strcpy(token.text, "::pvpush");
+        pos += 8;
+        return token;
+    }
+    if (starts_with("::pvset"))
+    {
+        token.type = TOK_PVEC_SET;
+        strcpy(token.text, "::pvset");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::pvpop"))
+    {
+        token.type = TOK_PVEC_POP;
+        strcpy(token.text, "::pvpop");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::pvget"))
+    {
+        token.type = TOK_PVEC_GET;
+        strcpy(token.text, "::pvget");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::pvsize"))
+    {
+        token.type = TOK_PVEC_SIZE;
+        strcpy(token.text, "::pvsize");
+        pos += 8;
+        return token;
+    }
+    if (starts_with("::pmput"))
+    {
+        token.type = TOK_PMAP_PUT;
+        strcpy(token.text, "::pmput");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::pmremove"))
+    {
+        token.type = TOK_PMAP_REMOVE;
+        strcpy(token.text, "::pmremove");
+        pos += 10;
+        return token;
+    }
+    if (starts_with("::pmget"))
+    {
+        token.type = TOK_PMAP_GET;
+        strcpy(token.text, "::pmget");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::pmhas"))
+    {
+        token.type = TOK_PMAP_HAS;
+        strcpy(token.text, "::pmhas");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::pmsize"))
+    {
+        token.type = TOK_PMAP_SIZE;
+        strcpy(token.text, "::pmsize");
+        pos += 8;
+        return token;
+    }
+    if (starts_with("<heap>"))
+    {
+        token.type = TOK_HEAP_NEW;
+        strcpy(token.text, "<heap>");
+        pos += 6;
+        return token;
+    }
+    if (starts_with("::hpush"))
+    {
+        token.type = TOK_HEAP_PUSH;
+        strcpy(token.text, "::hpush");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::hpop"))
+    {
+        token.type = TOK_HEAP_POP;
+        strcpy(token.text, "::hpop");
+        pos += 6;
+        return token;
+    }
+    if (starts_with("::hpeek"))
+    {
+        token.type = TOK_HEAP_PEEK;
+        strcpy(token.text, "::hpeek");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::hsize"))
+    {
+        token.type = TOK_HEAP_SIZE;
+        strcpy(token.text, "::hsize");
+        pos += 7;
+        return token;
+    }
+    if (starts_with("::hupdate"))
+    {
+        token.type = TOK_HEAP_UPDATE;
+        strcpy(token.text, "::hupdate");
+        pos += 9;
+        return token;
+    }
+    if (starts_with("::hkey"))
+    {
+        token.type = TOK_HEAP_KEY;
+        strcpy(token.text, "::hkey");
+        pos += 6;
+        return token;
+    }
+    if (starts_with("::hcompare"))
+    {
+        token.type = TOK_HEAP_COMPARE;
+        strcpy(token.text, "::hcompare");
+        pos += 10;
+        return token;
+    }
+    if (starts_with("::heapify"))
+    {
+        token.type = TOK_HEAPIFY;
+        strcpy(token.text, "::heapify");
+        pos += 9;
+        return token;
+    }
     if (starts_with("::tinsert"))
     {
         token.type = TOK_TREE_INSERT;
@@ -881,6 +1187,27 @@ Token lexer_next_token()
         pos += 12;
         return token;
     }
+    if (starts_with("::trange"))
+    {
+        token.type = TOK_TREE_RANGE;
+        strcpy(token.text, "::trange");
+        pos += 8;
+        return token;
+    }
+    if (starts_with("::tfloor"))
+    {
+        token.type = TOK_TREE_FLOOR;
+        strcpy(token.text, "::tfloor");
+        pos += 8;
+        return token;
+    }
+    if (starts_with("::tceil"))
+    {
+        token.type = TOK_TREE_CEIL;
+        strcpy(token.text, "::tceil");
+        pos += 7;
+        return token;
+    }
     if (starts_with("::gadd_vertex"))
     {
         token.type = TOK_GRAPH_ADD_VERTEX;
@@ -1305,7 +1632,9 @@ Token lexer_next_token()
         if (input[pos] == '"')
             pos++;
         
-        // Check if this is followed by //flags (regex pattern)
+        // Check if this is followed by //flags (regex pattern); a string without
+        // them must not keep the flags of an earlier one
+        token.string_value[0] = '\0';
         if (input[pos] == '/' && input[pos + 1] == '/')
         {
             pos += 2; // Skip //
@@ -1,7 +1,7 @@
 #include "tesseract_pch.h"
 #include "error.h"
 
-#define MAX_INPUT 1024
+#define MAX_INPUT_LINE 1024
 
 // Global debug flag
 int debug_mode = 0;
@@ -12,8 +12,8 @@ void run_repl()
            debug_mode ? " [DEBUG]" : "");
     fflush(stdout);
 
-    char input[MAX_INPUT];
-    while (fgets(input, MAX_INPUT, stdin))
+    char input[MAX_INPUT_LINE];
+    while (fgets(input, MAX_INPUT_LINE, stdin))
     {
         // Remove newline
         input[strcspn(input, "\n")] = '\0';
@@ -0,0 +1,509 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ndarray.h"
+#include "simd.h"
+
+// Matrix product tile sizes: a ROWS x DEPTH tile of A is swept across a DEPTH x COLS
+// tile of B, which (256 KB of doubles) stays in L2 while it is reused for every row
+#define MATMUL_BLOCK_ROWS 64
+#define MATMUL_BLOCK_DEPTH 128
+#define MATMUL_BLOCK_COLS 256
+
+// --- Construction ---
+
+static void contiguous_strides(int ndim, const int *shape, long *strides)
+{
+    long step = 1;
+    for (int d = ndim - 1; d >= 0; d--)
+    {
+        strides[d] = step;
+        step *= shape[d];
+    }
+}
+
+static long shape_size(int ndim, const int *shape)
+{
+    long size = 1;
+    for (int d = 0; d < ndim; d++)
+        size *= shape[d];
+    return size;
+}
+
+static ASTNode *ndarray_wrap(NDBuffer *buffer, int ndim, const int *shape, const long *strides, long offset)
+{
+    ASTNode *array = malloc(sizeof(ASTNode));
+    array->type = NODE_NDARRAY;
+    array->ndarray.buffer = buffer;
+    array->ndarray.ndim = ndim;
+    for (int d = 0; d < ndim; d++)
+    {
+        array->ndarray.shape[d] = shape[d];
+        array->ndarray.strides[d] = strides[d];
+    }
+    array->ndarray.offset = offset;
+    return array;
+}
+
+ASTNode *ndarray_new(int ndim, const int *shape)
+{
+    long size = shape_size(ndim, shape);
+    NDBuffer *buffer = calloc(1, sizeof(NDBuffer) + sizeof(double) * size);
+    buffer->refs = 1;
+    buffer->size = size;
+    long strides[NDARRAY_MAX_DIMS];
+    contiguous_strides(ndim, shape, strides);
+    return ndarray_wrap(buffer, ndim, shape, strides, 0);
+}
+
+ASTNode *ndarray_scalar(double value)
+{
+    ASTNode *array = ndarray_new(0, NULL);
+    array->ndarray.buffer->data[0] = value;
+    return array;
+}
+
+// Copies a nested list into out, checking that it matches shape at every level
+static int fill_from_list(ASTNode *node, const int *shape, int ndim, double **out)
+{
+    if (ndim == 0)
+    {
+        if (node->type != NODE_NUMBER)
+            return 0;
+        *(*out)++ = node->number;
+        return 1;
+    }
+    if (node->type != NODE_LIST || node->list.count != shape[0])
+        return 0;
+    for (int i = 0; i < node->list.count; i++)
+        if (!fill_from_list(ast_list_access(node, i), shape + 1, ndim - 1, out))
+            return 0;
+    return 1;
+}
+
+ASTNode *ndarray_from_list(ASTNode *list)
+{
+    // The first element at each depth gives the shape; fill_from_list checks the rest
+    int shape[NDARRAY_MAX_DIMS] = {0};
+    int ndim = 0;
+    ASTNode *level = list;
+    while (level->type == NODE_LIST)
+    {
+        if (ndim == NDARRAY_MAX_DIMS)
+            return NULL;
+        shape[ndim++] = level->list.count;
+        if (level->list.count == 0)
+            break;
+        level = ast_list_access(level, 0);
+    }
+    ASTNode *array = ndarray_new(ndim, shape);
+    double *out = array->ndarray.buffer->data;
+    if (!fill_from_list(list, shape, ndim, &out))
+    {
+        ast_free(array);
+        return NULL;
+    }
+    return array;
+}
+
+static ASTNode *to_list_dim(const double *data, const int *shape, const long *strides, int ndim)
+{
+    if (ndim == 0)
+        return ast_new_number(*data);
+    ASTNode *list = ast_new_list();
+    if (shape[0] > 0)
+        list->list.elements = malloc(sizeof(ASTNode *) * shape[0]);
+    for (int i = 0; i < shape[0]; i++)
+        list->list.elements[i] = to_list_dim(data + i * strides[0], shape + 1, strides + 1, ndim - 1);
+    list->list.count = shape[0];
+    return list;
+}
+
+ASTNode *ndarray_to_list(ASTNode *array)
+{
+    return to_list_dim(ndarray_data(array), array->ndarray.shape, array->ndarray.strides, array->ndarray.ndim);
+}
+
+// --- Access ---
+
+long ndarray_size(ASTNode *array)
+{
+    return shape_size(array->ndarray.ndim, array->ndarray.shape);
+}
+
+int ndarray_is_contiguous(ASTNode *array)
+{
+    long step = 1;
+    for (int d = array->ndarray.ndim - 1; d >= 0; d--)
+    {
+        // A length-1 axis is never stepped along, so its stride does not matter
+        if (array->ndarray.shape[d] != 1 && array->ndarray.strides[d] != step)
+            return 0;
+        step *= array->ndarray.shape[d];
+    }
+    return 1;
+}
+
+double *ndarray_data(ASTNode *array)
+{
+    return array->ndarray.buffer->data + array->ndarray.offset;
+}
+
+double ndarray_get(ASTNode *array, const int *index)
+{
+    long position = 0;
+    for (int d = 0; d < array->ndarray.ndim; d++)
+        position += index[d] * array->ndarray.strides[d];
+    return ndarray_data(array)[position];
+}
+
+// --- Views and copies ---
+
+ASTNode *ndarray_share(ASTNode *array)
+{
+    array->ndarray.buffer->refs++;
+    return ndarray_wrap(array->ndarray.buffer, array->ndarray.ndim, array->ndarray.shape,
+                        array->ndarray.strides, array->ndarray.offset);
+}
+
+// Writes the elements of a strided view to out in row-major order
+static void gather_dim(const double *data, const int *shape, const long *strides, int ndim, double **out)
+{
+    if (ndim == 0)
+    {
+        *(*out)++ = *data;
+        return;
+    }
+    if (ndim == 1)
+    {
+        for (int i = 0; i < shape[0]; i++)
+            *(*out)++ = data[i * strides[0]];
+        return;
+    }
+    for (int i = 0; i < shape[0]; i++)
+        gather_dim(data + i * strides[0], shape + 1, strides + 1, ndim - 1, out);
+}
+
+ASTNode *ndarray_copy(ASTNode *array)
+{
+    ASTNode *copy = ndarray_new(array->ndarray.ndim, array->ndarray.shape);
+    if (ndarray_is_contiguous(array))
+    {
+        memcpy(copy->ndarray.buffer->data, ndarray_data(array), sizeof(double) * ndarray_size(array));
+        return copy;
+    }
+    double *out = copy->ndarray.buffer->data;
+    gather_dim(ndarray_data(array), array->ndarray.shape, array->ndarray.strides, array->ndarray.ndim, &out);
+    return copy;
+}
+
+// The array itself when contiguous, else a contiguous copy the caller must free
+static ASTNode *contiguous(ASTNode *array)
+{
+    return ndarray_is_contiguous(array) ? array : ndarray_copy(array);
+}
+
+ASTNode *ndarray_reshape(ASTNode *array, int ndim, const int *shape)
+{
+    if (shape_size(ndim, shape) != ndarray_size(array))
+        return NULL;
+    ASTNode *source = contiguous(array);
+    long strides[NDARRAY_MAX_DIMS];
+    contiguous_strides(ndim, shape, strides);
+    ASTNode *result = ndarray_share(source);
+    for (int d = 0; d < ndim; d++)
+    {
+        result->ndarray.shape[d] = shape[d];
+        result->ndarray.strides[d] = strides[d];
+    }
+    result->ndarray.ndim = ndim;
+    if (source != array)
+        ast_free(source);
+    return result;
+}
+
+ASTNode *ndarray_transpose(ASTNode *array)
+{
+    ASTNode *result = ndarray_share(array);
+    int ndim = array->ndarray.ndim;
+    for (int d = 0; d < ndim; d++)
+    {
+        result->ndarray.shape[d] = array->ndarray.shape[ndim - 1 - d];
+        result->ndarray.strides[d] = array->ndarray.strides[ndim - 1 - d];
+    }
+    return result;
+}
+
+ASTNode *ndarray_index(ASTNode *array, int index)
+{
+    ASTNode *result = ndarray_share(array);
+    result->ndarray.ndim--;
+    for (int d = 0; d < result->ndarray.ndim; d++)
+    {
+        result->ndarray.shape[d] = array->ndarray.shape[d + 1];
+        result->ndarray.strides[d] = array->ndarray.strides[d + 1];
+    }
+    result->ndarray.offset += index * array->ndarray.strides[0];
+    return result;
+}
+
+// --- Elementwise operations ---
+
+ASTNode *ndarray_map(ASTNode *array, double (*fn)(double))
+{
+    ASTNode *result = ndarray_copy(array);
+    double *data = result->ndarray.buffer->data;
+    long size = ndarray_size(result);
+    for (long i = 0; i < size; i++)
+        data[i] = fn(data[i]);
+    return result;
+}
+
+#define ND_ADD_OP(x, y) ((x) + (y))
+#define ND_SUB_OP(x, y) ((x) - (y))
+#define ND_MUL_OP(x, y) ((x) * (y))
+#define ND_DIV_OP(x, y) ((x) / (y))
+#define ND_POW_OP(x, y) pow((x), (y))
+
+// Unit-stride and scalar operands get their own loops so the compiler can vectorize them
+#define ND_ROW_LOOP(OP)                                       \
+    if (sa == 1 && sb == 1)                                   \
+        for (int i = 0; i < count; i++)                       \
+            out[i] = OP(a[i], b[i]);                          \
+    else if (sa == 1 && sb == 0)                              \
+        for (int i = 0; i < count; i++)                       \
+            out[i] = OP(a[i], b[0]);                          \
+    else if (sa == 0 && sb == 1)                              \
+        for (int i = 0; i < count; i++)                       \
+            out[i] = OP(a[0], b[i]);                          \
+    else                                                      \
+        for (int i = 0; i < count; i++)                       \
+            out[i] = OP(a[i * sa], b[i * sb]);                \
+    break;
+
+static void binary_row(NDBinaryOp op, const double *a, long sa, const double *b, long sb, double *out, int count)
+{
+    switch (op)
+    {
+    case ND_ADD:
+        ND_ROW_LOOP(ND_ADD_OP)
+    case ND_SUB:
+        ND_ROW_LOOP(ND_SUB_OP)
+    case ND_MUL:
+        ND_ROW_LOOP(ND_MUL_OP)
+    case ND_DIV:
+        ND_ROW_LOOP(ND_DIV_OP)
+    case ND_POW:
+        ND_ROW_LOOP(ND_POW_OP)
+    }
+}
+
+static void binary_dim(NDBinaryOp op, const double *a, const long *sa, const double *b, const long *sb,
+                       const int *shape, int ndim, double **out)
+{
+    if (ndim == 0)
+    {
+        binary_row(op, a, 0, b, 0, *out, 1);
+        (*out)++;
+        return;
+    }
+    if (ndim == 1)
+    {
+        binary_row(op, a, sa[0], b, sb[0], *out, shape[0]);
+        *out += shape[0];
+        return;
+    }
+    for (int i = 0; i < shape[0]; i++)
+        binary_dim(op, a + i * sa[0], sa + 1, b + i * sb[0], sb + 1, shape + 1, ndim - 1, out);
+}
+
+// Strides of array seen through the broadcast shape: 0 along axes it repeats
+static void broadcast_strides(ASTNode *array, int ndim, const int *shape, long *strides)
+{
+    int skip = ndim - array->ndarray.ndim;
+    for (int d = 0; d < ndim; d++)
+    {
+        if (d < skip || (array->ndarray.shape[d - skip] == 1 && shape[d] != 1))
+            strides[d] = 0;
+        else
+            strides[d] = array->ndarray.strides[d - skip];
+    }
+}
+
+ASTNode *ndarray_binary(ASTNode *a, ASTNode *b, NDBinaryOp op)
+{
+    // Shapes are aligned from the last axis; each pair must match or be 1
+    int ndim = a->ndarray.ndim > b->ndarray.ndim ? a->ndarray.ndim : b->ndarray.ndim;
+    int shape[NDARRAY_MAX_DIMS];
+    for (int d = 0; d < ndim; d++)
+    {
+        int da = d - (ndim - a->ndarray.ndim), db = d - (ndim - b->ndarray.ndim);
+        int size_a = da >= 0 ? a->ndarray.shape[da] : 1;
+        int size_b = db >= 0 ? b->ndarray.shape[db] : 1;
+        if (size_a != size_b && size_a != 1 && size_b != 1)
+            return NULL;
+        shape[d] = size_a == 1 ? size_b : size_a;
+    }
+    ASTNode *result = ndarray_new(ndim, shape);
+    double *out = result->ndarray.buffer->data;
+    long size = ndarray_size(result);
+    if (ndarray_is_contiguous(a) && ndarray_is_contiguous(b) && ndarray_size(a) == size &&
+        ndarray_size(b) == size)
+    {
+        // Same shape and both contiguous: one flat pass
+        binary_row(op, ndarray_data(a), 1, ndarray_data(b), 1, out, (int)size);
+        return result;
+    }
+    long sa[NDARRAY_MAX_DIMS], sb[NDARRAY_MAX_DIMS];
+    broadcast_strides(a, ndim, shape, sa);
+    broadcast_strides(b, ndim, shape, sb);
+    if (size > 0)
+        binary_dim(op, ndarray_data(a), sa, ndarray_data(b), sb, shape, ndim, &out);
+    return result;
+}
+
+// --- Reductions ---
+
+static double reduce_values(const double *values, long count, NDReduceOp op)
+{
+    if (count == 0)
+        return 0;
+    switch (op)
+    {
+    case ND_SUM:
+        return simd_sum(values, count);
+    case ND_MEAN:
+        return simd_sum(values, count) / count;
+    case ND_MIN:
+        return simd_min(values, count);
+    default:
+        return simd_max(values, count);
+    }
+}
+
+double ndarray_reduce_all(ASTNode *array, NDReduceOp op)
+{
+    ASTNode *source = contiguous(array);
+    double result = reduce_values(ndarray_data(source), ndarray_size(source), op);
+    if (source != array)
+        ast_free(source);
+    return result;
+}
+
+ASTNode *ndarray_reduce_axis(ASTNode *array, NDReduceOp op, int axis)
+{
+    ASTNode *source = contiguous(array);
+    int ndim = source->ndarray.ndim;
+    int shape[NDARRAY_MAX_DIMS] = {0};
+    long outer = 1, inner = 1;
+    for (int d = 0; d < ndim; d++)
+    {
+        if (d < axis)
+            outer *= source->ndarray.shape[d];
+        else if (d > axis)
+            inner *= source->ndarray.shape[d];
+        if (d != axis)
+            shape[d < axis ? d : d - 1] = source->ndarray.shape[d];
+    }
+    int length = source->ndarray.shape[axis];
+    ASTNode *result = ndarray_new(ndim - 1, shape);
+    double *out = result->ndarray.buffer->data;
+    const double *data = ndarray_data(source);
+
+    if (inner == 1)
+    {
+        // Reducing the last axis: every output is one contiguous run
+        for (long o = 0; o < outer; o++)
+            out[o] = reduce_values(data + o * length, length, op);
+    }
+    else if (length > 0)
+    {
+        // Otherwise fold whole rows of inner elements at a time
+        for (long o = 0; o < outer; o++)
+        {
+            double *row = out + o * inner;
+            const double *slab = data + o * length * inner;
+            memcpy(row, slab, sizeof(double) * inner);
+            for (int k = 1; k < length; k++)
+            {
+                const double *next = slab + k * inner;
+                if (op == ND_SUM || op == ND_MEAN)
+                    simd_axpy(row, 1.0, next, inner);
+                else if (op == ND_MIN)
+                    for (long j = 0; j < inner; j++)
+                        row[j] = next[j] < row[j] ? next[j] : row[j];
+                else
+                    for (long j = 0; j < inner; j++)
+                        row[j] = next[j] > row[j] ? next[j] : row[j];
+            }
+            if (op == ND_MEAN)
+                for (long j = 0; j < inner; j++)
+                    row[j] /= length;
+        }
+    }
+    if (source != array)
+        ast_free(source);
+    return result;
+}
+
+// --- Matrix product ---
+
+ASTNode *ndarray_matmul(ASTNode *a, ASTNode *b)
+{
+    if (a->ndarray.ndim < 1 || a->ndarray.ndim > 2 || b->ndarray.ndim < 1 || b->ndarray.ndim > 2)
+        return NULL;
+    // A 1-D left operand is a row vector and a 1-D right operand a column vector
+    int n = a->ndarray.ndim == 2 ? a->ndarray.shape[0] : 1;
+    int k = a->ndarray.shape[a->ndarray.ndim - 1];
+    int m = b->ndarray.ndim == 2 ? b->ndarray.shape[1] : 1;
+    if (b->ndarray.shape[0] != k)
+        return NULL;
+
+    int shape[2], ndim = 0;
+    if (a->ndarray.ndim == 2)
+        shape[ndim++] = n;
+    if (b->ndarray.ndim == 2)
+        shape[ndim++] = m;
+    ASTNode *result = ndarray_new(ndim, shape);
+    double *c = result->ndarray.buffer->data;
+    ASTNode *left = contiguous(a), *right = contiguous(b);
+    const double *x = ndarray_data(left), *y = ndarray_data(right);
+
+    if (m == 1)
+    {
+        // Matrix times vector: one dot product per row
+        for (int i = 0; i < n; i++)
+            c[i] = simd_dot(x + (long)i * k, y, k);
+    }
+    else
+    {
+        // Tiled i-p-j order: each step adds a scaled row of B to a row of C, so the
+        // innermost loop streams contiguous memory through the vector kernel
+        for (int i0 = 0; i0 < n; i0 += MATMUL_BLOCK_ROWS)
+        {
+            int i1 = i0 + MATMUL_BLOCK_ROWS < n ? i0 + MATMUL_BLOCK_ROWS : n;
+            for (int p0 = 0; p0 < k; p0 += MATMUL_BLOCK_DEPTH)
+            {
+                int p1 = p0 + MATMUL_BLOCK_DEPTH < k ? p0 + MATMUL_BLOCK_DEPTH : k;
+                for (int j0 = 0; j0 < m; j0 += MATMUL_BLOCK_COLS)
+                {
+                    int width = j0 + MATMUL_BLOCK_COLS < m ? MATMUL_BLOCK_COLS : m - j0;
+                    for (int i = i0; i < i1; i++)
+                        for (int p = p0; p < p1; p++)
+                            simd_axpy(c + (long)i * m + j0, x[(long)i * k + p], y + (long)p * m + j0, width);
+                }
+            }
+        }
+    }
+    if (left != a)
+        ast_free(left);
+    if (right != b)
+        ast_free(right);
+    return result;
+}
+
+void ndarray_release(ASTNode *array)
+{
+    if (array->ndarray.buffer && --array->ndarray.buffer->refs == 0)
+        free(array->ndarray.buffer);
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,6 +6,8 @@
 #include "parser.h"
 #include "lexer.h"
 #include "ast.h"
+#include "persistent.h"
+#include "heap.h"
 #include "error.h"
 
 static Token current_token;
@@ -410,7 +413,8 @@ static ASTNode *parse_primary()
             // Parse set elements
             do {
                 ASTNode *element = parse_expression();
-                ast_set_add_element(set, element);
+                if (!ast_set_add_element(set, element))
+                    ast_free(element); // Duplicate literal
                 
                 if (current_token.type == TOK_COMMA)
                     next_token();
@@ -434,14 +438,17 @@ static ASTNode *parse_primary()
             expect(TOK_LBRACE); // This will fail and show error
         }
     }
-    if (current_token.type == TOK_PATTERN_MATCH)
+    if (current_token.type == TOK_PATTERN_MATCH || current_token.type == TOK_PATTERN_MATCH_ANY)
     {
+        TokenType func_type = current_token.type;
         next_token();
         expect(TOK_LPAREN);
         ASTNode *pattern = parse_expression();
         expect(TOK_COMMA);
         ASTNode *noise = parse_expression();
         expect(TOK_RPAREN);
+        if (func_type == TOK_PATTERN_MATCH_ANY)
+            return ast_new_pattern_match_any(pattern, noise);
         return ast_new_pattern_match(pattern, noise);
     }
 
@@ -499,6 +506,24 @@ static ASTNode *parse_primary()
         return ast_new_graph();
     }
 
+    if (current_token.type == TOK_PVEC_NEW)
+    {
+        next_token();
+        return pvec_new();
+    }
+
+    if (current_token.type == TOK_PMAP_NEW)
+    {
+        next_token();
+        return pmap_new();
+    }
+
+    if (current_token.type == TOK_HEAP_NEW)
+    {
+        next_token();
+        return heap_new();
+    }
+
     if (current_token.type == TOK_REGEX_NEW)
     {
         next_token();
@@ -533,23 +558,24 @@ static ASTNode *parse_primary()
 
     if (current_token.type == TOK_TEMP_NEW)
     {
-        // Parse <temp@N> to extract the history size
+        // Parse <temp@N> or <temp@N+M>: N samples kept as they are, and with +M
+        // about M older ones kept compressed
         char temp_text[64];
         strcpy(temp_text, current_token.text);
         next_token();
         
-        // Extract number from <temp@N>
         int max_history = 5; // default
+        long long archived = 0;
         char *at_pos = strchr(temp_text, '@');
         if (at_pos)
         {
             max_history = atoi(at_pos + 1);
+            char *plus_pos = strchr(at_pos, '+');
+            if (plus_pos)
+                archived = atoll(plus_pos + 1);
         }
         
-        // Create a special node that represents temporal variable creation
-        ASTNode *node = ast_new_number(max_history);
-        node->type = NODE_TEMPORAL_VAR; // Reuse this type for creation
-        return node;
+        return ast_new_temporal_new(max_history, archived);
     }
 
     if (current_token.type == TOK_TRUE)
@@ -655,15 +681,30 @@ static ASTNode *parse_primary()
         current_token.type == TOK_LINKED_LIST_GET ||
         current_token.type == TOK_LINKED_LIST_SIZE ||
         current_token.type == TOK_LINKED_LIST_ISEMPTY ||
+        current_token.type == TOK_LINKED_LIST_PUSH_FRONT ||
+        current_token.type == TOK_LINKED_LIST_PUSH_BACK ||
+        current_token.type == TOK_LINKED_LIST_POP_FRONT ||
+        current_token.type == TOK_LINKED_LIST_POP_BACK ||
+        current_token.type == TOK_LINKED_LIST_CURSOR ||
+        current_token.type == TOK_LINKED_LIST_NEXT ||
+        current_token.type == TOK_LINKED_LIST_CURRENT ||
+        current_token.type == TOK_LINKED_LIST_INSERT ||
+        current_token.type == TOK_LINKED_LIST_ERASE ||
+        current_token.type == TOK_LINKED_LIST_SPLICE ||
         current_token.type == TOK_REGEX_MATCH ||
         current_token.type == TOK_REGEX_REPLACE ||
         current_token.type == TOK_REGEX_FIND_ALL ||
+        current_token.type == TOK_REGEX_NEXT ||
+        current_token.type == TOK_REGEX_GROUP ||
         current_token.type == TOK_TREE_INSERT ||
         current_token.type == TOK_TREE_SEARCH ||
         current_token.type == TOK_TREE_DELETE ||
         current_token.type == TOK_TREE_INORDER ||
         current_token.type == TOK_TREE_PREORDER ||
         current_token.type == TOK_TREE_POSTORDER ||
+        current_token.type == TOK_TREE_RANGE ||
+        current_token.type == TOK_TREE_FLOOR ||
+        current_token.type == TOK_TREE_CEIL ||
         current_token.type == TOK_GRAPH_ADD_VERTEX ||
         current_token.type == TOK_GRAPH_ADD_EDGE ||
         current_token.type == TOK_GRAPH_REMOVE_VERTEX ||
@@ -682,7 +723,25 @@ static ASTNode *parse_primary()
         current_token.type == TOK_SET_SIZE ||
         current_token.type == TOK_SET_EMPTY ||
         current_token.type == TOK_SET_CLEAR ||
-        current_token.type == TOK_SET_COPY)
+        current_token.type == TOK_SET_COPY ||
+        current_token.type == TOK_PVEC_PUSH ||
+        current_token.type == TOK_PVEC_SET ||
+        current_token.type == TOK_PVEC_POP ||
+        current_token.type == TOK_PVEC_GET ||
+        current_token.type == TOK_PVEC_SIZE ||
+        current_token.type == TOK_PMAP_PUT ||
+        current_token.type == TOK_PMAP_REMOVE ||
+        current_token.type == TOK_PMAP_GET ||
+        current_token.type == TOK_PMAP_HAS ||
+        current_token.type == TOK_PMAP_SIZE ||
+        current_token.type == TOK_HEAP_PUSH ||
+        current_token.type == TOK_HEAP_POP ||
+        current_token.type == TOK_HEAP_PEEK ||
+        current_token.type == TOK_HEAP_SIZE ||
+        current_token.type == TOK_HEAP_UPDATE ||
+        current_token.type == TOK_HEAP_KEY ||
+        current_token.type == TOK_HEAP_COMPARE ||
+        current_token.type == TOK_HEAPIFY)
     {
         TokenType func_type = current_token.type;
         next_token();
@@ -696,13 +755,24 @@ static ASTNode *parse_primary()
             expect(TOK_RPAREN);
             return ast_new_queue_enqueue(queue, value);
         }
-        else if (func_type == TOK_LINKED_LIST_ADD || func_type == TOK_LINKED_LIST_REMOVE)
+        else if (func_type == TOK_LINKED_LIST_ADD || func_type == TOK_LINKED_LIST_REMOVE ||
+                 func_type == TOK_LINKED_LIST_PUSH_FRONT || func_type == TOK_LINKED_LIST_PUSH_BACK ||
+                 func_type == TOK_LINKED_LIST_CURSOR || func_type == TOK_LINKED_LIST_INSERT ||
+                 func_type == TOK_LINKED_LIST_SPLICE)
         {
             expect(TOK_COMMA);
             ASTNode *value = parse_expression();
             expect(TOK_RPAREN);
-            if (func_type == TOK_LINKED_LIST_ADD)
+            if (func_type == TOK_LINKED_LIST_ADD || func_type == TOK_LINKED_LIST_PUSH_BACK)
                 return ast_new_linked_list_add(queue, value);
+            else if (func_type == TOK_LINKED_LIST_PUSH_FRONT)
+                return ast_new_linked_list_push_front(queue, value);
+            else if (func_type == TOK_LINKED_LIST_CURSOR)
+                return ast_new_linked_list_cursor(queue, value);
+            else if (func_type == TOK_LINKED_LIST_INSERT)
+                return ast_new_linked_list_insert(queue, value);
+            else if (func_type == TOK_LINKED_LIST_SPLICE)
+                return ast_new_linked_list_splice(queue, value);
             else
                 return ast_new_linked_list_remove(queue, value);
         }
@@ -727,6 +797,22 @@ static ASTNode *parse_primary()
             expect(TOK_RPAREN);
             return ast_new_regex_find_all(queue, text);
         }
+        else if (func_type == TOK_REGEX_NEXT)
+        {
+            expect(TOK_COMMA);
+            ASTNode *text = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *from = parse_expression();
+            expect(TOK_RPAREN);
+            return ast_new_regex_next(queue, text, from);
+        }
+        else if (func_type == TOK_REGEX_GROUP)
+        {
+            expect(TOK_COMMA);
+            ASTNode *name = parse_expression();
+            expect(TOK_RPAREN);
+            return ast_new_regex_group(queue, name);
+        }
         else if (func_type == TOK_REGEX_REPLACE)
         {
             expect(TOK_COMMA);
@@ -748,6 +834,25 @@ static ASTNode *parse_primary()
             else
                 return ast_new_tree_delete(queue, value);
         }
+        else if (func_type == TOK_TREE_FLOOR || func_type == TOK_TREE_CEIL)
+        {
+            expect(TOK_COMMA);
+            ASTNode *value = parse_expression();
+            expect(TOK_RPAREN);
+            if (func_type == TOK_TREE_FLOOR)
+                return ast_new_tree_floor(queue, value);
+            else
+                return ast_new_tree_ceil(queue, value);
+        }
+        else if (func_type == TOK_TREE_RANGE)
+        {
+            expect(TOK_COMMA);
+            ASTNode *lo = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *hi = parse_expression();
+            expect(TOK_RPAREN);
+            return ast_new_tree_range(queue, lo, hi);
+        }
         else if (func_type == TOK_GRAPH_ADD_VERTEX || func_type == TOK_GRAPH_REMOVE_VERTEX || func_type == TOK_GRAPH_NEIGHBORS ||
                  func_type == TOK_GRAPH_DFS || func_type == TOK_GRAPH_BFS)
         {
@@ -771,14 +876,89 @@ static ASTNode *parse_primary()
             ASTNode *from = parse_expression();
             expect(TOK_COMMA);
             ASTNode *to = parse_expression();
+            ASTNode *weight = NULL;
+            if (func_type == TOK_GRAPH_ADD_EDGE && current_token.type == TOK_COMMA)
+            {
+                next_token();
+                weight = parse_expression();
+            }
             expect(TOK_RPAREN);
             if (func_type == TOK_GRAPH_ADD_EDGE)
-                return ast_new_graph_add_edge(queue, from, to);
+                return ast_new_graph_add_edge(queue, from, to, weight);
             else if (func_type == TOK_GRAPH_REMOVE_EDGE)
                 return ast_new_graph_remove_edge(queue, from, to);
             else
                 return ast_new_graph_has_edge(queue, from, to);
         }
+        else if (func_type == TOK_PVEC_PUSH ||
+                 func_type == TOK_PVEC_GET ||
+                 func_type == TOK_PMAP_REMOVE ||
+                 func_type == TOK_PMAP_GET ||
+                 func_type == TOK_PMAP_HAS)
+        {
+            expect(TOK_COMMA);
+            ASTNode *arg = parse_expression();
+            expect(TOK_RPAREN);
+            if (func_type == TOK_PVEC_PUSH)
+                return ast_new_pvec_push(queue, arg);
+            else if (func_type == TOK_PVEC_GET)
+                return ast_new_pvec_get(queue, arg);
+            else if (func_type == TOK_PMAP_REMOVE)
+                return ast_new_pmap_remove(queue, arg);
+            else if (func_type == TOK_PMAP_GET)
+                return ast_new_pmap_get(queue, arg);
+            else
+                return ast_new_pmap_has(queue, arg);
+        }
+        else if (func_type == TOK_PVEC_SET || func_type == TOK_PMAP_PUT)
+        {
+            expect(TOK_COMMA);
+            ASTNode *key = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *value = parse_expression();
+            expect(TOK_RPAREN);
+            if (func_type == TOK_PVEC_SET)
+                return ast_new_pvec_set(queue, key, value);
+            else
+                return ast_new_pmap_put(queue, key, value);
+        }
+        else if (func_type == TOK_HEAP_PUSH || func_type == TOK_HEAP_UPDATE)
+        {
+            expect(TOK_COMMA);
+            ASTNode *value = parse_expression();
+            ASTNode *priority = NULL;
+            if (func_type == TOK_HEAP_UPDATE || current_token.type == TOK_COMMA)
+            {
+                expect(TOK_COMMA);
+                priority = parse_expression();
+            }
+            expect(TOK_RPAREN);
+            if (func_type == TOK_HEAP_PUSH)
+                return ast_new_heap_push(queue, value, priority);
+            else
+                return ast_new_heap_update(queue, value, priority);
+        }
+        else if (func_type == TOK_HEAP_KEY || func_type == TOK_HEAP_COMPARE)
+        {
+            expect(TOK_COMMA);
+            ASTNode *function = parse_expression();
+            expect(TOK_RPAREN);
+            if (func_type == TOK_HEAP_KEY)
+                return ast_new_heap_key(queue, function);
+            else
+                return ast_new_heap_compare(queue, function);
+        }
+        else if (func_type == TOK_HEAPIFY)
+        {
+            ASTNode *key_function = NULL;
+            if (current_token.type == TOK_COMMA)
+            {
+                next_token();
+                key_function = parse_expression();
+            }
+            expect(TOK_RPAREN);
+            return ast_new_heapify(queue, key_function);
+        }
         else if (func_type == TOK_SET_UNION || func_type == TOK_SET_INTERSECTION ||
                  func_type == TOK_SET_DIFFERENCE || func_type == TOK_SET_SYMMETRIC_DIFF)
         {
@@ -825,6 +1005,16 @@ static ASTNode *parse_primary()
                 return ast_new_linked_list_size(queue);
             case TOK_LINKED_LIST_ISEMPTY:
                 return ast_new_linked_list_isempty(queue);
+            case TOK_LINKED_LIST_POP_FRONT:
+                return ast_new_linked_list_pop_front(queue);
+            case TOK_LINKED_LIST_POP_BACK:
+                return ast_new_linked_list_pop_back(queue);
+            case TOK_LINKED_LIST_NEXT:
+                return ast_new_linked_list_next(queue);
+            case TOK_LINKED_LIST_CURRENT:
+                return ast_new_linked_list_current(queue);
+            case TOK_LINKED_LIST_ERASE:
+                return ast_new_linked_list_erase(queue);
             case TOK_TREE_INORDER:
                 return ast_new_tree_inorder(queue);
             case TOK_TREE_PREORDER:
@@ -839,6 +1029,18 @@ static ASTNode *parse_primary()
                 return ast_new_set_clear(queue);
             case TOK_SET_COPY:
                 return ast_new_set_copy(queue);
+            case TOK_PVEC_POP:
+                return ast_new_pvec_pop(queue);
+            case TOK_PVEC_SIZE:
+                return ast_new_pvec_size(queue);
+            case TOK_PMAP_SIZE:
+                return ast_new_pmap_size(queue);
+            case TOK_HEAP_POP:
+                return ast_new_heap_pop(queue);
+            case TOK_HEAP_PEEK:
+                return ast_new_heap_peek(queue);
+            case TOK_HEAP_SIZE:
+                return ast_new_heap_size(queue);
             default:
                 printf("Parse error: Unknown queue, linked list, tree, graph, or set function\n");
                 exit(1);
@@ -865,6 +1067,14 @@ static ASTNode *parse_primary()
         current_token.type == TOK_TEMPORAL_QUERY ||
         current_token.type == TOK_TEMPORAL_CORRELATE ||
         current_token.type == TOK_TEMPORAL_INTERPOLATE ||
+        current_token.type == TOK_TEMPORAL_DOWNSAMPLE ||
+        current_token.type == TOK_TEMPORAL_CORRELATE_MATRIX ||
+        current_token.type == TOK_TEMPORAL_XCORR ||
+        current_token.type == TOK_TEMPORAL_PERSIST ||
+        current_token.type == TOK_TEMPORAL_FILL ||
+        current_token.type == TOK_TEMPORAL_RESAMPLE ||
+        current_token.type == TOK_TEMPORAL_TRIGGER ||
+        current_token.type == TOK_TEMPORAL_UNTRIGGER ||
         current_token.type == TOK_STRING_SPLIT ||
         current_token.type == TOK_STRING_JOIN ||
         current_token.type == TOK_STRING_REPLACE ||
@@ -1105,6 +1315,117 @@ static ASTNode *parse_primary()
             
             return ast_new_temporal_interpolate(varname_node->string, missing_index);
         }
+        else if (func_type == TOK_TEMPORAL_DOWNSAMPLE)
+        {
+            ASTNode *varname_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *bucket_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *operation_node = parse_expression();
+            expect(TOK_RPAREN);
+            
+            if (varname_node->type != NODE_STRING || bucket_node->type != NODE_STRING || operation_node->type != NODE_STRING)
+            {
+                printf("Parse error: temporal_downsample expects string arguments\n");
+                exit(1);
+            }
+            
+            return ast_new_temporal_downsample(varname_node->string, bucket_node->string, operation_node->string);
+        }
+        else if (func_type == TOK_TEMPORAL_CORRELATE_MATRIX)
+        {
+            ASTNode *names = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *window_size = parse_expression();
+            expect(TOK_RPAREN);
+            return ast_new_temporal_correlate_matrix(names, window_size);
+        }
+        else if (func_type == TOK_TEMPORAL_XCORR)
+        {
+            ASTNode *var1_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *var2_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *window_size = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *max_lag = parse_expression();
+            expect(TOK_RPAREN);
+            
+            if (var1_node->type != NODE_STRING || var2_node->type != NODE_STRING)
+            {
+                printf("Parse error: temporal_xcorr expects string arguments for variable names\n");
+                exit(1);
+            }
+            
+            return ast_new_temporal_xcorr(var1_node->string, var2_node->string, window_size, max_lag);
+        }
+        else if (func_type == TOK_TEMPORAL_PERSIST)
+        {
+            ASTNode *varname_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *path_node = parse_expression();
+            expect(TOK_RPAREN);
+            
+            if (varname_node->type != NODE_STRING || path_node->type != NODE_STRING)
+            {
+                printf("Parse error: temporal_persist expects string arguments\n");
+                exit(1);
+            }
+            
+            return ast_new_temporal_persist(varname_node->string, path_node->string);
+        }
+        else if (func_type == TOK_TEMPORAL_FILL)
+        {
+            ASTNode *varname_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *method_node = parse_expression();
+            expect(TOK_RPAREN);
+            
+            if (varname_node->type != NODE_STRING || method_node->type != NODE_STRING)
+            {
+                printf("Parse error: temporal_fill expects string arguments\n");
+                exit(1);
+            }
+            
+            return ast_new_temporal_fill(varname_node->string, method_node->string);
+        }
+        else if (func_type == TOK_TEMPORAL_RESAMPLE)
+        {
+            ASTNode *varname_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *bucket_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *operation_node = parse_expression();
+            expect(TOK_RPAREN);
+            
+            if (varname_node->type != NODE_STRING || bucket_node->type != NODE_STRING || operation_node->type != NODE_STRING)
+            {
+                printf("Parse error: temporal_resample expects string arguments\n");
+                exit(1);
+            }
+            
+            return ast_new_temporal_resample(varname_node->string, bucket_node->string, operation_node->string);
+        }
+        else if (func_type == TOK_TEMPORAL_TRIGGER || func_type == TOK_TEMPORAL_UNTRIGGER)
+        {
+            ASTNode *varname_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *condition_node = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *callback_node = parse_expression();
+            expect(TOK_RPAREN);
+            
+            if (varname_node->type != NODE_STRING || condition_node->type != NODE_STRING || callback_node->type != NODE_STRING)
+            {
+                printf("Parse error: %s expects string arguments\n",
+                       func_type == TOK_TEMPORAL_TRIGGER ? "temporal_trigger" : "temporal_untrigger");
+                exit(1);
+            }
+            
+            if (func_type == TOK_TEMPORAL_UNTRIGGER)
+                return ast_new_temporal_untrigger(varname_node->string, condition_node->string, callback_node->string);
+            return ast_new_temporal_trigger(varname_node->string, condition_node->string, callback_node->string);
+        }
         else if (func_type == TOK_STRING_SPLIT)
         {
             ASTNode *string = parse_expression();
@@ -1192,7 +1513,8 @@ static ASTNode *parse_primary()
         current_token.type == TOK_LIST_PREPEND ||
         current_token.type == TOK_LIST_POP ||
         current_token.type == TOK_LIST_INSERT ||
-        current_token.type == TOK_LIST_REMOVE)
+        current_token.type == TOK_LIST_REMOVE ||
+        current_token.type == TOK_LIST_SLICE)
     {
         TokenType func_type = current_token.type;
         next_token();
@@ -1217,6 +1539,22 @@ static ASTNode *parse_primary()
             expect(TOK_RPAREN);
             return ast_new_list_insert(list, index, value);
         }
+        else if (func_type == TOK_LIST_SLICE)
+        {
+            // ::slice(list, start, end) or ::slice(list, start, end, step)
+            expect(TOK_COMMA);
+            ASTNode *start = parse_expression();
+            expect(TOK_COMMA);
+            ASTNode *end = parse_expression();
+            ASTNode *step = NULL;
+            if (current_token.type == TOK_COMMA)
+            {
+                next_token();
+                step = parse_expression();
+            }
+            expect(TOK_RPAREN);
+            return ast_new_list_slice(list, start, end, step);
+        }
         else
         {
             expect(TOK_COMMA);
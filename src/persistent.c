@@ -0,0 +1,619 @@
+#include <stdlib.h>
+#include <string.h>
+#include "persistent.h"
+
+#define PBITS 5
+#define PWIDTH (1 << PBITS)
+#define PMASK (PWIDTH - 1)
+
+// --- Values ---
+
+static PValue pvalue_from(ASTNode *node)
+{
+    PValue value = {NULL, 0};
+    if (node->type == NODE_STRING)
+    {
+        size_t len = strlen(node->string);
+        value.string = malloc(sizeof(PString) + len + 1);
+        value.string->refs = 1;
+        memcpy(value.string->text, node->string, len + 1);
+    }
+    else
+    {
+        value.number = node->number;
+    }
+    return value;
+}
+
+static void pvalue_retain(PValue value)
+{
+    if (value.string)
+        value.string->refs++;
+}
+
+static void pvalue_release(PValue value)
+{
+    if (value.string && --value.string->refs == 0)
+        free(value.string);
+}
+
+static ASTNode *pvalue_to_node(PValue value)
+{
+    return value.string ? ast_new_string(value.string->text) : ast_new_number(value.number);
+}
+
+// Stack-allocated ASTNode view of a value, so hashing and equality match dicts and sets
+static ASTNode pvalue_view(PValue value)
+{
+    ASTNode view;
+    if (value.string)
+    {
+        view.type = NODE_STRING;
+        strncpy(view.string, value.string->text, sizeof(view.string) - 1);
+        view.string[sizeof(view.string) - 1] = '\0';
+    }
+    else
+    {
+        view.type = NODE_NUMBER;
+        view.number = value.number;
+    }
+    return view;
+}
+
+// --- Vector ---
+// Elements live in 32-slot leaves; branches index by 5 bits of the position
+// per level. pvec.shift is the bit offset handled by the root.
+
+typedef struct PVecNode
+{
+    int refs;
+    int leaf;
+    union
+    {
+        struct PVecNode *children[PWIDTH];
+        PValue values[PWIDTH];
+    } u;
+} PVecNode;
+
+static PVecNode *pvec_node_new(int leaf)
+{
+    PVecNode *node = calloc(1, sizeof(PVecNode));
+    node->refs = 1;
+    node->leaf = leaf;
+    return node;
+}
+
+static void pvec_node_release(PVecNode *node)
+{
+    if (!node || --node->refs > 0)
+        return;
+    for (int i = 0; i < PWIDTH; i++)
+    {
+        if (node->leaf)
+            pvalue_release(node->u.values[i]);
+        else
+            pvec_node_release(node->u.children[i]);
+    }
+    free(node);
+}
+
+// Shallow copy that takes its own reference to everything it points at
+static PVecNode *pvec_node_copy(PVecNode *node)
+{
+    PVecNode *copy = malloc(sizeof(PVecNode));
+    memcpy(copy, node, sizeof(PVecNode));
+    copy->refs = 1;
+    for (int i = 0; i < PWIDTH; i++)
+    {
+        if (copy->leaf)
+            pvalue_retain(copy->u.values[i]);
+        else if (copy->u.children[i])
+            copy->u.children[i]->refs++;
+    }
+    return copy;
+}
+
+static ASTNode *pvec_wrap(PVecNode *root, int count, int shift)
+{
+    ASTNode *vec = malloc(sizeof(ASTNode));
+    vec->type = NODE_PVEC;
+    vec->pvec.root = root;
+    vec->pvec.count = count;
+    vec->pvec.shift = shift;
+    return vec;
+}
+
+ASTNode *pvec_new(void)
+{
+    return pvec_wrap(NULL, 0, 0);
+}
+
+// Copy of the path to index with the element there replaced; node may be NULL
+// when pushing into a subtree that does not exist yet
+static PVecNode *pvec_assoc(PVecNode *node, int shift, int index, PValue value)
+{
+    PVecNode *copy = node ? pvec_node_copy(node) : pvec_node_new(shift == 0);
+    int slot = (index >> shift) & PMASK;
+    if (shift == 0)
+    {
+        pvalue_release(copy->u.values[slot]);
+        copy->u.values[slot] = value;
+    }
+    else
+    {
+        PVecNode *child = pvec_assoc(node ? node->u.children[slot] : NULL, shift - PBITS, index, value);
+        pvec_node_release(copy->u.children[slot]);
+        copy->u.children[slot] = child;
+    }
+    return copy;
+}
+
+ASTNode *pvec_push(ASTNode *vec, ASTNode *value)
+{
+    PVecNode *root = vec->pvec.root;
+    int shift = vec->pvec.shift;
+    int count = vec->pvec.count;
+    if (!root)
+        return pvec_wrap(pvec_assoc(NULL, 0, 0, pvalue_from(value)), 1, 0);
+
+    if (count == (PWIDTH << shift))
+    {
+        // Root is full: grow a level with the old root as the first child
+        PVecNode *grown = pvec_node_new(0);
+        grown->u.children[0] = root;
+        root->refs++;
+        PVecNode *new_root = pvec_assoc(grown, shift + PBITS, count, pvalue_from(value));
+        pvec_node_release(grown);
+        return pvec_wrap(new_root, count + 1, shift + PBITS);
+    }
+    return pvec_wrap(pvec_assoc(root, shift, count, pvalue_from(value)), count + 1, shift);
+}
+
+ASTNode *pvec_set(ASTNode *vec, int index, ASTNode *value)
+{
+    if (index < 0 || index >= vec->pvec.count)
+        return NULL;
+    PVecNode *root = pvec_assoc(vec->pvec.root, vec->pvec.shift, index, pvalue_from(value));
+    return pvec_wrap(root, vec->pvec.count, vec->pvec.shift);
+}
+
+// Copy of the path to the last element with it removed; NULL once a subtree is empty
+static PVecNode *pvec_pop_node(PVecNode *node, int shift, int index)
+{
+    int slot = (index >> shift) & PMASK;
+    PVecNode *child = NULL;
+    if (shift > 0)
+    {
+        child = pvec_pop_node(node->u.children[slot], shift - PBITS, index);
+        if (!child && slot == 0)
+            return NULL;
+    }
+    else if (slot == 0)
+    {
+        return NULL;
+    }
+
+    PVecNode *copy = pvec_node_copy(node);
+    if (shift == 0)
+    {
+        pvalue_release(copy->u.values[slot]);
+        copy->u.values[slot].string = NULL;
+        copy->u.values[slot].number = 0;
+    }
+    else
+    {
+        pvec_node_release(copy->u.children[slot]);
+        copy->u.children[slot] = child;
+    }
+    return copy;
+}
+
+ASTNode *pvec_pop(ASTNode *vec)
+{
+    if (vec->pvec.count == 0)
+        return pvec_new();
+    int shift = vec->pvec.shift;
+    PVecNode *root = pvec_pop_node(vec->pvec.root, shift, vec->pvec.count - 1);
+
+    // Drop levels whose root only has a single child left
+    while (root && shift > 0 && !root->u.children[1])
+    {
+        PVecNode *child = root->u.children[0];
+        child->refs++;
+        pvec_node_release(root);
+        root = child;
+        shift -= PBITS;
+    }
+    return pvec_wrap(root, vec->pvec.count - 1, root ? shift : 0);
+}
+
+static PValue *pvec_lookup(ASTNode *vec, int index)
+{
+    if (index < 0 || index >= vec->pvec.count)
+        return NULL;
+    PVecNode *node = vec->pvec.root;
+    for (int shift = vec->pvec.shift; shift > 0; shift -= PBITS)
+        node = node->u.children[(index >> shift) & PMASK];
+    return &node->u.values[index & PMASK];
+}
+
+ASTNode *pvec_get(ASTNode *vec, int index)
+{
+    PValue *value = pvec_lookup(vec, index);
+    return value ? pvalue_to_node(*value) : NULL;
+}
+
+ASTNode *pvec_to_list(ASTNode *vec)
+{
+    ASTNode *list = ast_new_list();
+    int count = vec->pvec.count;
+    if (count > 0)
+        list->list.elements = malloc(sizeof(ASTNode *) * count);
+    // Walk leaf by leaf rather than descending once per element
+    for (int base = 0; base < count; base += PWIDTH)
+    {
+        PValue *leaf = pvec_lookup(vec, base);
+        for (int i = 0; i < PWIDTH && base + i < count; i++)
+            list->list.elements[base + i] = pvalue_to_node(leaf[i]);
+    }
+    list->list.count = count;
+    return list;
+}
+
+// --- Hash map ---
+// Each branch has a 32-bit bitmap of occupied hash slots and a packed array
+// holding either an entry or a child branch per occupied slot. Keys whose
+// 64-bit hashes are identical end up together in a collision node.
+
+#define PMAP_MAX_SHIFT 60 // Last level that still has hash bits left
+
+typedef struct PMapSlot
+{
+    struct PMapNode *child; // Subtree, or NULL when this slot is an entry
+    unsigned long hash;
+    PValue key;
+    PValue value;
+} PMapSlot;
+
+typedef struct PMapNode
+{
+    int refs;
+    int collision; // Slots are unordered entries sharing one hash
+    unsigned int bitmap;
+    int size;
+    PMapSlot *slots;
+} PMapNode;
+
+static int popcount32(unsigned int x)
+{
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (int)((x * 0x01010101u) >> 24);
+}
+
+static void pmap_slot_retain(PMapSlot *slot)
+{
+    if (slot->child)
+    {
+        slot->child->refs++;
+    }
+    else
+    {
+        pvalue_retain(slot->key);
+        pvalue_retain(slot->value);
+    }
+}
+
+static void pmap_node_release(PMapNode *node);
+
+static void pmap_slot_release(PMapSlot *slot)
+{
+    if (slot->child)
+    {
+        pmap_node_release(slot->child);
+    }
+    else
+    {
+        pvalue_release(slot->key);
+        pvalue_release(slot->value);
+    }
+}
+
+static PMapNode *pmap_node_alloc(int collision, unsigned int bitmap, int size)
+{
+    PMapNode *node = malloc(sizeof(PMapNode));
+    node->refs = 1;
+    node->collision = collision;
+    node->bitmap = bitmap;
+    node->size = size;
+    node->slots = malloc(sizeof(PMapSlot) * (size > 0 ? size : 1));
+    return node;
+}
+
+static void pmap_node_release(PMapNode *node)
+{
+    if (!node || --node->refs > 0)
+        return;
+    for (int i = 0; i < node->size; i++)
+        pmap_slot_release(&node->slots[i]);
+    free(node->slots);
+    free(node);
+}
+
+// Copy of node with a slot inserted at pos (insert) or removed at pos (remove),
+// taking references to every slot carried over
+static PMapNode *pmap_node_edit(PMapNode *node, unsigned int bitmap, int pos, int insert, int remove)
+{
+    int size = node->size + insert - remove;
+    PMapNode *copy = pmap_node_alloc(node->collision, bitmap, size);
+    int out = 0;
+    for (int i = 0; i < node->size; i++)
+    {
+        if (insert && i == pos)
+            out++;
+        if (remove && i == pos)
+            continue;
+        copy->slots[out] = node->slots[i];
+        pmap_slot_retain(&copy->slots[out]);
+        out++;
+    }
+    return copy;
+}
+
+static PMapSlot pmap_entry(unsigned long hash, PValue key, PValue value)
+{
+    PMapSlot slot = {NULL, hash, key, value};
+    return slot;
+}
+
+// Smallest subtree at shift that holds two entries with different keys
+static PMapNode *pmap_pair(int shift, PMapSlot a, PMapSlot b)
+{
+    if (shift > PMAP_MAX_SHIFT)
+    {
+        PMapNode *node = pmap_node_alloc(1, 0, 2);
+        node->slots[0] = a;
+        node->slots[1] = b;
+        return node;
+    }
+    unsigned int ia = (a.hash >> shift) & PMASK;
+    unsigned int ib = (b.hash >> shift) & PMASK;
+    if (ia == ib)
+    {
+        PMapNode *node = pmap_node_alloc(0, 1u << ia, 1);
+        node->slots[0].child = pmap_pair(shift + PBITS, a, b);
+        return node;
+    }
+    PMapNode *node = pmap_node_alloc(0, (1u << ia) | (1u << ib), 2);
+    node->slots[ia < ib ? 0 : 1] = a;
+    node->slots[ia < ib ? 1 : 0] = b;
+    return node;
+}
+
+static int pmap_keys_equal(PValue a, PValue b)
+{
+    ASTNode va = pvalue_view(a), vb = pvalue_view(b);
+    return ast_value_equals(&va, &vb);
+}
+
+// New version of node with entry set; *added is 1 when the key was not present.
+// Takes ownership of the entry's key and value.
+static PMapNode *pmap_assoc(PMapNode *node, int shift, PMapSlot entry, int *added)
+{
+    if (node->collision)
+    {
+        for (int i = 0; i < node->size; i++)
+        {
+            if (pmap_keys_equal(node->slots[i].key, entry.key))
+            {
+                PMapNode *copy = pmap_node_edit(node, 0, -1, 0, 0);
+                pmap_slot_release(&copy->slots[i]);
+                copy->slots[i] = entry;
+                return copy;
+            }
+        }
+        PMapNode *copy = pmap_node_edit(node, 0, node->size, 1, 0);
+        copy->slots[node->size] = entry;
+        *added = 1;
+        return copy;
+    }
+
+    unsigned int bit = 1u << ((entry.hash >> shift) & PMASK);
+    int pos = popcount32(node->bitmap & (bit - 1));
+    if (!(node->bitmap & bit))
+    {
+        PMapNode *copy = pmap_node_edit(node, node->bitmap | bit, pos, 1, 0);
+        copy->slots[pos] = entry;
+        *added = 1;
+        return copy;
+    }
+
+    PMapSlot *slot = &node->slots[pos];
+    PMapSlot replacement;
+    if (slot->child)
+    {
+        replacement.child = pmap_assoc(slot->child, shift + PBITS, entry, added);
+    }
+    else if (slot->hash == entry.hash && pmap_keys_equal(slot->key, entry.key))
+    {
+        pvalue_release(entry.key);
+        replacement = pmap_entry(slot->hash, slot->key, entry.value);
+        pvalue_retain(replacement.key);
+    }
+    else
+    {
+        PMapSlot existing = *slot;
+        pmap_slot_retain(&existing);
+        replacement.child = pmap_pair(shift + PBITS, existing, entry);
+        *added = 1;
+    }
+
+    PMapNode *copy = pmap_node_edit(node, node->bitmap, -1, 0, 0);
+    pmap_slot_release(&copy->slots[pos]);
+    copy->slots[pos] = replacement;
+    return copy;
+}
+
+// New version of node without key. Returns node itself (unreferenced) when the key
+// is absent, and NULL when the node ends up empty.
+static PMapNode *pmap_dissoc(PMapNode *node, int shift, unsigned long hash, PValue key)
+{
+    if (node->collision)
+    {
+        for (int i = 0; i < node->size; i++)
+        {
+            if (pmap_keys_equal(node->slots[i].key, key))
+                return node->size == 1 ? NULL : pmap_node_edit(node, 0, i, 0, 1);
+        }
+        return node;
+    }
+
+    unsigned int bit = 1u << ((hash >> shift) & PMASK);
+    if (!(node->bitmap & bit))
+        return node;
+    int pos = popcount32(node->bitmap & (bit - 1));
+    PMapSlot *slot = &node->slots[pos];
+
+    if (!slot->child)
+    {
+        if (slot->hash != hash || !pmap_keys_equal(slot->key, key))
+            return node;
+        return node->size == 1 ? NULL : pmap_node_edit(node, node->bitmap & ~bit, pos, 0, 1);
+    }
+
+    PMapNode *child = pmap_dissoc(slot->child, shift + PBITS, hash, key);
+    if (child == slot->child)
+        return node;
+    if (!child)
+        return node->size == 1 ? NULL : pmap_node_edit(node, node->bitmap & ~bit, pos, 0, 1);
+
+    PMapSlot replacement;
+    replacement.child = child;
+    if (child->size == 1 && !child->slots[0].child)
+    {
+        // A lone entry moves up instead of keeping a one-slot subtree
+        replacement = child->slots[0];
+        pmap_slot_retain(&replacement);
+        pmap_node_release(child);
+    }
+    PMapNode *copy = pmap_node_edit(node, node->bitmap, -1, 0, 0);
+    pmap_slot_release(&copy->slots[pos]);
+    copy->slots[pos] = replacement;
+    return copy;
+}
+
+static ASTNode *pmap_wrap(PMapNode *root, int count)
+{
+    ASTNode *map = malloc(sizeof(ASTNode));
+    map->type = NODE_PMAP;
+    map->pmap.root = root;
+    map->pmap.count = count;
+    return map;
+}
+
+ASTNode *pmap_new(void)
+{
+    return pmap_wrap(NULL, 0);
+}
+
+ASTNode *pmap_put(ASTNode *map, ASTNode *key, ASTNode *value)
+{
+    PMapSlot entry = pmap_entry(ast_value_hash(key), pvalue_from(key), pvalue_from(value));
+    if (!map->pmap.root)
+    {
+        PMapNode *root = pmap_node_alloc(0, 1u << (entry.hash & PMASK), 1);
+        root->slots[0] = entry;
+        return pmap_wrap(root, 1);
+    }
+    int added = 0;
+    PMapNode *root = pmap_assoc(map->pmap.root, 0, entry, &added);
+    return pmap_wrap(root, map->pmap.count + added);
+}
+
+ASTNode *pmap_remove(ASTNode *map, ASTNode *key)
+{
+    if (!map->pmap.root)
+        return pmap_new();
+    PValue probe = pvalue_from(key);
+    PMapNode *root = pmap_dissoc(map->pmap.root, 0, ast_value_hash(key), probe);
+    pvalue_release(probe);
+    if (root == map->pmap.root)
+        return persistent_snapshot(map);
+    return pmap_wrap(root, map->pmap.count - 1);
+}
+
+ASTNode *pmap_get(ASTNode *map, ASTNode *key)
+{
+    PMapNode *node = map->pmap.root;
+    unsigned long hash = ast_value_hash(key);
+    for (int shift = 0; node; shift += PBITS)
+    {
+        if (node->collision)
+        {
+            for (int i = 0; i < node->size; i++)
+            {
+                ASTNode stored = pvalue_view(node->slots[i].key);
+                if (ast_value_equals(&stored, key))
+                    return pvalue_to_node(node->slots[i].value);
+            }
+            return NULL;
+        }
+        unsigned int bit = 1u << ((hash >> shift) & PMASK);
+        if (!(node->bitmap & bit))
+            return NULL;
+        PMapSlot *slot = &node->slots[popcount32(node->bitmap & (bit - 1))];
+        if (slot->child)
+        {
+            node = slot->child;
+            continue;
+        }
+        ASTNode stored = pvalue_view(slot->key);
+        if (slot->hash == hash && ast_value_equals(&stored, key))
+            return pvalue_to_node(slot->value);
+        return NULL;
+    }
+    return NULL;
+}
+
+static void pmap_collect(PMapNode *node, ASTNode *dict)
+{
+    for (int i = 0; i < node->size; i++)
+    {
+        if (node->slots[i].child)
+            pmap_collect(node->slots[i].child, dict);
+        else
+            ast_dict_add_pair(dict, pvalue_to_node(node->slots[i].key), pvalue_to_node(node->slots[i].value));
+    }
+}
+
+ASTNode *pmap_to_dict(ASTNode *map)
+{
+    ASTNode *dict = ast_new_dict();
+    if (map->pmap.root)
+        pmap_collect(map->pmap.root, dict);
+    return dict;
+}
+
+// --- Shared ---
+
+ASTNode *persistent_snapshot(ASTNode *collection)
+{
+    if (collection->type == NODE_PVEC)
+    {
+        if (collection->pvec.root)
+            collection->pvec.root->refs++;
+        return pvec_wrap(collection->pvec.root, collection->pvec.count, collection->pvec.shift);
+    }
+    if (collection->pmap.root)
+        collection->pmap.root->refs++;
+    return pmap_wrap(collection->pmap.root, collection->pmap.count);
+}
+
+void persistent_release(ASTNode *collection)
+{
+    if (collection->type == NODE_PVEC)
+        pvec_node_release(collection->pvec.root);
+    else
+        pmap_node_release(collection->pmap.root);
+}
@@ -0,0 +1,1087 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "regex_vm.h"
+
+#define REGEX_MAX_REPEAT 1000
+// A pattern whose DFA outgrows this many states is left to the Pike VM
+#define DFA_MAX_STATES 2048
+#define DFA_TABLE_SIZE (2 * DFA_MAX_STATES)
+
+typedef struct
+{
+    int pc;
+    int slot; // A slot to restore to value instead of a pc to follow, when >= 0
+    size_t value;
+} Frame;
+
+struct RegexVm
+{
+    int *mark; // Generation in which each instruction was last added to a list
+    int generation;
+    Frame *frames;
+    int *set;
+    const char *text; // Text being searched, for anchors
+    size_t length;
+    int *pcs[2]; // Current and next thread lists, in priority order
+    size_t *slots[2];
+    int count[2];
+    size_t *work;
+    size_t *best;
+};
+
+typedef struct
+{
+    int *pcs; // Sorted
+    int count;
+    int match;
+    int next[256]; // State reached on each byte, -1 until it is first needed
+} DfaState;
+
+struct RegexDfa
+{
+    DfaState **states;
+    int count;
+    int table[DFA_TABLE_SIZE]; // State index + 1 by hash of its pcs, 0 when free
+    int start;
+};
+
+static void set_add(uint8_t *set, int c)
+{
+    set[c >> 3] |= (uint8_t)(1 << (c & 7));
+}
+
+static int set_has(const uint8_t *set, int c)
+{
+    return (set[c >> 3] >> (c & 7)) & 1;
+}
+
+// --- Parsing ---
+
+typedef enum
+{
+    TERM_EMPTY,
+    TERM_CHAR,
+    TERM_ANY,
+    TERM_CLASS,
+    TERM_CONCAT,
+    TERM_ALTERNATE,
+    TERM_REPEAT,
+    TERM_GROUP,
+    TERM_ASSERT
+} TermKind;
+
+typedef struct Term
+{
+    TermKind kind;
+    int value;   // The byte, class index, group number or assertion
+    int min;     // Repeat bounds, max -1 when unbounded
+    int max;
+    int greedy;
+    struct Term *left;
+    struct Term *right;
+} Term;
+
+typedef struct
+{
+    const char *p;
+    int flags;
+    RegexProgram *program;
+    const char *error;
+} Parser;
+
+static Term *term_new(TermKind kind, Term *left, Term *right)
+{
+    Term *term = calloc(1, sizeof(Term));
+    if (!term)
+    {
+        perror("Failed to allocate regex term");
+        exit(EXIT_FAILURE);
+    }
+    term->kind = kind;
+    term->left = left;
+    term->right = right;
+    return term;
+}
+
+static void term_free(Term *term)
+{
+    if (!term)
+        return;
+    term_free(term->left);
+    term_free(term->right);
+    free(term);
+}
+
+// Under the i flag, a set holding a letter in either case holds it in both
+static void fold_case(Parser *parser, uint8_t set[32])
+{
+    if (!(parser->flags & REGEX_CASE_INSENSITIVE))
+        return;
+    for (int c = 'a'; c <= 'z'; c++)
+    {
+        if (set_has(set, c) || set_has(set, toupper(c)))
+        {
+            set_add(set, c);
+            set_add(set, toupper(c));
+        }
+    }
+}
+
+static Term *class_term(Parser *parser, uint8_t set[32])
+{
+    fold_case(parser, set);
+    RegexProgram *program = parser->program;
+    program->classes = realloc(program->classes, sizeof(*program->classes) * (program->class_count + 1));
+    memcpy(program->classes[program->class_count], set, 32);
+    Term *term = term_new(TERM_CLASS, NULL, NULL);
+    term->value = program->class_count++;
+    return term;
+}
+
+// Adds \d \w \s or their complements to set; returns 0 for any other letter
+static int shorthand_class(int c, uint8_t set[32])
+{
+    uint8_t members[32] = {0};
+    for (int b = 0; b < 256; b++)
+    {
+        int in = tolower(c) == 'd' ? isdigit(b) : tolower(c) == 'w' ? (isalnum(b) || b == '_') : tolower(c) == 's' ? isspace(b) : -1;
+        if (in < 0)
+            return 0;
+        if ((in != 0) != (isupper(c) != 0))
+            set_add(members, b);
+    }
+    for (int i = 0; i < 32; i++)
+        set[i] |= members[i];
+    return 1;
+}
+
+// Consumes an escape at the parser's position, which is on a backslash. A doubled
+// backslash counts as one, so "\\d" means \d
+static int read_escape(Parser *parser)
+{
+    const char *p = parser->p;
+    if (p[1] == '\\' && p[2])
+        p++;
+    if (!p[1])
+    {
+        parser->p = p + 1;
+        return '\\';
+    }
+    parser->p = p + 2;
+    switch (p[1])
+    {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    case 'f':
+        return '\f';
+    case 'v':
+        return '\v';
+    default:
+        return (unsigned char)p[1];
+    }
+}
+
+static Term *parse_class(Parser *parser)
+{
+    uint8_t set[32] = {0};
+    int negate = 0;
+    parser->p++;
+    if (*parser->p == '^')
+    {
+        negate = 1;
+        parser->p++;
+    }
+    int first = 1;
+    while (*parser->p && (*parser->p != ']' || first))
+    {
+        first = 0;
+        int lo;
+        if (*parser->p == '\\')
+        {
+            lo = read_escape(parser);
+            if (shorthand_class(lo, set))
+                continue;
+        }
+        else
+        {
+            lo = (unsigned char)*parser->p++;
+        }
+
+        int hi = lo;
+        if (parser->p[0] == '-' && parser->p[1] && parser->p[1] != ']')
+        {
+            parser->p++;
+            hi = *parser->p == '\\' ? read_escape(parser) : (unsigned char)*parser->p++;
+            if (hi < lo)
+            {
+                parser->error = "invalid range in character class";
+                return NULL;
+            }
+        }
+        for (int c = lo; c <= hi; c++)
+            set_add(set, c);
+    }
+    if (*parser->p != ']')
+    {
+        parser->error = "missing ] after character class";
+        return NULL;
+    }
+    parser->p++;
+    fold_case(parser, set);
+    if (negate)
+    {
+        for (int i = 0; i < 32; i++)
+            set[i] = (uint8_t)~set[i];
+    }
+    return class_term(parser, set);
+}
+
+static Term *parse_alternate(Parser *parser);
+
+static Term *assert_term(Parser *parser, RegexAssertion assertion)
+{
+    parser->program->assertions = 1;
+    Term *term = term_new(TERM_ASSERT, NULL, NULL);
+    term->value = assertion;
+    return term;
+}
+
+// Reads what follows an opening parenthesis: ?: for a group that does not capture,
+// ?<name> or ?P<name> for a named one. Returns the new group's number, or 0 when it
+// does not capture
+static int parse_group_name(Parser *parser)
+{
+    RegexProgram *program = parser->program;
+    const char *p = parser->p;
+    if (p[0] == '?' && p[1] == ':')
+    {
+        parser->p += 2;
+        return 0;
+    }
+
+    const char *name = NULL;
+    size_t name_length = 0;
+    if (p[0] == '?')
+    {
+        p += p[1] == 'P' ? 2 : 1;
+        if (*p != '<' || !(isalpha((unsigned char)p[1]) || p[1] == '_'))
+        {
+            parser->error = "expected :, <name> or P<name> after (?";
+            return 0;
+        }
+        name = ++p;
+        while (isalnum((unsigned char)*p) || *p == '_')
+            p++;
+        if (*p != '>')
+        {
+            parser->error = "group names are letters, digits and _, ended by >";
+            return 0;
+        }
+        name_length = (size_t)(p - name);
+        parser->p = p + 1;
+        for (int i = 1; i <= program->groups; i++)
+        {
+            if (program->names[i] && strlen(program->names[i]) == name_length &&
+                strncmp(program->names[i], name, name_length) == 0)
+            {
+                parser->error = "group name used twice";
+                return 0;
+            }
+        }
+    }
+
+    if (program->groups == REGEX_MAX_GROUPS)
+    {
+        parser->error = "too many groups";
+        return 0;
+    }
+    int group = ++program->groups;
+    program->names = realloc(program->names, sizeof(char *) * (group + 1));
+    program->names[0] = NULL;
+    program->names[group] = name ? strndup(name, name_length) : NULL;
+    return group;
+}
+
+static Term *parse_atom(Parser *parser)
+{
+    char c = *parser->p;
+    if (c == '(')
+    {
+        parser->p++;
+        int group = parse_group_name(parser);
+        if (parser->error)
+            return NULL;
+        Term *inner = parse_alternate(parser);
+        if (!parser->error && *parser->p != ')')
+            parser->error = "missing )";
+        if (!parser->error)
+            parser->p++;
+        if (group == 0)
+            return inner;
+        Term *term = term_new(TERM_GROUP, inner, NULL);
+        term->value = group;
+        return term;
+    }
+    if (c == '^' || c == '$')
+    {
+        parser->p++;
+        int multiline = parser->flags & REGEX_MULTILINE;
+        return assert_term(parser, c == '^' ? (multiline ? REGEX_LINE_START : REGEX_TEXT_START)
+                                            : (multiline ? REGEX_LINE_END : REGEX_TEXT_END));
+    }
+    if (c == '*' || c == '+' || c == '?')
+    {
+        parser->error = "quantifier with nothing to repeat";
+        return NULL;
+    }
+    if (c == '[')
+        return parse_class(parser);
+    if (c == '.')
+    {
+        parser->p++;
+        return term_new(TERM_ANY, NULL, NULL);
+    }
+
+    int byte;
+    if (c == '\\')
+    {
+        byte = read_escape(parser);
+        if (byte == 'b' || byte == 'B')
+            return assert_term(parser, byte == 'b' ? REGEX_WORD_BOUNDARY : REGEX_NOT_WORD_BOUNDARY);
+        uint8_t set[32] = {0};
+        if (shorthand_class(byte, set))
+            return class_term(parser, set);
+    }
+    else
+    {
+        byte = (unsigned char)c;
+        parser->p++;
+    }
+    if ((parser->flags & REGEX_CASE_INSENSITIVE) && isalpha(byte))
+    {
+        uint8_t set[32] = {0};
+        set_add(set, byte);
+        return class_term(parser, set);
+    }
+    Term *term = term_new(TERM_CHAR, NULL, NULL);
+    term->value = byte;
+    return term;
+}
+
+// Reads {n}, {n,} or {n,m}; returns 0, consuming nothing, when the brace does
+// not start one, in which case it is an ordinary character
+static int read_bounds(Parser *parser, int *min, int *max)
+{
+    const char *p = parser->p + 1;
+    if (!isdigit((unsigned char)*p))
+        return 0;
+    long lo = strtol(p, (char **)&p, 10);
+    long hi = lo;
+    if (*p == ',')
+    {
+        p++;
+        hi = isdigit((unsigned char)*p) ? strtol(p, (char **)&p, 10) : -1;
+    }
+    if (*p != '}')
+        return 0;
+    parser->p = p + 1;
+    if (lo > REGEX_MAX_REPEAT || hi > REGEX_MAX_REPEAT)
+        parser->error = "repeat count too large";
+    else if (hi >= 0 && hi < lo)
+        parser->error = "repeat bounds out of order";
+    *min = (int)lo;
+    *max = (int)hi;
+    return 1;
+}
+
+static Term *parse_repeat(Parser *parser)
+{
+    Term *term = parse_atom(parser);
+    while (!parser->error)
+    {
+        int min, max;
+        char c = *parser->p;
+        if (c == '*' || c == '+' || c == '?')
+        {
+            min = c == '+' ? 1 : 0;
+            max = c == '?' ? 1 : -1;
+            parser->p++;
+        }
+        else if (c != '{' || !read_bounds(parser, &min, &max))
+        {
+            break;
+        }
+        Term *repeat = term_new(TERM_REPEAT, term, NULL);
+        repeat->min = min;
+        repeat->max = max;
+        repeat->greedy = 1;
+        if (*parser->p == '?')
+        {
+            repeat->greedy = 0;
+            parser->p++;
+        }
+        term = repeat;
+    }
+    return term;
+}
+
+static Term *parse_concat(Parser *parser)
+{
+    Term *term = NULL;
+    while (!parser->error && *parser->p && *parser->p != '|' && *parser->p != ')')
+    {
+        Term *next = parse_repeat(parser);
+        term = term ? term_new(TERM_CONCAT, term, next) : next;
+    }
+    return term ? term : term_new(TERM_EMPTY, NULL, NULL);
+}
+
+static Term *parse_alternate(Parser *parser)
+{
+    Term *term = parse_concat(parser);
+    while (!parser->error && *parser->p == '|')
+    {
+        parser->p++;
+        term = term_new(TERM_ALTERNATE, term, parse_concat(parser));
+    }
+    return term;
+}
+
+// --- Code generation ---
+
+// Instructions term compiles to, saturating past REGEX_MAX_PROGRAM
+static long long term_size(const Term *term)
+{
+    long long size;
+    switch (term->kind)
+    {
+    case TERM_EMPTY:
+        return 0;
+    case TERM_CONCAT:
+        size = term_size(term->left) + term_size(term->right);
+        break;
+    case TERM_ALTERNATE:
+        size = term_size(term->left) + term_size(term->right) + 2;
+        break;
+    case TERM_REPEAT:
+    {
+        long long body = term_size(term->left);
+        if (term->max < 0)
+            size = term->min > 0 ? term->min * body + 1 : body + 2;
+        else
+            size = term->min * body + (long long)(term->max - term->min) * (body + 1);
+        break;
+    }
+    case TERM_GROUP:
+        size = term_size(term->left) + 2;
+        break;
+    default:
+        return 1;
+    }
+    return size > REGEX_MAX_PROGRAM ? REGEX_MAX_PROGRAM + 1 : size;
+}
+
+static int emit(RegexProgram *program, RegexOp op, int x, int y)
+{
+    RegexInst *inst = &program->code[program->length];
+    inst->op = op;
+    inst->x = x;
+    inst->y = y;
+    return program->length++;
+}
+
+// Points a split at the loop body and the way out, in the order of preference
+static void prefer(RegexProgram *program, int split, int stay, int leave, int greedy)
+{
+    program->code[split].x = greedy ? stay : leave;
+    program->code[split].y = greedy ? leave : stay;
+}
+
+static void emit_term(RegexProgram *program, const Term *term);
+
+static void emit_repeat(RegexProgram *program, const Term *term)
+{
+    int required = term->max < 0 && term->min > 0 ? term->min - 1 : term->min;
+    for (int i = 0; i < required; i++)
+        emit_term(program, term->left);
+
+    if (term->max < 0 && term->min > 0)
+    {
+        // The last required copy loops back on itself
+        int body = program->length;
+        emit_term(program, term->left);
+        int split = emit(program, REGEX_SPLIT, 0, 0);
+        prefer(program, split, body, program->length, term->greedy);
+    }
+    else if (term->max < 0)
+    {
+        int split = emit(program, REGEX_SPLIT, 0, 0);
+        emit_term(program, term->left);
+        emit(program, REGEX_JMP, split, 0);
+        prefer(program, split, split + 1, program->length, term->greedy);
+    }
+    else if (term->max > term->min)
+    {
+        // Each optional copy is tried only after the one before it matched
+        int optional = term->max - term->min;
+        int *splits = malloc(sizeof(int) * optional);
+        for (int i = 0; i < optional; i++)
+        {
+            splits[i] = emit(program, REGEX_SPLIT, 0, 0);
+            emit_term(program, term->left);
+        }
+        for (int i = 0; i < optional; i++)
+            prefer(program, splits[i], splits[i] + 1, program->length, term->greedy);
+        free(splits);
+    }
+}
+
+static void emit_term(RegexProgram *program, const Term *term)
+{
+    switch (term->kind)
+    {
+    case TERM_EMPTY:
+        break;
+    case TERM_CHAR:
+        emit(program, REGEX_CHAR, term->value, 0);
+        break;
+    case TERM_ANY:
+        emit(program, REGEX_ANY, 0, 0);
+        break;
+    case TERM_CLASS:
+        emit(program, REGEX_CLASS, term->value, 0);
+        break;
+    case TERM_CONCAT:
+        emit_term(program, term->left);
+        emit_term(program, term->right);
+        break;
+    case TERM_ALTERNATE:
+    {
+        int split = emit(program, REGEX_SPLIT, program->length + 1, 0);
+        emit_term(program, term->left);
+        int jump = emit(program, REGEX_JMP, 0, 0);
+        program->code[split].y = program->length;
+        emit_term(program, term->right);
+        program->code[jump].x = program->length;
+        break;
+    }
+    case TERM_REPEAT:
+        emit_repeat(program, term);
+        break;
+    case TERM_GROUP:
+        emit(program, REGEX_SAVE, 2 * term->value, 0);
+        emit_term(program, term->left);
+        emit(program, REGEX_SAVE, 2 * term->value + 1, 0);
+        break;
+    case TERM_ASSERT:
+        emit(program, REGEX_ASSERT, term->value, 0);
+        break;
+    }
+}
+
+// --- Thread lists ---
+
+static void next_generation(RegexVm *vm, int length)
+{
+    if (vm->generation == INT_MAX)
+    {
+        memset(vm->mark, 0, sizeof(int) * length);
+        vm->generation = 0;
+    }
+    vm->generation++;
+}
+
+static int accepts(const RegexProgram *program, const RegexInst *inst, unsigned char c)
+{
+    switch (inst->op)
+    {
+    case REGEX_CHAR:
+        return c == inst->x;
+    case REGEX_ANY:
+        return 1;
+    case REGEX_CLASS:
+        return set_has(program->classes[inst->x], c);
+    default:
+        return 0;
+    }
+}
+
+// Adds to set the instructions reachable from pc without reading a byte, skipping
+// those already added in this generation
+static void closure(RegexProgram *program, int pc, int *set, int *count)
+{
+    RegexVm *vm = program->vm;
+    int top = 0;
+    vm->frames[top++].pc = pc;
+    while (top > 0)
+    {
+        for (pc = vm->frames[--top].pc; vm->mark[pc] != vm->generation;)
+        {
+            const RegexInst *inst = &program->code[pc];
+            vm->mark[pc] = vm->generation;
+            if (inst->op == REGEX_JMP)
+            {
+                pc = inst->x;
+            }
+            else if (inst->op == REGEX_SPLIT)
+            {
+                vm->frames[top++].pc = inst->y;
+                pc = inst->x;
+            }
+            else if (inst->op == REGEX_SAVE || inst->op == REGEX_ASSERT)
+            {
+                pc++;
+            }
+            else
+            {
+                set[(*count)++] = pc;
+                break;
+            }
+        }
+    }
+}
+
+static int word_byte(const RegexVm *vm, size_t pos)
+{
+    return pos < vm->length && (isalnum((unsigned char)vm->text[pos]) || vm->text[pos] == '_');
+}
+
+static int assertion_holds(const RegexVm *vm, int assertion, size_t pos)
+{
+    switch (assertion)
+    {
+    case REGEX_TEXT_START:
+        return pos == 0;
+    case REGEX_TEXT_END:
+        return pos == vm->length;
+    case REGEX_LINE_START:
+        return pos == 0 || vm->text[pos - 1] == '\n';
+    case REGEX_LINE_END:
+        return pos == vm->length || vm->text[pos] == '\n';
+    default:
+    {
+        int boundary = (pos > 0 && word_byte(vm, pos - 1)) != word_byte(vm, pos);
+        return assertion == REGEX_WORD_BOUNDARY ? boundary : !boundary;
+    }
+    }
+}
+
+// Like closure, for the Pike VM: appends threads to the list with their own copy
+// of slots, as recorded along the way, and drops those whose anchors fail
+static void add_thread(RegexProgram *program, int list, int pc, size_t *slots, size_t pos)
+{
+    RegexVm *vm = program->vm;
+    int top = 0;
+    vm->frames[top++] = (Frame){pc, -1, 0};
+    while (top > 0)
+    {
+        Frame frame = vm->frames[--top];
+        if (frame.slot >= 0)
+        {
+            slots[frame.slot] = frame.value;
+            continue;
+        }
+        for (pc = frame.pc; vm->mark[pc] != vm->generation;)
+        {
+            const RegexInst *inst = &program->code[pc];
+            vm->mark[pc] = vm->generation;
+            if (inst->op == REGEX_JMP)
+            {
+                pc = inst->x;
+            }
+            else if (inst->op == REGEX_SPLIT)
+            {
+                vm->frames[top++] = (Frame){inst->y, -1, 0};
+                pc = inst->x;
+            }
+            else if (inst->op == REGEX_SAVE)
+            {
+                vm->frames[top++] = (Frame){0, inst->x, slots[inst->x]};
+                slots[inst->x] = pos;
+                pc++;
+            }
+            else if (inst->op == REGEX_ASSERT)
+            {
+                if (!assertion_holds(vm, inst->x, pos))
+                    break;
+                pc++;
+            }
+            else
+            {
+                int n = vm->count[list]++;
+                vm->pcs[list][n] = pc;
+                memcpy(&vm->slots[list][(size_t)n * program->slots], slots, sizeof(size_t) * program->slots);
+                break;
+            }
+        }
+    }
+}
+
+// --- Compilation ---
+
+RegexProgram *regex_compile(const char *pattern, int flags, char *error, size_t error_size)
+{
+    RegexProgram *program = calloc(1, sizeof(RegexProgram));
+    if (!program)
+    {
+        perror("Failed to allocate regex program");
+        exit(EXIT_FAILURE);
+    }
+    Parser parser = {pattern, flags, program, NULL};
+    Term *term = parse_alternate(&parser);
+    if (!parser.error && *parser.p == ')')
+        parser.error = "unmatched )";
+    if (!parser.error && term_size(term) + 3 > REGEX_MAX_PROGRAM)
+        parser.error = "pattern too large";
+    if (parser.error)
+    {
+        snprintf(error, error_size, "%s", parser.error);
+        term_free(term);
+        regex_free(program);
+        return NULL;
+    }
+
+    int capacity = (int)term_size(term) + 3;
+    program->code = malloc(sizeof(RegexInst) * capacity);
+    emit(program, REGEX_SAVE, 0, 0);
+    emit_term(program, term);
+    emit(program, REGEX_SAVE, 1, 0);
+    emit(program, REGEX_MATCH, 0, 0);
+    term_free(term);
+    program->slots = 2 * (program->groups + 1);
+    int pc = 1;
+    while (program->code[pc].op == REGEX_SAVE)
+        pc++;
+    program->anchored = program->code[pc].op == REGEX_ASSERT && program->code[pc].x == REGEX_TEXT_START;
+
+    RegexVm *vm = calloc(1, sizeof(RegexVm));
+    int length = program->length;
+    vm->mark = calloc(length, sizeof(int));
+    vm->frames = malloc(sizeof(Frame) * (length + 1));
+    vm->set = malloc(sizeof(int) * length);
+    for (int i = 0; i < 2; i++)
+    {
+        vm->pcs[i] = malloc(sizeof(int) * length);
+        vm->slots[i] = malloc(sizeof(size_t) * length * program->slots);
+    }
+    vm->work = malloc(sizeof(size_t) * program->slots);
+    vm->best = malloc(sizeof(size_t) * program->slots);
+    if (!vm->mark || !vm->frames || !vm->set || !vm->pcs[0] || !vm->pcs[1] || !vm->slots[0] || !vm->slots[1])
+    {
+        perror("Failed to allocate regex program");
+        exit(EXIT_FAILURE);
+    }
+    program->vm = vm;
+
+    // The bytes a search can skip to when no thread is alive
+    int count = 0;
+    next_generation(vm, length);
+    closure(program, 0, vm->set, &count);
+    for (int i = 0; i < count; i++)
+    {
+        const RegexInst *inst = &program->code[vm->set[i]];
+        if (inst->op == REGEX_MATCH)
+            program->nullable = 1;
+        else if (inst->op == REGEX_CHAR)
+            set_add(program->first, inst->x);
+        else
+            for (int c = 0; c < 256; c++)
+                if (accepts(program, inst, (unsigned char)c))
+                    set_add(program->first, c);
+    }
+    program->first_byte = -1;
+    for (int c = 0; c < 256; c++)
+    {
+        if (set_has(program->first, c))
+        {
+            program->first_byte = program->first_byte == -1 ? c : -2;
+        }
+    }
+    if (program->first_byte < 0)
+        program->first_byte = -1;
+    return program;
+}
+
+void regex_free(RegexProgram *program)
+{
+    if (!program)
+        return;
+    if (program->dfa)
+    {
+        for (int i = 0; i < program->dfa->count; i++)
+        {
+            free(program->dfa->states[i]->pcs);
+            free(program->dfa->states[i]);
+        }
+        free(program->dfa->states);
+        free(program->dfa);
+    }
+    if (program->vm)
+    {
+        RegexVm *vm = program->vm;
+        free(vm->mark);
+        free(vm->frames);
+        free(vm->set);
+        for (int i = 0; i < 2; i++)
+        {
+            free(vm->pcs[i]);
+            free(vm->slots[i]);
+        }
+        free(vm->work);
+        free(vm->best);
+        free(vm);
+    }
+    for (int i = 1; i <= program->groups; i++)
+        free(program->names[i]);
+    free(program->names);
+    free(program->code);
+    free(program->classes);
+    free(program);
+}
+
+// The first position from pos on holding a byte a match can start with
+static size_t skip_to_first(const RegexProgram *program, const char *text, size_t length, size_t pos)
+{
+    if (program->first_byte >= 0)
+    {
+        const char *found = memchr(text + pos, program->first_byte, length - pos);
+        return found ? (size_t)(found - text) : length;
+    }
+    while (pos < length && !set_has(program->first, (unsigned char)text[pos]))
+        pos++;
+    return pos;
+}
+
+// --- Lazy DFA ---
+
+static int compare_pcs(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+// The state for the set of instructions, added if it is new; -1 when the DFA is full
+static int dfa_state(RegexProgram *program, int *set, int count)
+{
+    RegexDfa *dfa = program->dfa;
+    qsort(set, count, sizeof(int), compare_pcs);
+    unsigned hash = 2166136261u;
+    for (int i = 0; i < count; i++)
+        hash = (hash ^ (unsigned)set[i]) * 16777619u;
+
+    unsigned slot = hash & (DFA_TABLE_SIZE - 1);
+    for (; dfa->table[slot]; slot = (slot + 1) & (DFA_TABLE_SIZE - 1))
+    {
+        DfaState *state = dfa->states[dfa->table[slot] - 1];
+        if (state->count == count && memcmp(state->pcs, set, sizeof(int) * count) == 0)
+            return dfa->table[slot] - 1;
+    }
+    if (dfa->count == DFA_MAX_STATES)
+        return -1;
+
+    DfaState *state = malloc(sizeof(DfaState));
+    state->pcs = malloc(sizeof(int) * (count ? count : 1));
+    memcpy(state->pcs, set, sizeof(int) * count);
+    state->count = count;
+    state->match = 0;
+    for (int i = 0; i < count; i++)
+        if (program->code[set[i]].op == REGEX_MATCH)
+            state->match = 1;
+    for (int c = 0; c < 256; c++)
+        state->next[c] = -1;
+    if (dfa->count % 64 == 0)
+        dfa->states = realloc(dfa->states, sizeof(DfaState *) * (dfa->count + 64));
+    dfa->states[dfa->count] = state;
+    dfa->table[slot] = dfa->count + 1;
+    return dfa->count++;
+}
+
+// The state after reading c, with a new match allowed to start at every byte
+static int dfa_step(RegexProgram *program, int from, unsigned char c)
+{
+    RegexVm *vm = program->vm;
+    DfaState *state = program->dfa->states[from];
+    int count = 0;
+    next_generation(vm, program->length);
+    for (int i = 0; i < state->count; i++)
+    {
+        const RegexInst *inst = &program->code[state->pcs[i]];
+        if (accepts(program, inst, c))
+            closure(program, state->pcs[i] + 1, vm->set, &count);
+    }
+    closure(program, 0, vm->set, &count);
+    return dfa_state(program, vm->set, count);
+}
+
+// Whether a match ends anywhere in text from the given offset on: 1 or 0, or -1
+// when the DFA grew too large to answer
+static int dfa_search(RegexProgram *program, const char *text, size_t length, size_t from)
+{
+    if (!program->dfa)
+    {
+        program->dfa = calloc(1, sizeof(RegexDfa));
+        int count = 0;
+        next_generation(program->vm, program->length);
+        closure(program, 0, program->vm->set, &count);
+        program->dfa->start = dfa_state(program, program->vm->set, count);
+    }
+    RegexDfa *dfa = program->dfa;
+    int current = dfa->start;
+    if (dfa->states[current]->match)
+        return 1;
+    for (size_t pos = from; pos < length; pos++)
+    {
+        // With nothing under way, go straight to a byte a match can start with
+        if (current == dfa->start)
+        {
+            pos = skip_to_first(program, text, length, pos);
+            if (pos >= length)
+                break;
+        }
+        unsigned char c = (unsigned char)text[pos];
+        int next = dfa->states[current]->next[c];
+        if (next < 0)
+        {
+            next = dfa_step(program, current, c);
+            if (next < 0)
+                return -1;
+            dfa->states[current]->next[c] = next;
+        }
+        current = next;
+        if (dfa->states[current]->match)
+            return 1;
+    }
+    return 0;
+}
+
+// --- Searching ---
+
+// Runs every thread in step, a new one starting at each position until a match
+// is found; then only the threads that take priority over it carry on. With
+// nonempty set, an empty match at from does not count
+static int pike_search(RegexProgram *program, const char *text, size_t length, size_t from, size_t *spans, int nonempty)
+{
+    RegexVm *vm = program->vm;
+    int slots = program->slots;
+    vm->text = text;
+    vm->length = length;
+    int current = 0;
+    int matched = 0;
+    vm->count[current] = 0;
+    next_generation(vm, program->length);
+    for (size_t pos = from;; pos++)
+    {
+        if (!matched && vm->count[current] == 0)
+        {
+            // Nothing is under way, so the search can jump ahead; instructions
+            // visited at an earlier position must not count as visited here
+            if (program->anchored && pos > 0)
+                break;
+            next_generation(vm, program->length);
+            if (!program->nullable)
+            {
+                pos = skip_to_first(program, text, length, pos);
+                if (pos >= length)
+                    break;
+            }
+        }
+        if (!matched && (!program->anchored || pos == 0))
+        {
+            for (int i = 0; i < slots; i++)
+                vm->work[i] = REGEX_NONE;
+            add_thread(program, current, 0, vm->work, pos);
+        }
+        if (vm->count[current] == 0)
+        {
+            // Every thread failed an anchor; a new one starts at the next position
+            if (matched || pos >= length)
+                break;
+            continue;
+        }
+
+        int next = 1 - current;
+        vm->count[next] = 0;
+        next_generation(vm, program->length);
+        for (int i = 0; i < vm->count[current]; i++)
+        {
+            size_t *thread_slots = &vm->slots[current][(size_t)i * slots];
+            const RegexInst *inst = &program->code[vm->pcs[current][i]];
+            if (inst->op == REGEX_MATCH)
+            {
+                if (nonempty && thread_slots[0] == from && thread_slots[1] == from)
+                    continue;
+                memcpy(vm->best, thread_slots, sizeof(size_t) * slots);
+                matched = 1;
+                break;
+            }
+            if (pos < length && accepts(program, inst, (unsigned char)text[pos]))
+                add_thread(program, next, vm->pcs[current][i] + 1, thread_slots, pos + 1);
+        }
+        current = next;
+        if (pos >= length)
+            break;
+    }
+    if (!matched)
+        return 0;
+    if (spans != vm->best)
+        memcpy(spans, vm->best, sizeof(size_t) * slots);
+    return 1;
+}
+
+int regex_test(RegexProgram *program, const char *text, size_t length)
+{
+    int found = program->assertions ? -1 : dfa_search(program, text, length, 0);
+    if (found >= 0)
+        return found;
+    return pike_search(program, text, length, 0, program->vm->best, 0);
+}
+
+static int search(RegexProgram *program, const char *text, size_t length, size_t from, size_t *spans, int nonempty)
+{
+    // The DFA rules out a text with no match left in it without tracking positions
+    if (from > length || (!program->assertions && dfa_search(program, text, length, from) == 0))
+        return 0;
+    return pike_search(program, text, length, from, spans, nonempty);
+}
+
+int regex_search(RegexProgram *program, const char *text, size_t length, size_t from, size_t *spans)
+{
+    return search(program, text, length, from, spans, 0);
+}
+
+int regex_group_index(const RegexProgram *program, const char *name)
+{
+    for (int i = 1; i <= program->groups; i++)
+        if (program->names[i] && strcmp(program->names[i], name) == 0)
+            return i;
+    return -1;
+}
+
+void regex_iter_init(RegexIterator *iter, RegexProgram *program, const char *text, size_t length)
+{
+    iter->program = program;
+    iter->text = text;
+    iter->length = length;
+    iter->pos = 0;
+    iter->after_empty = 0;
+    iter->done = 0;
+}
+
+int regex_iter_next(RegexIterator *iter, size_t *spans)
+{
+    if (iter->done || !search(iter->program, iter->text, iter->length, iter->pos, spans, iter->after_empty))
+    {
+        iter->done = 1;
+        return 0;
+    }
+    iter->pos = spans[1];
+    iter->after_empty = spans[1] == spans[0];
+    return 1;
+}
@@ -0,0 +1,567 @@
+#include <pthread.h>
+#include <string.h>
+#include "simd.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+typedef struct
+{
+    const char *name;
+    double (*sum)(const double *values, size_t count);
+    double (*dot)(const double *a, const double *b, size_t count);
+    double (*squared_deviation)(const double *values, size_t count, double mean);
+    double (*min)(const double *values, size_t count);
+    double (*max)(const double *values, size_t count);
+    size_t (*count_compare)(const double *values, size_t count, SimdCompare op, double threshold);
+    size_t (*find)(const double *values, size_t count, double target);
+    void (*axpy)(double *y, double alpha, const double *x, size_t count);
+    size_t (*find_pair)(const unsigned char *text, size_t count, unsigned char first, unsigned char last, size_t gap);
+} SimdKernels;
+
+// Scalar kernels. Four accumulators break the add dependency chain, and they finish
+// the tails of the vector kernels.
+
+static double scalar_sum(const double *values, size_t count)
+{
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        s0 += values[i];
+        s1 += values[i + 1];
+        s2 += values[i + 2];
+        s3 += values[i + 3];
+    }
+    for (; i < count; i++)
+        s0 += values[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static double scalar_dot(const double *a, const double *b, size_t count)
+{
+    double s0 = 0, s1 = 0;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+    }
+    for (; i < count; i++)
+        s0 += a[i] * b[i];
+    return s0 + s1;
+}
+
+static double scalar_squared_deviation(const double *values, size_t count, double mean)
+{
+    double total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        double d = values[i] - mean;
+        total += d * d;
+    }
+    return total;
+}
+
+static double scalar_min(const double *values, size_t count)
+{
+    double result = values[0];
+    for (size_t i = 1; i < count; i++)
+        if (values[i] < result)
+            result = values[i];
+    return result;
+}
+
+static double scalar_max(const double *values, size_t count)
+{
+    double result = values[0];
+    for (size_t i = 1; i < count; i++)
+        if (values[i] > result)
+            result = values[i];
+    return result;
+}
+
+static int compare_scalar(double value, SimdCompare op, double threshold)
+{
+    switch (op)
+    {
+    case SIMD_LESS:
+        return value < threshold;
+    case SIMD_LESS_EQUAL:
+        return value <= threshold;
+    case SIMD_GREATER:
+        return value > threshold;
+    case SIMD_GREATER_EQUAL:
+        return value >= threshold;
+    case SIMD_EQUAL:
+        return value == threshold;
+    default:
+        return value != threshold;
+    }
+}
+
+static size_t scalar_count_compare(const double *values, size_t count, SimdCompare op, double threshold)
+{
+    size_t matches = 0;
+    for (size_t i = 0; i < count; i++)
+        matches += compare_scalar(values[i], op, threshold);
+    return matches;
+}
+
+static size_t scalar_find(const double *values, size_t count, double target)
+{
+    for (size_t i = 0; i < count; i++)
+        if (values[i] == target)
+            return i;
+    return count;
+}
+
+static void scalar_axpy(double *y, double alpha, const double *x, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        y[i] += alpha * x[i];
+}
+
+// memchr is itself vectorized in most C libraries, so this is only scalar in name
+static size_t scalar_find_pair(const unsigned char *text, size_t count, unsigned char first, unsigned char last, size_t gap)
+{
+    const unsigned char *end = text + count;
+    for (const unsigned char *p = text; (p = memchr(p, first, end - p)) != NULL; p++)
+    {
+        if (p[gap] == last)
+            return p - text;
+    }
+    return count;
+}
+
+static const SimdKernels scalar_kernels = {
+    "scalar", scalar_sum, scalar_dot, scalar_squared_deviation, scalar_min, scalar_max,
+    scalar_count_compare, scalar_find, scalar_axpy, scalar_find_pair};
+
+#ifdef SIMD_X86
+
+// SSE2 kernels: two doubles per register, always available on x86-64
+
+static double hsum128(__m128d v)
+{
+    double lanes[2];
+    _mm_storeu_pd(lanes, v);
+    return lanes[0] + lanes[1];
+}
+
+static double sse2_sum(const double *values, size_t count)
+{
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    __m128d acc2 = _mm_setzero_pd(), acc3 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(values + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(values + i + 2));
+        acc2 = _mm_add_pd(acc2, _mm_loadu_pd(values + i + 4));
+        acc3 = _mm_add_pd(acc3, _mm_loadu_pd(values + i + 6));
+    }
+    double total = hsum128(_mm_add_pd(_mm_add_pd(acc0, acc1), _mm_add_pd(acc2, acc3)));
+    return total + scalar_sum(values + i, count - i);
+}
+
+static double sse2_dot(const double *a, const double *b, size_t count)
+{
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    return hsum128(_mm_add_pd(acc0, acc1)) + scalar_dot(a + i, b + i, count - i);
+}
+
+static double sse2_squared_deviation(const double *values, size_t count, double mean)
+{
+    __m128d center = _mm_set1_pd(mean), acc = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d d = _mm_sub_pd(_mm_loadu_pd(values + i), center);
+        acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+    }
+    return hsum128(acc) + scalar_squared_deviation(values + i, count - i, mean);
+}
+
+static double sse2_min(const double *values, size_t count)
+{
+    if (count < 2)
+        return values[0];
+    __m128d acc = _mm_loadu_pd(values);
+    size_t i = 2;
+    for (; i + 2 <= count; i += 2)
+        acc = _mm_min_pd(acc, _mm_loadu_pd(values + i));
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double result = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    return i < count && values[i] < result ? values[i] : result;
+}
+
+static double sse2_max(const double *values, size_t count)
+{
+    if (count < 2)
+        return values[0];
+    __m128d acc = _mm_loadu_pd(values);
+    size_t i = 2;
+    for (; i + 2 <= count; i += 2)
+        acc = _mm_max_pd(acc, _mm_loadu_pd(values + i));
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double result = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    return i < count && values[i] > result ? values[i] : result;
+}
+
+static __m128d sse2_compare(__m128d v, __m128d t, SimdCompare op)
+{
+    switch (op)
+    {
+    case SIMD_LESS:
+        return _mm_cmplt_pd(v, t);
+    case SIMD_LESS_EQUAL:
+        return _mm_cmple_pd(v, t);
+    case SIMD_GREATER:
+        return _mm_cmpgt_pd(v, t);
+    case SIMD_GREATER_EQUAL:
+        return _mm_cmpge_pd(v, t);
+    case SIMD_EQUAL:
+        return _mm_cmpeq_pd(v, t);
+    default:
+        return _mm_cmpneq_pd(v, t);
+    }
+}
+
+static size_t sse2_count_compare(const double *values, size_t count, SimdCompare op, double threshold)
+{
+    __m128d t = _mm_set1_pd(threshold);
+    size_t matches = 0, i = 0;
+    for (; i + 2 <= count; i += 2)
+        matches += __builtin_popcount(_mm_movemask_pd(sse2_compare(_mm_loadu_pd(values + i), t, op)));
+    return matches + scalar_count_compare(values + i, count - i, op, threshold);
+}
+
+static size_t sse2_find(const double *values, size_t count, double target)
+{
+    __m128d t = _mm_set1_pd(target);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        int mask = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(values + i), t));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + scalar_find(values + i, count - i, target);
+}
+
+static void sse2_axpy(double *y, double alpha, const double *x, size_t count)
+{
+    __m128d a = _mm_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(a, _mm_loadu_pd(x + i))));
+        _mm_storeu_pd(y + i + 2, _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_mul_pd(a, _mm_loadu_pd(x + i + 2))));
+    }
+    scalar_axpy(y + i, alpha, x + i, count - i);
+}
+
+// Compares sixteen positions at once against both bytes of the pair
+static size_t sse2_find_pair(const unsigned char *text, size_t count, unsigned char first, unsigned char last, size_t gap)
+{
+    __m128i f = _mm_set1_epi8((char)first);
+    __m128i l = _mm_set1_epi8((char)last);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(text + i)), f);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(text + i + gap)), l);
+        int mask = _mm_movemask_epi8(_mm_and_si128(a, b));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + scalar_find_pair(text + i, count - i, first, last, gap);
+}
+
+static const SimdKernels sse2_kernels = {
+    "sse2", sse2_sum, sse2_dot, sse2_squared_deviation, sse2_min, sse2_max,
+    sse2_count_compare, sse2_find, sse2_axpy, sse2_find_pair};
+
+// AVX2 kernels: four doubles per register, compiled for AVX2 whatever the build flags
+// and only called when the CPU reports support
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static double hsum256(__m256d v)
+{
+    double lanes[4];
+    _mm256_storeu_pd(lanes, v);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+AVX2 static double avx2_sum(const double *values, size_t count)
+{
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + i + 4));
+        acc2 = _mm256_add_pd(acc2, _mm256_loadu_pd(values + i + 8));
+        acc3 = _mm256_add_pd(acc3, _mm256_loadu_pd(values + i + 12));
+    }
+    double total = hsum256(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    return total + scalar_sum(values + i, count - i);
+}
+
+AVX2 static double avx2_dot(const double *a, const double *b, size_t count)
+{
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    return hsum256(_mm256_add_pd(acc0, acc1)) + scalar_dot(a + i, b + i, count - i);
+}
+
+AVX2 static double avx2_squared_deviation(const double *values, size_t count, double mean)
+{
+    __m256d center = _mm256_set1_pd(mean), acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(values + i), center);
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(values + i + 4), center);
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(d0, d0));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(d1, d1));
+    }
+    return hsum256(_mm256_add_pd(acc0, acc1)) + scalar_squared_deviation(values + i, count - i, mean);
+}
+
+AVX2 static double avx2_min(const double *values, size_t count)
+{
+    if (count < 4)
+        return scalar_min(values, count);
+    __m256d acc = _mm256_loadu_pd(values);
+    size_t i = 4;
+    for (; i + 4 <= count; i += 4)
+        acc = _mm256_min_pd(acc, _mm256_loadu_pd(values + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double result = scalar_min(lanes, 4);
+    for (; i < count; i++)
+        if (values[i] < result)
+            result = values[i];
+    return result;
+}
+
+AVX2 static double avx2_max(const double *values, size_t count)
+{
+    if (count < 4)
+        return scalar_max(values, count);
+    __m256d acc = _mm256_loadu_pd(values);
+    size_t i = 4;
+    for (; i + 4 <= count; i += 4)
+        acc = _mm256_max_pd(acc, _mm256_loadu_pd(values + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double result = scalar_max(lanes, 4);
+    for (; i < count; i++)
+        if (values[i] > result)
+            result = values[i];
+    return result;
+}
+
+// The comparison predicate has to be a constant, so each operator gets its own loop
+#define AVX2_COUNT_LOOP(predicate)                                                                \
+    for (; i + 4 <= count; i += 4)                                                                \
+        matches += __builtin_popcount(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), \
+                                                                       t, predicate)));           \
+    break;
+
+AVX2 static size_t avx2_count_compare(const double *values, size_t count, SimdCompare op, double threshold)
+{
+    __m256d t = _mm256_set1_pd(threshold);
+    size_t matches = 0, i = 0;
+    switch (op)
+    {
+    case SIMD_LESS:
+        AVX2_COUNT_LOOP(_CMP_LT_OQ)
+    case SIMD_LESS_EQUAL:
+        AVX2_COUNT_LOOP(_CMP_LE_OQ)
+    case SIMD_GREATER:
+        AVX2_COUNT_LOOP(_CMP_GT_OQ)
+    case SIMD_GREATER_EQUAL:
+        AVX2_COUNT_LOOP(_CMP_GE_OQ)
+    case SIMD_EQUAL:
+        AVX2_COUNT_LOOP(_CMP_EQ_OQ)
+    default:
+        AVX2_COUNT_LOOP(_CMP_NEQ_UQ)
+    }
+    return matches + scalar_count_compare(values + i, count - i, op, threshold);
+}
+
+AVX2 static size_t avx2_find(const double *values, size_t count, double target)
+{
+    __m256d t = _mm256_set1_pd(target);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        int low = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), t, _CMP_EQ_OQ));
+        int high = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i + 4), t, _CMP_EQ_OQ));
+        int mask = low | (high << 4);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + scalar_find(values + i, count - i, target);
+}
+
+AVX2 static void avx2_axpy(double *y, double alpha, const double *x, size_t count)
+{
+    __m256d a = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256d y0 = _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(a, _mm256_loadu_pd(x + i)));
+        __m256d y1 = _mm256_add_pd(_mm256_loadu_pd(y + i + 4), _mm256_mul_pd(a, _mm256_loadu_pd(x + i + 4)));
+        _mm256_storeu_pd(y + i, y0);
+        _mm256_storeu_pd(y + i + 4, y1);
+    }
+    scalar_axpy(y + i, alpha, x + i, count - i);
+}
+
+AVX2 static size_t avx2_find_pair(const unsigned char *text, size_t count, unsigned char first, unsigned char last, size_t gap)
+{
+    __m256i f = _mm256_set1_epi8((char)first);
+    __m256i l = _mm256_set1_epi8((char)last);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(text + i)), f);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(text + i + gap)), l);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(a, b));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + sse2_find_pair(text + i, count - i, first, last, gap);
+}
+
+static const SimdKernels avx2_kernels = {
+    "avx2", avx2_sum, avx2_dot, avx2_squared_deviation, avx2_min, avx2_max,
+    avx2_count_compare, avx2_find, avx2_axpy, avx2_find_pair};
+
+#endif
+
+static const SimdKernels *active_kernels = NULL;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static void select_kernels(void)
+{
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    active_kernels = __builtin_cpu_supports("avx2") ? &avx2_kernels : &sse2_kernels;
+#else
+    active_kernels = &scalar_kernels;
+#endif
+}
+
+// The first caller picks the kernels; pthread_once keeps concurrent first calls
+// (such as the correlation workers) from racing on the choice
+static const SimdKernels *kernels(void)
+{
+    pthread_once(&kernels_once, select_kernels);
+    return active_kernels;
+}
+
+double simd_sum(const double *values, size_t count)
+{
+    return kernels()->sum(values, count);
+}
+
+double simd_dot(const double *a, const double *b, size_t count)
+{
+    return kernels()->dot(a, b, count);
+}
+
+double simd_squared_deviation(const double *values, size_t count, double mean)
+{
+    return kernels()->squared_deviation(values, count, mean);
+}
+
+double simd_min(const double *values, size_t count)
+{
+    return kernels()->min(values, count);
+}
+
+double simd_max(const double *values, size_t count)
+{
+    return kernels()->max(values, count);
+}
+
+size_t simd_argmin(const double *values, size_t count)
+{
+    return kernels()->find(values, count, kernels()->min(values, count));
+}
+
+size_t simd_argmax(const double *values, size_t count)
+{
+    return kernels()->find(values, count, kernels()->max(values, count));
+}
+
+size_t simd_count_compare(const double *values, size_t count, SimdCompare op, double threshold)
+{
+    return kernels()->count_compare(values, count, op, threshold);
+}
+
+size_t simd_find(const double *values, size_t count, double target)
+{
+    return kernels()->find(values, count, target);
+}
+
+void simd_axpy(double *y, double alpha, const double *x, size_t count)
+{
+    kernels()->axpy(y, alpha, x, count);
+}
+
+size_t simd_find_byte_pair(const char *text, size_t count, unsigned char first, unsigned char last, size_t gap)
+{
+    return kernels()->find_pair((const unsigned char *)text, count, first, last, gap);
+}
+
+const char *simd_backend(void)
+{
+    return kernels()->name;
+}
+
+int simd_set_backend(const char *name)
+{
+    // Select first so the default choice can never overwrite a forced one
+    pthread_once(&kernels_once, select_kernels);
+    if (strcmp(name, "scalar") == 0)
+    {
+        active_kernels = &scalar_kernels;
+        return 1;
+    }
+#ifdef SIMD_X86
+    if (strcmp(name, "sse2") == 0)
+    {
+        active_kernels = &sse2_kernels;
+        return 1;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+    {
+        active_kernels = &avx2_kernels;
+        return 1;
+    }
+#endif
+    return 0;
+}
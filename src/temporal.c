@@ -0,0 +1,2419 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "temporal.h"
+#include "simd.h"
+
+#define TEMPORAL_INITIAL_CAPACITY 16
+
+static long long next_id = 1;
+
+static void window_free(TemporalWindow *window);
+static void window_remove(TemporalVariable *history, TemporalWindow *window, double value);
+static void window_add(TemporalVariable *history, TemporalWindow *window, double value);
+static void detector_add(TemporalVariable *history, TemporalDetector *detector, double value, int count,
+                         const double *newest);
+static void detector_remove(TemporalDetector *detector, int count, const double *oldest);
+static void trigger_add(TemporalTrigger *trigger, double value, long long time, int notify);
+static void trigger_arm(TemporalVariable *history, TemporalTrigger *trigger);
+static void archive_append(TemporalArchive *archive, double value, long long time);
+static void archive_free(TemporalArchive *archive);
+
+TemporalVariable *temporal_new(int max_history)
+{
+    if (max_history < 1)
+        max_history = 1;
+    TemporalVariable *history = malloc(sizeof(TemporalVariable));
+    history->capacity = max_history < TEMPORAL_INITIAL_CAPACITY ? max_history : TEMPORAL_INITIAL_CAPACITY;
+    history->values = malloc(sizeof(double) * history->capacity);
+    history->times = malloc(sizeof(long long) * history->capacity);
+    history->texts = NULL;
+    history->head = 0;
+    history->count = 0;
+    history->max_history = max_history;
+    history->total = 0;
+    history->id = next_id++;
+    history->window_count = 0;
+    history->detector_count = 0;
+    history->trigger_count = 0;
+    history->archive = NULL;
+    history->log = NULL;
+    history->scratch[0] = '\0';
+    return history;
+}
+
+void temporal_free(TemporalVariable *history)
+{
+    if (history->texts)
+    {
+        for (int i = 0; i < history->capacity; i++)
+            free(history->texts[i]);
+        free(history->texts);
+    }
+    for (int i = 0; i < history->window_count; i++)
+        window_free(history->windows[i]);
+    for (int i = 0; i < history->detector_count; i++)
+        free(history->detectors[i]);
+    for (int i = 0; i < history->trigger_count; i++)
+        free(history->triggers[i]);
+    if (history->archive)
+        archive_free(history->archive);
+    if (history->log)
+        temporal_log_close(history->log);
+    free(history->values);
+    free(history->times);
+    free(history);
+}
+
+static int slot_of(const TemporalVariable *history, int i)
+{
+    int slot = history->head + i;
+    return slot >= history->capacity ? slot - history->capacity : slot;
+}
+
+// Slot for a new sample, dropping the oldest once the history is full
+static int claim_slot(TemporalVariable *history)
+{
+    if (history->count == history->capacity && history->capacity < history->max_history)
+    {
+        // Not wrapped yet (head is 0), so the samples stay in place
+        int capacity = history->capacity * 2;
+        if (capacity > history->max_history)
+            capacity = history->max_history;
+        history->values = realloc(history->values, sizeof(double) * capacity);
+        history->times = realloc(history->times, sizeof(long long) * capacity);
+        if (history->texts)
+        {
+            history->texts = realloc(history->texts, sizeof(char *) * capacity);
+            memset(history->texts + history->capacity, 0, sizeof(char *) * (capacity - history->capacity));
+        }
+        history->capacity = capacity;
+    }
+    if (history->count < history->capacity)
+        return slot_of(history, history->count++);
+
+    int slot = history->head;
+    history->head = slot + 1 == history->capacity ? 0 : slot + 1;
+    return slot;
+}
+
+// Store value as the newest sample and bring the window trackers up to date
+static int store(TemporalVariable *history, double value)
+{
+    // Read the samples leaving each window before the ring can overwrite them
+    double leaving[TEMPORAL_MAX_WINDOWS];
+    for (int i = 0; i < history->window_count; i++)
+    {
+        TemporalWindow *window = history->windows[i];
+        if (window->count == window->size)
+            leaving[i] = temporal_value(history, history->count - window->size);
+    }
+    // and the samples at both ends that the detectors look at
+    int count = history->count;
+    int evicting = count == history->max_history;
+    double oldest[3], newest[2];
+    if (history->detector_count > 0)
+    {
+        for (int i = 0; i < 3 && i < count; i++)
+            oldest[i] = temporal_value(history, i);
+        for (int i = 0; i < 2 && i < count; i++)
+            newest[i] = temporal_value(history, count - 1 - i);
+    }
+    if (evicting && history->archive)
+        archive_append(history->archive, temporal_value(history, 0), temporal_time(history, 0));
+
+    int slot = claim_slot(history);
+    long long time = temporal_now();
+    history->values[slot] = value;
+    history->times[slot] = time;
+    history->total++;
+    if (history->log)
+        temporal_log_append(history->log, time, value);
+
+    for (int i = 0; i < history->window_count; i++)
+    {
+        TemporalWindow *window = history->windows[i];
+        if (window->count == window->size)
+            window_remove(history, window, leaving[i]);
+        window_add(history, window, value);
+    }
+    for (int i = 0; i < history->detector_count; i++)
+    {
+        if (evicting)
+            detector_remove(history->detectors[i], count, oldest);
+        detector_add(history, history->detectors[i], value, history->count, newest);
+    }
+    for (int i = 0; i < history->trigger_count; i++)
+        trigger_add(history->triggers[i], value, time, 1);
+    return slot;
+}
+
+void temporal_push(TemporalVariable *history, double value)
+{
+    int slot = store(history, value);
+    if (history->texts && history->texts[slot])
+    {
+        free(history->texts[slot]);
+        history->texts[slot] = NULL;
+    }
+}
+
+void temporal_push_text(TemporalVariable *history, const char *text)
+{
+    char *end;
+    double value = strtod(text, &end);
+    char formatted[32];
+    snprintf(formatted, sizeof(formatted), "%g", value);
+    if (end != text && *end == '\0' && strcmp(formatted, text) == 0)
+    {
+        temporal_push(history, value);
+        return;
+    }
+
+    // Numeric reads of text keep the old strtod behaviour, e.g. "abc" counts as 0
+    int slot = store(history, value);
+    if (!history->texts)
+        history->texts = calloc(history->capacity, sizeof(char *));
+    free(history->texts[slot]);
+    history->texts[slot] = strdup(text);
+}
+
+// A quiet NaN. Built from its bits, since -ffast-math lets the compiler assume
+// there are no NaNs
+static double missing_value(void)
+{
+    uint64_t bits = 0x7FF8000000000000ULL;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void temporal_push_missing(TemporalVariable *history)
+{
+    temporal_push(history, missing_value());
+}
+
+int temporal_missing(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x7FF0000000000000ULL) == 0x7FF0000000000000ULL && (bits & 0x000FFFFFFFFFFFFFULL) != 0;
+}
+
+double temporal_value(const TemporalVariable *history, int i)
+{
+    return history->values[slot_of(history, i)];
+}
+
+// Samples [start, start + count) into out, oldest first; at most two block copies
+static void copy_range(const TemporalVariable *history, int start, int count, double *out)
+{
+    if (count <= 0)
+        return;
+    int first = slot_of(history, start);
+    int run = history->capacity - first < count ? history->capacity - first : count;
+    memcpy(out, history->values + first, sizeof(double) * run);
+    memcpy(out + run, history->values, sizeof(double) * (count - run));
+}
+
+const char *temporal_text(TemporalVariable *history, int i)
+{
+    int slot = slot_of(history, i);
+    if (history->texts && history->texts[slot])
+        return history->texts[slot];
+    if (temporal_missing(history->values[slot]))
+        return "UNDEF";
+    snprintf(history->scratch, sizeof(history->scratch), "%g", history->values[slot]);
+    return history->scratch;
+}
+
+// --- Time ---
+
+long long temporal_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+long long temporal_time(const TemporalVariable *history, int i)
+{
+    return history->times[slot_of(history, i)];
+}
+
+static const struct
+{
+    const char *name;
+    long long ns;
+} duration_units[] = {
+    {"ns", 1LL}, {"us", 1000LL}, {"ms", 1000000LL},
+    {"s", 1000000000LL}, {"sec", 1000000000LL}, {"secs", 1000000000LL},
+    {"second", 1000000000LL}, {"seconds", 1000000000LL},
+    {"m", 60000000000LL}, {"min", 60000000000LL}, {"mins", 60000000000LL},
+    {"minute", 60000000000LL}, {"minutes", 60000000000LL},
+    {"h", 3600000000000LL}, {"hour", 3600000000000LL}, {"hours", 3600000000000LL},
+    {"d", 86400000000000LL}, {"day", 86400000000000LL}, {"days", 86400000000000LL},
+};
+
+int temporal_parse_duration(const char *text, long long *ns, int *has_unit)
+{
+    char *end;
+    double amount = strtod(text, &end);
+    if (end == text || amount < 0)
+        return 0;
+    while (*end == ' ')
+        end++;
+    *has_unit = 0;
+    *ns = (long long)amount;
+    if (*end == '\0')
+        return 1;
+    for (size_t i = 0; i < sizeof(duration_units) / sizeof(duration_units[0]); i++)
+    {
+        if (strcasecmp(end, duration_units[i].name) == 0)
+        {
+            *has_unit = 1;
+            *ns = (long long)(amount * duration_units[i].ns);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// "start", "now"/"end", a time of day "HH:MM[:SS]" or a duration ago
+static int parse_bound(const char *text, TemporalBound *bound)
+{
+    bound->clock = 0;
+    if (strcasecmp(text, "start") == 0)
+    {
+        bound->ns = LLONG_MAX;
+        return 1;
+    }
+    if (strcasecmp(text, "now") == 0 || strcasecmp(text, "end") == 0)
+    {
+        bound->ns = 0;
+        return 1;
+    }
+    int hours, minutes, seconds = 0, used = 0;
+    if (strchr(text, ':'))
+    {
+        if ((sscanf(text, "%d:%d:%d%n", &hours, &minutes, &seconds, &used) != 3 &&
+             sscanf(text, "%d:%d%n", &hours, &minutes, &used) != 2) || text[used] != '\0')
+            return 0;
+        bound->clock = 1;
+        bound->ns = ((hours * 60LL + minutes) * 60 + seconds) * 1000000000LL;
+        return 1;
+    }
+    int has_unit;
+    return temporal_parse_duration(text, &bound->ns, &has_unit) && has_unit;
+}
+
+int temporal_parse_span(const char *text, TemporalSpan *span)
+{
+    while (isspace((unsigned char)*text))
+        text++;
+    if (strncmp(text, "last ", 5) == 0)
+    {
+        long long amount;
+        int has_unit;
+        if (!temporal_parse_duration(text + 5, &amount, &has_unit))
+            return 0;
+        if (!has_unit)
+        {
+            span->kind = TEMPORAL_SPAN_COUNT;
+            span->count = amount > INT_MAX ? INT_MAX : (int)amount;
+            return 1;
+        }
+        span->kind = TEMPORAL_SPAN_TIME;
+        span->from.clock = 0;
+        span->from.ns = amount;
+        span->to.clock = 0;
+        span->to.ns = 0;
+        return 1;
+    }
+    if (strncmp(text, "between ", 8) == 0)
+    {
+        char from[32], to[32];
+        int used = 0;
+        if (sscanf(text + 8, "%31s %31s %n", from, to, &used) != 2 || text[8 + used] != '\0')
+            return 0;
+        span->kind = TEMPORAL_SPAN_TIME;
+        return parse_bound(from, &span->from) && parse_bound(to, &span->to);
+    }
+    return 0;
+}
+
+// Monotonic time of a bound, saturating instead of overflowing
+static long long bound_time(const TemporalBound *bound, long long now)
+{
+    long long age = bound->ns;
+    if (bound->clock)
+    {
+        // Age of that time today on the wall clock
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        struct tm local;
+        localtime_r(&ts.tv_sec, &local);
+        long long since_midnight = ((local.tm_hour * 60LL + local.tm_min) * 60 + local.tm_sec) * 1000000000LL + ts.tv_nsec;
+        age = since_midnight - bound->ns;
+    }
+    if (age == LLONG_MAX || (age > 0 && now < LLONG_MIN + age))
+        return LLONG_MIN;
+    return now - age;
+}
+
+// Bucket of bucket_ns holding time. Floor division, so buckets line up on
+// multiples of bucket_ns
+static long long bucket_of(long long time, long long bucket_ns)
+{
+    return time / bucket_ns - (time % bucket_ns < 0);
+}
+
+// First sample written at or after time
+static int lower_bound(const TemporalVariable *history, long long time)
+{
+    int low = 0, high = history->count;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (temporal_time(history, mid) < time)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+int temporal_downsample(const TemporalVariable *history, int start, int end, long long bucket_ns,
+                        TemporalStat stat, double *out)
+{
+    int buckets = 0;
+    int first = start;
+    while (first < end)
+    {
+        long long limit = bucket_ns * (bucket_of(temporal_time(history, first), bucket_ns) + 1);
+        int last = first + 1;
+        while (last < end && temporal_time(history, last) < limit)
+            last++;
+        out[buckets++] = temporal_range_stat(history, first, last, stat);
+        first = last;
+    }
+    return buckets;
+}
+
+// --- Selectors and conditions ---
+
+static const char *const stat_names[] = {
+    [TEMPORAL_SUM] = "sum", [TEMPORAL_MEAN] = "avg", [TEMPORAL_MIN] = "min", [TEMPORAL_MAX] = "max",
+    [TEMPORAL_VARIANCE] = "variance", [TEMPORAL_STDDEV] = "stddev", [TEMPORAL_RANGE] = "range",
+    [TEMPORAL_MEDIAN] = "median", [TEMPORAL_COUNT] = "count", [TEMPORAL_FIRST] = "first",
+    [TEMPORAL_LAST] = "last",
+};
+
+static int index_of(const char *const *names, int count, const char *name)
+{
+    for (int i = 0; i < count; i++)
+        if (strcmp(names[i], name) == 0)
+            return i;
+    return -1;
+}
+
+int temporal_stat_by_name(const char *name)
+{
+    return index_of(stat_names, sizeof(stat_names) / sizeof(stat_names[0]), name);
+}
+
+int temporal_parse_pattern(const char *text, TemporalPatternSpec *spec)
+{
+    static const struct
+    {
+        const char *name;
+        TemporalPattern pattern;
+        int params;
+        double a, b; // Defaults
+    } patterns[] = {
+        {"trend", TEMPORAL_TREND, 0, 0, 0},   {"cycle", TEMPORAL_CYCLE, 0, 0, 0},
+        {"anomaly", TEMPORAL_ANOMALY, 0, 0, 0}, {"ewma", TEMPORAL_EWMA, 1, 0.1, 0},
+        {"cusum", TEMPORAL_CUSUM, 1, 0.5, 0}, {"holt", TEMPORAL_HOLT, 2, 0.5, 0.1},
+    };
+    char name[16];
+    int used = 0;
+    if (sscanf(text, " %15[a-z]%n", name, &used) != 1)
+        return 0;
+    int found = -1;
+    for (int i = 0; i < (int)(sizeof(patterns) / sizeof(patterns[0])); i++)
+        if (strcmp(name, patterns[i].name) == 0)
+            found = i;
+    if (found < 0)
+        return 0;
+
+    spec->pattern = patterns[found].pattern;
+    double params[2] = {patterns[found].a, patterns[found].b};
+    const char *rest = text + used;
+    for (int i = 0; i < patterns[found].params; i++)
+    {
+        char *end;
+        double value = strtod(rest, &end);
+        if (end == rest)
+            break;
+        params[i] = value;
+        rest = end;
+    }
+    while (isspace((unsigned char)*rest))
+        rest++;
+    if (*rest != '\0')
+        return 0;
+    spec->a = params[0];
+    spec->b = params[1];
+
+    // Smoothing constants are weights in (0, 1]; the CUSUM slack is a distance
+    if (spec->pattern == TEMPORAL_CUSUM)
+        return spec->a >= 0;
+    if (spec->pattern == TEMPORAL_EWMA || spec->pattern == TEMPORAL_HOLT)
+        return spec->a > 0 && spec->a <= 1 && spec->b >= 0 && spec->b <= 1;
+    return 1;
+}
+
+// Whether text is a number and nothing else (surrounding spaces aside)
+static int parse_number(const char *text, double *value)
+{
+    char *end;
+    *value = strtod(text, &end);
+    if (end == text)
+        return 0;
+    while (isspace((unsigned char)*end))
+        end++;
+    return *end == '\0';
+}
+
+void temporal_parse_condition(const char *text, TemporalCondition *condition)
+{
+    condition->op = TEMPORAL_COND_NONE;
+    condition->a = 0;
+    condition->b = 0;
+    while (isspace((unsigned char)*text))
+        text++;
+
+    if (strncmp(text, "between ", 8) == 0)
+    {
+        char *rest;
+        condition->a = strtod(text + 8, &rest);
+        if (rest != text + 8 && parse_number(rest, &condition->b))
+            condition->op = TEMPORAL_COND_BETWEEN;
+    }
+    else if (strncmp(text, "stable ", 7) == 0)
+    {
+        if (parse_number(text + 7, &condition->a))
+            condition->op = TEMPORAL_COND_STABLE;
+    }
+    else if (strcmp(text, "increasing") == 0)
+        condition->op = TEMPORAL_COND_INCREASING;
+    else if (strncmp(text, "==", 2) == 0)
+    {
+        if (parse_number(text + 2, &condition->a))
+            condition->op = TEMPORAL_COND_EQ;
+    }
+    else if (*text == '>' || *text == '<')
+    {
+        if (parse_number(text + 1, &condition->a))
+            condition->op = *text == '>' ? TEMPORAL_COND_GT : TEMPORAL_COND_LT;
+    }
+}
+
+int temporal_count_matches(const TemporalVariable *history, int start, int end, const TemporalCondition *condition)
+{
+    // Dispatch once, then run a tight loop per operator
+    int matches = 0;
+    double a = condition->a, b = condition->b;
+    switch (condition->op)
+    {
+    case TEMPORAL_COND_GT:
+        for (int i = start; i < end; i++)
+            matches += temporal_value(history, i) > a;
+        break;
+    case TEMPORAL_COND_LT:
+        for (int i = start; i < end; i++)
+            matches += temporal_value(history, i) < a;
+        break;
+    case TEMPORAL_COND_EQ:
+        for (int i = start; i < end; i++)
+            matches += temporal_value(history, i) == a;
+        break;
+    case TEMPORAL_COND_BETWEEN:
+        for (int i = start; i < end; i++)
+        {
+            double value = temporal_value(history, i);
+            matches += value >= a && value <= b;
+        }
+        break;
+    default:
+        break;
+    }
+    return matches;
+}
+
+// --- Monotonic deques for window min and max ---
+
+static void deque_init(SampleDeque *deque, int capacity)
+{
+    deque->items = malloc(sizeof(WindowSample) * capacity);
+    deque->head = 0;
+    deque->count = 0;
+    deque->capacity = capacity;
+}
+
+static WindowSample *deque_at(SampleDeque *deque, int i)
+{
+    int slot = deque->head + i;
+    return &deque->items[slot >= deque->capacity ? slot - deque->capacity : slot];
+}
+
+// Drop samples older than first_seq from the front, then every sample from the back
+// that the new one dominates; front() is then the window's min (or max)
+static void deque_push(SampleDeque *deque, WindowSample sample, long long first_seq, int keep_max)
+{
+    while (deque->count > 0 && deque_at(deque, 0)->seq < first_seq)
+    {
+        deque->head = deque->head + 1 == deque->capacity ? 0 : deque->head + 1;
+        deque->count--;
+    }
+    while (deque->count > 0)
+    {
+        double back = deque_at(deque, deque->count - 1)->value;
+        if (keep_max ? back > sample.value : back < sample.value)
+            break;
+        deque->count--;
+    }
+    *deque_at(deque, deque->count++) = sample;
+}
+
+// --- Two heaps split at the median ---
+
+// Total order on samples, so equal values still have a definite side
+static int sample_less(const WindowSample *a, const WindowSample *b)
+{
+    return a->value < b->value || (a->value == b->value && a->seq < b->seq);
+}
+
+// Whether a belongs above b: the larger sample in the low max-heap, the smaller in the high min-heap
+static int heap_above(const WindowSample *a, const WindowSample *b, int max_heap)
+{
+    return max_heap ? sample_less(b, a) : sample_less(a, b);
+}
+
+static void heap_sift_down(SampleHeap *heap, int index, int max_heap)
+{
+    WindowSample sample = heap->items[index];
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= heap->count)
+            break;
+        if (child + 1 < heap->count && heap_above(&heap->items[child + 1], &heap->items[child], max_heap))
+            child++;
+        if (!heap_above(&heap->items[child], &sample, max_heap))
+            break;
+        heap->items[index] = heap->items[child];
+        index = child;
+    }
+    heap->items[index] = sample;
+}
+
+static void sample_heap_push(SampleHeap *heap, WindowSample sample, int max_heap)
+{
+    if (heap->count == heap->capacity)
+    {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : 16;
+        heap->items = realloc(heap->items, sizeof(WindowSample) * heap->capacity);
+    }
+    int index = heap->count++;
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (!heap_above(&sample, &heap->items[parent], max_heap))
+            break;
+        heap->items[index] = heap->items[parent];
+        index = parent;
+    }
+    heap->items[index] = sample;
+}
+
+static WindowSample sample_heap_pop(SampleHeap *heap, int max_heap)
+{
+    WindowSample top = heap->items[0];
+    if (--heap->count > 0)
+    {
+        heap->items[0] = heap->items[heap->count];
+        heap_sift_down(heap, 0, max_heap);
+    }
+    return top;
+}
+
+// Pop expired samples off the top, and rebuild without them once they make up
+// most of the heap so it cannot grow past twice the window
+static void heap_prune(SampleHeap *heap, int live, long long first_seq, int max_heap)
+{
+    while (heap->count > 0 && heap->items[0].seq < first_seq)
+        sample_heap_pop(heap, max_heap);
+    if (heap->count > 2 * live + 16)
+    {
+        int kept = 0;
+        for (int i = 0; i < heap->count; i++)
+            if (heap->items[i].seq >= first_seq)
+                heap->items[kept++] = heap->items[i];
+        heap->count = kept;
+        for (int i = kept / 2 - 1; i >= 0; i--)
+            heap_sift_down(heap, i, max_heap);
+    }
+}
+
+static long long first_seq(const TemporalVariable *history, const TemporalWindow *window)
+{
+    return history->total - window->count;
+}
+
+// Keep low_count equal to high_count or one more, with live tops on both heaps
+static void median_rebalance(TemporalVariable *history, TemporalWindow *window)
+{
+    long long first = first_seq(history, window);
+    heap_prune(&window->low, window->low_count, first, 1);
+    heap_prune(&window->high, window->high_count, first, 0);
+    while (window->low_count > window->high_count + 1)
+    {
+        sample_heap_push(&window->high, sample_heap_pop(&window->low, 1), 0);
+        window->low_count--;
+        window->high_count++;
+        heap_prune(&window->low, window->low_count, first, 1);
+    }
+    while (window->high_count > window->low_count)
+    {
+        sample_heap_push(&window->low, sample_heap_pop(&window->high, 0), 1);
+        window->high_count--;
+        window->low_count++;
+        heap_prune(&window->high, window->high_count, first, 0);
+    }
+}
+
+static void median_add(TemporalVariable *history, TemporalWindow *window, WindowSample sample)
+{
+    if (window->low.count == 0 || !sample_less(&window->low.items[0], &sample))
+    {
+        sample_heap_push(&window->low, sample, 1);
+        window->low_count++;
+    }
+    else
+    {
+        sample_heap_push(&window->high, sample, 0);
+        window->high_count++;
+    }
+    median_rebalance(history, window);
+}
+
+// The sample itself stays in its heap until it reaches the top
+static void median_remove(TemporalWindow *window, WindowSample sample)
+{
+    // Every sample in low orders at or below low's top, expired or not
+    if (window->low.count > 0 && !sample_less(&window->low.items[0], &sample))
+        window->low_count--;
+    else
+        window->high_count--;
+}
+
+static void median_build(TemporalVariable *history, TemporalWindow *window)
+{
+    window->has_median = 1;
+    for (int i = history->count - window->count; i < history->count; i++)
+    {
+        WindowSample sample = {temporal_value(history, i), history->total - history->count + i};
+        median_add(history, window, sample);
+    }
+}
+
+// --- Window trackers ---
+
+// Recompute the running sum and Welford values from the stored samples, which
+// keeps rounding error from add/remove updates from building up
+static void window_reseed(TemporalVariable *history, TemporalWindow *window)
+{
+    window->sum = 0;
+    window->mean = 0;
+    window->m2 = 0;
+    for (int i = history->count - window->count, n = 1; i < history->count; i++, n++)
+    {
+        double value = temporal_value(history, i);
+        double delta = value - window->mean;
+        window->sum += value;
+        window->mean += delta / n;
+        window->m2 += delta * (value - window->mean);
+    }
+    window->since_reseed = 0;
+}
+
+static void window_remove(TemporalVariable *history, TemporalWindow *window, double value)
+{
+    long long seq = history->total - 1 - window->count;
+    window->count--;
+    window->sum -= value;
+    if (window->count == 0)
+    {
+        window->mean = 0;
+        window->m2 = 0;
+    }
+    else
+    {
+        double delta = value - window->mean;
+        window->mean -= delta / window->count;
+        window->m2 -= delta * (value - window->mean);
+    }
+    if (window->has_median)
+    {
+        WindowSample sample = {value, seq};
+        median_remove(window, sample);
+    }
+    window->since_reseed++;
+}
+
+static void window_add(TemporalVariable *history, TemporalWindow *window, double value)
+{
+    window->count++;
+    double delta = value - window->mean;
+    window->sum += value;
+    window->mean += delta / window->count;
+    window->m2 += delta * (value - window->mean);
+
+    WindowSample sample = {value, history->total - 1};
+    long long first = first_seq(history, window);
+    deque_push(&window->min_deque, sample, first, 0);
+    deque_push(&window->max_deque, sample, first, 1);
+    if (window->has_median)
+        median_add(history, window, sample);
+
+    if (window->since_reseed >= window->size)
+        window_reseed(history, window);
+}
+
+static TemporalWindow *window_new(TemporalVariable *history, int size)
+{
+    TemporalWindow *window = calloc(1, sizeof(TemporalWindow));
+    window->size = size;
+    window->count = history->count < size ? history->count : size;
+    deque_init(&window->min_deque, size);
+    deque_init(&window->max_deque, size);
+    long long first = first_seq(history, window);
+    for (int i = history->count - window->count; i < history->count; i++)
+    {
+        WindowSample sample = {temporal_value(history, i), first + i - (history->count - window->count)};
+        deque_push(&window->min_deque, sample, first, 0);
+        deque_push(&window->max_deque, sample, first, 1);
+    }
+    window_reseed(history, window);
+    return window;
+}
+
+static void window_free(TemporalWindow *window)
+{
+    free(window->min_deque.items);
+    free(window->max_deque.items);
+    free(window->low.items);
+    free(window->high.items);
+    free(window);
+}
+
+// Tracker for a window size, registering one on first use; NULL when all are taken
+static TemporalWindow *find_window(TemporalVariable *history, int size)
+{
+    for (int i = 0; i < history->window_count; i++)
+        if (history->windows[i]->size == size)
+            return history->windows[i];
+    if (history->window_count == TEMPORAL_MAX_WINDOWS)
+        return NULL;
+    TemporalWindow *window = window_new(history, size);
+    history->windows[history->window_count++] = window;
+    return window;
+}
+
+// --- Pattern detectors ---
+
+// Smoothing of the baseline the CUSUM sums are measured against
+#define CUSUM_BASELINE_ALPHA 0.1
+
+// 1 if curr rose from prev by more than threshold percent, -1 if it fell as far
+static int trend_step(double threshold, double prev, double curr)
+{
+    double change = (curr - prev) / (prev == 0 ? 1 : prev) * 100;
+    return change > threshold ? 1 : change < -threshold ? -1 : 0;
+}
+
+// Whether b is a peak or a valley between a and c
+static int is_turn(double a, double b, double c)
+{
+    return (b > a && b > c) || (b < a && b < c);
+}
+
+static void count_pair(TemporalDetector *detector, double prev, double curr, int sign)
+{
+    int step = trend_step(detector->threshold, prev, curr);
+    if (step > 0)
+        detector->up += sign;
+    else if (step < 0)
+        detector->down += sign;
+}
+
+static void anomaly_reseed(TemporalVariable *history, TemporalDetector *detector)
+{
+    detector->sum = 0;
+    detector->mean = 0;
+    detector->m2 = 0;
+    for (int i = 0; i < history->count; i++)
+    {
+        double value = temporal_value(history, i);
+        double delta = value - detector->mean;
+        detector->sum += value;
+        detector->mean += delta / (i + 1);
+        detector->m2 += delta * (value - detector->mean);
+    }
+    detector->count = history->count;
+    detector->since_reseed = 0;
+}
+
+// Move an exponentially weighted mean and variance toward value; returns the
+// z-score of value against them as they were before it
+static double ewma_step(double alpha, double *ewma, double *ewmv, double value)
+{
+    double deviation = sqrt(*ewmv);
+    double diff = value - *ewma;
+    *ewma += alpha * diff;
+    *ewmv = (1 - alpha) * (*ewmv + alpha * diff * diff);
+    return diff / (deviation == 0 ? 1 : deviation);
+}
+
+// Feed the sample just written. count is the history length after the write and
+// newest[0], newest[1] the samples that were newest before it
+static void detector_add(TemporalVariable *history, TemporalDetector *detector, double value, int count,
+                         const double *newest)
+{
+    switch (detector->spec.pattern)
+    {
+    case TEMPORAL_TREND:
+        if (count >= 2)
+            count_pair(detector, newest[0], value, 1);
+        break;
+    case TEMPORAL_CYCLE:
+        if (count >= 3)
+            detector->turns += is_turn(newest[1], newest[0], value);
+        break;
+    case TEMPORAL_ANOMALY:
+    {
+        detector->count++;
+        double delta = value - detector->mean;
+        detector->sum += value;
+        detector->mean += delta / detector->count;
+        detector->m2 += delta * (value - detector->mean);
+        if (detector->since_reseed >= history->max_history)
+            anomaly_reseed(history, detector);
+        break;
+    }
+    case TEMPORAL_EWMA:
+    case TEMPORAL_CUSUM:
+    {
+        if (detector->seen == 0)
+        {
+            detector->ewma = value;
+            break;
+        }
+        double alpha = detector->spec.pattern == TEMPORAL_EWMA ? detector->spec.a : CUSUM_BASELINE_ALPHA;
+        detector->z = ewma_step(alpha, &detector->ewma, &detector->ewmv, value);
+        double slack = detector->spec.a;
+        detector->high = fmax(0, detector->high + detector->z - slack);
+        detector->low = fmax(0, detector->low - detector->z - slack);
+        break;
+    }
+    case TEMPORAL_HOLT:
+    {
+        double alpha = detector->spec.a, beta = detector->spec.b;
+        if (detector->seen == 0)
+        {
+            detector->level = value;
+        }
+        else if (detector->seen == 1)
+        {
+            detector->slope = value - detector->level;
+            detector->level = value;
+        }
+        else
+        {
+            double level = alpha * value + (1 - alpha) * (detector->level + detector->slope);
+            detector->slope = beta * (level - detector->level) + (1 - beta) * detector->slope;
+            detector->level = level;
+        }
+        break;
+    }
+    }
+    detector->seen++;
+}
+
+// Forget the oldest sample as it drops out of a full history of count samples;
+// oldest[0..2] are the three oldest. The smoothed detectors keep their state
+static void detector_remove(TemporalDetector *detector, int count, const double *oldest)
+{
+    switch (detector->spec.pattern)
+    {
+    case TEMPORAL_TREND:
+        if (count >= 2)
+            count_pair(detector, oldest[0], oldest[1], -1);
+        break;
+    case TEMPORAL_CYCLE:
+        if (count >= 3)
+            detector->turns -= is_turn(oldest[0], oldest[1], oldest[2]);
+        break;
+    case TEMPORAL_ANOMALY:
+    {
+        double value = oldest[0];
+        detector->count--;
+        detector->sum -= value;
+        if (detector->count == 0)
+        {
+            detector->mean = 0;
+            detector->m2 = 0;
+        }
+        else
+        {
+            double delta = value - detector->mean;
+            detector->mean -= delta / detector->count;
+            detector->m2 -= delta * (value - detector->mean);
+        }
+        detector->since_reseed++;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Set up a detector by replaying the history through it
+static void detector_init(TemporalDetector *detector, TemporalVariable *history, const TemporalPatternSpec *spec,
+                          double threshold)
+{
+    memset(detector, 0, sizeof(TemporalDetector));
+    detector->spec = *spec;
+    detector->threshold = spec->pattern == TEMPORAL_TREND ? threshold : 0;
+    for (int i = 0; i < history->count; i++)
+    {
+        double newest[2] = {i >= 1 ? temporal_value(history, i - 1) : 0, i >= 2 ? temporal_value(history, i - 2) : 0};
+        detector_add(history, detector, temporal_value(history, i), i + 1, newest);
+    }
+}
+
+// Detector for a setup, attaching one on first use; NULL when all are taken
+static TemporalDetector *find_detector(TemporalVariable *history, const TemporalPatternSpec *spec, double threshold)
+{
+    if (spec->pattern != TEMPORAL_TREND)
+        threshold = 0;
+    for (int i = 0; i < history->detector_count; i++)
+    {
+        TemporalDetector *detector = history->detectors[i];
+        if (detector->spec.pattern == spec->pattern && detector->spec.a == spec->a &&
+            detector->spec.b == spec->b && detector->threshold == threshold)
+            return detector;
+    }
+    if (history->detector_count == TEMPORAL_MAX_DETECTORS)
+        return NULL;
+    TemporalDetector *detector = malloc(sizeof(TemporalDetector));
+    detector_init(detector, history, spec, threshold);
+    history->detectors[history->detector_count++] = detector;
+    return detector;
+}
+
+int temporal_pattern(TemporalVariable *history, const TemporalPatternSpec *spec, double threshold)
+{
+    // Past the attached detectors, replay the history into a throwaway one
+    TemporalDetector scratch;
+    TemporalDetector *detector = find_detector(history, spec, threshold);
+    if (!detector)
+    {
+        detector_init(&scratch, history, spec, threshold);
+        detector = &scratch;
+    }
+
+    int count = history->count;
+    switch (spec->pattern)
+    {
+    case TEMPORAL_TREND:
+        return detector->up > detector->down ? 1 : detector->down > detector->up ? -1 : 0;
+    case TEMPORAL_CYCLE:
+    {
+        if (count < 4)
+            return 0;
+        // The triple ending at the newest sample is not counted
+        int turns = detector->turns - is_turn(temporal_value(history, count - 3), temporal_value(history, count - 2),
+                                              temporal_value(history, count - 1));
+        return turns >= 2 ? 1 : 0;
+    }
+    case TEMPORAL_ANOMALY:
+    {
+        if (count == 0)
+            return 0;
+        double deviation = detector->m2 > 0 ? sqrt(detector->m2 / detector->count) : 0;
+        double z = (temporal_value(history, count - 1) - detector->mean) / (deviation == 0 ? 1 : deviation);
+        return fabs(z) > threshold ? 1 : 0;
+    }
+    case TEMPORAL_EWMA:
+        return detector->z > threshold ? 1 : detector->z < -threshold ? -1 : 0;
+    case TEMPORAL_CUSUM:
+        if (detector->high > threshold && detector->high >= detector->low)
+            return 1;
+        return detector->low > threshold ? -1 : 0;
+    default:
+    {
+        double change = detector->slope / (detector->level == 0 ? 1 : fabs(detector->level)) * 100;
+        return change > threshold ? 1 : change < -threshold ? -1 : 0;
+    }
+    }
+}
+
+// --- Triggers ---
+
+// Baseline smoothing for "anomaly z" without an alpha
+#define TRIGGER_ANOMALY_ALPHA 0.1
+
+int temporal_parse_trigger(const char *text, TemporalTriggerSpec *spec)
+{
+    static const char *const names[] = {"band", "rate", "anomaly"};
+    char name[16];
+    int used = 0;
+    if (sscanf(text, " %15[a-z]%n", name, &used) != 1)
+        return 0;
+    int kind = index_of(names, 3, name);
+    if (kind < 0)
+        return 0;
+
+    memset(spec, 0, sizeof(TemporalTriggerSpec));
+    spec->kind = (TemporalTriggerKind)kind;
+    spec->b = kind == TEMPORAL_TRIGGER_ANOMALY ? TRIGGER_ANOMALY_ALPHA : 0;
+    const char *rest = text + used;
+    char *end;
+    spec->a = strtod(rest, &end);
+    if (end == rest)
+        return 0;
+    rest = end;
+    if (kind == TEMPORAL_TRIGGER_RATE && *rest == '/')
+    {
+        // "5/s" means 5 per 1s
+        char duration[32];
+        snprintf(duration, sizeof(duration), "%s%s", isalpha((unsigned char)rest[1]) ? "1" : "", rest + 1);
+        int has_unit;
+        if (!temporal_parse_duration(duration, &spec->per_ns, &has_unit) || !has_unit || spec->per_ns <= 0)
+            return 0;
+        rest += strlen(rest);
+    }
+    else if (kind != TEMPORAL_TRIGGER_RATE)
+    {
+        double value = strtod(rest, &end);
+        if (end == rest && kind == TEMPORAL_TRIGGER_BAND)
+            return 0;
+        if (end != rest)
+            spec->b = value;
+        rest = end;
+    }
+    while (isspace((unsigned char)*rest))
+        rest++;
+    if (*rest != '\0')
+        return 0;
+
+    if (kind == TEMPORAL_TRIGGER_BAND)
+        return spec->a <= spec->b;
+    if (kind == TEMPORAL_TRIGGER_ANOMALY)
+        return spec->a >= 0 && spec->b > 0 && spec->b <= 1;
+    return spec->a >= 0;
+}
+
+// Feed a sample; with notify, a change of state flags the trigger
+static void trigger_add(TemporalTrigger *trigger, double value, long long time, int notify)
+{
+    if (temporal_missing(value))
+        return;
+    const TemporalTriggerSpec *spec = &trigger->spec;
+    int state = trigger->state;
+    switch (spec->kind)
+    {
+    case TEMPORAL_TRIGGER_BAND:
+        state = value < spec->a ? -1 : value > spec->b ? 1 : 0;
+        break;
+    case TEMPORAL_TRIGGER_RATE:
+        if (trigger->seen > 0)
+        {
+            double change = value - trigger->last;
+            if (spec->per_ns > 0)
+            {
+                long long elapsed = time - trigger->last_time;
+                change *= (double)spec->per_ns / (double)(elapsed > 0 ? elapsed : 1);
+            }
+            state = change > spec->a ? 1 : change < -spec->a ? -1 : 0;
+        }
+        trigger->last = value;
+        trigger->last_time = time;
+        break;
+    case TEMPORAL_TRIGGER_ANOMALY:
+        if (trigger->seen == 0)
+        {
+            trigger->ewma = value;
+        }
+        else
+        {
+            // No z-score means anything until the baseline has some spread
+            int ready = trigger->ewmv > 0;
+            double z = ewma_step(spec->b, &trigger->ewma, &trigger->ewmv, value);
+            state = !ready ? 0 : z > spec->a ? 1 : z < -spec->a ? -1 : 0;
+        }
+        break;
+    }
+    trigger->seen++;
+    if (notify && state != trigger->state)
+    {
+        trigger->fired = 1;
+        trigger->value = value;
+    }
+    trigger->state = state;
+}
+
+// Reset a trigger and replay the history through it without firing
+static void trigger_arm(TemporalVariable *history, TemporalTrigger *trigger)
+{
+    TemporalTriggerSpec spec = trigger->spec;
+    char callback[sizeof(trigger->callback)];
+    memcpy(callback, trigger->callback, sizeof(callback));
+    memset(trigger, 0, sizeof(TemporalTrigger));
+    trigger->spec = spec;
+    memcpy(trigger->callback, callback, sizeof(callback));
+    for (int i = 0; i < history->count; i++)
+        trigger_add(trigger, temporal_value(history, i), temporal_time(history, i), 0);
+}
+
+// Index of the trigger with this setup and callback, or -1
+static int find_trigger(TemporalVariable *history, const TemporalTriggerSpec *spec, const char *callback)
+{
+    for (int i = 0; i < history->trigger_count; i++)
+    {
+        TemporalTrigger *trigger = history->triggers[i];
+        if (trigger->spec.kind == spec->kind && trigger->spec.a == spec->a && trigger->spec.b == spec->b &&
+            trigger->spec.per_ns == spec->per_ns && strcmp(trigger->callback, callback) == 0)
+            return i;
+    }
+    return -1;
+}
+
+TemporalTrigger *temporal_add_trigger(TemporalVariable *history, const TemporalTriggerSpec *spec,
+                                      const char *callback)
+{
+    int existing = find_trigger(history, spec, callback);
+    if (existing >= 0)
+        return history->triggers[existing];
+    if (history->trigger_count == TEMPORAL_MAX_TRIGGERS)
+        return NULL;
+    TemporalTrigger *trigger = calloc(1, sizeof(TemporalTrigger));
+    trigger->spec = *spec;
+    strncpy(trigger->callback, callback, sizeof(trigger->callback) - 1);
+    trigger_arm(history, trigger);
+    history->triggers[history->trigger_count++] = trigger;
+    return trigger;
+}
+
+int temporal_remove_trigger(TemporalVariable *history, const TemporalTriggerSpec *spec, const char *callback)
+{
+    int index = find_trigger(history, spec, callback);
+    if (index < 0)
+        return 0;
+    // A pending firing goes with it; the rest keep their order
+    free(history->triggers[index]);
+    history->trigger_count--;
+    memmove(&history->triggers[index], &history->triggers[index + 1],
+            sizeof(TemporalTrigger *) * (history->trigger_count - index));
+    return 1;
+}
+
+TemporalTrigger *temporal_next_fired(TemporalVariable *history)
+{
+    for (int i = 0; i < history->trigger_count; i++)
+    {
+        if (history->triggers[i]->fired)
+        {
+            history->triggers[i]->fired = 0;
+            return history->triggers[i];
+        }
+    }
+    return NULL;
+}
+
+// --- Correlation ---
+
+#define CORRELATION_MAX_THREADS 8
+// Multiply-adds below which starting threads costs more than it saves
+#define CORRELATION_THREAD_WORK (1L << 22)
+
+// Pearson's r from sums over n pairs; 0 when either side has no variance
+static double pearson(double n, double sx, double sy, double sxy, double sxx, double syy)
+{
+    double denominator = (n * sxx - sx * sx) * (n * syy - sy * sy);
+    if (denominator <= 0)
+        return 0;
+    double r = (n * sxy - sx * sy) / sqrt(denominator);
+    return r > 1 ? 1 : r < -1 ? -1 : r;
+}
+
+TemporalCorrelation *temporal_correlation_new(void)
+{
+    return calloc(1, sizeof(TemporalCorrelation));
+}
+
+static void correlation_release(TemporalCorrelation *cache)
+{
+    free(cache->ids);
+    free(cache->totals);
+    free(cache->shift);
+    free(cache->sum);
+    free(cache->sum_sq);
+    free(cache->cross);
+}
+
+void temporal_correlation_free(TemporalCorrelation *cache)
+{
+    if (!cache)
+        return;
+    correlation_release(cache);
+    free(cache);
+}
+
+typedef struct
+{
+    const double *rows;
+    double *cross;
+    int series;
+    int window;
+    int first; // Rows first, first + step, ... so every thread gets long and short rows
+    int step;
+} CrossTask;
+
+static void *cross_rows(void *arg)
+{
+    CrossTask *task = arg;
+    int n = task->series, w = task->window;
+    for (int i = task->first; i < n; i += task->step)
+        for (int j = i; j < n; j++)
+            task->cross[(size_t)i * n + j] = simd_dot(task->rows + (size_t)i * w, task->rows + (size_t)j * w, w);
+    return NULL;
+}
+
+static int correlation_threads(long work)
+{
+    if (work < CORRELATION_THREAD_WORK)
+        return 1;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores < 1 ? 1 : cores > CORRELATION_MAX_THREADS ? CORRELATION_MAX_THREADS : (int)cores;
+}
+
+// Recompute every sum from the windows: pack each window into a row, centre it,
+// then take the dot product of every pair of rows
+static void correlation_reseed(TemporalCorrelation *cache, TemporalVariable **vars)
+{
+    int n = cache->series, w = cache->window;
+    double *rows = malloc(sizeof(double) * n * w);
+    for (int i = 0; i < n; i++)
+    {
+        double *row = rows + (size_t)i * w;
+        copy_range(vars[i], vars[i]->count - w, w, row);
+        cache->shift[i] = simd_sum(row, w) / w;
+        for (int k = 0; k < w; k++)
+            row[k] -= cache->shift[i];
+        cache->sum[i] = simd_sum(row, w);
+    }
+
+    int threads = correlation_threads((long)n * n / 2 * w);
+    if (threads > n)
+        threads = n;
+    pthread_t workers[CORRELATION_MAX_THREADS];
+    CrossTask tasks[CORRELATION_MAX_THREADS];
+    for (int t = 0; t < threads; t++)
+    {
+        tasks[t] = (CrossTask){rows, cache->cross, n, w, t, threads};
+        if (t > 0)
+            pthread_create(&workers[t], NULL, cross_rows, &tasks[t]);
+    }
+    cross_rows(&tasks[0]);
+    for (int t = 1; t < threads; t++)
+        pthread_join(workers[t], NULL);
+
+    for (int i = 0; i < n; i++)
+    {
+        cache->sum_sq[i] = cache->cross[(size_t)i * n + i];
+        cache->totals[i] = vars[i]->total;
+    }
+    cache->since_reseed = 0;
+    free(rows);
+}
+
+// Slide every window forward by advance samples, folding the new samples into the
+// sums and taking out the ones that left
+static void correlation_advance(TemporalCorrelation *cache, TemporalVariable **vars, int advance)
+{
+    int n = cache->series, w = cache->window;
+    double *entering = malloc(sizeof(double) * n * advance);
+    double *leaving = malloc(sizeof(double) * n * advance);
+    for (int i = 0; i < n; i++)
+    {
+        double *in = entering + (size_t)i * advance, *out = leaving + (size_t)i * advance;
+        copy_range(vars[i], vars[i]->count - advance, advance, in);
+        copy_range(vars[i], vars[i]->count - w - advance, advance, out);
+        for (int k = 0; k < advance; k++)
+        {
+            in[k] -= cache->shift[i];
+            out[k] -= cache->shift[i];
+            cache->sum[i] += in[k] - out[k];
+        }
+        cache->totals[i] = vars[i]->total;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        const double *in_i = entering + (size_t)i * advance, *out_i = leaving + (size_t)i * advance;
+        for (int j = i; j < n; j++)
+        {
+            const double *in_j = entering + (size_t)j * advance, *out_j = leaving + (size_t)j * advance;
+            double delta = 0;
+            for (int k = 0; k < advance; k++)
+                delta += in_i[k] * in_j[k] - out_i[k] * out_j[k];
+            cache->cross[(size_t)i * n + j] += delta;
+        }
+        cache->sum_sq[i] = cache->cross[(size_t)i * n + i];
+    }
+    cache->since_reseed += advance;
+    free(entering);
+    free(leaving);
+}
+
+// Samples every series gained since the sums were computed, if the sums can be
+// carried forward; -1 when they have to be recomputed
+static int correlation_advance_by(TemporalCorrelation *cache, TemporalVariable **vars, int series, int window)
+{
+    if (cache->series != series || cache->window != window)
+        return -1;
+    long long advance = vars[0]->total - cache->totals[0];
+    // Sliding costs O(n^2) per sample, so past a few samples start over; the
+    // samples leaving the windows must also still be in the histories
+    if (advance < 0 || advance >= window || cache->since_reseed + advance >= window)
+        return -1;
+    for (int i = 0; i < series; i++)
+    {
+        if (vars[i]->id != cache->ids[i] || vars[i]->total - cache->totals[i] != advance ||
+            vars[i]->count < window + advance)
+            return -1;
+    }
+    return (int)advance;
+}
+
+void temporal_correlation_matrix(TemporalCorrelation *cache, TemporalVariable **vars, int series, int window,
+                                 double *out)
+{
+    for (int i = 0; i < series; i++)
+        if (vars[i]->count < window)
+            window = vars[i]->count;
+    if (window < 2)
+    {
+        memset(out, 0, sizeof(double) * series * series);
+        return;
+    }
+
+    int advance = correlation_advance_by(cache, vars, series, window);
+    if (advance < 0)
+    {
+        if (cache->series != series)
+        {
+            correlation_release(cache);
+            cache->ids = malloc(sizeof(long long) * series);
+            cache->totals = malloc(sizeof(long long) * series);
+            cache->shift = malloc(sizeof(double) * series);
+            cache->sum = malloc(sizeof(double) * series);
+            cache->sum_sq = malloc(sizeof(double) * series);
+            cache->cross = malloc(sizeof(double) * series * series);
+            cache->series = series;
+        }
+        cache->window = window;
+        for (int i = 0; i < series; i++)
+            cache->ids[i] = vars[i]->id;
+        correlation_reseed(cache, vars);
+    }
+    else if (advance > 0)
+    {
+        correlation_advance(cache, vars, advance);
+    }
+
+    for (int i = 0; i < series; i++)
+    {
+        for (int j = i; j < series; j++)
+        {
+            double r = pearson(window, cache->sum[i], cache->sum[j], cache->cross[(size_t)i * series + j],
+                               cache->sum_sq[i], cache->sum_sq[j]);
+            out[(size_t)i * series + j] = r;
+            out[(size_t)j * series + i] = r;
+        }
+    }
+}
+
+int temporal_cross_correlation(const TemporalVariable *a, const TemporalVariable *b, int window, int max_lag,
+                               double *out)
+{
+    if (window > b->count)
+        window = b->count;
+    if (window > a->count)
+        window = a->count;
+    if (window < 2 || max_lag < 0)
+        return 0;
+    if (max_lag > a->count - window)
+        max_lag = a->count - window;
+
+    // x holds a's newest window plus max_lag older samples; both are centred on
+    // their newest window
+    int span = window + max_lag;
+    double *x = malloc(sizeof(double) * span);
+    double *y = malloc(sizeof(double) * window);
+    copy_range(a, a->count - span, span, x);
+    copy_range(b, b->count - window, window, y);
+    double x_shift = simd_sum(x + max_lag, window) / window;
+    double y_shift = simd_sum(y, window) / window;
+    for (int k = 0; k < span; k++)
+        x[k] -= x_shift;
+    for (int k = 0; k < window; k++)
+        y[k] -= y_shift;
+
+    double sy = simd_sum(y, window), syy = simd_dot(y, y, window);
+    for (int lag = 0; lag <= max_lag; lag++)
+    {
+        const double *segment = x + max_lag - lag;
+        out[lag] = pearson(window, simd_sum(segment, window), sy, simd_dot(segment, y, window),
+                           simd_dot(segment, segment, window), syy);
+    }
+    free(x);
+    free(y);
+    return max_lag + 1;
+}
+
+// --- Queries ---
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts values in place
+static double median_of(double *values, long long count)
+{
+    qsort(values, count, sizeof(double), compare_doubles);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2.0;
+}
+
+double temporal_range_stat(const TemporalVariable *history, int start, int end, TemporalStat stat)
+{
+    int count = end - start;
+    if (count <= 0)
+        return 0;
+    switch (stat)
+    {
+    case TEMPORAL_COUNT:
+        return count;
+    case TEMPORAL_FIRST:
+        return temporal_value(history, start);
+    case TEMPORAL_LAST:
+        return temporal_value(history, end - 1);
+    case TEMPORAL_MEDIAN:
+    {
+        double *values = malloc(sizeof(double) * count);
+        copy_range(history, start, count, values);
+        double median = median_of(values, count);
+        free(values);
+        return median;
+    }
+    default:
+        break;
+    }
+    double sum = 0, mean = 0, m2 = 0;
+    double min = temporal_value(history, start), max = min;
+    for (int i = 0; i < count; i++)
+    {
+        double value = temporal_value(history, start + i);
+        double delta = value - mean;
+        sum += value;
+        mean += delta / (i + 1);
+        m2 += delta * (value - mean);
+        if (value < min)
+            min = value;
+        if (value > max)
+            max = value;
+    }
+    switch (stat)
+    {
+    case TEMPORAL_SUM:
+        return sum;
+    case TEMPORAL_MEAN:
+        return sum / count;
+    case TEMPORAL_MIN:
+        return min;
+    case TEMPORAL_MAX:
+        return max;
+    case TEMPORAL_VARIANCE:
+        return m2 / count;
+    case TEMPORAL_STDDEV:
+        return sqrt(m2 / count);
+    default:
+        return max - min;
+    }
+}
+
+double temporal_window_stat(TemporalVariable *history, int window_size, TemporalStat stat)
+{
+    if (history->count == 0)
+        return 0;
+    long long archived = temporal_archived(history);
+    if (window_size <= 0 || window_size > history->max_history)
+    {
+        if (archived > 0)
+        {
+            long long length = archived + history->count;
+            long long count = window_size <= 0 || window_size > length ? length : window_size;
+            return temporal_full_stat(history, length - count, length, stat);
+        }
+        window_size = history->max_history;
+    }
+
+    TemporalWindow *window = find_window(history, window_size);
+    if (!window)
+    {
+        // Past the tracked sizes, fall back to one pass over the window
+        int count = history->count < window_size ? history->count : window_size;
+        return temporal_range_stat(history, history->count - count, history->count, stat);
+    }
+
+    double variance = window->m2 > 0 ? window->m2 / window->count : 0;
+    switch (stat)
+    {
+    case TEMPORAL_SUM:
+        return window->sum;
+    case TEMPORAL_MEAN:
+        return window->sum / window->count;
+    case TEMPORAL_MIN:
+        return deque_at(&window->min_deque, 0)->value;
+    case TEMPORAL_MAX:
+        return deque_at(&window->max_deque, 0)->value;
+    case TEMPORAL_VARIANCE:
+        return variance;
+    case TEMPORAL_STDDEV:
+        return sqrt(variance);
+    case TEMPORAL_RANGE:
+        return deque_at(&window->max_deque, 0)->value - deque_at(&window->min_deque, 0)->value;
+    case TEMPORAL_COUNT:
+        return window->count;
+    case TEMPORAL_FIRST:
+        return temporal_value(history, history->count - window->count);
+    case TEMPORAL_LAST:
+        return temporal_value(history, history->count - 1);
+    default:
+        if (!window->has_median)
+            median_build(history, window);
+        if (window->low_count > window->high_count)
+            return window->low.items[0].value;
+        return (window->low.items[0].value + window->high.items[0].value) / 2.0;
+    }
+}
+
+// --- Archive ---
+
+static void summary_add(TemporalSummary *summary, double value)
+{
+    if (summary->count == 0)
+    {
+        summary->min = value;
+        summary->max = value;
+        summary->first = value;
+    }
+    if (value < summary->min)
+        summary->min = value;
+    if (value > summary->max)
+        summary->max = value;
+    summary->count++;
+    double delta = value - summary->mean;
+    summary->sum += value;
+    summary->mean += delta / summary->count;
+    summary->m2 += delta * (value - summary->mean);
+    summary->last = value;
+}
+
+// Fold in the summary of the samples that follow, combining the variances as
+// Chan et al. do for parallel Welford
+static void summary_merge(TemporalSummary *summary, const TemporalSummary *next)
+{
+    if (next->count == 0)
+        return;
+    if (summary->count == 0)
+    {
+        *summary = *next;
+        return;
+    }
+    double count = (double)(summary->count + next->count);
+    double delta = next->mean - summary->mean;
+    summary->m2 += next->m2 + delta * delta * summary->count * next->count / count;
+    summary->mean += delta * next->count / count;
+    summary->sum += next->sum;
+    if (next->min < summary->min)
+        summary->min = next->min;
+    if (next->max > summary->max)
+        summary->max = next->max;
+    summary->last = next->last;
+    summary->count += next->count;
+}
+
+// Any statistic but the median, which needs the samples themselves
+static double summary_stat(const TemporalSummary *summary, TemporalStat stat)
+{
+    if (summary->count == 0)
+        return 0;
+    switch (stat)
+    {
+    case TEMPORAL_SUM:
+        return summary->sum;
+    case TEMPORAL_MEAN:
+        return summary->sum / summary->count;
+    case TEMPORAL_MIN:
+        return summary->min;
+    case TEMPORAL_MAX:
+        return summary->max;
+    case TEMPORAL_VARIANCE:
+        return summary->m2 / summary->count;
+    case TEMPORAL_STDDEV:
+        return sqrt(summary->m2 / summary->count);
+    case TEMPORAL_COUNT:
+        return summary->count;
+    case TEMPORAL_FIRST:
+        return summary->first;
+    case TEMPORAL_LAST:
+        return summary->last;
+    default:
+        return summary->max - summary->min;
+    }
+}
+
+void temporal_enable_archive(TemporalVariable *history, long long limit)
+{
+    if (history->archive || limit <= 0)
+        return;
+    history->archive = calloc(1, sizeof(TemporalArchive));
+    history->archive->limit = limit;
+}
+
+long long temporal_archived(const TemporalVariable *history)
+{
+    return history->archive ? history->archive->samples : 0;
+}
+
+static TemporalArchiveBlock *archive_block(const TemporalArchive *archive, int i)
+{
+    int slot = archive->head + i;
+    return &archive->blocks[slot >= archive->capacity ? slot - archive->capacity : slot];
+}
+
+size_t temporal_archive_bytes(const TemporalVariable *history)
+{
+    const TemporalArchive *archive = history->archive;
+    if (!archive)
+        return 0;
+    size_t bytes = sizeof(TemporalArchive) + sizeof(TemporalArchiveBlock) * archive->capacity;
+    for (int i = 0; i < archive->count; i++)
+        bytes += gorilla_bytes(&archive_block(archive, i)->data);
+    return bytes;
+}
+
+static void archive_free(TemporalArchive *archive)
+{
+    for (int i = 0; i < archive->count; i++)
+        gorilla_free(&archive_block(archive, i)->data);
+    free(archive->blocks);
+    free(archive);
+}
+
+// Compress a sample leaving the buffer into the newest block, starting a new one
+// when it is full and dropping the oldest once the rest cover the limit
+static void archive_append(TemporalArchive *archive, double value, long long time)
+{
+    if (archive->count == 0 || archive_block(archive, archive->count - 1)->summary.count == TEMPORAL_ARCHIVE_BLOCK)
+    {
+        if (archive->count > 0)
+            gorilla_seal(&archive_block(archive, archive->count - 1)->data);
+        if (archive->count == archive->capacity)
+        {
+            int capacity = archive->capacity ? archive->capacity * 2 : 4;
+            TemporalArchiveBlock *blocks = malloc(sizeof(TemporalArchiveBlock) * capacity);
+            for (int i = 0; i < archive->count; i++)
+                blocks[i] = *archive_block(archive, i);
+            free(archive->blocks);
+            archive->blocks = blocks;
+            archive->head = 0;
+            archive->capacity = capacity;
+        }
+        TemporalArchiveBlock *block = archive_block(archive, archive->count++);
+        gorilla_init(&block->data);
+        memset(&block->summary, 0, sizeof(TemporalSummary));
+    }
+
+    // Times are kept to the microsecond, which the encoding's buckets are sized for
+    TemporalArchiveBlock *block = archive_block(archive, archive->count - 1);
+    gorilla_append(&block->data, time / 1000, value);
+    summary_add(&block->summary, value);
+    block->last_time = time / 1000 * 1000;
+    archive->samples++;
+
+    while (archive->count > 1 && archive->samples - archive_block(archive, 0)->summary.count >= archive->limit)
+    {
+        TemporalArchiveBlock *oldest = archive_block(archive, 0);
+        archive->samples -= oldest->summary.count;
+        gorilla_free(&oldest->data);
+        archive->head = archive->head + 1 == archive->capacity ? 0 : archive->head + 1;
+        archive->count--;
+    }
+}
+
+// Decompress block i into values and times (either may be NULL); returns its count
+static int archive_decode(const TemporalArchive *archive, int i, double *values, long long *times)
+{
+    GorillaReader reader;
+    gorilla_reader_init(&reader, &archive_block(archive, i)->data);
+    int64_t time;
+    double value;
+    int count = 0;
+    while (gorilla_next(&reader, &time, &value))
+    {
+        if (values)
+            values[count] = value;
+        if (times)
+            times[count] = time * 1000;
+        count++;
+    }
+    return count;
+}
+
+// Reads the full history in order, decompressing one archive block at a time.
+// Every block but the newest is full, so sample i lives in block i / TEMPORAL_ARCHIVE_BLOCK
+typedef struct
+{
+    const TemporalVariable *history;
+    long long index;
+    int block; // Block held in values and times, -1 for none
+    double values[TEMPORAL_ARCHIVE_BLOCK];
+    long long times[TEMPORAL_ARCHIVE_BLOCK];
+} ArchiveCursor;
+
+static ArchiveCursor *cursor_new(const TemporalVariable *history, long long start)
+{
+    ArchiveCursor *cursor = malloc(sizeof(ArchiveCursor));
+    cursor->history = history;
+    cursor->index = start;
+    cursor->block = -1;
+    return cursor;
+}
+
+static void cursor_next(ArchiveCursor *cursor, double *value, long long *time)
+{
+    const TemporalVariable *history = cursor->history;
+    long long archived = temporal_archived(history);
+    long long i = cursor->index++;
+    if (i >= archived)
+    {
+        *value = temporal_value(history, (int)(i - archived));
+        *time = temporal_time(history, (int)(i - archived));
+        return;
+    }
+    int block = (int)(i / TEMPORAL_ARCHIVE_BLOCK);
+    if (block != cursor->block)
+    {
+        archive_decode(history->archive, block, cursor->values, cursor->times);
+        cursor->block = block;
+    }
+    *value = cursor->values[i % TEMPORAL_ARCHIVE_BLOCK];
+    *time = cursor->times[i % TEMPORAL_ARCHIVE_BLOCK];
+}
+
+// First sample of the full history written at or after time
+static long long full_lower_bound(const TemporalVariable *history, long long time)
+{
+    const TemporalArchive *archive = history->archive;
+    long long archived = temporal_archived(history);
+    if (archived == 0 || time > archive_block(archive, archive->count - 1)->last_time)
+        return archived + lower_bound(history, time);
+
+    // The first block that reaches time, then a search inside it
+    int low = 0, high = archive->count - 1;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (archive_block(archive, mid)->last_time < time)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    long long times[TEMPORAL_ARCHIVE_BLOCK];
+    int count = archive_decode(archive, low, NULL, times);
+    int first = 0;
+    while (first < count && times[first] < time)
+        first++;
+    return (long long)low * TEMPORAL_ARCHIVE_BLOCK + first;
+}
+
+void temporal_span_range(const TemporalVariable *history, const TemporalSpan *span, long long *start,
+                         long long *end)
+{
+    long long length = temporal_archived(history) + history->count;
+    if (span->kind == TEMPORAL_SPAN_COUNT)
+    {
+        long long count = span->count <= 0 || span->count > length ? length : span->count;
+        *start = length - count;
+        *end = length;
+        return;
+    }
+    long long now = temporal_now();
+    long long from = bound_time(&span->from, now);
+    long long to = bound_time(&span->to, now);
+    if (from > to)
+    {
+        long long swap = from;
+        from = to;
+        to = swap;
+    }
+    *start = full_lower_bound(history, from);
+    *end = to == LLONG_MAX ? length : full_lower_bound(history, to + 1);
+    if (*end < *start)
+        *end = *start;
+}
+
+double temporal_full_stat(const TemporalVariable *history, long long start, long long end, TemporalStat stat)
+{
+    long long archived = temporal_archived(history);
+    if (start >= archived)
+        return temporal_range_stat(history, (int)(start - archived), (int)(end - archived), stat);
+    if (end <= start)
+        return 0;
+    if (stat == TEMPORAL_MEDIAN)
+    {
+        double *values = malloc(sizeof(double) * (end - start));
+        ArchiveCursor *cursor = cursor_new(history, start);
+        long long time;
+        for (long long i = 0; i < end - start; i++)
+            cursor_next(cursor, &values[i], &time);
+        double median = median_of(values, end - start);
+        free(cursor);
+        free(values);
+        return median;
+    }
+
+    // Whole blocks contribute their summaries; only partly covered ones are decoded
+    const TemporalArchive *archive = history->archive;
+    TemporalSummary summary;
+    memset(&summary, 0, sizeof(summary));
+    for (int b = (int)(start / TEMPORAL_ARCHIVE_BLOCK); b < archive->count; b++)
+    {
+        const TemporalArchiveBlock *block = archive_block(archive, b);
+        long long base = (long long)b * TEMPORAL_ARCHIVE_BLOCK;
+        if (base >= end)
+            break;
+        int from = start > base ? (int)(start - base) : 0;
+        int to = end < base + block->summary.count ? (int)(end - base) : (int)block->summary.count;
+        if (from == 0 && to == block->summary.count)
+        {
+            summary_merge(&summary, &block->summary);
+            continue;
+        }
+        double values[TEMPORAL_ARCHIVE_BLOCK];
+        archive_decode(archive, b, values, NULL);
+        for (int k = from; k < to; k++)
+            summary_add(&summary, values[k]);
+    }
+    for (long long i = archived; i < end; i++)
+        summary_add(&summary, temporal_value(history, (int)(i - archived)));
+    return summary_stat(&summary, stat);
+}
+
+// Matches in a whole block decided from its summary alone, or -1 if it has to be decoded
+static long long block_matches(const TemporalSummary *summary, const TemporalCondition *condition)
+{
+    double a = condition->a, b = condition->b;
+    switch (condition->op)
+    {
+    case TEMPORAL_COND_GT:
+        return summary->min > a ? summary->count : summary->max <= a ? 0 : -1;
+    case TEMPORAL_COND_LT:
+        return summary->max < a ? summary->count : summary->min >= a ? 0 : -1;
+    case TEMPORAL_COND_EQ:
+        if (summary->min == a && summary->max == a)
+            return summary->count;
+        return a < summary->min || a > summary->max ? 0 : -1;
+    case TEMPORAL_COND_BETWEEN:
+        if (summary->min >= a && summary->max <= b)
+            return summary->count;
+        return summary->max < a || summary->min > b ? 0 : -1;
+    default:
+        return 0;
+    }
+}
+
+static int condition_holds(const TemporalCondition *condition, double value)
+{
+    switch (condition->op)
+    {
+    case TEMPORAL_COND_GT:
+        return value > condition->a;
+    case TEMPORAL_COND_LT:
+        return value < condition->a;
+    case TEMPORAL_COND_EQ:
+        return value == condition->a;
+    case TEMPORAL_COND_BETWEEN:
+        return value >= condition->a && value <= condition->b;
+    default:
+        return 0;
+    }
+}
+
+long long temporal_full_count_matches(const TemporalVariable *history, long long start, long long end,
+                                      const TemporalCondition *condition)
+{
+    long long archived = temporal_archived(history);
+    if (end <= start)
+        return 0;
+    long long matches = 0;
+    if (start < archived)
+    {
+        const TemporalArchive *archive = history->archive;
+        for (int b = (int)(start / TEMPORAL_ARCHIVE_BLOCK); b < archive->count; b++)
+        {
+            const TemporalArchiveBlock *block = archive_block(archive, b);
+            long long base = (long long)b * TEMPORAL_ARCHIVE_BLOCK;
+            if (base >= end)
+                break;
+            int from = start > base ? (int)(start - base) : 0;
+            int to = end < base + block->summary.count ? (int)(end - base) : (int)block->summary.count;
+            long long known = from == 0 && to == block->summary.count ? block_matches(&block->summary, condition) : -1;
+            if (known >= 0)
+            {
+                matches += known;
+                continue;
+            }
+            double values[TEMPORAL_ARCHIVE_BLOCK];
+            archive_decode(archive, b, values, NULL);
+            for (int k = from; k < to; k++)
+                matches += condition_holds(condition, values[k]);
+        }
+        start = archived;
+    }
+    if (end > start)
+        matches += temporal_count_matches(history, (int)(start - archived), (int)(end - archived), condition);
+    return matches;
+}
+
+long long temporal_full_downsample(const TemporalVariable *history, long long start, long long end,
+                                   long long bucket_ns, TemporalStat stat, double *out)
+{
+    long long archived = temporal_archived(history);
+    if (start >= archived)
+        return temporal_downsample(history, (int)(start - archived), (int)(end - archived), bucket_ns, stat, out);
+
+    // One pass over the samples, closing a bucket when a sample falls past it
+    ArchiveCursor *cursor = cursor_new(history, start);
+    TemporalSummary summary;
+    double *held = NULL; // The bucket's values, for the median
+    long long held_count = 0, held_capacity = 0;
+    long long buckets = 0, limit = 0;
+    for (long long i = start; i <= end; i++)
+    {
+        double value = 0;
+        long long time = 0;
+        if (i < end)
+            cursor_next(cursor, &value, &time);
+        if (i > start && (i == end || time >= limit))
+            out[buckets++] = stat == TEMPORAL_MEDIAN ? median_of(held, held_count) : summary_stat(&summary, stat);
+        if (i == end)
+            break;
+        if (i == start || time >= limit)
+        {
+            limit = bucket_ns * (bucket_of(time, bucket_ns) + 1);
+            memset(&summary, 0, sizeof(summary));
+            held_count = 0;
+        }
+        if (stat != TEMPORAL_MEDIAN)
+        {
+            summary_add(&summary, value);
+            continue;
+        }
+        if (held_count == held_capacity)
+        {
+            held_capacity = held_capacity ? held_capacity * 2 : 64;
+            held = realloc(held, sizeof(double) * held_capacity);
+        }
+        held[held_count++] = value;
+    }
+    free(held);
+    free(cursor);
+    return buckets;
+}
+
+// --- Persistence ---
+
+// Forget every sample, with the trackers, detectors and archive built on them
+static void history_clear(TemporalVariable *history)
+{
+    if (history->texts)
+    {
+        for (int i = 0; i < history->capacity; i++)
+            free(history->texts[i]);
+        free(history->texts);
+        history->texts = NULL;
+    }
+    for (int i = 0; i < history->window_count; i++)
+        window_free(history->windows[i]);
+    for (int i = 0; i < history->detector_count; i++)
+        free(history->detectors[i]);
+    history->window_count = 0;
+    history->detector_count = 0;
+    if (history->archive)
+    {
+        long long limit = history->archive->limit;
+        archive_free(history->archive);
+        history->archive = NULL;
+        temporal_enable_archive(history, limit);
+    }
+    history->head = 0;
+    history->count = 0;
+    history->total = 0;
+    history->id = next_id++;
+}
+
+long long temporal_persist(TemporalVariable *history, const char *path)
+{
+    if (history->log)
+        temporal_log_close(history->log);
+    history->log = NULL;
+    long long keep = history->max_history;
+    if (history->archive)
+        keep += history->archive->limit + TEMPORAL_ARCHIVE_BLOCK;
+    TemporalLog *log = temporal_log_open(path, keep);
+    if (!log)
+        return -1;
+
+    if (log->count == 0)
+    {
+        for (int i = 0; i < history->count; i++)
+            temporal_log_append(log, temporal_time(history, i), temporal_value(history, i));
+        history->log = log;
+        return 0;
+    }
+
+    // The newest samples go back into the buffer and the ones before them into the
+    // archive, read straight from the mapping
+    history_clear(history);
+    long long now = temporal_now();
+    int count = log->count < history->max_history ? (int)log->count : history->max_history;
+    long long first = log->count - count;
+    long long archived = 0;
+    if (history->archive)
+    {
+        archived = first < history->archive->limit ? first : history->archive->limit;
+        for (long long i = first - archived; i < first; i++)
+        {
+            const TemporalLogRecord *record = temporal_log_record(log, i);
+            archive_append(history->archive, record->value, temporal_log_time(log, record, now));
+        }
+    }
+    if (count > history->capacity)
+    {
+        history->values = realloc(history->values, sizeof(double) * count);
+        history->times = realloc(history->times, sizeof(long long) * count);
+        history->capacity = count;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        const TemporalLogRecord *record = temporal_log_record(log, first + i);
+        history->values[i] = record->value;
+        history->times[i] = temporal_log_time(log, record, now);
+    }
+    history->count = count;
+    history->total = log->count;
+    history->log = log;
+    for (int i = 0; i < history->trigger_count; i++)
+        trigger_arm(history, history->triggers[i]);
+    return archived + count;
+}
+
+// --- Gap filling and resampling ---
+
+int temporal_fill_by_name(const char *name)
+{
+    static const char *const names[] = {"previous", "linear", "spline"};
+    return index_of(names, 3, name);
+}
+
+// Straight line by time from sample a to sample b; the average if they share a time
+static double line_between(const TemporalVariable *history, int a, double va, int b, double vb, int i)
+{
+    long long ta = temporal_time(history, a), tb = temporal_time(history, b);
+    if (tb == ta)
+        return (va + vb) / 2;
+    return va + (vb - va) * (double)(temporal_time(history, i) - ta) / (double)(tb - ta);
+}
+
+// Natural cubic spline through the present samples in out, with times as x,
+// filling the gaps between samples first and last. Samples sharing a time with
+// the knot before them are left out of the knots. Returns 0, leaving out alone,
+// when there are fewer than three knots
+static int fill_spline(const TemporalVariable *history, int first, int last, double *out)
+{
+    int count = last - first + 1;
+    double *x = malloc(sizeof(double) * count);
+    double *y = malloc(sizeof(double) * count);
+    long long origin = 0;
+    int knots = 0;
+    for (int i = first; i <= last; i++)
+    {
+        if (temporal_missing(out[i]))
+            continue;
+        long long time = temporal_time(history, i);
+        if (knots == 0)
+            origin = time;
+        else if ((double)(time - origin) <= x[knots - 1])
+            continue;
+        x[knots] = (double)(time - origin);
+        y[knots++] = out[i];
+    }
+    if (knots < 3)
+    {
+        free(x);
+        free(y);
+        return 0;
+    }
+
+    // Second derivatives m, with m[0] = m[knots - 1] = 0, from the tridiagonal
+    // system solved by the Thomas algorithm
+    double *m = calloc(knots, sizeof(double));
+    double *upper = malloc(sizeof(double) * knots);
+    for (int k = 1; k < knots - 1; k++)
+    {
+        double h0 = x[k] - x[k - 1], h1 = x[k + 1] - x[k];
+        double rhs = 6 * ((y[k + 1] - y[k]) / h1 - (y[k] - y[k - 1]) / h0);
+        double diagonal = 2 * (h0 + h1) - (k > 1 ? h0 * upper[k - 1] : 0);
+        upper[k] = h1 / diagonal;
+        m[k] = (rhs - (k > 1 ? h0 * m[k - 1] : 0)) / diagonal;
+    }
+    for (int k = knots - 3; k >= 1; k--)
+        m[k] -= upper[k] * m[k + 1];
+
+    // Missing samples come in time order, so the interval holding each one is
+    // found by walking forward through the knots
+    int k = 0;
+    for (int i = first; i <= last; i++)
+    {
+        if (!temporal_missing(out[i]))
+            continue;
+        double t = (double)(temporal_time(history, i) - origin);
+        while (k < knots - 2 && x[k + 1] < t)
+            k++;
+        double h = x[k + 1] - x[k], a = x[k + 1] - t, b = t - x[k];
+        out[i] = (m[k] * a * a * a + m[k + 1] * b * b * b) / (6 * h) + (y[k] / h - m[k] * h / 6) * a +
+                 (y[k + 1] / h - m[k + 1] * h / 6) * b;
+    }
+    free(x);
+    free(y);
+    free(m);
+    free(upper);
+    return 1;
+}
+
+int temporal_fill(const TemporalVariable *history, TemporalFill method, double *out)
+{
+    int count = history->count;
+    copy_range(history, 0, count, out);
+
+    // One pass: each gap is filled when the sample closing it is reached. The
+    // spline only needs to know the gaps, so it is fitted afterwards
+    int filled = 0, previous = -1;
+    for (int i = 0; i <= count; i++)
+    {
+        if (i < count && temporal_missing(out[i]))
+            continue;
+        int gap = i - previous - 1;
+        if (gap > 0 && (previous >= 0 || i < count))
+        {
+            filled += gap;
+            for (int j = previous + 1; j < i && method != TEMPORAL_FILL_SPLINE; j++)
+            {
+                if (previous < 0)
+                    out[j] = out[i];
+                else if (i == count || method == TEMPORAL_FILL_PREVIOUS)
+                    out[j] = out[previous];
+                else
+                    out[j] = line_between(history, previous, out[previous], i, out[i], j);
+            }
+        }
+        previous = i;
+    }
+    if (method != TEMPORAL_FILL_SPLINE || filled == 0)
+        return filled;
+
+    // With too few knots for a spline the gaps get straight lines. Either way
+    // nothing is extrapolated: the ends hold the first and last samples
+    int first = 0, last = count - 1;
+    while (temporal_missing(out[first]))
+        first++;
+    while (temporal_missing(out[last]))
+        last--;
+    if (!fill_spline(history, first, last, out))
+    {
+        previous = first;
+        for (int i = first + 1; i <= last; i++)
+        {
+            if (temporal_missing(out[i]))
+                continue;
+            for (int j = previous + 1; j < i; j++)
+                out[j] = line_between(history, previous, out[previous], i, out[i], j);
+            previous = i;
+        }
+    }
+    for (int j = 0; j < first; j++)
+        out[j] = out[first];
+    for (int j = last + 1; j < count; j++)
+        out[j] = out[last];
+    return filled;
+}
+
+double temporal_interpolate(const TemporalVariable *history, int i)
+{
+    double value = temporal_value(history, i);
+    if (!temporal_missing(value))
+        return value;
+    int before = i - 1, after = i + 1;
+    while (before >= 0 && temporal_missing(temporal_value(history, before)))
+        before--;
+    while (after < history->count && temporal_missing(temporal_value(history, after)))
+        after++;
+    if (before < 0 && after >= history->count)
+        return value;
+    if (before < 0)
+        return temporal_value(history, after);
+    if (after >= history->count)
+        return temporal_value(history, before);
+    return line_between(history, before, temporal_value(history, before), after, temporal_value(history, after), i);
+}
+
+long long temporal_grid_size(const TemporalVariable *history, long long bucket_ns)
+{
+    if (history->count == 0)
+        return 0;
+    long long first = temporal_time(history, 0);
+    if (temporal_archived(history) > 0)
+    {
+        long long times[TEMPORAL_ARCHIVE_BLOCK];
+        archive_decode(history->archive, 0, NULL, times);
+        first = times[0];
+    }
+    return bucket_of(temporal_time(history, history->count - 1), bucket_ns) - bucket_of(first, bucket_ns) + 1;
+}
+
+// The bucket being filled, written out when a sample lands past it. Squares are
+// taken about the bucket's first sample, so adding a sample needs no division
+typedef struct
+{
+    long long bucket_ns;
+    long long origin;  // First bucket of the grid
+    long long current; // Grid index of the open bucket, -1 before the first sample
+    long long limit;   // Time the open bucket ends at
+    long long count;
+    double sum, shifted_sum, shifted_squares, min, max, first, last;
+    TemporalStat stat;
+    double *out;
+} Resampler;
+
+static void resample_flush(Resampler *resampler)
+{
+    if (resampler->current < 0)
+        return;
+    double count = (double)resampler->count;
+    TemporalSummary summary = {0};
+    summary.count = resampler->count;
+    summary.sum = resampler->sum;
+    summary.mean = resampler->sum / count;
+    summary.m2 = resampler->shifted_squares - resampler->shifted_sum * resampler->shifted_sum / count;
+    summary.min = resampler->min;
+    summary.max = resampler->max;
+    summary.first = resampler->first;
+    summary.last = resampler->last;
+    resampler->out[resampler->current] = summary_stat(&summary, resampler->stat);
+}
+
+static void resample_run(Resampler *resampler, const double *values, const long long *times, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        double value = values[i];
+        if (temporal_missing(value))
+            continue;
+        if (resampler->current < 0 || times[i] >= resampler->limit)
+        {
+            resample_flush(resampler);
+            long long bucket = bucket_of(times[i], resampler->bucket_ns);
+            resampler->current = bucket - resampler->origin;
+            resampler->limit = resampler->bucket_ns * (bucket + 1);
+            resampler->count = 0;
+            resampler->sum = resampler->shifted_sum = resampler->shifted_squares = 0;
+            resampler->min = resampler->max = resampler->first = value;
+        }
+        double shifted = value - resampler->first;
+        resampler->count++;
+        resampler->sum += value;
+        resampler->shifted_sum += shifted;
+        resampler->shifted_squares += shifted * shifted;
+        resampler->min = value < resampler->min ? value : resampler->min;
+        resampler->max = value > resampler->max ? value : resampler->max;
+        resampler->last = value;
+    }
+}
+
+void temporal_resample(const TemporalVariable *history, long long bucket_ns, TemporalStat stat, double *out)
+{
+    long long size = temporal_grid_size(history, bucket_ns);
+    double missing = missing_value();
+    for (long long i = 0; i < size; i++)
+        out[i] = missing;
+    if (size == 0)
+        return;
+
+    // Archive blocks one at a time, then the buffer as its two runs in the ring
+    Resampler resampler = {0};
+    resampler.bucket_ns = bucket_ns;
+    resampler.current = -1;
+    resampler.stat = stat;
+    resampler.out = out;
+    ArchiveCursor *cursor = cursor_new(history, 0);
+    int blocks = history->archive ? history->archive->count : 0;
+    for (int b = 0; b < blocks; b++)
+    {
+        int count = archive_decode(history->archive, b, cursor->values, cursor->times);
+        if (b == 0)
+            resampler.origin = bucket_of(cursor->times[0], bucket_ns);
+        resample_run(&resampler, cursor->values, cursor->times, count);
+    }
+    free(cursor);
+    if (blocks == 0)
+        resampler.origin = bucket_of(temporal_time(history, 0), bucket_ns);
+    int run = history->capacity - history->head < history->count ? history->capacity - history->head : history->count;
+    resample_run(&resampler, history->values + history->head, history->times + history->head, run);
+    resample_run(&resampler, history->values, history->times, history->count - run);
+    resample_flush(&resampler);
+}
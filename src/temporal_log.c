@@ -0,0 +1,243 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "temporal_log.h"
+
+#define LOG_MAGIC "TSRTLOG1"
+#define LOG_VERSION 1
+// The file grows by doubling, from LOG_MIN_SIZE and by at most LOG_MAX_GROWTH at a time
+#define LOG_MIN_SIZE (64 * 1024)
+#define LOG_MAX_GROWTH (64 * 1024 * 1024)
+
+typedef struct
+{
+    char magic[8];
+    int version;
+    int record_size;
+    long long checkpoint; // Records written when the last checkpoint was taken
+    char reserved[40];
+} LogHeader;
+
+static LogHeader *log_header(const TemporalLog *log)
+{
+    return (LogHeader *)log->map;
+}
+
+static TemporalLogRecord *log_records(const TemporalLog *log)
+{
+    return (TemporalLogRecord *)(log->map + sizeof(LogHeader));
+}
+
+static size_t log_size(long long count)
+{
+    return sizeof(LogHeader) + sizeof(TemporalLogRecord) * (size_t)count;
+}
+
+static long long clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Resize the file to size bytes and map all of it
+static int log_map(TemporalLog *log, size_t size)
+{
+    if (log->map)
+        munmap(log->map, log->mapped);
+    log->map = NULL;
+    log->mapped = 0;
+    if (ftruncate(log->fd, (off_t)size) != 0)
+        return 0;
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+    if (map == MAP_FAILED)
+        return 0;
+    log->map = map;
+    log->mapped = size;
+    return 1;
+}
+
+static void log_release(TemporalLog *log)
+{
+    if (log->map)
+        munmap(log->map, log->mapped);
+    if (log->fd >= 0)
+        close(log->fd);
+    free(log->path);
+    free(log);
+}
+
+// Replace the file with one holding only the newest keep records. The copy is
+// written next to it and renamed over it, so a crash leaves one or the other
+static int log_compact(TemporalLog *log)
+{
+    long long kept = log->count < log->keep ? log->count : log->keep;
+    size_t length = strlen(log->path) + 5;
+    char *temp_path = malloc(length);
+    snprintf(temp_path, length, "%s.tmp", log->path);
+    int fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        free(temp_path);
+        return 0;
+    }
+
+    LogHeader header = *log_header(log);
+    header.checkpoint = kept;
+    const char *data = (const char *)(log_records(log) + (log->count - kept));
+    size_t remaining = sizeof(TemporalLogRecord) * (size_t)kept;
+    int ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+    while (ok && remaining > 0)
+    {
+        ssize_t written = write(fd, data, remaining);
+        ok = written > 0;
+        data += ok ? written : 0;
+        remaining -= ok ? (size_t)written : 0;
+    }
+    if (!ok || fsync(fd) != 0 || rename(temp_path, log->path) != 0)
+    {
+        close(fd);
+        unlink(temp_path);
+        free(temp_path);
+        return 0;
+    }
+    free(temp_path);
+
+    munmap(log->map, log->mapped);
+    log->map = NULL;
+    close(log->fd);
+    log->fd = fd;
+    log->count = kept;
+    log->checkpointed = kept;
+    return log_map(log, log_size(kept));
+}
+
+TemporalLog *temporal_log_open(const char *path, long long keep)
+{
+    TemporalLog *log = calloc(1, sizeof(TemporalLog));
+    log->path = strdup(path);
+    log->keep = keep;
+    log->clock_offset = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC);
+    log->fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (log->fd < 0 || fstat(log->fd, &info) != 0)
+    {
+        int error = errno;
+        log_release(log);
+        errno = error;
+        return NULL;
+    }
+
+    if (info.st_size == 0)
+    {
+        if (!log_map(log, LOG_MIN_SIZE))
+        {
+            int error = errno;
+            log_release(log);
+            errno = error;
+            return NULL;
+        }
+        LogHeader *header = log_header(log);
+        memcpy(header->magic, LOG_MAGIC, sizeof(header->magic));
+        header->version = LOG_VERSION;
+        header->record_size = sizeof(TemporalLogRecord);
+        return log;
+    }
+
+    // Map the file as it is; nothing is read until a record is looked at
+    log->map = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+    if (log->map == MAP_FAILED)
+    {
+        int error = errno;
+        log->map = NULL;
+        log_release(log);
+        errno = error;
+        return NULL;
+    }
+    log->mapped = info.st_size;
+    LogHeader *header = log_header(log);
+    long long capacity = ((long long)log->mapped - (long long)sizeof(LogHeader)) / (long long)sizeof(TemporalLogRecord);
+    if (log->mapped < sizeof(LogHeader) || memcmp(header->magic, LOG_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != LOG_VERSION || header->record_size != (int)sizeof(TemporalLogRecord) ||
+        header->checkpoint < 0 || header->checkpoint > capacity)
+    {
+        log_release(log);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Recover what was written after the last checkpoint: records end at the
+    // zero-filled space left by the last growth, or where times go backwards
+    TemporalLogRecord *records = log_records(log);
+    long long count = header->checkpoint;
+    while (count < capacity && records[count].time != 0 &&
+           (count == 0 || records[count].time >= records[count - 1].time))
+        count++;
+    log->count = count;
+    log->checkpointed = header->checkpoint;
+    if (count != header->checkpoint)
+        temporal_log_checkpoint(log);
+    else if (log->keep > 0 && log->count > 2 * log->keep)
+        log_compact(log);
+    return log;
+}
+
+void temporal_log_checkpoint(TemporalLog *log)
+{
+    if (log->keep > 0 && log->count > 2 * log->keep && log_compact(log))
+        return;
+    // Schedule the records written since the last checkpoint, then the header
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t from = log_size(log->checkpointed) / page * page;
+    msync(log->map + from, log_size(log->count) - from, MS_ASYNC);
+    log_header(log)->checkpoint = log->count;
+    log->checkpointed = log->count;
+    msync(log->map, sizeof(LogHeader), MS_ASYNC);
+}
+
+void temporal_log_append(TemporalLog *log, long long time, double value)
+{
+    if (log_size(log->count + 1) > log->mapped)
+    {
+        size_t growth = log->mapped < LOG_MIN_SIZE ? LOG_MIN_SIZE : log->mapped < LOG_MAX_GROWTH ? log->mapped : LOG_MAX_GROWTH;
+        if (!log_map(log, log->mapped + growth))
+        {
+            perror("Failed to grow temporal log");
+            exit(EXIT_FAILURE);
+        }
+    }
+    TemporalLogRecord *record = &log_records(log)[log->count++];
+    record->time = time + log->clock_offset;
+    record->value = value;
+    if (log->count - log->checkpointed >= TEMPORAL_LOG_CHECKPOINT)
+        temporal_log_checkpoint(log);
+}
+
+void temporal_log_close(TemporalLog *log)
+{
+    log_header(log)->checkpoint = log->count;
+    msync(log->map, log->mapped, MS_SYNC);
+    munmap(log->map, log->mapped);
+    log->map = NULL;
+    if (ftruncate(log->fd, (off_t)log_size(log->count)) != 0)
+        perror("Failed to trim temporal log");
+    log_release(log);
+}
+
+const TemporalLogRecord *temporal_log_record(const TemporalLog *log, long long i)
+{
+    return &log_records(log)[i];
+}
+
+long long temporal_log_time(const TemporalLog *log, const TemporalLogRecord *record, long long now)
+{
+    long long time = record->time - log->clock_offset;
+    return time > now ? now : time;
+}
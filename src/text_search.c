@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "text_search.h"
+#include "simd.h"
+
+// --- One needle ---
+
+void text_needle_init(TextNeedle *needle, const char *bytes, size_t length)
+{
+    needle->bytes = bytes;
+    needle->length = length;
+    for (int c = 0; c < 256; c++)
+        needle->shift[c] = length;
+    for (size_t i = 0; i + 1 < length; i++)
+        needle->shift[(unsigned char)bytes[i]] = length - 1 - i;
+    needle->horspool = 0;
+    needle->misses = 0;
+    needle->covered = 0;
+}
+
+static size_t horspool_find(const TextNeedle *needle, const char *text, size_t last, size_t pos)
+{
+    size_t m = needle->length;
+    unsigned char final = (unsigned char)needle->bytes[m - 1];
+    while (pos <= last)
+    {
+        unsigned char c = (unsigned char)text[pos + m - 1];
+        if (c == final && memcmp(text + pos, needle->bytes, m - 1) == 0)
+            return pos;
+        pos += needle->shift[c];
+    }
+    return TEXT_NONE;
+}
+
+size_t text_find(TextNeedle *needle, const char *text, size_t length, size_t from)
+{
+    size_t m = needle->length;
+    if (from > length || length - from < m)
+        return TEXT_NONE;
+    if (m == 0)
+        return from;
+    if (m == 1)
+    {
+        const char *hit = memchr(text + from, needle->bytes[0], length - from);
+        return hit ? (size_t)(hit - text) : TEXT_NONE;
+    }
+
+    size_t last = length - m; // Last place the needle can start
+    size_t pos = from;
+    while (!needle->horspool)
+    {
+        size_t skipped = simd_find_byte_pair(text + pos, last - pos + 1, (unsigned char)needle->bytes[0],
+                                             (unsigned char)needle->bytes[m - 1], m - 1);
+        pos += skipped;
+        if (pos > last)
+            return TEXT_NONE;
+        if (memcmp(text + pos + 1, needle->bytes + 1, m - 2) == 0)
+            return pos;
+        // A false candidate more often than every 32 bytes means the pair is common
+        // here, and skipping by the needle length will do better
+        needle->covered += skipped + 1;
+        if (++needle->misses > 16 && needle->misses * 32 > needle->covered)
+            needle->horspool = 1;
+        pos++;
+    }
+    return horspool_find(needle, text, last, pos);
+}
+
+// --- Many needles ---
+
+static void *checked_malloc(size_t size)
+{
+    void *p = malloc(size ? size : 1);
+    if (!p)
+    {
+        perror("Failed to allocate text matcher");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+TextMatcher *text_matcher_new(const char *const *needles, const size_t *lengths, int count)
+{
+    TextMatcher *matcher = calloc(1, sizeof(TextMatcher));
+    if (!matcher)
+    {
+        perror("Failed to allocate text matcher");
+        exit(EXIT_FAILURE);
+    }
+    matcher->count = count;
+    matcher->offsets = checked_malloc(sizeof(size_t) * (count + 1));
+    size_t total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        matcher->offsets[i] = total;
+        total += lengths[i];
+    }
+    matcher->offsets[count] = total;
+    matcher->bytes = checked_malloc(total);
+    for (int i = 0; i < count; i++)
+        memcpy(matcher->bytes + matcher->offsets[i], needles[i], lengths[i]);
+
+    // One column per byte that appears in a needle
+    matcher->alphabet = 1;
+    for (size_t i = 0; i < total; i++)
+    {
+        unsigned char c = (unsigned char)matcher->bytes[i];
+        if (!matcher->classes[c])
+            matcher->classes[c] = matcher->alphabet++;
+    }
+
+    // The trie: a needle of length n adds at most n states to the root
+    int capacity = (int)total + 1;
+    int alphabet = matcher->alphabet;
+    matcher->next = checked_malloc(sizeof(int32_t) * (size_t)capacity * alphabet);
+    matcher->output = checked_malloc(sizeof(int) * capacity);
+    matcher->dict = checked_malloc(sizeof(int) * capacity);
+    matcher->same = checked_malloc(sizeof(int) * (count ? count : 1));
+    memset(matcher->next, -1, sizeof(int32_t) * alphabet);
+    matcher->output[0] = -1;
+    matcher->states = 1;
+    matcher->first_byte = -1;
+    int first_bytes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        matcher->same[i] = -1;
+        if (lengths[i] == 0)
+            continue;
+        const unsigned char *bytes = (const unsigned char *)matcher->bytes + matcher->offsets[i];
+        if (!matcher->start[bytes[0]])
+        {
+            matcher->start[bytes[0]] = 1;
+            matcher->first_byte = first_bytes++ ? -1 : bytes[0];
+        }
+        int state = 0;
+        for (size_t j = 0; j < lengths[i]; j++)
+        {
+            int32_t *slot = &matcher->next[(size_t)state * alphabet + matcher->classes[bytes[j]]];
+            if (*slot < 0)
+            {
+                int added = matcher->states++;
+                memset(&matcher->next[(size_t)added * alphabet], -1, sizeof(int32_t) * alphabet);
+                matcher->output[added] = -1;
+                *slot = added;
+            }
+            state = *slot;
+        }
+        // Needles are reported in the order given, so a repeat goes after the first
+        int *tail = &matcher->output[state];
+        while (*tail >= 0)
+            tail = &matcher->same[*tail];
+        *tail = i;
+    }
+
+    // Breadth first, so every state's suffix link is known before its children's:
+    // a child's link is where its parent's link goes on the same byte
+    int *fail = checked_malloc(sizeof(int) * matcher->states);
+    int *queue = checked_malloc(sizeof(int) * matcher->states);
+    int head = 0, tail = 0;
+    fail[0] = 0;
+    matcher->dict[0] = -1;
+    for (int c = 0; c < alphabet; c++)
+    {
+        int32_t *slot = &matcher->next[c];
+        if (*slot < 0)
+        {
+            *slot = 0;
+            continue;
+        }
+        fail[*slot] = 0;
+        matcher->dict[*slot] = -1;
+        queue[tail++] = *slot;
+    }
+    while (head < tail)
+    {
+        int state = queue[head++];
+        int32_t *row = &matcher->next[(size_t)state * alphabet];
+        const int32_t *fail_row = &matcher->next[(size_t)fail[state] * alphabet];
+        for (int c = 0; c < alphabet; c++)
+        {
+            if (row[c] < 0)
+            {
+                row[c] = fail_row[c];
+                continue;
+            }
+            int child = row[c];
+            int link = fail_row[c];
+            fail[child] = link;
+            matcher->dict[child] = matcher->output[link] >= 0 ? link : matcher->dict[link];
+            queue[tail++] = child;
+        }
+    }
+    free(queue);
+    free(fail);
+    return matcher;
+}
+
+void text_matcher_free(TextMatcher *matcher)
+{
+    if (!matcher)
+        return;
+    free(matcher->bytes);
+    free(matcher->offsets);
+    free(matcher->next);
+    free(matcher->output);
+    free(matcher->dict);
+    free(matcher->same);
+    free(matcher);
+}
+
+int text_matcher_same(const TextMatcher *matcher, const char *const *needles, const size_t *lengths, int count)
+{
+    if (matcher->count != count)
+        return 0;
+    for (int i = 0; i < count; i++)
+    {
+        size_t offset = matcher->offsets[i];
+        if (matcher->offsets[i + 1] - offset != lengths[i] ||
+            memcmp(matcher->bytes + offset, needles[i], lengths[i]) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+void text_matcher_scan(const TextMatcher *matcher, const char *text, size_t length, TextMatchFn report, void *ctx)
+{
+    const unsigned char *bytes = (const unsigned char *)text;
+    int alphabet = matcher->alphabet;
+    int state = 0;
+    for (size_t pos = 0; pos < length; pos++)
+    {
+        // At the root only a byte that starts a needle leads anywhere
+        if (state == 0)
+        {
+            if (matcher->first_byte >= 0)
+            {
+                const unsigned char *hit = memchr(bytes + pos, matcher->first_byte, length - pos);
+                if (!hit)
+                    return;
+                pos = hit - bytes;
+            }
+            else
+            {
+                while (pos < length && !matcher->start[bytes[pos]])
+                    pos++;
+                if (pos == length)
+                    return;
+            }
+        }
+        state = matcher->next[(size_t)state * alphabet + matcher->classes[bytes[pos]]];
+        for (int s = matcher->output[state] >= 0 ? state : matcher->dict[state]; s >= 0; s = matcher->dict[s])
+        {
+            for (int i = matcher->output[s]; i >= 0; i = matcher->same[i])
+                report(pos + 1 - (matcher->offsets[i + 1] - matcher->offsets[i]), i, ctx);
+        }
+    }
+}
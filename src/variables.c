@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,9 +23,14 @@ typedef struct
         ASTNode *regex_val; // For regex values
         ASTNode *tree_val; // For tree values
         ASTNode *graph_val; // For graph values
+        ASTNode *persistent_val; // For persistent vector and map values
+        ASTNode *ndarray_val; // For ndarray values
+        ASTNode *heap_val; // For heap values
     } value;
-    int type; // 0=string, 1=list, 2=dict, 3=stack, 4=queue, 5=linked_list, 6=regex, 7=temporal, 8=set, 9=undef, 10=iterator, 11=tree, 12=graph
+    int type; // 0=string, 1=list, 2=dict, 3=stack, 4=queue, 5=linked_list, 6=regex, 7=temporal, 8=set, 9=undef, 10=iterator, 11=tree, 12=graph, 13=persistent, 14=ndarray, 15=heap
     TemporalVariable *temporal_val; // For temporal variables
+    int is_number; // A type 0 value that was stored from a number rather than from text
+    double number_val; // That number exactly; the text is rounded to %g
 } VarEntry;
 
 static VarEntry vars[MAX_VARS];
@@ -66,15 +72,14 @@ void set_variable(const char *name, const char *value)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         else if (entry->type == 7)
-        {
-            // Free temporal variable history
-            for (int i = 0; i < entry->temporal_val->count; i++)
-            {
-                free(entry->temporal_val->history[i].value);
-            }
-            free(entry->temporal_val);
-        }
+            temporal_free(entry->temporal_val);
         else if (entry->type == 0)
             free(entry->value.string_val);
 
@@ -85,6 +90,7 @@ void set_variable(const char *name, const char *value)
             exit(EXIT_FAILURE);
         }
         entry->type = 0;
+        entry->is_number = 0;
         return;
     }
 
@@ -104,9 +110,23 @@ void set_variable(const char *name, const char *value)
         exit(EXIT_FAILURE);
     }
     vars[var_count].type = 0;
+    vars[var_count].is_number = 0;
     var_count++;
 }
 
+void set_number_variable(const char *name, double value)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%g", value);
+    set_variable(name, buf);
+    VarEntry *entry = find_variable(name);
+    if (entry)
+    {
+        entry->is_number = 1;
+        entry->number_val = value;
+    }
+}
+
 void set_list_variable(const char *name, ASTNode *list)
 {
     if (strlen(name) > MAX_VAR_NAME_LEN)
@@ -139,6 +159,12 @@ void set_list_variable(const char *name, ASTNode *list)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         entry->value.list_val = list;
         entry->type = 1;
         return;
@@ -190,6 +216,12 @@ void set_dict_variable(const char *name, ASTNode *dict)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         entry->value.dict_val = dict;
         entry->type = 2;
         return;
@@ -282,6 +314,12 @@ void set_stack_variable(const char *name, ASTNode *stack)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         entry->value.stack_val = stack;
         entry->type = 3;
         return;
@@ -342,6 +380,12 @@ void set_queue_variable(const char *name, ASTNode *queue)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         entry->value.queue_val = queue;
         entry->type = 4;
         return;
@@ -444,6 +488,9 @@ void set_regex_variable(const char *name, ASTNode *regex)
     VarEntry *entry = find_variable(name);
     if (entry)
     {
+        // Running the same assignment again stores the same literal, compiled program and all
+        if (entry->type == 6 && entry->value.regex_val == regex)
+            return;
         if (entry->type == 0)
             free(entry->value.string_val);
         else if (entry->type == 1)
@@ -458,6 +505,12 @@ void set_regex_variable(const char *name, ASTNode *regex)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         entry->value.regex_val = regex;
         entry->type = 6;
         return;
@@ -517,6 +570,14 @@ void set_set_variable(const char *name, ASTNode *set)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
+        else if (entry->type == 8 && entry->value.list_val != set)
+            ast_free(entry->value.list_val);
         entry->value.list_val = set; // Reuse list_val for set
         entry->type = 8; // New type for sets
         return;
@@ -545,6 +606,30 @@ ASTNode *get_set_variable(const char *name)
     return entry->value.list_val;
 }
 
+static TriggerCallbackRunner trigger_callback_runner = NULL;
+
+void set_trigger_callback_runner(TriggerCallbackRunner runner)
+{
+    trigger_callback_runner = runner;
+}
+
+// Run the callback of every trigger the last write moved to a new state, as
+// callback(name, state, value). A callback that writes to the variable again runs
+// the triggers of that write before returning
+static void fire_triggers(const char *name, TemporalVariable *history)
+{
+    TemporalTrigger *trigger;
+    while (history && trigger_callback_runner && (trigger = temporal_next_fired(history)))
+    {
+        ASTNode *args[3] = {ast_new_string(name), ast_new_number(trigger->state), ast_new_number(trigger->value)};
+        trigger_callback_runner(trigger->callback, args, 3);
+        for (int i = 0; i < 3; i++)
+            ast_free(args[i]);
+        // The callback may have replaced the variable
+        history = get_temporal_var_struct(name);
+    }
+}
+
 void set_temporal_variable(const char *name, const char *value, int max_history)
 {
     if (strlen(name) > MAX_VAR_NAME_LEN)
@@ -553,30 +638,12 @@ void set_temporal_variable(const char *name, const char *value, int max_history)
         return;
     }
 
-    if (max_history > MAX_TEMPORAL_HISTORY)
-        max_history = MAX_TEMPORAL_HISTORY;
-
     VarEntry *entry = find_variable(name);
     if (entry && entry->type == 7)
     {
         // Existing temporal variable - add new value to history
-        TemporalVariable *temp_var = entry->temporal_val;
-        
-        // Shift history if at capacity
-        if (temp_var->count >= temp_var->max_history)
-        {
-            free(temp_var->history[0].value);
-            for (int i = 0; i < temp_var->count - 1; i++)
-            {
-                temp_var->history[i] = temp_var->history[i + 1];
-            }
-            temp_var->count--;
-        }
-        
-        // Add new value
-        temp_var->history[temp_var->count].value = strdup(value);
-        temp_var->history[temp_var->count].timestamp = temp_var->count;
-        temp_var->count++;
+        temporal_push_text(entry->temporal_val, value);
+        fire_triggers(name, entry->temporal_val);
         return;
     }
     
@@ -597,6 +664,12 @@ void set_temporal_variable(const char *name, const char *value, int max_history)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
     }
     else
     {
@@ -612,15 +685,23 @@ void set_temporal_variable(const char *name, const char *value, int max_history)
     }
     
     // Initialize temporal variable
-    entry->temporal_val = malloc(sizeof(TemporalVariable));
-    entry->temporal_val->max_history = max_history;
-    entry->temporal_val->count = 1;
-    entry->temporal_val->current_index = 0;
-    entry->temporal_val->history[0].value = strdup(value);
-    entry->temporal_val->history[0].timestamp = 0;
+    entry->temporal_val = temporal_new(max_history);
+    temporal_push_text(entry->temporal_val, value);
     entry->type = 7;
 }
 
+void set_temporal_number(const char *name, double value)
+{
+    VarEntry *entry = find_variable(name);
+    if (!entry || entry->type != 7)
+    {
+        fprintf(stderr, "Variable %s is not a temporal variable\n", name);
+        return;
+    }
+    temporal_push(entry->temporal_val, value);
+    fire_triggers(name, entry->temporal_val);
+}
+
 const char *get_temporal_variable(const char *name, int time_offset)
 {
     VarEntry *entry = find_variable(name);
@@ -643,7 +724,7 @@ const char *get_temporal_variable(const char *name, int time_offset)
         return NULL;
     }
     
-    return temp_var->history[index].value;
+    return temporal_text(temp_var, index);
 }
 
 int get_temporal_variable_count(const char *name)
@@ -692,14 +773,14 @@ void set_undef_variable(const char *name)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         else if (entry->type == 7)
-        {
-            for (int i = 0; i < entry->temporal_val->count; i++)
-            {
-                free(entry->temporal_val->history[i].value);
-            }
-            free(entry->temporal_val);
-        }
+            temporal_free(entry->temporal_val);
         
         entry->type = 9; // UNDEF type
         entry->value.string_val = NULL;
@@ -732,6 +813,21 @@ int is_undef_variable(const char *name)
     return entry->type == 9;
 }
 
+int is_number_variable(const char *name)
+{
+    VarEntry *entry = find_variable(name);
+    return entry && entry->type == 0 && entry->is_number;
+}
+
+int get_number_variable(const char *name, double *value)
+{
+    VarEntry *entry = find_variable(name);
+    if (!entry || entry->type != 0 || !entry->is_number)
+        return 0;
+    *value = entry->number_val;
+    return 1;
+}
+
 // Generator and iterator implementation
 #define MAX_GENERATORS 1000
 static Generator generators[MAX_GENERATORS];
@@ -797,14 +893,14 @@ void set_iterator_variable(const char *name, Iterator *iterator)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         else if (entry->type == 7)
-        {
-            for (int i = 0; i < entry->temporal_val->count; i++)
-            {
-                free(entry->temporal_val->history[i].value);
-            }
-            free(entry->temporal_val);
-        }
+            temporal_free(entry->temporal_val);
         else if (entry->type == 10) // Iterator type
         {
             free_iterator((Iterator*)entry->value.string_val);
@@ -951,6 +1047,12 @@ void set_tree_variable(const char *name, ASTNode *tree)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         else if (entry->type == 11)
             ast_free(entry->value.tree_val);
         else if (entry->type == 12)
@@ -1014,6 +1116,12 @@ void set_graph_variable(const char *name, ASTNode *graph)
             ast_free(entry->value.linked_list_val);
         else if (entry->type == 6)
             ast_free(entry->value.regex_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
         else if (entry->type == 11)
             ast_free(entry->value.tree_val);
         else if (entry->type == 12)
@@ -1044,4 +1152,211 @@ ASTNode *get_graph_variable(const char *name)
         return NULL;
     }
     return entry->value.graph_val;
-}
\ No newline at end of file
+}
+
+void set_persistent_variable(const char *name, ASTNode *collection)
+{
+    if (strlen(name) > MAX_VAR_NAME_LEN)
+    {
+        fprintf(stderr, "Variable name too long: %s\n", name);
+        return;
+    }
+
+    if (collection->type != NODE_PVEC && collection->type != NODE_PMAP)
+    {
+        fprintf(stderr, "Attempt to set non-persistent value as persistent variable\n");
+        return;
+    }
+
+    VarEntry *entry = find_variable(name);
+    if (entry)
+    {
+        if (entry->type == 0)
+            free(entry->value.string_val);
+        else if (entry->type == 1)
+            ast_free(entry->value.list_val);
+        else if (entry->type == 2)
+            ast_free(entry->value.dict_val);
+        else if (entry->type == 3)
+            ast_free(entry->value.stack_val);
+        else if (entry->type == 4)
+            ast_free(entry->value.queue_val);
+        else if (entry->type == 5)
+            ast_free(entry->value.linked_list_val);
+        else if (entry->type == 6)
+            ast_free(entry->value.regex_val);
+        else if (entry->type == 11)
+            ast_free(entry->value.tree_val);
+        else if (entry->type == 12)
+            ast_free(entry->value.graph_val);
+        else if (entry->type == 13 && entry->value.persistent_val != collection)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
+        entry->value.persistent_val = collection;
+        entry->type = 13;
+        return;
+    }
+
+    if (var_count >= MAX_VARS)
+    {
+        fprintf(stderr, "Maximum number of variables (%d) exceeded\n", MAX_VARS);
+        exit(EXIT_FAILURE);
+    }
+
+    strncpy(vars[var_count].name, name, MAX_VAR_NAME_LEN);
+    vars[var_count].name[MAX_VAR_NAME_LEN] = '\0';
+    vars[var_count].value.persistent_val = collection;
+    vars[var_count].type = 13;
+    var_count++;
+}
+
+ASTNode *get_persistent_variable(const char *name)
+{
+    VarEntry *entry = find_variable(name);
+    if (!entry || entry->type != 13)
+    {
+        return NULL;
+    }
+    return entry->value.persistent_val;
+}
+
+void set_ndarray_variable(const char *name, ASTNode *array)
+{
+    if (strlen(name) > MAX_VAR_NAME_LEN)
+    {
+        fprintf(stderr, "Variable name too long: %s\n", name);
+        return;
+    }
+
+    if (array->type != NODE_NDARRAY)
+    {
+        fprintf(stderr, "Attempt to set non-ndarray value as ndarray variable\n");
+        return;
+    }
+
+    VarEntry *entry = find_variable(name);
+    if (entry)
+    {
+        if (entry->type == 0)
+            free(entry->value.string_val);
+        else if (entry->type == 1)
+            ast_free(entry->value.list_val);
+        else if (entry->type == 2)
+            ast_free(entry->value.dict_val);
+        else if (entry->type == 3)
+            ast_free(entry->value.stack_val);
+        else if (entry->type == 4)
+            ast_free(entry->value.queue_val);
+        else if (entry->type == 5)
+            ast_free(entry->value.linked_list_val);
+        else if (entry->type == 6)
+            ast_free(entry->value.regex_val);
+        else if (entry->type == 11)
+            ast_free(entry->value.tree_val);
+        else if (entry->type == 12)
+            ast_free(entry->value.graph_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14 && entry->value.ndarray_val != array)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15)
+            ast_free(entry->value.heap_val);
+        entry->value.ndarray_val = array;
+        entry->type = 14;
+        return;
+    }
+
+    if (var_count >= MAX_VARS)
+    {
+        fprintf(stderr, "Maximum number of variables (%d) exceeded\n", MAX_VARS);
+        exit(EXIT_FAILURE);
+    }
+
+    strncpy(vars[var_count].name, name, MAX_VAR_NAME_LEN);
+    vars[var_count].name[MAX_VAR_NAME_LEN] = '\0';
+    vars[var_count].value.ndarray_val = array;
+    vars[var_count].type = 14;
+    var_count++;
+}
+
+ASTNode *get_ndarray_variable(const char *name)
+{
+    VarEntry *entry = find_variable(name);
+    if (!entry || entry->type != 14)
+    {
+        return NULL;
+    }
+    return entry->value.ndarray_val;
+}
+
+void set_heap_variable(const char *name, ASTNode *heap)
+{
+    if (strlen(name) > MAX_VAR_NAME_LEN)
+    {
+        fprintf(stderr, "Variable name too long: %s\n", name);
+        return;
+    }
+
+    if (heap->type != NODE_HEAP)
+    {
+        fprintf(stderr, "Attempt to set non-heap value as heap variable\n");
+        return;
+    }
+
+    VarEntry *entry = find_variable(name);
+    if (entry)
+    {
+        if (entry->type == 0)
+            free(entry->value.string_val);
+        else if (entry->type == 1)
+            ast_free(entry->value.list_val);
+        else if (entry->type == 2)
+            ast_free(entry->value.dict_val);
+        else if (entry->type == 3)
+            ast_free(entry->value.stack_val);
+        else if (entry->type == 4)
+            ast_free(entry->value.queue_val);
+        else if (entry->type == 5)
+            ast_free(entry->value.linked_list_val);
+        else if (entry->type == 6)
+            ast_free(entry->value.regex_val);
+        else if (entry->type == 11)
+            ast_free(entry->value.tree_val);
+        else if (entry->type == 12)
+            ast_free(entry->value.graph_val);
+        else if (entry->type == 13)
+            ast_free(entry->value.persistent_val);
+        else if (entry->type == 14)
+            ast_free(entry->value.ndarray_val);
+        else if (entry->type == 15 && entry->value.heap_val != heap)
+            ast_free(entry->value.heap_val);
+        entry->value.heap_val = heap;
+        entry->type = 15;
+        return;
+    }
+
+    if (var_count >= MAX_VARS)
+    {
+        fprintf(stderr, "Maximum number of variables (%d) exceeded\n", MAX_VARS);
+        exit(EXIT_FAILURE);
+    }
+
+    strncpy(vars[var_count].name, name, MAX_VAR_NAME_LEN);
+    vars[var_count].name[MAX_VAR_NAME_LEN] = '\0';
+    vars[var_count].value.heap_val = heap;
+    vars[var_count].type = 15;
+    var_count++;
+}
+
+ASTNode *get_heap_variable(const char *name)
+{
+    VarEntry *entry = find_variable(name);
+    if (!entry || entry->type != 15)
+    {
+        return NULL;
+    }
+    return entry->value.heap_val;
+}
@@ -0,0 +1,16 @@
+# Runs one test script and compares what it prints with the .expected file beside it.
+# Called by ctest with -DTESSER=<interpreter> -DSCRIPT=<test>.tesseract
+get_filename_component(dir ${SCRIPT} DIRECTORY)
+get_filename_component(name ${SCRIPT} NAME_WE)
+execute_process(COMMAND ${TESSER} ${SCRIPT}
+                WORKING_DIRECTORY ${dir}
+                OUTPUT_VARIABLE actual
+                ERROR_VARIABLE errors
+                RESULT_VARIABLE status)
+file(READ ${dir}/${name}.expected expected)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "${name} exited with ${status}\n${actual}${errors}")
+endif()
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "${name} output differs\n--- expected\n${expected}--- actual\n${actual}")
+endif()